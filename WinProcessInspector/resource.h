@@ -33,6 +33,22 @@
 
 #define IDM_TOOLS_NETWORK 240
 #define IDM_TOOLS_SYSTEM_INFO 241
+#define IDM_TOOLS_FIND_OBJECT 242
+#define IDM_TOOLS_SCAN_SIGNATURES 243
+#define IDM_TOOLS_DUPLICATE_PAGES 244
+#define IDM_TOOLS_OPEN_MINIDUMP 245
+#define IDM_TOOLS_OPEN_COMPRESSED_DUMP 246
+#define IDM_TOOLS_SCAN_MINIDUMP 247
+#define IDM_TOOLS_MINIDUMP_STRINGS 248
+#define IDM_TOOLS_COMPARE_MINIDUMPS 249
+
+#define IDM_VIEW_GROUP_NONE 250
+#define IDM_VIEW_GROUP_APPCONTAINER 251
+#define IDM_VIEW_GROUP_PACKAGE 252
+#define IDM_VIEW_GROUP_JOB 253
+#define IDM_VIEW_GROUP_SESSION 254
+#define IDM_VIEW_GROUP_USER 255
+#define IDM_VIEW_GROUP_SERVICE 256
 
 #define IDM_CONTEXT_PROPERTIES 301
 #define IDM_CONTEXT_TERMINATE 302
@@ -46,6 +62,11 @@
 #define IDM_CONTEXT_VIEW_COMMANDLINE 310
 
 #define IDC_SEARCH_ONLINE_BUTTON 900
+#define IDC_HANDLE_HISTORY_BUTTON 901
+#define IDC_SHARED_OBJECTS_BUTTON 902
+#define IDC_MEMORY_SUMMARY_BUTTON 903
+#define IDC_MEMORY_STRINGS_BUTTON 904
+#define IDC_MEMORY_COMPARE_BUTTON 905
 
 #define IDD_INJECTION_METHOD 500
 #define IDC_INJECTION_METHOD_LIST 501
@@ -67,6 +88,7 @@
 #define IDC_COLUMN_IMAGEPATH 561
 #define IDC_COLUMN_COMMANDLINE 562
 #define IDC_COLUMN_COMPANY 563
+#define IDC_COLUMN_SERVICES 564
 
 #define IDC_PERFORMANCE_TAB 470
 #define IDC_ENVIRONMENT_TAB 480
@@ -97,5 +119,6 @@
 #define IDA_MAIN_ACCEL 800
 
 #define IDT_REFRESH_TIMER 1000
+#define IDT_HANDLE_SAMPLE_TIMER 1001
 
 #endif // RESOURCE_H
@@ -0,0 +1,326 @@
+#define WIN32_NO_STATUS
+#include <Windows.h>
+#undef WIN32_NO_STATUS
+
+#include <winternl.h>
+#include <ntstatus.h>
+
+#include "AddressSpaceSummary.h"
+#include "HandleWrapper.h"
+#include <tlHelp32.h>
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	typedef NTSTATUS (WINAPI* pNtQueryInformationProcess)(
+		HANDLE ProcessHandle,
+		ULONG ProcessInformationClass,
+		PVOID ProcessInformation,
+		ULONG ProcessInformationLength,
+		PULONG ReturnLength
+	);
+
+	typedef NTSTATUS (WINAPI* pNtQueryInformationThread)(
+		HANDLE ThreadHandle,
+		ULONG ThreadInformationClass,
+		PVOID ThreadInformation,
+		ULONG ThreadInformationLength,
+		PULONG ReturnLength
+	);
+
+	struct ThreadBasicInformation {
+		LONG ExitStatus;
+		PVOID TebBaseAddress;
+		HANDLE UniqueProcess;
+		HANDLE UniqueThread;
+		ULONG_PTR AffinityMask;
+		LONG Priority;
+		LONG BasePriority;
+	};
+
+	const ULONG ProcessBasicInformationClass = 0;
+	const ULONG ProcessWow64InformationClass = 26;
+	const ULONG ThreadBasicInformationClass = 0;
+	const ULONG MaxHeaps = 1024;
+
+	// PEB.NumberOfHeaps and PEB.ProcessHeaps.
+#ifdef _WIN64
+	const ULONG_PTR HeapCountOffset = 0xE8;
+	const ULONG_PTR HeapListOffset = 0xF0;
+	// A WoW64 thread's 32-bit TEB follows its 64-bit one.
+	const ULONG_PTR Teb32Offset = 0x2000;
+#else
+	const ULONG_PTR HeapCountOffset = 0x88;
+	const ULONG_PTR HeapListOffset = 0x90;
+#endif
+	const ULONG_PTR Heap32CountOffset = 0x88;
+	const ULONG_PTR Heap32ListOffset = 0x90;
+
+	template <typename T>
+	bool ReadRemote(HANDLE hProcess, ULONG_PTR address, T& value) {
+		SIZE_T bytesRead = 0;
+		return ReadProcessMemory(hProcess, reinterpret_cast<LPCVOID>(address), &value, sizeof(value), &bytesRead)
+			&& bytesRead == sizeof(value);
+	}
+
+	template <typename Pointer>
+	void ReadHeapList(HANDLE hProcess, ULONG_PTR peb, ULONG_PTR countOffset, ULONG_PTR listOffset, std::vector<ULONG_PTR>& heaps) {
+		ULONG count = 0;
+		Pointer list = 0;
+		if (!ReadRemote(hProcess, peb + countOffset, count) || !ReadRemote(hProcess, peb + listOffset, list) || list == 0) {
+			return;
+		}
+
+		std::vector<Pointer> entries(std::min(count, MaxHeaps));
+		SIZE_T bytesRead = 0;
+		if (entries.empty() || !ReadProcessMemory(hProcess, reinterpret_cast<LPCVOID>(static_cast<ULONG_PTR>(list)),
+			entries.data(), entries.size() * sizeof(Pointer), &bytesRead)) {
+			return;
+		}
+		for (size_t i = 0; i < bytesRead / sizeof(Pointer); ++i) {
+			if (entries[i] != 0) {
+				heaps.push_back(static_cast<ULONG_PTR>(entries[i]));
+			}
+		}
+	}
+
+}
+
+void AddressSpaceSummary::Build(const std::vector<MemoryRegionInfo>& regions, const AddressSpaceHints& hints) {
+	Clear();
+
+	std::vector<std::pair<ULONG_PTR, AllocationKind>> marks;
+	marks.reserve(hints.Heaps.size() + hints.Stacks.size() + hints.Tebs.size() + hints.Pebs.size());
+	for (ULONG_PTR address : hints.Heaps) marks.emplace_back(address, AllocationKind::Heap);
+	for (ULONG_PTR address : hints.Stacks) marks.emplace_back(address, AllocationKind::Stack);
+	for (ULONG_PTR address : hints.Tebs) marks.emplace_back(address, AllocationKind::Teb);
+	for (ULONG_PTR address : hints.Pebs) marks.emplace_back(address, AllocationKind::Peb);
+	std::sort(marks.begin(), marks.end());
+
+	size_t nextHint = 0;
+	AllocationSummary current;
+	bool open = false;
+	for (const auto& region : regions) {
+		if (region.State == MemoryState::Free) {
+			if (open) {
+				Finish(current, marks, nextHint);
+				open = false;
+			}
+
+			// Adjacent free regions form one block.
+			if (!m_Allocations.empty() && m_Allocations.back().Kind == AllocationKind::Free
+				&& m_Allocations.back().AllocationBase + m_Allocations.back().Size == region.BaseAddress) {
+				m_Allocations.back().Size += region.RegionSize;
+				++m_Allocations.back().RegionCount;
+			} else {
+				AllocationSummary block;
+				block.AllocationBase = region.BaseAddress;
+				block.Size = region.RegionSize;
+				block.RegionCount = 1;
+				block.Kind = AllocationKind::Free;
+				m_Allocations.push_back(block);
+				++m_Totals[static_cast<size_t>(AllocationKind::Free)].Allocations;
+			}
+
+			AddressSpaceTotals& freeTotals = m_Totals[static_cast<size_t>(AllocationKind::Free)];
+			freeTotals.Size += region.RegionSize;
+			++freeTotals.Regions;
+			if (m_Allocations.back().Size > m_LargestFree) {
+				m_LargestFree = m_Allocations.back().Size;
+				m_LargestFreeBase = m_Allocations.back().AllocationBase;
+			}
+			continue;
+		}
+
+		if (!open || region.AllocationBase != current.AllocationBase) {
+			if (open) {
+				Finish(current, marks, nextHint);
+			}
+			current = AllocationSummary();
+			current.AllocationBase = region.AllocationBase;
+			current.Kind = region.Type == MemoryType::Image ? AllocationKind::Image
+				: region.Type == MemoryType::Mapped ? AllocationKind::Mapped : AllocationKind::Private;
+			open = true;
+		}
+
+		current.Size = region.BaseAddress + region.RegionSize - current.AllocationBase;
+		if (region.State == MemoryState::Commit) {
+			current.Committed += region.RegionSize;
+		} else if (region.State == MemoryState::Reserve) {
+			current.Reserved += region.RegionSize;
+		}
+		++current.RegionCount;
+	}
+	if (open) {
+		Finish(current, marks, nextHint);
+	}
+}
+
+void AddressSpaceSummary::Clear() {
+	m_Allocations.clear();
+	for (auto& totals : m_Totals) {
+		totals = AddressSpaceTotals();
+	}
+	m_LargestFree = 0;
+	m_LargestFreeBase = 0;
+}
+
+SIZE_T AddressSpaceSummary::GetCommitted() const {
+	SIZE_T committed = 0;
+	for (const auto& totals : m_Totals) {
+		committed += totals.Committed;
+	}
+	return committed;
+}
+
+SIZE_T AddressSpaceSummary::GetReserved() const {
+	SIZE_T reserved = 0;
+	for (const auto& totals : m_Totals) {
+		reserved += totals.Reserved;
+	}
+	return reserved;
+}
+
+void AddressSpaceSummary::Finish(AllocationSummary& allocation, const std::vector<std::pair<ULONG_PTR, AllocationKind>>& hints, size_t& nextHint) {
+	// Hints and allocations both ascend, so each hint is looked at once.
+	// When several land in one allocation the most specific kind wins;
+	// images keep their kind.
+	ULONG_PTR end = allocation.AllocationBase + allocation.Size;
+	while (nextHint < hints.size() && hints[nextHint].first < end) {
+		if (hints[nextHint].first >= allocation.AllocationBase && allocation.Kind != AllocationKind::Image
+			&& hints[nextHint].second > allocation.Kind) {
+			allocation.Kind = hints[nextHint].second;
+		}
+		++nextHint;
+	}
+
+	AddressSpaceTotals& totals = m_Totals[static_cast<size_t>(allocation.Kind)];
+	totals.Size += allocation.Size;
+	totals.Committed += allocation.Committed;
+	totals.Reserved += allocation.Reserved;
+	++totals.Allocations;
+	totals.Regions += allocation.RegionCount;
+	m_Allocations.push_back(allocation);
+}
+
+bool AddressSpaceSummary::CollectHints(DWORD processId, AddressSpaceHints& hints) {
+	hints = AddressSpaceHints();
+
+	HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+	if (!hNtdll) {
+		return false;
+	}
+	pNtQueryInformationProcess NtQueryInformationProcess =
+		reinterpret_cast<pNtQueryInformationProcess>(GetProcAddress(hNtdll, "NtQueryInformationProcess"));
+	pNtQueryInformationThread NtQueryInformationThread =
+		reinterpret_cast<pNtQueryInformationThread>(GetProcAddress(hNtdll, "NtQueryInformationThread"));
+	if (!NtQueryInformationProcess || !NtQueryInformationThread) {
+		return false;
+	}
+
+	HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId));
+	if (!hProcess.IsValid()) {
+		return false;
+	}
+
+	BOOL selfWow64 = FALSE;
+	BOOL targetWow64 = FALSE;
+	IsWow64Process(GetCurrentProcess(), &selfWow64);
+	IsWow64Process(hProcess.Get(), &targetWow64);
+
+	PROCESS_BASIC_INFORMATION pbi = {};
+	ULONG returnLength = 0;
+	if (NT_SUCCESS(NtQueryInformationProcess(hProcess.Get(), ProcessBasicInformationClass, &pbi, sizeof(pbi), &returnLength))
+		&& pbi.PebBaseAddress) {
+		ULONG_PTR peb = reinterpret_cast<ULONG_PTR>(pbi.PebBaseAddress);
+		hints.Pebs.push_back(peb);
+		// The PEB layout only matches ours when the bitness does.
+		if (selfWow64 == targetWow64) {
+			ReadHeapList<ULONG_PTR>(hProcess.Get(), peb, HeapCountOffset, HeapListOffset, hints.Heaps);
+		}
+	}
+
+#ifdef _WIN64
+	if (targetWow64) {
+		ULONG_PTR peb32 = 0;
+		if (NT_SUCCESS(NtQueryInformationProcess(hProcess.Get(), ProcessWow64InformationClass, &peb32, sizeof(peb32), &returnLength))
+			&& peb32 != 0) {
+			hints.Pebs.push_back(peb32);
+			ReadHeapList<ULONG>(hProcess.Get(), peb32, Heap32CountOffset, Heap32ListOffset, hints.Heaps);
+		}
+	}
+#endif
+
+	HandleWrapper hSnap(CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0));
+	if (!hSnap.IsValid()) {
+		return true;
+	}
+
+	THREADENTRY32 te32 = {};
+	te32.dwSize = sizeof(te32);
+	if (!Thread32First(hSnap.Get(), &te32)) {
+		return true;
+	}
+	do {
+		if (te32.th32OwnerProcessID != processId) {
+			continue;
+		}
+
+		HandleWrapper hThread(OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, te32.th32ThreadID));
+		ThreadBasicInformation tbi = {};
+		if (!hThread.IsValid()
+			|| !NT_SUCCESS(NtQueryInformationThread(hThread.Get(), ThreadBasicInformationClass, &tbi, sizeof(tbi), &returnLength))
+			|| !tbi.TebBaseAddress) {
+			continue;
+		}
+
+		ULONG_PTR teb = reinterpret_cast<ULONG_PTR>(tbi.TebBaseAddress);
+		hints.Tebs.push_back(teb);
+		NT_TIB tib = {};
+		if (selfWow64 == targetWow64 && ReadRemote(hProcess.Get(), teb, tib) && tib.StackLimit) {
+			hints.Stacks.push_back(reinterpret_cast<ULONG_PTR>(tib.StackLimit));
+		}
+
+#ifdef _WIN64
+		if (targetWow64) {
+			// NT_TIB32: ExceptionList, StackBase, StackLimit.
+			ULONG tib32[3] = {};
+			if (ReadRemote(hProcess.Get(), teb + Teb32Offset, tib32) && tib32[2] != 0) {
+				hints.Tebs.push_back(teb + Teb32Offset);
+				hints.Stacks.push_back(tib32[2]);
+			}
+		}
+#endif
+	} while (Thread32Next(hSnap.Get(), &te32));
+
+	return true;
+}
+
+std::wstring_view AddressSpaceSummary::KindToString(AllocationKind kind) {
+	switch (kind) {
+		case AllocationKind::Free:
+			return L"Free";
+		case AllocationKind::Image:
+			return L"Image";
+		case AllocationKind::Mapped:
+			return L"Mapped";
+		case AllocationKind::Private:
+			return L"Private";
+		case AllocationKind::Heap:
+			return L"Heap";
+		case AllocationKind::Stack:
+			return L"Stack";
+		case AllocationKind::Teb:
+			return L"TEB";
+		case AllocationKind::Peb:
+			return L"PEB";
+		default:
+			return L"Unknown";
+	}
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
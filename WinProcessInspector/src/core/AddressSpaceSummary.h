@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string_view>
+#include "MemoryManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class AllocationKind : BYTE {
+		Free,
+		Image,
+		Mapped,
+		Private,
+		Heap,
+		Stack,
+		Teb,
+		Peb,
+		Count
+	};
+
+	// Addresses inside allocations that VirtualQueryEx alone cannot
+	// classify. Any address within an allocation marks all of it.
+	struct AddressSpaceHints {
+		std::vector<ULONG_PTR> Heaps;
+		std::vector<ULONG_PTR> Stacks;
+		std::vector<ULONG_PTR> Tebs;
+		std::vector<ULONG_PTR> Pebs;
+	};
+
+	struct AllocationSummary {
+		ULONG_PTR AllocationBase = 0;
+		SIZE_T Size = 0;
+		SIZE_T Committed = 0;
+		// Reserved but not committed.
+		SIZE_T Reserved = 0;
+		DWORD RegionCount = 0;
+		AllocationKind Kind = AllocationKind::Private;
+	};
+
+	struct AddressSpaceTotals {
+		SIZE_T Size = 0;
+		SIZE_T Committed = 0;
+		SIZE_T Reserved = 0;
+		DWORD Allocations = 0;
+		DWORD Regions = 0;
+	};
+
+	// VMMap-style view of an address space: regions grouped into their
+	// allocations, each classified, with totals per kind and free-space
+	// fragmentation. Built in one pass over regions in address order, so it
+	// works as well on regions read from a fixture as on a live process.
+	class AddressSpaceSummary {
+	public:
+		AddressSpaceSummary() = default;
+		~AddressSpaceSummary() = default;
+
+		AddressSpaceSummary(const AddressSpaceSummary&) = delete;
+		AddressSpaceSummary& operator=(const AddressSpaceSummary&) = delete;
+		AddressSpaceSummary(AddressSpaceSummary&&) = default;
+		AddressSpaceSummary& operator=(AddressSpaceSummary&&) = default;
+
+		// regions must be sorted by base address, as EnumerateMemoryRegions
+		// returns them.
+		void Build(const std::vector<MemoryRegionInfo>& regions, const AddressSpaceHints& hints);
+		void Clear();
+
+		const std::vector<AllocationSummary>& GetAllocations() const { return m_Allocations; }
+		const AddressSpaceTotals& GetTotals(AllocationKind kind) const { return m_Totals[static_cast<size_t>(kind)]; }
+		SIZE_T GetCommitted() const;
+		SIZE_T GetReserved() const;
+		SIZE_T GetLargestFree() const { return m_LargestFree; }
+		ULONG_PTR GetLargestFreeBase() const { return m_LargestFreeBase; }
+
+		// Process heaps, thread stacks and TEBs and the PEB of a live process.
+		static bool CollectHints(DWORD processId, AddressSpaceHints& hints);
+		static std::wstring_view KindToString(AllocationKind kind);
+
+	private:
+		void Finish(AllocationSummary& allocation, const std::vector<std::pair<ULONG_PTR, AllocationKind>>& hints, size_t& nextHint);
+
+		std::vector<AllocationSummary> m_Allocations;
+		AddressSpaceTotals m_Totals[static_cast<size_t>(AllocationKind::Count)];
+		SIZE_T m_LargestFree = 0;
+		ULONG_PTR m_LargestFreeBase = 0;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,377 @@
+#include "FileMetadataCache.h"
+#include "../utils/CacheFile.h"
+#include <algorithm>
+#include <cwctype>
+#include <vector>
+
+#pragma comment(lib, "version.lib")
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const DWORD CacheMagic = 0x4D465057; // "WPFM"
+	const DWORD CacheVersion = 1;
+	const size_t MaxCacheEntries = 8192;
+	const size_t FieldCount = 8;
+
+	struct CacheHeader {
+		DWORD Magic;
+		DWORD Version;
+		DWORD EntryCount;
+		DWORD Reserved;
+	};
+
+	std::wstring FileMetadata::* const Fields[FieldCount] = {
+		&FileMetadata::FileDescription,
+		&FileMetadata::CompanyName,
+		&FileMetadata::ProductName,
+		&FileMetadata::FileVersion,
+		&FileMetadata::ProductVersion,
+		&FileMetadata::OriginalFilename,
+		&FileMetadata::InternalName,
+		&FileMetadata::LegalCopyright
+	};
+
+	const wchar_t* const FieldNames[FieldCount] = {
+		L"FileDescription",
+		L"CompanyName",
+		L"ProductName",
+		L"FileVersion",
+		L"ProductVersion",
+		L"OriginalFilename",
+		L"InternalName",
+		L"LegalCopyright"
+	};
+
+	// Reads a length-prefixed string from the mapped view.
+	bool ReadString(const BYTE* view, size_t viewSize, size_t& offset, std::wstring* value) {
+		DWORD length = 0;
+		if (offset + sizeof(length) > viewSize) {
+			return false;
+		}
+		memcpy(&length, view + offset, sizeof(length));
+		offset += sizeof(length);
+
+		if (length > (viewSize - offset) / sizeof(wchar_t)) {
+			return false;
+		}
+		if (value) {
+			value->assign(reinterpret_cast<const wchar_t*>(view + offset), length);
+		}
+		offset += length * sizeof(wchar_t);
+		return true;
+	}
+
+	void WriteBytes(std::vector<BYTE>& buffer, const void* data, size_t size) {
+		const BYTE* bytes = static_cast<const BYTE*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	void WriteString(std::vector<BYTE>& buffer, const std::wstring& value) {
+		DWORD length = static_cast<DWORD>(value.size());
+		WriteBytes(buffer, &length, sizeof(length));
+		WriteBytes(buffer, value.data(), value.size() * sizeof(wchar_t));
+	}
+
+	void WriteRecord(std::vector<BYTE>& buffer, const std::wstring& key, ULONGLONG fileSize, ULONGLONG lastWriteTime,
+		const FileMetadata& metadata) {
+		WriteBytes(buffer, &fileSize, sizeof(fileSize));
+		WriteBytes(buffer, &lastWriteTime, sizeof(lastWriteTime));
+		WriteString(buffer, key);
+		for (size_t i = 0; i < FieldCount; ++i) {
+			WriteString(buffer, metadata.*Fields[i]);
+		}
+	}
+
+}
+
+FileMetadataCache::FileMetadataCache()
+	: m_Table(std::make_shared<Table>()) {
+}
+
+FileMetadataCache::~FileMetadataCache() {
+	Close();
+}
+
+bool FileMetadataCache::Open(const std::wstring& cachePath) {
+	std::lock_guard<std::mutex> lock(m_WriteMutex);
+	Unmap();
+	m_Stored.clear();
+	m_CachePath = cachePath;
+	if (m_CachePath.empty()) {
+		return false;
+	}
+
+	m_hFile = CreateFileW(m_CachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CacheHeader)) ||
+		fileSize.QuadPart > 256 * 1024 * 1024) {
+		Unmap();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping) {
+		m_View = static_cast<const BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!m_View) {
+		Unmap();
+		return false;
+	}
+	m_ViewSize = static_cast<size_t>(fileSize.QuadPart);
+
+	CacheHeader header = {};
+	memcpy(&header, m_View, sizeof(header));
+	if (header.Magic != CacheMagic || header.Version != CacheVersion) {
+		Unmap();
+		return false;
+	}
+
+	// Only paths and file stamps are indexed here; the strings stay in the
+	// mapping until a file is actually looked up.
+	size_t offset = sizeof(header);
+	for (DWORD i = 0; i < header.EntryCount; ++i) {
+		StoredRecord record;
+		if (offset + sizeof(record.FileSize) + sizeof(record.LastWriteTime) > m_ViewSize) {
+			break;
+		}
+		memcpy(&record.FileSize, m_View + offset, sizeof(record.FileSize));
+		offset += sizeof(record.FileSize);
+		memcpy(&record.LastWriteTime, m_View + offset, sizeof(record.LastWriteTime));
+		offset += sizeof(record.LastWriteTime);
+
+		std::wstring key;
+		if (!ReadString(m_View, m_ViewSize, offset, &key)) {
+			break;
+		}
+		record.Offset = offset;
+
+		bool complete = true;
+		for (size_t field = 0; field < FieldCount && complete; ++field) {
+			complete = ReadString(m_View, m_ViewSize, offset, nullptr);
+		}
+		if (!complete) {
+			break;
+		}
+		m_Stored[key] = record;
+	}
+	return true;
+}
+
+void FileMetadataCache::Close() {
+	std::lock_guard<std::mutex> lock(m_WriteMutex);
+	if (m_Dirty) {
+		Save();
+	}
+	Unmap();
+	m_Stored.clear();
+}
+
+std::shared_ptr<const FileMetadata> FileMetadataCache::Get(const std::wstring& filePath) {
+	std::wstring key = MakeKey(filePath);
+
+	std::shared_ptr<const Table> table = std::atomic_load(&m_Table);
+	auto it = table->find(key);
+	if (it != table->end()) {
+		return it->second.Metadata;
+	}
+
+	return Load(key, filePath);
+}
+
+std::shared_ptr<const FileMetadata> FileMetadataCache::Load(const std::wstring& key, const std::wstring& filePath) {
+	std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+	// Another thread may have loaded or published the file while this one
+	// waited.
+	std::shared_ptr<const Table> table = std::atomic_load(&m_Table);
+	auto existing = table->find(key);
+	if (existing != table->end()) {
+		return existing->second.Metadata;
+	}
+	auto staged = m_Staged.find(key);
+	if (staged != m_Staged.end()) {
+		return staged->second.Metadata;
+	}
+
+	Entry entry;
+	bool hasStamp = !filePath.empty() && Utils::CacheFile::GetFileStamp(filePath, entry.FileSize, entry.LastWriteTime);
+
+	auto metadata = std::make_shared<FileMetadata>();
+	bool loaded = false;
+	if (hasStamp) {
+		auto stored = m_Stored.find(key);
+		if (stored != m_Stored.end() && stored->second.FileSize == entry.FileSize &&
+			stored->second.LastWriteTime == entry.LastWriteTime) {
+			loaded = DecodeRecord(stored->second.Offset, *metadata);
+			entry.Persist = loaded;
+		}
+	}
+
+	if (!loaded && !filePath.empty()) {
+		ReadVersionInfo(filePath, *metadata);
+		entry.Persist = hasStamp;
+		m_Dirty = m_Dirty || hasStamp;
+	}
+	entry.Metadata = metadata;
+	m_Staged[key] = entry;
+	return entry.Metadata;
+}
+
+void FileMetadataCache::Publish() {
+	std::lock_guard<std::mutex> lock(m_WriteMutex);
+	PublishLocked();
+}
+
+void FileMetadataCache::PublishLocked() {
+	if (m_Staged.empty()) {
+		return;
+	}
+
+	// Readers keep using the previous table until the new one is stored.
+	auto updated = std::make_shared<Table>(*std::atomic_load(&m_Table));
+	for (auto& entry : m_Staged) {
+		(*updated)[entry.first] = std::move(entry.second);
+	}
+	m_Staged.clear();
+	std::atomic_store(&m_Table, std::shared_ptr<const Table>(std::move(updated)));
+}
+
+bool FileMetadataCache::DecodeRecord(size_t offset, FileMetadata& metadata) const {
+	if (!m_View) {
+		return false;
+	}
+
+	for (size_t i = 0; i < FieldCount; ++i) {
+		if (!ReadString(m_View, m_ViewSize, offset, &(metadata.*Fields[i]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FileMetadataCache::Save() {
+	if (m_CachePath.empty()) {
+		return false;
+	}
+
+	PublishLocked();
+	std::shared_ptr<const Table> table = std::atomic_load(&m_Table);
+
+	std::vector<BYTE> buffer;
+	CacheHeader header = {};
+	header.Magic = CacheMagic;
+	header.Version = CacheVersion;
+	WriteBytes(buffer, &header, sizeof(header));
+
+	// Files seen this session first, then records of files that were not
+	// looked up, so entries for programs that ran before survive.
+	size_t count = 0;
+	for (const auto& entry : *table) {
+		if (count < MaxCacheEntries && entry.second.Persist) {
+			WriteRecord(buffer, entry.first, entry.second.FileSize, entry.second.LastWriteTime, *entry.second.Metadata);
+			++count;
+		}
+	}
+	for (const auto& stored : m_Stored) {
+		if (count >= MaxCacheEntries) {
+			break;
+		}
+		if (table->find(stored.first) != table->end()) {
+			continue;
+		}
+		FileMetadata metadata;
+		if (DecodeRecord(stored.second.Offset, metadata)) {
+			WriteRecord(buffer, stored.first, stored.second.FileSize, stored.second.LastWriteTime, metadata);
+			++count;
+		}
+	}
+
+	header.EntryCount = static_cast<DWORD>(count);
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	// The old file is still mapped; release it before replacing it.
+	Unmap();
+
+	if (!Utils::CacheFile::Write(m_CachePath, buffer)) {
+		return false;
+	}
+
+	m_Dirty = false;
+	return true;
+}
+
+void FileMetadataCache::Unmap() {
+	if (m_View) {
+		UnmapViewOfFile(m_View);
+		m_View = nullptr;
+	}
+	m_ViewSize = 0;
+	if (m_hMapping) {
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool FileMetadataCache::ReadVersionInfo(const std::wstring& filePath, FileMetadata& metadata) {
+	DWORD handle = 0;
+	DWORD size = GetFileVersionInfoSizeW(filePath.c_str(), &handle);
+	if (size == 0 || size >= 10 * 1024 * 1024) {
+		return false;
+	}
+
+	std::vector<BYTE> buffer(size);
+	if (!GetFileVersionInfoW(filePath.c_str(), 0, size, buffer.data())) {
+		return false;
+	}
+
+	struct LANGANDCODEPAGE {
+		WORD wLanguage;
+		WORD wCodePage;
+	} *lpTranslate = nullptr;
+
+	UINT cbTranslate = 0;
+	if (!VerQueryValueW(buffer.data(), L"\\VarFileInfo\\Translation", reinterpret_cast<LPVOID*>(&lpTranslate), &cbTranslate)) {
+		return false;
+	}
+
+	// Each field takes the first translation that defines it.
+	for (size_t field = 0; field < FieldCount; ++field) {
+		for (UINT i = 0; i < (cbTranslate / sizeof(LANGANDCODEPAGE)); i++) {
+			wchar_t subBlock[256];
+			swprintf_s(subBlock, L"\\StringFileInfo\\%04x%04x\\%s",
+				lpTranslate[i].wLanguage, lpTranslate[i].wCodePage, FieldNames[field]);
+
+			LPVOID lpBuffer = nullptr;
+			UINT dwBytes = 0;
+			if (VerQueryValueW(buffer.data(), subBlock, &lpBuffer, &dwBytes) && dwBytes > 0) {
+				metadata.*Fields[field] = static_cast<LPCWSTR>(lpBuffer);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+std::wstring FileMetadataCache::MakeKey(const std::wstring& filePath) {
+	std::wstring key = filePath;
+	std::transform(key.begin(), key.end(), key.begin(), ::towlower);
+	return key;
+}
+
+std::wstring FileMetadataCache::GetDefaultCachePath() {
+	return Utils::CacheFile::GetDefaultPath(L"FileMetadata.bin");
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
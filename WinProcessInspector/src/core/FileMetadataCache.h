@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// String fields of a file's version resource.
+	struct FileMetadata {
+		std::wstring FileDescription;
+		std::wstring CompanyName;
+		std::wstring ProductName;
+		std::wstring FileVersion;
+		std::wstring ProductVersion;
+		std::wstring OriginalFilename;
+		std::wstring InternalName;
+		std::wstring LegalCopyright;
+	};
+
+	// Version resource of each file, read once per file identity (path, size
+	// and last write time) and kept in a memory-mapped cache file between
+	// sessions. Get() reads an immutable snapshot of the table and only takes
+	// the writer lock when a file is not in it yet. Files looked up since the
+	// last Publish() are staged and join the snapshot in one copy, so a cold
+	// start does not copy the table once per file.
+	class FileMetadataCache {
+	public:
+		FileMetadataCache();
+		~FileMetadataCache();
+
+		FileMetadataCache(const FileMetadataCache&) = delete;
+		FileMetadataCache& operator=(const FileMetadataCache&) = delete;
+
+		// Maps an existing cache file. Missing or stale files are not an error.
+		bool Open(const std::wstring& cachePath);
+		// Writes the cache back if anything changed and releases the mapping.
+		void Close();
+
+		// Never null; files without a version resource get empty fields.
+		std::shared_ptr<const FileMetadata> Get(const std::wstring& filePath);
+		// Moves staged files into the snapshot. Meant to run once per refresh.
+		void Publish();
+
+		static bool ReadVersionInfo(const std::wstring& filePath, FileMetadata& metadata);
+		static std::wstring GetDefaultCachePath();
+
+	private:
+		struct Entry {
+			ULONGLONG FileSize = 0;
+			ULONGLONG LastWriteTime = 0;
+			bool Persist = false;
+			std::shared_ptr<const FileMetadata> Metadata;
+		};
+
+		// Record of the mapped file, decoded only when the file is looked up.
+		struct StoredRecord {
+			ULONGLONG FileSize = 0;
+			ULONGLONG LastWriteTime = 0;
+			size_t Offset = 0;
+		};
+
+		typedef std::unordered_map<std::wstring, Entry> Table;
+
+		std::shared_ptr<const FileMetadata> Load(const std::wstring& key, const std::wstring& filePath);
+		void PublishLocked();
+		bool DecodeRecord(size_t offset, FileMetadata& metadata) const;
+		bool Save();
+		void Unmap();
+
+		static std::wstring MakeKey(const std::wstring& filePath);
+
+		std::shared_ptr<const Table> m_Table;
+		std::mutex m_WriteMutex;
+		// Files loaded since the last publish, guarded by m_WriteMutex.
+		Table m_Staged;
+		bool m_Dirty = false;
+
+		std::wstring m_CachePath;
+		HANDLE m_hFile = INVALID_HANDLE_VALUE;
+		HANDLE m_hMapping = nullptr;
+		const BYTE* m_View = nullptr;
+		size_t m_ViewSize = 0;
+		std::unordered_map<std::wstring, StoredRecord> m_Stored;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
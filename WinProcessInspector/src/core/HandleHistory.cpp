@@ -0,0 +1,205 @@
+#include "HandleHistory.h"
+#include "ObjectTypeTable.h"
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const DWORD NoPrefix = 0;
+
+	ULONGLONG MakeBucketKey(WORD typeIndex, DWORD prefixId) {
+		return (static_cast<ULONGLONG>(typeIndex) << 32) | prefixId;
+	}
+
+	std::wstring FormatCount(ULONGLONG value) {
+		std::wstring digits = std::to_wstring(value);
+		std::wstring result;
+		for (size_t i = 0; i < digits.size(); ++i) {
+			if (i > 0 && (digits.size() - i) % 3 == 0) {
+				result += L',';
+			}
+			result += digits[i];
+		}
+		return result;
+	}
+
+	// Device paths such as "\Device\HarddiskVolume3\" shown as "C:\".
+	std::wstring ToDosPath(const std::wstring& path) {
+		static const std::vector<std::pair<std::wstring, std::wstring>> drives = []() {
+			std::vector<std::pair<std::wstring, std::wstring>> mapped;
+			wchar_t drive[3] = L"A:";
+			wchar_t device[MAX_PATH] = {};
+			for (wchar_t letter = L'A'; letter <= L'Z'; ++letter) {
+				drive[0] = letter;
+				if (QueryDosDeviceW(drive, device, MAX_PATH)) {
+					mapped.emplace_back(std::wstring(device) + L"\\", std::wstring(drive) + L"\\");
+				}
+			}
+			return mapped;
+		}();
+
+		for (const auto& mapping : drives) {
+			if (path.compare(0, mapping.first.size(), mapping.first) == 0) {
+				return mapping.second + path.substr(mapping.first.size());
+			}
+		}
+		return path;
+	}
+
+}
+
+HandleHistory::HandleHistory(size_t maxSamples)
+	: m_MaxSamples(std::max<size_t>(maxSamples, 4)) {
+	m_Prefixes.push_back(L"");
+	m_PrefixIds[L""] = NoPrefix;
+}
+
+void HandleHistory::Record(DWORD processId, ULONGLONG startTime, ULONGLONG time, const std::vector<HandleInfo>& handles) {
+	ProcessHistory& history = m_Processes[ProcessKey(processId, startTime)];
+	if (history.Samples.size() >= m_MaxSamples) {
+		Thin(history);
+	}
+
+	std::unordered_map<ULONGLONG, DWORD> counts;
+	for (const auto& handle : handles) {
+		DWORD prefixId = handle.ObjectName.empty() ? NoPrefix : InternPrefix(GetNamePrefix(handle.ObjectName));
+		++counts[MakeBucketKey(handle.ObjectTypeIndex, prefixId)];
+	}
+
+	std::vector<std::pair<ULONGLONG, DWORD>> sorted(counts.begin(), counts.end());
+	std::sort(sorted.begin(), sorted.end());
+
+	Sample sample;
+	sample.Time = time;
+	sample.FirstBucket = history.Buckets.size();
+	sample.BucketCount = static_cast<DWORD>(sorted.size());
+	sample.TotalHandles = static_cast<DWORD>(handles.size());
+	history.Samples.push_back(sample);
+
+	for (const auto& entry : sorted) {
+		Bucket bucket;
+		bucket.ObjectTypeIndex = static_cast<WORD>(entry.first >> 32);
+		bucket.PrefixId = static_cast<DWORD>(entry.first);
+		bucket.Count = entry.second;
+		history.Buckets.push_back(bucket);
+	}
+}
+
+size_t HandleHistory::GetSampleCount(DWORD processId, ULONGLONG startTime) const {
+	const ProcessHistory* history = Find(processId, startTime);
+	return history ? history->Samples.size() : 0;
+}
+
+bool HandleHistory::GetSample(DWORD processId, ULONGLONG startTime, size_t index, ULONGLONG& time, size_t& totalHandles) const {
+	const ProcessHistory* history = Find(processId, startTime);
+	if (!history || index >= history->Samples.size()) {
+		return false;
+	}
+
+	time = history->Samples[index].Time;
+	totalHandles = history->Samples[index].TotalHandles;
+	return true;
+}
+
+std::vector<HandleHistogramChange> HandleHistory::Diff(DWORD processId, ULONGLONG startTime, size_t from, size_t to, bool byPrefix) const {
+	std::vector<HandleHistogramChange> changes;
+	const ProcessHistory* history = Find(processId, startTime);
+	if (!history || from >= history->Samples.size() || to >= history->Samples.size()) {
+		return changes;
+	}
+
+	std::map<ULONGLONG, std::pair<LONGLONG, LONGLONG>> merged;
+	auto add = [&](const Sample& sample, bool after) {
+		for (DWORD i = 0; i < sample.BucketCount; ++i) {
+			const Bucket& bucket = history->Buckets[sample.FirstBucket + i];
+			auto& counts = merged[MakeBucketKey(bucket.ObjectTypeIndex, byPrefix ? bucket.PrefixId : NoPrefix)];
+			(after ? counts.second : counts.first) += bucket.Count;
+		}
+	};
+	add(history->Samples[from], false);
+	add(history->Samples[to], true);
+
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	for (const auto& entry : merged) {
+		if (entry.second.first == entry.second.second) {
+			continue;
+		}
+
+		HandleHistogramChange change;
+		change.ObjectTypeIndex = static_cast<WORD>(entry.first >> 32);
+		change.TypeName = types.GetName(change.ObjectTypeIndex);
+		change.Prefix = m_Prefixes[static_cast<DWORD>(entry.first)];
+		change.Before = entry.second.first;
+		change.After = entry.second.second;
+		change.Delta = change.After - change.Before;
+		changes.push_back(std::move(change));
+	}
+
+	std::stable_sort(changes.begin(), changes.end(), [](const HandleHistogramChange& a, const HandleHistogramChange& b) {
+		return (a.Delta < 0 ? -a.Delta : a.Delta) > (b.Delta < 0 ? -b.Delta : b.Delta);
+	});
+	return changes;
+}
+
+std::wstring HandleHistory::GetNamePrefix(const std::wstring& name) {
+	size_t separator = name.find_last_of(L'\\');
+	if (separator == std::wstring::npos) {
+		return name;
+	}
+	return name.substr(0, separator + 1);
+}
+
+std::wstring HandleHistory::FormatChange(const HandleHistogramChange& change) {
+	ULONGLONG magnitude = static_cast<ULONGLONG>(change.Delta < 0 ? -change.Delta : change.Delta);
+	std::wstring text = (change.Delta < 0 ? L"-" : L"+") + FormatCount(magnitude) + L" " + change.TypeName
+		+ (magnitude == 1 ? L" handle" : L" handles");
+	if (!change.Prefix.empty()) {
+		text += L" under " + ToDosPath(change.Prefix);
+	}
+	return text;
+}
+
+DWORD HandleHistory::InternPrefix(const std::wstring& prefix) {
+	auto it = m_PrefixIds.find(prefix);
+	if (it != m_PrefixIds.end()) {
+		return it->second;
+	}
+
+	DWORD id = static_cast<DWORD>(m_Prefixes.size());
+	m_Prefixes.push_back(prefix);
+	m_PrefixIds.emplace(prefix, id);
+	return id;
+}
+
+void HandleHistory::Thin(ProcessHistory& history) const {
+	size_t count = history.Samples.size();
+	size_t half = count / 2;
+
+	ProcessHistory thinned;
+	thinned.Samples.reserve(count);
+	thinned.Buckets.reserve(history.Buckets.size());
+	for (size_t i = 0; i < count; ++i) {
+		// Keep the first sample as the baseline and every recent one.
+		if (i != 0 && i < half && i % 2 != 0) {
+			continue;
+		}
+
+		Sample sample = history.Samples[i];
+		size_t first = sample.FirstBucket;
+		sample.FirstBucket = thinned.Buckets.size();
+		thinned.Buckets.insert(thinned.Buckets.end(),
+			history.Buckets.begin() + first, history.Buckets.begin() + first + sample.BucketCount);
+		thinned.Samples.push_back(sample);
+	}
+	history = std::move(thinned);
+}
+
+const HandleHistory::ProcessHistory* HandleHistory::Find(DWORD processId, ULONGLONG startTime) const {
+	auto it = m_Processes.find(ProcessKey(processId, startTime));
+	return it != m_Processes.end() ? &it->second : nullptr;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include "HandleManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct HandleHistogramChange {
+		WORD ObjectTypeIndex = 0;
+		std::wstring TypeName;
+		// Directory part of the object name; empty when grouped by type only
+		// or for unnamed handles.
+		std::wstring Prefix;
+		LONGLONG Before = 0;
+		LONGLONG After = 0;
+		LONGLONG Delta = 0;
+	};
+
+	// Handle counts of each process over time, by object type and name
+	// prefix. A sample is a sorted run of (type, prefix, count) buckets with
+	// prefixes interned once for all processes. When a process reaches the
+	// sample limit, every other sample in the older half is dropped, so the
+	// first sample and recent ones are kept as the history grows.
+	class HandleHistory {
+	public:
+		static const size_t DefaultMaxSamples = 120;
+
+		explicit HandleHistory(size_t maxSamples = DefaultMaxSamples);
+		~HandleHistory() = default;
+
+		HandleHistory(const HandleHistory&) = delete;
+		HandleHistory& operator=(const HandleHistory&) = delete;
+		HandleHistory(HandleHistory&&) = default;
+		HandleHistory& operator=(HandleHistory&&) = default;
+
+		// startTime tells apart processes that reused an id. time is in
+		// milliseconds, as from GetTickCount64.
+		void Record(DWORD processId, ULONGLONG startTime, ULONGLONG time, const std::vector<HandleInfo>& handles);
+
+		size_t GetSampleCount(DWORD processId, ULONGLONG startTime) const;
+		bool GetSample(DWORD processId, ULONGLONG startTime, size_t index, ULONGLONG& time, size_t& totalHandles) const;
+
+		// Changes from sample from to sample to, largest first. Grouped by
+		// type alone unless byPrefix is set.
+		std::vector<HandleHistogramChange> Diff(DWORD processId, ULONGLONG startTime, size_t from, size_t to, bool byPrefix) const;
+
+		// "\Device\X\logs\app.log" becomes "\Device\X\logs\".
+		static std::wstring GetNamePrefix(const std::wstring& name);
+		// "+12,400 Event handles" or "+300 File handles under C:\logs\".
+		static std::wstring FormatChange(const HandleHistogramChange& change);
+
+	private:
+		struct Bucket {
+			WORD ObjectTypeIndex;
+			DWORD PrefixId;
+			DWORD Count;
+		};
+
+		struct Sample {
+			ULONGLONG Time;
+			size_t FirstBucket;
+			DWORD BucketCount;
+			DWORD TotalHandles;
+		};
+
+		struct ProcessHistory {
+			std::vector<Sample> Samples;
+			std::vector<Bucket> Buckets;
+		};
+
+		typedef std::pair<DWORD, ULONGLONG> ProcessKey;
+
+		DWORD InternPrefix(const std::wstring& prefix);
+		void Thin(ProcessHistory& history) const;
+		const ProcessHistory* Find(DWORD processId, ULONGLONG startTime) const;
+
+		size_t m_MaxSamples;
+		std::map<ProcessKey, ProcessHistory> m_Processes;
+		std::vector<std::wstring> m_Prefixes;
+		std::unordered_map<std::wstring, DWORD> m_PrefixIds;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -3,6 +3,7 @@
 #include <Windows.h>
 #include <vector>
 #include <string>
+#include "HandleSnapshot.h"
 
 namespace WinProcessInspector {
 namespace Core {
@@ -27,16 +28,21 @@ namespace Core {
 		HandleManager(HandleManager&&) = default;
 		HandleManager& operator=(HandleManager&&) = default;
 
-		std::vector<HandleInfo> EnumerateHandles(DWORD processId) const;
+		// Without names the list is ready at once; HandleNameResolver can fill
+		// them in afterwards.
+		std::vector<HandleInfo> EnumerateHandles(DWORD processId, bool includeNames = true);
 
-		std::vector<HandleInfo> EnumerateAllHandles() const;
+		std::vector<HandleInfo> EnumerateAllHandles(bool includeNames = true);
 
 	private:
 		std::wstring GetObjectTypeName(WORD typeIndex) const;
 
 		std::wstring GetObjectName(HANDLE hProcess, HANDLE handleValue) const;
 
-		bool QuerySystemHandles(std::vector<HandleInfo>& handles) const;
+		void AppendProcessHandles(DWORD processId, bool includeNames, std::vector<HandleInfo>& handles) const;
+
+		// Reused between queries so its buffer keeps its size.
+		HandleSnapshot m_Snapshot;
 	};
 
 } // namespace Core
@@ -0,0 +1,411 @@
+#define WIN32_NO_STATUS
+#include <Windows.h>
+#undef WIN32_NO_STATUS
+
+#include <winternl.h>
+#include <ntstatus.h>
+
+#include "HandleNameResolver.h"
+#include <algorithm>
+#include <chrono>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const ULONG ObjectNameInformation = 1;
+	const ULONG MaxObjectNameLength = 65536;
+	const size_t MaxWorkers = 4;
+	const DWORD QueryTimeoutMs = 250;
+	// Each abandoned helper stays blocked in the kernel until its query
+	// returns; while this many are, deadline-bound types are not queried.
+	const size_t MaxAbandonedThreads = 8;
+	const size_t MaxCachedNames = 65536;
+
+	const wchar_t* const SkippedTypes[] = {
+		L"EtwConsumer",
+		L"EtwRegistration",
+		L"IoCompletion",
+		L"IoCompletionReserve",
+		L"IRTimer",
+		L"Process",
+		L"Thread",
+		L"Token",
+		L"TpWorkerFactory",
+		L"UserApcReserve",
+		L"WaitCompletionPacket"
+	};
+
+	enum DeadlineState {
+		DeadlineRunning,
+		DeadlineFinished,
+		DeadlineAbandoned
+	};
+
+}
+
+// State shared by a worker and its helper thread. The helper keeps its own
+// reference so an abandoned query can finish (or never finish) safely.
+struct HandleNameResolver::DeadlineQuery {
+	HandleWrapper RequestEvent;
+	HandleWrapper DoneEvent;
+	// Duplicated handle to query; nullptr tells the helper to exit.
+	HANDLE Object = nullptr;
+	std::wstring Name;
+	std::atomic<int> State{ DeadlineRunning };
+	// The resolver's count, released by the helper when an abandoned query
+	// finally returns.
+	std::shared_ptr<std::atomic<size_t>> AbandonedThreads;
+};
+
+HandleNameResolver::~HandleNameResolver() {
+	Stop();
+}
+
+bool HandleNameResolver::Start(HWND notifyWindow, UINT notifyMessage, size_t workerCount) {
+	if (!m_Workers.empty()) {
+		return true;
+	}
+
+	if (workerCount == 0) {
+		workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+	}
+
+	m_NotifyWindow = notifyWindow;
+	m_NotifyMessage = notifyMessage;
+	m_Stopping = false;
+
+	for (size_t i = 0; i < workerCount; ++i) {
+		m_Workers.emplace_back(&HandleNameResolver::WorkerThread, this);
+	}
+	return true;
+}
+
+void HandleNameResolver::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_Queue.clear();
+		m_Pending.clear();
+	}
+	m_Wakeup.notify_all();
+	m_Drained.notify_all();
+
+	for (auto& worker : m_Workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+	m_Workers.clear();
+
+	std::lock_guard<std::mutex> lock(m_ProcessMutex);
+	m_SourceProcesses.clear();
+}
+
+bool HandleNameResolver::Request(const HandleInfo& handle, std::wstring& name) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (IsSkippedType(handle.ObjectTypeName)) {
+		name.clear();
+		++m_Statistics.Skipped;
+		return true;
+	}
+
+	Key key = { handle.ProcessId, reinterpret_cast<ULONG_PTR>(handle.HandleValue), handle.ObjectAddress, handle.ObjectTypeIndex };
+	auto it = m_Names.find(key);
+	if (it != m_Names.end()) {
+		name = it->second;
+		++m_Statistics.CacheHits;
+		return true;
+	}
+
+	bool deadline = NeedsDeadline(handle.ObjectTypeName);
+	if (deadline && m_AbandonedThreads->load() >= MaxAbandonedThreads) {
+		name.clear();
+		++m_Statistics.Skipped;
+		return true;
+	}
+
+	if (!m_Workers.empty() && !m_Stopping && m_Pending.insert(key).second) {
+		m_Queue.push_back({ key, deadline });
+		m_Wakeup.notify_one();
+	}
+	return false;
+}
+
+void HandleNameResolver::CancelPending() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.clear();
+		m_Pending.clear();
+		m_Results.clear();
+	}
+	m_Drained.notify_all();
+
+	// Process ids may be reused before the next request.
+	std::lock_guard<std::mutex> lock(m_ProcessMutex);
+	m_SourceProcesses.clear();
+}
+
+std::vector<HandleNameResult> HandleNameResolver::TakeResults() {
+	std::vector<HandleNameResult> results;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	results.swap(m_Results);
+	return results;
+}
+
+bool HandleNameResolver::WaitForPending(DWORD timeoutMs) {
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	return m_Drained.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return m_Pending.empty(); });
+}
+
+HandleNameStatistics HandleNameResolver::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	HandleNameStatistics statistics = m_Statistics;
+	statistics.AbandonedThreads = m_AbandonedThreads->load();
+	return statistics;
+}
+
+bool HandleNameResolver::IsSkippedType(const std::wstring& typeName) {
+	for (const wchar_t* skipped : SkippedTypes) {
+		if (typeName == skipped) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HandleNameResolver::NeedsDeadline(const std::wstring& typeName) {
+	// Naming a file object waits for its lock, which a pending synchronous
+	// read on a pipe holds indefinitely.
+	return typeName == L"File";
+}
+
+std::wstring HandleNameResolver::QueryObjectName(HANDLE handle) {
+	typedef NTSTATUS (WINAPI* pNtQueryObject)(
+		HANDLE Handle,
+		ULONG ObjectInformationClass,
+		PVOID ObjectInformation,
+		ULONG ObjectInformationLength,
+		PULONG ReturnLength
+	);
+
+	HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+	static const pNtQueryObject NtQueryObject = hNtdll
+		? reinterpret_cast<pNtQueryObject>(GetProcAddress(hNtdll, "NtQueryObject"))
+		: nullptr;
+	if (!NtQueryObject) {
+		return L"";
+	}
+
+	// Most names fit in the first buffer, saving the size query.
+	std::vector<BYTE> buffer(1024);
+	ULONG returnLength = 0;
+	NTSTATUS status = NtQueryObject(handle, ObjectNameInformation, buffer.data(), static_cast<ULONG>(buffer.size()), &returnLength);
+	if (status == STATUS_INFO_LENGTH_MISMATCH || status == STATUS_BUFFER_TOO_SMALL || status == STATUS_BUFFER_OVERFLOW) {
+		if (returnLength == 0 || returnLength > MaxObjectNameLength) {
+			return L"";
+		}
+		buffer.resize(returnLength);
+		status = NtQueryObject(handle, ObjectNameInformation, buffer.data(), returnLength, &returnLength);
+	}
+	if (!NT_SUCCESS(status)) {
+		return L"";
+	}
+
+	UNICODE_STRING* us = reinterpret_cast<UNICODE_STRING*>(buffer.data());
+	if (us->Buffer && us->Length > 0) {
+		return std::wstring(us->Buffer, us->Length / sizeof(WCHAR));
+	}
+	return L"";
+}
+
+size_t HandleNameResolver::KeyHash::operator()(const Key& key) const {
+	ULONGLONG hash = 14695981039346656037ULL;
+	auto mix = [&hash](ULONGLONG value) {
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	};
+	mix(key.ProcessId);
+	mix(key.HandleValue);
+	mix(key.ObjectAddress);
+	mix(key.ObjectTypeIndex);
+	return static_cast<size_t>(hash);
+}
+
+void HandleNameResolver::WorkerThread() {
+	Helper helper;
+
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+			if (m_Stopping) {
+				break;
+			}
+			job = m_Queue.front();
+			m_Queue.pop_front();
+		}
+
+		std::wstring name;
+		bool resolved = Resolve(job, helper, name);
+
+		bool notify = false;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Pending.erase(job.HandleKey) == 0 || m_Stopping) {
+				// Cancelled while it was being resolved.
+				continue;
+			}
+
+			++m_Statistics.Queried;
+			if (resolved && job.HandleKey.ObjectAddress != 0) {
+				if (m_Names.size() >= MaxCachedNames) {
+					m_Names.clear();
+				}
+				m_Names[job.HandleKey] = name;
+			}
+
+			HandleNameResult result;
+			result.ProcessId = job.HandleKey.ProcessId;
+			result.HandleValue = job.HandleKey.HandleValue;
+			result.ObjectAddress = job.HandleKey.ObjectAddress;
+			result.Name = std::move(name);
+			result.Resolved = resolved;
+			m_Results.push_back(std::move(result));
+			notify = m_Results.size() == 1;
+			if (m_Pending.empty()) {
+				m_Drained.notify_all();
+			}
+		}
+
+		// One message per batch; the window drains every result queued so far.
+		if (notify && m_NotifyWindow) {
+			PostMessageW(m_NotifyWindow, m_NotifyMessage, 0, 0);
+		}
+	}
+
+	if (helper.Query) {
+		helper.Query->Object = nullptr;
+		SetEvent(helper.Query->RequestEvent.Get());
+	}
+}
+
+bool HandleNameResolver::Resolve(const Job& job, Helper& helper, std::wstring& name) {
+	std::shared_ptr<HandleWrapper> process = GetSourceProcess(job.HandleKey.ProcessId);
+	if (!process) {
+		return false;
+	}
+
+	HANDLE duplicate = nullptr;
+	if (!DuplicateHandle(process->Get(), reinterpret_cast<HANDLE>(job.HandleKey.HandleValue),
+		GetCurrentProcess(), &duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+		return false;
+	}
+
+	if (job.NeedsDeadline) {
+		return QueryWithDeadline(helper, duplicate, name);
+	}
+
+	name = QueryObjectName(duplicate);
+	CloseHandle(duplicate);
+	return true;
+}
+
+bool HandleNameResolver::QueryWithDeadline(Helper& helper, HANDLE duplicate, std::wstring& name) {
+	if (!helper.Query) {
+		auto query = std::make_shared<DeadlineQuery>();
+		query->RequestEvent.Reset(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+		query->DoneEvent.Reset(CreateEventW(nullptr, FALSE, FALSE, nullptr));
+		query->AbandonedThreads = m_AbandonedThreads;
+		if (!query->RequestEvent.IsValid() || !query->DoneEvent.IsValid()) {
+			CloseHandle(duplicate);
+			return false;
+		}
+
+		auto* reference = new std::shared_ptr<DeadlineQuery>(query);
+		HANDLE hThread = CreateThread(nullptr, 64 * 1024, &HandleNameResolver::DeadlineThread, reference, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+		if (!hThread) {
+			delete reference;
+			CloseHandle(duplicate);
+			return false;
+		}
+		CloseHandle(hThread);
+		helper.Query = query;
+	}
+
+	DeadlineQuery& query = *helper.Query;
+	query.Object = duplicate;
+	query.State = DeadlineRunning;
+	SetEvent(query.RequestEvent.Get());
+
+	if (WaitForSingleObject(query.DoneEvent.Get(), QueryTimeoutMs) != WAIT_OBJECT_0) {
+		// Counted before the helper can see the abandonment and release it.
+		++*m_AbandonedThreads;
+		int expected = DeadlineRunning;
+		if (query.State.compare_exchange_strong(expected, DeadlineAbandoned)) {
+			// The helper now owns the duplicate and exits if it ever returns.
+			helper.Query.reset();
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			++m_Statistics.TimedOut;
+			return false;
+		}
+		// Finished right at the deadline.
+		--*m_AbandonedThreads;
+		WaitForSingleObject(query.DoneEvent.Get(), INFINITE);
+	}
+
+	name = std::move(query.Name);
+	CloseHandle(duplicate);
+	return true;
+}
+
+// Runs one query per request until told to exit or abandoned mid-query.
+DWORD WINAPI HandleNameResolver::DeadlineThread(LPVOID parameter) {
+	auto* owned = static_cast<std::shared_ptr<DeadlineQuery>*>(parameter);
+	std::shared_ptr<DeadlineQuery> query = std::move(*owned);
+	delete owned;
+
+	for (;;) {
+		WaitForSingleObject(query->RequestEvent.Get(), INFINITE);
+		HANDLE object = query->Object;
+		if (!object) {
+			break;
+		}
+
+		std::wstring name = QueryObjectName(object);
+		int expected = DeadlineRunning;
+		if (!query->State.compare_exchange_strong(expected, DeadlineFinished)) {
+			// The worker gave up on this query and moved on.
+			CloseHandle(object);
+			--*query->AbandonedThreads;
+			break;
+		}
+		query->Name = std::move(name);
+		SetEvent(query->DoneEvent.Get());
+	}
+	return 0;
+}
+
+std::shared_ptr<HandleWrapper> HandleNameResolver::GetSourceProcess(DWORD processId) {
+	std::lock_guard<std::mutex> lock(m_ProcessMutex);
+	auto it = m_SourceProcesses.find(processId);
+	if (it != m_SourceProcesses.end()) {
+		// An exited process means the id may now belong to another one.
+		if (!it->second || WaitForSingleObject(it->second->Get(), 0) != WAIT_OBJECT_0) {
+			return it->second;
+		}
+	}
+
+	std::shared_ptr<HandleWrapper> process = std::make_shared<HandleWrapper>(
+		::OpenProcess(PROCESS_DUP_HANDLE | SYNCHRONIZE, FALSE, processId));
+	if (!process->IsValid()) {
+		process.reset();
+	}
+	m_SourceProcesses[processId] = process;
+	return process;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include "HandleManager.h"
+#include "HandleWrapper.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct HandleNameResult {
+		DWORD ProcessId = 0;
+		ULONG_PTR HandleValue = 0;
+		ULONG_PTR ObjectAddress = 0;
+		std::wstring Name;
+		// False when the query failed or timed out; Name is then empty.
+		bool Resolved = false;
+	};
+
+	struct HandleNameStatistics {
+		ULONGLONG Queried = 0;
+		ULONGLONG CacheHits = 0;
+		ULONGLONG Skipped = 0;
+		ULONGLONG TimedOut = 0;
+		size_t AbandonedThreads = 0;
+	};
+
+	// Resolves handle object names on a pool of worker threads so handle
+	// lists can be shown before their names are known. Each owning process
+	// is opened once. Queries that can block forever (file objects, which
+	// include synchronous pipes) run on a helper thread that is abandoned
+	// when it misses its deadline. Names of handles from system-wide captures
+	// are cached by process, handle value, object address and type. Handles
+	// without an object address (per-process captures) are queried every
+	// time, since a reused handle value could otherwise show a closed
+	// object's name.
+	class HandleNameResolver {
+	public:
+		HandleNameResolver() = default;
+		~HandleNameResolver();
+
+		HandleNameResolver(const HandleNameResolver&) = delete;
+		HandleNameResolver& operator=(const HandleNameResolver&) = delete;
+
+		// notifyMessage is posted without parameters when results are queued.
+		bool Start(HWND notifyWindow, UINT notifyMessage, size_t workerCount = 0);
+		void Stop();
+
+		// Fills name and returns true when it is already known or the type
+		// never has a name. Otherwise queues the handle and returns false.
+		bool Request(const HandleInfo& handle, std::wstring& name);
+		// Drops queued handles and the cached process handles.
+		void CancelPending();
+		std::vector<HandleNameResult> TakeResults();
+		// Blocks until every queued handle has a result, for callers without
+		// a window. False when timeoutMs passes first.
+		bool WaitForPending(DWORD timeoutMs);
+
+		HandleNameStatistics GetStatistics() const;
+
+		// Types whose objects are never named or cannot be queried safely.
+		static bool IsSkippedType(const std::wstring& typeName);
+		// Types whose name query may block indefinitely.
+		static bool NeedsDeadline(const std::wstring& typeName);
+		// NtQueryObject(ObjectNameInformation) on a handle owned by this
+		// process.
+		static std::wstring QueryObjectName(HANDLE handle);
+
+	private:
+		struct Key {
+			DWORD ProcessId;
+			ULONG_PTR HandleValue;
+			// Zero for per-process captures, whose names are not cached.
+			ULONG_PTR ObjectAddress;
+			WORD ObjectTypeIndex;
+
+			bool operator==(const Key& other) const {
+				return ProcessId == other.ProcessId && HandleValue == other.HandleValue
+					&& ObjectAddress == other.ObjectAddress && ObjectTypeIndex == other.ObjectTypeIndex;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Job {
+			Key HandleKey;
+			bool NeedsDeadline;
+		};
+
+		struct DeadlineQuery;
+
+		// Per-worker helper that runs deadline-bound queries. Replaced when it
+		// hangs.
+		struct Helper {
+			std::shared_ptr<DeadlineQuery> Query;
+		};
+
+		void WorkerThread();
+		bool Resolve(const Job& job, Helper& helper, std::wstring& name);
+		bool QueryWithDeadline(Helper& helper, HANDLE duplicate, std::wstring& name);
+		std::shared_ptr<HandleWrapper> GetSourceProcess(DWORD processId);
+		static DWORD WINAPI DeadlineThread(LPVOID parameter);
+
+		HWND m_NotifyWindow = nullptr;
+		UINT m_NotifyMessage = 0;
+
+		std::vector<std::thread> m_Workers;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Wakeup;
+		std::condition_variable m_Drained;
+		bool m_Stopping = false;
+
+		std::deque<Job> m_Queue;
+		std::unordered_set<Key, KeyHash> m_Pending;
+		std::unordered_map<Key, std::wstring, KeyHash> m_Names;
+		std::vector<HandleNameResult> m_Results;
+		HandleNameStatistics m_Statistics;
+		// Helpers still blocked after missing their deadline. Shared with
+		// them, since they may outlive the resolver.
+		std::shared_ptr<std::atomic<size_t>> m_AbandonedThreads = std::make_shared<std::atomic<size_t>>(0);
+
+		std::mutex m_ProcessMutex;
+		std::unordered_map<DWORD, std::shared_ptr<HandleWrapper>> m_SourceProcesses;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
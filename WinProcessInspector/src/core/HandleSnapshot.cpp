@@ -0,0 +1,269 @@
+#define WIN32_NO_STATUS
+#include <Windows.h>
+#undef WIN32_NO_STATUS
+
+#include <winternl.h>
+#include <ntstatus.h>
+
+#include "HandleSnapshot.h"
+#include "HandleWrapper.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const ULONG SystemExtendedHandleInformation = 64;
+	const ULONG ProcessHandleInformation = 51;
+
+	const size_t InitialSystemBufferSize = 4 * 1024 * 1024;
+	const size_t InitialProcessBufferSize = 64 * 1024;
+	const size_t MaxBufferSize = 0x7FFFFFFF;
+	const int MaxQueryAttempts = 8;
+
+	typedef NTSTATUS (WINAPI* pNtQuerySystemInformation)(
+		ULONG SystemInformationClass,
+		PVOID SystemInformation,
+		ULONG SystemInformationLength,
+		PULONG ReturnLength
+	);
+
+	typedef NTSTATUS (WINAPI* pNtQueryInformationProcess)(
+		HANDLE ProcessHandle,
+		ULONG ProcessInformationClass,
+		PVOID ProcessInformation,
+		ULONG ProcessInformationLength,
+		PULONG ReturnLength
+	);
+
+	template <typename T>
+	T GetNtdllFunction(const char* name) {
+		HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+		return hNtdll ? reinterpret_cast<T>(GetProcAddress(hNtdll, name)) : nullptr;
+	}
+
+	// Handles come and go between the size query and the real one, so the
+	// buffer gets some room beyond what was asked for.
+	size_t WithHeadroom(size_t size) {
+		return std::min(size + size / 8 + 4096, MaxBufferSize);
+	}
+
+	// Number of whole entries after the header, or false if the header
+	// claims more than the buffer holds.
+	bool GetEntryCount(const void* buffer, size_t size, size_t headerSize, size_t entrySize, size_t& count) {
+		if (!buffer || size < headerSize) {
+			return false;
+		}
+		count = static_cast<size_t>(*static_cast<const ULONG_PTR*>(buffer));
+		return count <= (size - headerSize) / entrySize;
+	}
+
+}
+
+bool HandleSnapshot::Capture() {
+	size_t size = 0;
+	if (!QuerySystem(size)) {
+		Clear();
+		return false;
+	}
+
+	bool parsed = Parse(m_Buffer.data(), size);
+	TrimBuffer(size);
+	return parsed;
+}
+
+bool HandleSnapshot::CaptureProcess(DWORD processId) {
+	HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, processId));
+	size_t size = 0;
+	if (hProcess.IsValid() && QueryProcess(hProcess.Get(), size)) {
+		return ParseProcess(processId, m_Buffer.data(), size);
+	}
+
+	// Protected processes and systems without the per-process class.
+	if (!Capture()) {
+		return false;
+	}
+
+	size_t count = 0;
+	const HandleEntry* handles = GetProcessHandles(processId, count);
+	if (handles) {
+		std::copy(handles, handles + count, m_Handles.begin());
+	}
+	m_Handles.resize(count);
+	m_Processes.clear();
+	if (count > 0) {
+		m_Processes.push_back({ processId, 0, count });
+	}
+	return true;
+}
+
+bool HandleSnapshot::Parse(const void* buffer, size_t size) {
+	Clear();
+
+	size_t count = 0;
+	if (!GetEntryCount(buffer, size, offsetof(SystemHandleInformationEx, Handles), sizeof(SystemHandleTableEntryEx), count)) {
+		return false;
+	}
+	const SystemHandleTableEntryEx* entries = static_cast<const SystemHandleInformationEx*>(buffer)->Handles;
+
+	// The kernel lists handles table by table, so each process is normally
+	// one run already. Runs are ordered by process id and copied once.
+	m_Runs.clear();
+	for (size_t i = 0; i < count; ++i) {
+		DWORD processId = static_cast<DWORD>(entries[i].UniqueProcessId);
+		if (m_Runs.empty() || m_Runs.back().ProcessId != processId) {
+			m_Runs.push_back({ processId, i, 0 });
+		}
+		++m_Runs.back().Count;
+	}
+	std::stable_sort(m_Runs.begin(), m_Runs.end(), [](const ProcessRange& a, const ProcessRange& b) {
+		return a.ProcessId < b.ProcessId;
+	});
+
+	m_Handles.reserve(count);
+	for (const auto& run : m_Runs) {
+		if (m_Processes.empty() || m_Processes.back().ProcessId != run.ProcessId) {
+			m_Processes.push_back({ run.ProcessId, m_Handles.size(), 0 });
+		}
+		m_Processes.back().Count += run.Count;
+
+		for (size_t i = run.First; i < run.First + run.Count; ++i) {
+			const SystemHandleTableEntryEx& source = entries[i];
+			HandleEntry entry;
+			entry.HandleValue = source.HandleValue;
+			entry.ObjectAddress = reinterpret_cast<ULONG_PTR>(source.Object);
+			entry.ProcessId = run.ProcessId;
+			entry.AccessMask = source.GrantedAccess;
+			entry.ObjectTypeIndex = source.ObjectTypeIndex;
+			entry.Attributes = static_cast<WORD>(source.HandleAttributes);
+			m_Handles.push_back(entry);
+		}
+	}
+	return true;
+}
+
+bool HandleSnapshot::ParseProcess(DWORD processId, const void* buffer, size_t size) {
+	Clear();
+
+	size_t count = 0;
+	if (!GetEntryCount(buffer, size, offsetof(ProcessHandleSnapshotInformation, Handles), sizeof(ProcessHandleTableEntryInfo), count)) {
+		return false;
+	}
+	const ProcessHandleTableEntryInfo* entries = static_cast<const ProcessHandleSnapshotInformation*>(buffer)->Handles;
+
+	m_Handles.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		HandleEntry entry;
+		entry.HandleValue = reinterpret_cast<ULONG_PTR>(entries[i].HandleValue);
+		entry.ProcessId = processId;
+		entry.AccessMask = entries[i].GrantedAccess;
+		entry.ObjectTypeIndex = static_cast<WORD>(entries[i].ObjectTypeIndex);
+		entry.Attributes = static_cast<WORD>(entries[i].HandleAttributes);
+		m_Handles.push_back(entry);
+	}
+	if (count > 0) {
+		m_Processes.push_back({ processId, 0, count });
+	}
+	return true;
+}
+
+void HandleSnapshot::Clear() {
+	m_Handles.clear();
+	m_Processes.clear();
+}
+
+const HandleEntry* HandleSnapshot::GetProcessHandles(DWORD processId, size_t& count) const {
+	auto it = std::lower_bound(m_Processes.begin(), m_Processes.end(), processId, [](const ProcessRange& range, DWORD id) {
+		return range.ProcessId < id;
+	});
+	if (it == m_Processes.end() || it->ProcessId != processId) {
+		count = 0;
+		return nullptr;
+	}
+
+	count = it->Count;
+	return m_Handles.data() + it->First;
+}
+
+std::vector<DWORD> HandleSnapshot::GetProcessIds() const {
+	std::vector<DWORD> processIds;
+	processIds.reserve(m_Processes.size());
+	for (const auto& range : m_Processes) {
+		processIds.push_back(range.ProcessId);
+	}
+	return processIds;
+}
+
+bool HandleSnapshot::QuerySystem(size_t& size) {
+	static const pNtQuerySystemInformation NtQuerySystemInformation =
+		GetNtdllFunction<pNtQuerySystemInformation>("NtQuerySystemInformation");
+	if (!NtQuerySystemInformation) {
+		return false;
+	}
+
+	if (m_Buffer.size() < InitialSystemBufferSize) {
+		m_Buffer.resize(InitialSystemBufferSize);
+	}
+
+	for (int attempt = 0; attempt < MaxQueryAttempts; ++attempt) {
+		ULONG returnLength = 0;
+		NTSTATUS status = NtQuerySystemInformation(SystemExtendedHandleInformation,
+			m_Buffer.data(), static_cast<ULONG>(m_Buffer.size()), &returnLength);
+		if (NT_SUCCESS(status)) {
+			size = returnLength > 0 && returnLength <= m_Buffer.size() ? returnLength : m_Buffer.size();
+			return true;
+		}
+		if (status != STATUS_INFO_LENGTH_MISMATCH || m_Buffer.size() >= MaxBufferSize) {
+			return false;
+		}
+
+		// Some builds report no length for this class; double instead.
+		size_t needed = returnLength > m_Buffer.size() ? returnLength : m_Buffer.size() * 2;
+		m_Buffer.resize(WithHeadroom(needed));
+	}
+	return false;
+}
+
+bool HandleSnapshot::QueryProcess(HANDLE hProcess, size_t& size) {
+	static const pNtQueryInformationProcess NtQueryInformationProcess =
+		GetNtdllFunction<pNtQueryInformationProcess>("NtQueryInformationProcess");
+	if (!NtQueryInformationProcess) {
+		return false;
+	}
+
+	if (m_Buffer.size() < InitialProcessBufferSize) {
+		m_Buffer.resize(InitialProcessBufferSize);
+	}
+
+	for (int attempt = 0; attempt < MaxQueryAttempts; ++attempt) {
+		ULONG returnLength = 0;
+		NTSTATUS status = NtQueryInformationProcess(hProcess, ProcessHandleInformation,
+			m_Buffer.data(), static_cast<ULONG>(m_Buffer.size()), &returnLength);
+		if (NT_SUCCESS(status)) {
+			size = returnLength > 0 && returnLength <= m_Buffer.size() ? returnLength : m_Buffer.size();
+			return true;
+		}
+		if (status != STATUS_INFO_LENGTH_MISMATCH || m_Buffer.size() >= MaxBufferSize) {
+			return false;
+		}
+
+		size_t needed = returnLength > m_Buffer.size() ? returnLength : m_Buffer.size() * 2;
+		m_Buffer.resize(WithHeadroom(needed));
+	}
+	return false;
+}
+
+void HandleSnapshot::TrimBuffer(size_t used) {
+	// Keep the buffer for the next capture unless a spike left it far larger
+	// than what is in use now.
+	size_t keep = std::max(WithHeadroom(used), InitialSystemBufferSize);
+	if (m_Buffer.size() > keep * 4) {
+		m_Buffer.resize(keep);
+		m_Buffer.shrink_to_fit();
+	}
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
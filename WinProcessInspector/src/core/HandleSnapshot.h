@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Layouts returned by NtQuerySystemInformation(SystemExtendedHandleInformation)
+	// and NtQueryInformationProcess(ProcessHandleInformation). Unlike the
+	// legacy handle class these keep full-width process ids and handle values.
+	struct SystemHandleTableEntryEx {
+		PVOID Object;
+		ULONG_PTR UniqueProcessId;
+		ULONG_PTR HandleValue;
+		ULONG GrantedAccess;
+		USHORT CreatorBackTraceIndex;
+		USHORT ObjectTypeIndex;
+		ULONG HandleAttributes;
+		ULONG Reserved;
+	};
+
+	struct SystemHandleInformationEx {
+		ULONG_PTR NumberOfHandles;
+		ULONG_PTR Reserved;
+		SystemHandleTableEntryEx Handles[1];
+	};
+
+	struct ProcessHandleTableEntryInfo {
+		HANDLE HandleValue;
+		ULONG_PTR HandleCount;
+		ULONG_PTR PointerCount;
+		ULONG GrantedAccess;
+		ULONG ObjectTypeIndex;
+		ULONG HandleAttributes;
+		ULONG Reserved;
+	};
+
+	struct ProcessHandleSnapshotInformation {
+		ULONG_PTR NumberOfHandles;
+		ULONG_PTR Reserved;
+		ProcessHandleTableEntryInfo Handles[1];
+	};
+
+	struct HandleEntry {
+		ULONG_PTR HandleValue = 0;
+		// Kernel object address; zero when it is hidden or came from the
+		// per-process query.
+		ULONG_PTR ObjectAddress = 0;
+		DWORD ProcessId = 0;
+		DWORD AccessMask = 0;
+		WORD ObjectTypeIndex = 0;
+		WORD Attributes = 0;
+	};
+
+	// Handle table captured in one query. Handles are stored contiguously per
+	// process, with a sorted process index to find them. The query buffer is
+	// kept between captures and sized from the previous one.
+	class HandleSnapshot {
+	public:
+		HandleSnapshot() = default;
+		~HandleSnapshot() = default;
+
+		HandleSnapshot(const HandleSnapshot&) = delete;
+		HandleSnapshot& operator=(const HandleSnapshot&) = delete;
+		HandleSnapshot(HandleSnapshot&&) = default;
+		HandleSnapshot& operator=(HandleSnapshot&&) = default;
+
+		// Every handle in the system.
+		bool Capture();
+		// Handles of one process, asked of the process itself when it can be
+		// opened, otherwise filtered from a system-wide capture.
+		bool CaptureProcess(DWORD processId);
+
+		// Build the snapshot from a buffer in the layouts above.
+		bool Parse(const void* buffer, size_t size);
+		bool ParseProcess(DWORD processId, const void* buffer, size_t size);
+
+		void Clear();
+
+		const std::vector<HandleEntry>& GetHandles() const { return m_Handles; }
+		size_t GetHandleCount() const { return m_Handles.size(); }
+		size_t GetProcessCount() const { return m_Processes.size(); }
+		// Handles of one process, or nullptr with count 0 if it has none.
+		const HandleEntry* GetProcessHandles(DWORD processId, size_t& count) const;
+		std::vector<DWORD> GetProcessIds() const;
+
+		size_t GetBufferSize() const { return m_Buffer.size(); }
+
+	private:
+		struct ProcessRange {
+			DWORD ProcessId;
+			size_t First;
+			size_t Count;
+		};
+
+		// Fill m_Buffer, growing it until the result fits; size is the part
+		// in use.
+		bool QuerySystem(size_t& size);
+		bool QueryProcess(HANDLE hProcess, size_t& size);
+		void TrimBuffer(size_t used);
+
+		std::vector<BYTE> m_Buffer;
+		std::vector<HandleEntry> m_Handles;
+		std::vector<ProcessRange> m_Processes;
+		std::vector<ProcessRange> m_Runs;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
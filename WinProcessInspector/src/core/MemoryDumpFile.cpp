@@ -0,0 +1,594 @@
+#include "MemoryDumpFile.h"
+#include "PageHashSnapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#pragma comment(lib, "cabinet.lib")
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t MaxWorkers = 8;
+	const char DumpMagic[8] = { 'W', 'P', 'I', 'D', 'U', 'M', 'P', '\0' };
+	// Version 2 added block checksums.
+	const DWORD DumpVersion = 2;
+	const DWORD DumpAlgorithm = COMPRESS_ALGORITHM_XPRESS_HUFF;
+
+#pragma pack(push, 1)
+	struct DumpHeader {
+		char Magic[8];
+		DWORD Version;
+		DWORD BlockSize;
+		DWORD Algorithm;
+		DWORD ProcessId;
+		FILETIME CaptureTime;
+		// Zero until the dump is complete.
+		ULONGLONG IndexOffset;
+		ULONGLONG RegionCount;
+		ULONGLONG BlockCount;
+	};
+
+	// The index is the region table followed by one DumpBlock per block,
+	// in region order.
+	struct DumpRegion {
+		ULONGLONG BaseAddress;
+		ULONGLONG AllocationBase;
+		ULONGLONG RegionSize;
+		DWORD Protect;
+		BYTE State;
+		BYTE Type;
+		WORD Reserved;
+	};
+
+	struct DumpBlock {
+		ULONGLONG FileOffset;
+		DWORD StoredSize;
+		DWORD Kind;
+		ULONGLONG Checksum;
+	};
+#pragma pack(pop)
+
+	struct BlockJob {
+		ULONG_PTR Address;
+		DWORD Length;
+	};
+
+	bool IsZero(const BYTE* data, size_t size) {
+		size_t i = 0;
+		for (; i + sizeof(ULONGLONG) <= size; i += sizeof(ULONGLONG)) {
+			ULONGLONG word;
+			memcpy(&word, data + i, sizeof(word));
+			if (word != 0) {
+				return false;
+			}
+		}
+		for (; i < size; ++i) {
+			if (data[i] != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool WriteAll(HANDLE file, const void* data, size_t size) {
+		const BYTE* in = static_cast<const BYTE*>(data);
+		while (size > 0) {
+			DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+			DWORD written = 0;
+			if (!WriteFile(file, in, chunk, &written, nullptr) || written != chunk) {
+				return false;
+			}
+			in += chunk;
+			size -= chunk;
+		}
+		return true;
+	}
+
+	bool IsWritable(DWORD protect) {
+		switch (protect & 0xFF) {
+			case PAGE_READWRITE:
+			case PAGE_WRITECOPY:
+			case PAGE_EXECUTE_READWRITE:
+			case PAGE_EXECUTE_WRITECOPY:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+}
+
+ULONGLONG MemoryDumpFile::ComputeChecksum(const BYTE* data, size_t size) {
+	// The page hash is reused and chained over the pages in order; a partial
+	// last page is hashed zero padded.
+	const size_t pageSize = PageHashSnapshot::PageSize;
+	ULONGLONG checksum = size;
+	size_t offset = 0;
+	for (; offset + pageSize <= size; offset += pageSize) {
+		checksum = (checksum ^ PageHashSnapshot::HashPage64(data + offset)) * 0x9E3779B185EBCA87ULL;
+	}
+	if (offset < size) {
+		BYTE tail[PageHashSnapshot::PageSize] = {};
+		memcpy(tail, data + offset, size - offset);
+		checksum = (checksum ^ PageHashSnapshot::HashPage64(tail)) * 0x9E3779B185EBCA87ULL;
+	}
+	return checksum;
+}
+
+std::vector<MemoryRegionInfo> MemoryDumpWriter::SelectRegions(const std::vector<MemoryRegionInfo>& regions, const MemoryDumpOptions& options) {
+	std::vector<MemoryRegionInfo> selected;
+	for (const auto& region : regions) {
+		if (!MemoryManager::IsReadable(region, options.IncludeImages)) {
+			continue;
+		}
+		if ((region.Type == MemoryType::Private && !options.IncludePrivate) ||
+			(region.Type == MemoryType::Mapped && !options.IncludeMapped)) {
+			continue;
+		}
+		if (options.WritableOnly && !IsWritable(region.Protect)) {
+			continue;
+		}
+		selected.push_back(region);
+	}
+	return selected;
+}
+
+MemoryDumpStatistics MemoryDumpWriter::Write(const std::wstring& filePath, const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+	const MemoryDumpOptions& options, const MemoryDumpProgress& progress, const std::atomic<bool>* cancelled) const {
+	MemoryDumpStatistics statistics;
+	if (!read) {
+		return statistics;
+	}
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<MemoryRegionInfo> selected = SelectRegions(regions, options);
+	std::vector<DumpRegion> regionTable;
+	std::vector<BlockJob> jobs;
+	ULONGLONG total = 0;
+	for (const auto& region : selected) {
+		DumpRegion entry = {};
+		entry.BaseAddress = region.BaseAddress;
+		entry.AllocationBase = region.AllocationBase;
+		entry.RegionSize = region.RegionSize;
+		entry.Protect = region.Protect;
+		entry.State = static_cast<BYTE>(region.State);
+		entry.Type = static_cast<BYTE>(region.Type);
+		regionTable.push_back(entry);
+
+		for (SIZE_T offset = 0; offset < region.RegionSize; offset += BlockSize) {
+			jobs.push_back({ region.BaseAddress + offset, static_cast<DWORD>(std::min<SIZE_T>(BlockSize, region.RegionSize - offset)) });
+		}
+		total += region.RegionSize;
+	}
+
+	HandleWrapper file(CreateFileW(filePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!file.IsValid()) {
+		return statistics;
+	}
+
+	DumpHeader header = {};
+	memcpy(header.Magic, DumpMagic, sizeof(header.Magic));
+	header.Version = DumpVersion;
+	header.BlockSize = BlockSize;
+	header.Algorithm = DumpAlgorithm;
+	header.ProcessId = options.ProcessId;
+	GetSystemTimeAsFileTime(&header.CaptureTime);
+	header.RegionCount = regionTable.size();
+	header.BlockCount = jobs.size();
+	std::atomic<bool> failed(!WriteAll(file.Get(), &header, sizeof(header)));
+
+	// Blocks are compressed in parallel and appended under the lock, so at
+	// most one block per worker is held in memory.
+	std::vector<DumpBlock> blocks(jobs.size());
+	std::mutex fileLock;
+	ULONGLONG fileOffset = sizeof(header);
+	ULONGLONG done = 0;
+	std::atomic<size_t> nextJob(0);
+	auto worker = [&]() {
+		std::vector<BYTE> data(BlockSize);
+		std::vector<BYTE> packed(BlockSize);
+		// Without a compressor every block is stored raw.
+		COMPRESSOR_HANDLE compressor = nullptr;
+		if (!CreateCompressor(DumpAlgorithm | COMPRESS_RAW, nullptr, &compressor)) {
+			compressor = nullptr;
+		}
+
+		for (;;) {
+			if (failed || (cancelled && *cancelled)) {
+				break;
+			}
+			size_t index = nextJob++;
+			if (index >= jobs.size()) {
+				break;
+			}
+
+			const BlockJob& job = jobs[index];
+			DumpBlock block = {};
+			const BYTE* payload = nullptr;
+			if (!read(job.Address, data.data(), job.Length, nullptr)) {
+				block.Kind = static_cast<DWORD>(MemoryDumpBlockKind::Unreadable);
+			} else if (IsZero(data.data(), job.Length)) {
+				block.Kind = static_cast<DWORD>(MemoryDumpBlockKind::Zero);
+			} else {
+				block.Checksum = MemoryDumpFile::ComputeChecksum(data.data(), job.Length);
+				SIZE_T packedSize = 0;
+				if (compressor && Compress(compressor, data.data(), job.Length, packed.data(), job.Length, &packedSize) && packedSize < job.Length) {
+					block.Kind = static_cast<DWORD>(MemoryDumpBlockKind::Compressed);
+					block.StoredSize = static_cast<DWORD>(packedSize);
+					payload = packed.data();
+				} else {
+					block.Kind = static_cast<DWORD>(MemoryDumpBlockKind::Raw);
+					block.StoredSize = job.Length;
+					payload = data.data();
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(fileLock);
+			if (payload) {
+				if (!WriteAll(file.Get(), payload, block.StoredSize)) {
+					failed = true;
+					break;
+				}
+				block.FileOffset = fileOffset;
+				fileOffset += block.StoredSize;
+			}
+			blocks[index] = block;
+			switch (static_cast<MemoryDumpBlockKind>(block.Kind)) {
+				case MemoryDumpBlockKind::Zero:
+					++statistics.ZeroBlocks;
+					break;
+				case MemoryDumpBlockKind::Unreadable:
+					++statistics.UnreadableBlocks;
+					break;
+				default:
+					statistics.BytesStored += block.StoredSize;
+					break;
+			}
+			done += job.Length;
+			if (progress) {
+				progress(done, total);
+			}
+		}
+
+		if (compressor) {
+			CloseCompressor(compressor);
+		}
+	};
+
+	size_t workerCount = options.WorkerCount;
+	if (workerCount == 0) {
+		workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+	}
+	workerCount = std::max<size_t>(std::min(workerCount, jobs.size()), 1);
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workerCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	statistics.Cancelled = cancelled && *cancelled;
+	bool completed = !failed && !statistics.Cancelled;
+	if (completed) {
+		LARGE_INTEGER start = {};
+		header.IndexOffset = fileOffset;
+		completed = WriteAll(file.Get(), regionTable.data(), regionTable.size() * sizeof(DumpRegion)) &&
+			WriteAll(file.Get(), blocks.data(), blocks.size() * sizeof(DumpBlock)) &&
+			SetFilePointerEx(file.Get(), start, nullptr, FILE_BEGIN) &&
+			WriteAll(file.Get(), &header, sizeof(header));
+	}
+	file.Reset();
+
+	// Reading the dump back checks the whole path, from the index through
+	// decompression to the bytes that were read. A dump that fails is
+	// kept, since most of it may still be good.
+	if (completed && options.Verify) {
+		MemoryDumpFile dump;
+		if (dump.Open(filePath)) {
+			statistics.BadBlocks = dump.Verify(nullptr, cancelled);
+			statistics.Verified = !(cancelled && *cancelled);
+		} else {
+			statistics.BadBlocks = jobs.size();
+			statistics.Verified = true;
+		}
+	}
+	if (!completed) {
+		DeleteFileW(filePath.c_str());
+	}
+
+	statistics.Completed = completed;
+	statistics.Regions = regionTable.size();
+	statistics.Blocks = jobs.size();
+	statistics.BytesRead = done;
+	statistics.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return statistics;
+}
+
+MemoryDumpFile::~MemoryDumpFile() {
+	Close();
+}
+
+bool MemoryDumpFile::Open(const std::wstring& filePath) {
+	Close();
+	m_File.Reset(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!m_File.IsValid()) {
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	DumpHeader header = {};
+	if (!GetFileSizeEx(m_File.Get(), &size) || !ReadStored(0, &header, sizeof(header))) {
+		Close();
+		return false;
+	}
+	m_FileSize = static_cast<ULONGLONG>(size.QuadPart);
+
+	// Sizes are checked against the file before anything is allocated, so
+	// a damaged index fails here rather than in a read.
+	if (memcmp(header.Magic, DumpMagic, sizeof(header.Magic)) != 0 || header.Version != DumpVersion ||
+		header.BlockSize != MemoryDumpWriter::BlockSize || header.IndexOffset < sizeof(header) ||
+		header.IndexOffset > m_FileSize || header.RegionCount > (m_FileSize - header.IndexOffset) / sizeof(DumpRegion) ||
+		header.BlockCount > (m_FileSize - header.IndexOffset - header.RegionCount * sizeof(DumpRegion)) / sizeof(DumpBlock)) {
+		Close();
+		return false;
+	}
+
+	std::vector<DumpRegion> regionTable(static_cast<size_t>(header.RegionCount));
+	std::vector<DumpBlock> blockTable(static_cast<size_t>(header.BlockCount));
+	ULONGLONG blockTableOffset = header.IndexOffset + regionTable.size() * sizeof(DumpRegion);
+	if (!ReadStored(header.IndexOffset, regionTable.data(), regionTable.size() * sizeof(DumpRegion)) ||
+		!ReadStored(blockTableOffset, blockTable.data(), blockTable.size() * sizeof(DumpBlock))) {
+		Close();
+		return false;
+	}
+
+	ULONGLONG blockTotal = 0;
+	ULONGLONG previousEnd = 0;
+	for (const auto& entry : regionTable) {
+		if (entry.RegionSize == 0 || entry.BaseAddress < previousEnd || entry.BaseAddress + entry.RegionSize < entry.BaseAddress ||
+			static_cast<ULONG_PTR>(entry.BaseAddress + entry.RegionSize - 1) != entry.BaseAddress + entry.RegionSize - 1) {
+			Close();
+			return false;
+		}
+		previousEnd = entry.BaseAddress + entry.RegionSize;
+
+		MemoryRegionInfo region;
+		region.BaseAddress = static_cast<ULONG_PTR>(entry.BaseAddress);
+		region.AllocationBase = static_cast<ULONG_PTR>(entry.AllocationBase);
+		region.RegionSize = static_cast<SIZE_T>(entry.RegionSize);
+		region.Protect = entry.Protect;
+		region.State = static_cast<MemoryState>(entry.State);
+		region.Type = static_cast<MemoryType>(entry.Type);
+		m_Regions.push_back(region);
+		m_FirstBlocks.push_back(static_cast<size_t>(blockTotal));
+		blockTotal += (entry.RegionSize + MemoryDumpWriter::BlockSize - 1) / MemoryDumpWriter::BlockSize;
+	}
+	if (blockTotal != header.BlockCount) {
+		Close();
+		return false;
+	}
+
+	m_Blocks.reserve(blockTable.size());
+	for (const auto& entry : blockTable) {
+		MemoryDumpBlock block;
+		block.FileOffset = entry.FileOffset;
+		block.StoredSize = entry.StoredSize;
+		block.Kind = static_cast<MemoryDumpBlockKind>(entry.Kind);
+		block.Checksum = entry.Checksum;
+		bool stored = block.Kind == MemoryDumpBlockKind::Raw || block.Kind == MemoryDumpBlockKind::Compressed;
+		if (entry.Kind > static_cast<DWORD>(MemoryDumpBlockKind::Unreadable) ||
+			(stored && (block.StoredSize > MemoryDumpWriter::BlockSize || block.FileOffset < sizeof(header) ||
+				block.FileOffset > header.IndexOffset || block.StoredSize > header.IndexOffset - block.FileOffset))) {
+			Close();
+			return false;
+		}
+		m_Blocks.push_back(block);
+	}
+
+	m_ProcessId = header.ProcessId;
+	m_CaptureTime = header.CaptureTime;
+	m_Algorithm = header.Algorithm;
+	return true;
+}
+
+void MemoryDumpFile::Close() {
+	m_File.Reset();
+	m_FileSize = 0;
+	m_ProcessId = 0;
+	m_CaptureTime = {};
+	m_Algorithm = 0;
+	m_Regions.clear();
+	m_FirstBlocks.clear();
+	m_Blocks.clear();
+
+	std::lock_guard<std::mutex> lock(m_DecompressorLock);
+	for (auto decompressor : m_Decompressors) {
+		CloseDecompressor(decompressor);
+	}
+	m_Decompressors.clear();
+}
+
+bool MemoryDumpFile::Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) const {
+	if (!m_File.IsValid() || size == 0) {
+		return false;
+	}
+
+	ResetFailedPages(failedPages, address, size);
+	BYTE* out = static_cast<BYTE*>(buffer);
+	memset(out, 0, size);
+	ULONG_PTR end = address + size;
+	if (end < address) {
+		end = static_cast<ULONG_PTR>(-1);
+	}
+
+	auto it = std::upper_bound(m_Regions.begin(), m_Regions.end(), address, [](ULONG_PTR value, const MemoryRegionInfo& region) {
+		return value < region.BaseAddress;
+	});
+	if (it != m_Regions.begin()) {
+		--it;
+	}
+
+	// Bytes between the regions read were not dumped.
+	std::vector<BYTE> blockBuffer;
+	bool anyRead = false;
+	ULONG_PTR covered = address;
+	for (size_t regionIndex = it - m_Regions.begin(); regionIndex < m_Regions.size(); ++regionIndex) {
+		const MemoryRegionInfo& region = m_Regions[regionIndex];
+		if (region.BaseAddress >= end) {
+			break;
+		}
+		ULONG_PTR current = std::max(address, region.BaseAddress);
+		ULONG_PTR stop = std::min<ULONG_PTR>(end, region.BaseAddress + region.RegionSize);
+		if (current >= stop) {
+			continue;
+		}
+		if (current > covered) {
+			MarkFailedPages(failedPages, address, covered, current - covered);
+		}
+		covered = std::max(covered, stop);
+
+		while (current < stop) {
+			ULONG_PTR offset = current - region.BaseAddress;
+			ULONG_PTR blockStart = offset - offset % MemoryDumpWriter::BlockSize;
+			size_t block = m_FirstBlocks[regionIndex] + blockStart / MemoryDumpWriter::BlockSize;
+			DWORD blockLength = static_cast<DWORD>(std::min<ULONG_PTR>(MemoryDumpWriter::BlockSize, region.RegionSize - blockStart));
+			size_t skip = static_cast<size_t>(offset - blockStart);
+			size_t length = std::min<size_t>(stop - current, blockLength - skip);
+			BYTE* target = out + (current - address);
+
+			// Whole blocks are decoded in place.
+			bool blockRead = false;
+			if (skip == 0 && length == blockLength) {
+				blockRead = ReadBlock(block, blockLength, target);
+			} else {
+				blockBuffer.resize(blockLength);
+				if (ReadBlock(block, blockLength, blockBuffer.data())) {
+					memcpy(target, blockBuffer.data() + skip, length);
+					blockRead = true;
+				}
+			}
+			if (!blockRead) {
+				MarkFailedPages(failedPages, address, current, length);
+			}
+			anyRead |= blockRead;
+			current += length;
+		}
+	}
+	if (covered < end) {
+		MarkFailedPages(failedPages, address, covered, end - covered);
+	}
+	return anyRead;
+}
+
+MemoryReadFunction MemoryDumpFile::GetReadFunction() const {
+	return [this](ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) {
+		return Read(address, buffer, size, failedPages);
+	};
+}
+
+ULONGLONG MemoryDumpFile::Verify(const MemoryDumpProgress& progress, const std::atomic<bool>* cancelled) const {
+	ULONGLONG total = 0;
+	for (const auto& region : m_Regions) {
+		total += region.RegionSize;
+	}
+
+	std::vector<BYTE> buffer(MemoryDumpWriter::BlockSize);
+	ULONGLONG badBlocks = 0;
+	ULONGLONG done = 0;
+	for (size_t regionIndex = 0; regionIndex < m_Regions.size(); ++regionIndex) {
+		const MemoryRegionInfo& region = m_Regions[regionIndex];
+		for (SIZE_T offset = 0; offset < region.RegionSize; offset += MemoryDumpWriter::BlockSize) {
+			if (cancelled && *cancelled) {
+				return badBlocks;
+			}
+			size_t block = m_FirstBlocks[regionIndex] + offset / MemoryDumpWriter::BlockSize;
+			DWORD length = static_cast<DWORD>(std::min<SIZE_T>(MemoryDumpWriter::BlockSize, region.RegionSize - offset));
+			MemoryDumpBlockKind kind = m_Blocks[block].Kind;
+			bool stored = kind == MemoryDumpBlockKind::Raw || kind == MemoryDumpBlockKind::Compressed;
+			if (stored && !ReadBlock(block, length, buffer.data())) {
+				++badBlocks;
+			}
+			done += length;
+			if (progress) {
+				progress(done, total);
+			}
+		}
+	}
+	return badBlocks;
+}
+
+bool MemoryDumpFile::ReadBlock(size_t block, DWORD length, BYTE* buffer) const {
+	const MemoryDumpBlock& entry = m_Blocks[block];
+	bool ok = false;
+	switch (entry.Kind) {
+		case MemoryDumpBlockKind::Zero:
+			memset(buffer, 0, length);
+			return true;
+		case MemoryDumpBlockKind::Raw:
+			ok = entry.StoredSize == length && ReadStored(entry.FileOffset, buffer, length);
+			break;
+		case MemoryDumpBlockKind::Compressed: {
+			std::vector<BYTE> packed(entry.StoredSize);
+			if (!ReadStored(entry.FileOffset, packed.data(), entry.StoredSize)) {
+				break;
+			}
+
+			DECOMPRESSOR_HANDLE decompressor = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(m_DecompressorLock);
+				if (!m_Decompressors.empty()) {
+					decompressor = m_Decompressors.back();
+					m_Decompressors.pop_back();
+				}
+			}
+			if (!decompressor && !CreateDecompressor(m_Algorithm | COMPRESS_RAW, nullptr, &decompressor)) {
+				break;
+			}
+
+			SIZE_T decoded = 0;
+			ok = Decompress(decompressor, packed.data(), entry.StoredSize, buffer, length, &decoded) && decoded == length;
+			std::lock_guard<std::mutex> lock(m_DecompressorLock);
+			m_Decompressors.push_back(decompressor);
+			break;
+		}
+		default:
+			break;
+	}
+
+	if (ok) {
+		ok = ComputeChecksum(buffer, length) == entry.Checksum;
+	}
+	if (!ok) {
+		memset(buffer, 0, length);
+	}
+	return ok;
+}
+
+bool MemoryDumpFile::ReadStored(ULONGLONG offset, void* buffer, size_t size) const {
+	BYTE* out = static_cast<BYTE*>(buffer);
+	size_t done = 0;
+	while (done < size) {
+		// Reads carry their own offset, so threads can share the handle.
+		OVERLAPPED overlapped = {};
+		ULONGLONG position = offset + done;
+		overlapped.Offset = static_cast<DWORD>(position);
+		overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+		DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - done, 0x40000000));
+		DWORD bytesRead = 0;
+		if (!ReadFile(m_File.Get(), out + done, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+			return false;
+		}
+		done += bytesRead;
+	}
+	return true;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
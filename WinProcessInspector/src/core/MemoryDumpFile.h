@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Windows.h>
+#include <compressapi.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "HandleWrapper.h"
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct MemoryDumpOptions {
+		// Kinds of committed, readable region written to the dump.
+		bool IncludePrivate = true;
+		bool IncludeMapped = true;
+		bool IncludeImages = true;
+		// Only regions that can be written to, such as heaps and stacks.
+		bool WritableOnly = false;
+		// 0 picks one worker per core, up to 8.
+		size_t WorkerCount = 0;
+		// Recorded in the dump for the reader.
+		DWORD ProcessId = 0;
+		// Reopen the finished dump and decode every block against its
+		// checksum.
+		bool Verify = true;
+	};
+
+	struct MemoryDumpStatistics {
+		bool Completed = false;
+		bool Cancelled = false;
+		size_t Regions = 0;
+		ULONGLONG Blocks = 0;
+		ULONGLONG ZeroBlocks = 0;
+		ULONGLONG UnreadableBlocks = 0;
+		// Memory covered by the dump, and the file bytes its blocks took.
+		ULONGLONG BytesRead = 0;
+		ULONGLONG BytesStored = 0;
+		// Set when the verify pass ran; BadBlocks failed to decode to the
+		// bytes that were read.
+		bool Verified = false;
+		ULONGLONG BadBlocks = 0;
+		double Seconds = 0.0;
+	};
+
+	enum class MemoryDumpBlockKind : DWORD {
+		Raw,
+		Compressed,
+		// Nothing is stored for zero and unreadable blocks; both read as zeros.
+		Zero,
+		Unreadable
+	};
+
+	struct MemoryDumpBlock {
+		ULONGLONG FileOffset = 0;
+		DWORD StoredSize = 0;
+		MemoryDumpBlockKind Kind = MemoryDumpBlockKind::Unreadable;
+		// Of the block's memory; zero for blocks with nothing stored.
+		ULONGLONG Checksum = 0;
+	};
+
+	// Memory bytes written so far and in all. Calls never overlap.
+	typedef std::function<void(ULONGLONG done, ULONGLONG total)> MemoryDumpProgress;
+
+	// Writes process memory to a chunked dump file. Regions are cut into
+	// blocks of BlockSize that worker threads read and compress on their
+	// own, then append to the file in whatever order they finish; an index
+	// at the end maps every block to its place in the file and holds a
+	// checksum of its memory. The header points at the index only once the
+	// dump is complete, so an interrupted dump is never taken for a whole
+	// one.
+	class MemoryDumpWriter {
+	public:
+		static const DWORD BlockSize = 0x100000;
+
+		MemoryDumpWriter() = default;
+		~MemoryDumpWriter() = default;
+
+		MemoryDumpWriter(const MemoryDumpWriter&) = delete;
+		MemoryDumpWriter& operator=(const MemoryDumpWriter&) = delete;
+
+		// The file is deleted unless the dump completes.
+		MemoryDumpStatistics Write(const std::wstring& filePath, const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+			const MemoryDumpOptions& options, const MemoryDumpProgress& progress = nullptr, const std::atomic<bool>* cancelled = nullptr) const;
+
+		static std::vector<MemoryRegionInfo> SelectRegions(const std::vector<MemoryRegionInfo>& regions, const MemoryDumpOptions& options);
+	};
+
+	// Opens a dump written by MemoryDumpWriter. Only the header and index
+	// are loaded; blocks are read, decompressed and checked against their
+	// checksums as addresses are read, so a dump of any size opens quickly
+	// and reads can run in parallel.
+	class MemoryDumpFile {
+	public:
+		MemoryDumpFile() = default;
+		~MemoryDumpFile();
+
+		MemoryDumpFile(const MemoryDumpFile&) = delete;
+		MemoryDumpFile& operator=(const MemoryDumpFile&) = delete;
+
+		bool Open(const std::wstring& filePath);
+		void Close();
+		bool IsOpen() const { return m_File.IsValid(); }
+
+		DWORD GetProcessId() const { return m_ProcessId; }
+		FILETIME GetCaptureTime() const { return m_CaptureTime; }
+		const std::vector<MemoryRegionInfo>& GetRegions() const { return m_Regions; }
+		const std::vector<MemoryDumpBlock>& GetBlocks() const { return m_Blocks; }
+
+		// Bytes outside the dump and in blocks that could not be read come
+		// back as zeros, with their pages flagged in failedPages. Fails if
+		// none of the range was dumped.
+		bool Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages = nullptr) const;
+		// Bound to this dump, which must outlive it.
+		MemoryReadFunction GetReadFunction() const;
+
+		// Decodes every stored block and returns how many did not match their
+		// checksums. progress counts memory bytes.
+		ULONGLONG Verify(const MemoryDumpProgress& progress = nullptr, const std::atomic<bool>* cancelled = nullptr) const;
+
+		// Of size bytes of memory, which is whole pages but for a block at
+		// the end of an odd-sized region.
+		static ULONGLONG ComputeChecksum(const BYTE* data, size_t size);
+
+	private:
+		// Blocks that do not match their checksums read as zeros.
+		bool ReadBlock(size_t block, DWORD length, BYTE* buffer) const;
+		bool ReadStored(ULONGLONG offset, void* buffer, size_t size) const;
+
+		HandleWrapper m_File;
+		ULONGLONG m_FileSize = 0;
+		DWORD m_ProcessId = 0;
+		FILETIME m_CaptureTime = {};
+		DWORD m_Algorithm = 0;
+		std::vector<MemoryRegionInfo> m_Regions;
+		// Index of each region's first block.
+		std::vector<size_t> m_FirstBlocks;
+		std::vector<MemoryDumpBlock> m_Blocks;
+
+		// A decompressor serves one call at a time, so idle ones are pooled.
+		mutable std::mutex m_DecompressorLock;
+		mutable std::vector<DECOMPRESSOR_HANDLE> m_Decompressors;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
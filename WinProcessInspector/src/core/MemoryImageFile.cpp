@@ -0,0 +1,89 @@
+#include "MemoryImageFile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace WinProcessInspector {
+namespace Core {
+
+bool MemoryImageFile::Open(const std::wstring& filePath, ULONG_PTR baseAddress) {
+	Close();
+	m_File.Reset(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!m_File.IsValid()) {
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(m_File.Get(), &size)) {
+		m_File.Reset();
+		return false;
+	}
+	m_Size = static_cast<ULONGLONG>(size.QuadPart);
+	m_BaseAddress = baseAddress;
+	return true;
+}
+
+void MemoryImageFile::Close() {
+	m_File.Reset();
+	m_Size = 0;
+	m_BaseAddress = 0;
+}
+
+bool MemoryImageFile::Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) const {
+	if (!m_File.IsValid() || size == 0 || address < m_BaseAddress) {
+		return false;
+	}
+
+	ULONGLONG offset = address - m_BaseAddress;
+	if (offset >= m_Size) {
+		return false;
+	}
+
+	BYTE* out = static_cast<BYTE*>(buffer);
+	size_t available = static_cast<size_t>(std::min<ULONGLONG>(size, m_Size - offset));
+	size_t done = 0;
+	while (done < available) {
+		// The offset in OVERLAPPED makes each read independent of the file
+		// pointer, so workers can share the handle.
+		OVERLAPPED overlapped = {};
+		ULONGLONG position = offset + done;
+		overlapped.Offset = static_cast<DWORD>(position);
+		overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+		DWORD chunk = static_cast<DWORD>(std::min<size_t>(available - done, 0x40000000));
+		DWORD bytesRead = 0;
+		if (!ReadFile(m_File.Get(), out + done, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+			break;
+		}
+		done += bytesRead;
+	}
+
+	ResetFailedPages(failedPages, address, size);
+	if (done < size) {
+		memset(out + done, 0, size - done);
+		MarkFailedPages(failedPages, address, address + done, size - done);
+	}
+	return done > 0;
+}
+
+MemoryReadFunction MemoryImageFile::GetReadFunction() const {
+	return [this](ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) {
+		return Read(address, buffer, size, failedPages);
+	};
+}
+
+std::vector<MemoryRegionInfo> MemoryImageFile::GetRegions() const {
+	std::vector<MemoryRegionInfo> regions;
+	if (m_File.IsValid() && m_Size > 0) {
+		MemoryRegionInfo region = {};
+		region.BaseAddress = m_BaseAddress;
+		region.AllocationBase = m_BaseAddress;
+		region.RegionSize = static_cast<SIZE_T>(m_Size);
+		region.Protect = PAGE_READONLY;
+		region.State = MemoryState::Commit;
+		region.Type = MemoryType::Private;
+		regions.push_back(region);
+	}
+	return regions;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include "HandleWrapper.h"
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// A raw memory image on disk, such as a region saved from a process,
+	// read as if it were mapped at a chosen base address. Lets the
+	// scanners run against a fixed input.
+	class MemoryImageFile {
+	public:
+		MemoryImageFile() = default;
+		~MemoryImageFile() = default;
+
+		MemoryImageFile(const MemoryImageFile&) = delete;
+		MemoryImageFile& operator=(const MemoryImageFile&) = delete;
+		MemoryImageFile(MemoryImageFile&&) = default;
+		MemoryImageFile& operator=(MemoryImageFile&&) = default;
+
+		bool Open(const std::wstring& filePath, ULONG_PTR baseAddress = 0);
+		void Close();
+		bool IsOpen() const { return m_File.IsValid(); }
+		ULONGLONG GetSize() const { return m_Size; }
+		ULONG_PTR GetBaseAddress() const { return m_BaseAddress; }
+
+		// Bytes past the end of the file read as zero, with their pages
+		// flagged in failedPages.
+		bool Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages = nullptr) const;
+		// Bound to this image, which must outlive it.
+		MemoryReadFunction GetReadFunction() const;
+		// One committed, read-only private region covering the file.
+		std::vector<MemoryRegionInfo> GetRegions() const;
+
+	private:
+		HandleWrapper m_File;
+		ULONG_PTR m_BaseAddress = 0;
+		ULONGLONG m_Size = 0;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
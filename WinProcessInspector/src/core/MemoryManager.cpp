@@ -1,11 +1,44 @@
 #include "MemoryManager.h"
 #include "HandleWrapper.h"
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <cstring>
 
 namespace WinProcessInspector {
 namespace Core {
 
+namespace {
+
+	struct ProtectionName {
+		DWORD Flag;
+		std::wstring_view Name;
+	};
+
+	constexpr ProtectionName BaseProtections[] = {
+		{ PAGE_NOACCESS, L"No Access" },
+		{ PAGE_READONLY, L"Read-Only" },
+		{ PAGE_READWRITE, L"Read/Write" },
+		{ PAGE_WRITECOPY, L"Write Copy" },
+		{ PAGE_EXECUTE, L"Execute" },
+		{ PAGE_EXECUTE_READ, L"Execute/Read" },
+		{ PAGE_EXECUTE_READWRITE, L"Execute/Read/Write" },
+		{ PAGE_EXECUTE_WRITECOPY, L"Execute/Write Copy" }
+	};
+
+	constexpr ProtectionName ProtectionModifiers[] = {
+		{ PAGE_GUARD, L" | Guard" },
+		{ PAGE_NOCACHE, L" | No Cache" },
+		{ PAGE_WRITECOMBINE, L" | Write Combine" }
+	};
+
+	// Indexed by MemoryState and MemoryType.
+	constexpr std::wstring_view StateNames[] = { L"Unknown", L"Committed", L"Reserved", L"Free" };
+	constexpr std::wstring_view TypeNames[] = { L"Unknown", L"Image", L"Mapped", L"Private" };
+
+	constexpr std::wstring_view NoProtection = L"";
+	constexpr std::wstring_view UnknownProtection = L"Unknown";
+
+}
+
 std::vector<MemoryRegionInfo> MemoryManager::EnumerateMemoryRegions(DWORD processId) const {
 	std::vector<MemoryRegionInfo> regions;
 
@@ -20,15 +53,11 @@ std::vector<MemoryRegionInfo> MemoryManager::EnumerateMemoryRegions(DWORD proces
 	while (VirtualQueryEx(hProcess.Get(), reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi)) == sizeof(mbi)) {
 		MemoryRegionInfo info;
 		info.BaseAddress = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress);
+		info.AllocationBase = reinterpret_cast<ULONG_PTR>(mbi.AllocationBase);
 		info.RegionSize = mbi.RegionSize;
-		info.State = mbi.State;
 		info.Protect = mbi.Protect;
-		info.Type = mbi.Type;
-
-		info.ProtectionString = ProtectionToString(mbi.Protect);
-		info.StateString = StateToString(mbi.State);
-		info.TypeString = TypeToString(mbi.Type);
-
+		info.State = StateFromFlags(mbi.State);
+		info.Type = TypeFromFlags(mbi.Type);
 		regions.push_back(info);
 
 		address = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress) + mbi.RegionSize;
@@ -41,97 +70,103 @@ std::vector<MemoryRegionInfo> MemoryManager::EnumerateMemoryRegions(DWORD proces
 	return regions;
 }
 
-std::wstring MemoryManager::ProtectionToString(DWORD protect) {
-	if (protect == 0) {
-		return L"";
-	}
-
-	std::wstring result;
-
-	switch (protect & 0xFF) {
-		case PAGE_NOACCESS:
-			result = L"No Access";
-			break;
-		case PAGE_READONLY:
-			result = L"Read-Only";
-			break;
-		case PAGE_READWRITE:
-			result = L"Read/Write";
-			break;
-		case PAGE_WRITECOPY:
-			result = L"Write Copy";
-			break;
-		case PAGE_EXECUTE:
-			result = L"Execute";
-			break;
-		case PAGE_EXECUTE_READ:
-			result = L"Execute/Read";
-			break;
-		case PAGE_EXECUTE_READWRITE:
-			result = L"Execute/Read/Write";
-			break;
-		case PAGE_EXECUTE_WRITECOPY:
-			result = L"Execute/Write Copy";
-			break;
-		case PAGE_GUARD:
-			result = L"Guard";
-			break;
-		case PAGE_NOCACHE:
-			result = L"No Cache";
-			break;
-		case PAGE_WRITECOMBINE:
-			result = L"Write Combine";
-			break;
-		default:
-			result = L"Unknown";
-			break;
-	}
-
-	if (protect & PAGE_GUARD) {
-		result += L" | Guard";
-	}
-	if (protect & PAGE_NOCACHE) {
-		result += L" | No Cache";
-	}
-	if (protect & PAGE_WRITECOMBINE) {
-		result += L" | Write Combine";
-	}
-
-	return result;
-}
-
-std::wstring MemoryManager::StateToString(DWORD state) {
+MemoryState MemoryManager::StateFromFlags(DWORD state) {
 	switch (state) {
 		case MEM_COMMIT:
-			return L"Committed";
+			return MemoryState::Commit;
 		case MEM_RESERVE:
-			return L"Reserved";
+			return MemoryState::Reserve;
 		case MEM_FREE:
-			return L"Free";
-		case MEM_DECOMMIT:
-			return L"Decommitted";
-		case MEM_RELEASE:
-			return L"Released";
+			return MemoryState::Free;
 		default:
-			return L"Unknown";
+			return MemoryState::Unknown;
 	}
 }
 
-std::wstring MemoryManager::TypeToString(DWORD type) {
+MemoryType MemoryManager::TypeFromFlags(DWORD type) {
 	switch (type) {
 		case MEM_IMAGE:
-			return L"Image";
+			return MemoryType::Image;
 		case MEM_MAPPED:
-			return L"Mapped";
+			return MemoryType::Mapped;
 		case MEM_PRIVATE:
-			return L"Private";
+			return MemoryType::Private;
 		default:
-			return L"Unknown";
+			return MemoryType::Unknown;
 	}
 }
 
-void MemoryManager::FormatProtection(DWORD protect, std::wstring& result) {
-	result = ProtectionToString(protect);
+std::wstring_view MemoryManager::StateToString(MemoryState state) {
+	size_t index = static_cast<size_t>(state);
+	return index < _countof(StateNames) ? StateNames[index] : StateNames[0];
+}
+
+std::wstring_view MemoryManager::TypeToString(MemoryType type) {
+	size_t index = static_cast<size_t>(type);
+	return index < _countof(TypeNames) ? TypeNames[index] : TypeNames[0];
+}
+
+std::wstring_view MemoryManager::ProtectionBaseToString(DWORD protect) {
+	if (protect == 0) {
+		return NoProtection;
+	}
+	for (const auto& entry : BaseProtections) {
+		if ((protect & 0xFF) == entry.Flag) {
+			return entry.Name;
+		}
+	}
+	return UnknownProtection;
+}
+
+std::wstring MemoryManager::ProtectionToString(DWORD protect) {
+	wchar_t buffer[64];
+	size_t length = FormatProtection(protect, buffer, _countof(buffer));
+	return std::wstring(buffer, length);
+}
+
+size_t MemoryManager::FormatProtection(DWORD protect, wchar_t* buffer, size_t bufferSize) {
+	if (bufferSize == 0) {
+		return 0;
+	}
+
+	size_t length = 0;
+	auto append = [&](std::wstring_view text) {
+		size_t count = std::min(text.size(), bufferSize - 1 - length);
+		memcpy(buffer + length, text.data(), count * sizeof(wchar_t));
+		length += count;
+	};
+
+	append(ProtectionBaseToString(protect));
+	for (const auto& modifier : ProtectionModifiers) {
+		if (protect & modifier.Flag) {
+			append(modifier.Name);
+		}
+	}
+	buffer[length] = L'\0';
+	return length;
+}
+
+bool MemoryManager::IsReadable(const MemoryRegionInfo& region, bool includeImages) {
+	if (region.State != MemoryState::Commit || region.RegionSize == 0) {
+		return false;
+	}
+	if (!includeImages && region.Type == MemoryType::Image) {
+		return false;
+	}
+	if (region.Protect & PAGE_GUARD) {
+		return false;
+	}
+	switch (region.Protect & 0xFF) {
+		case PAGE_READONLY:
+		case PAGE_READWRITE:
+		case PAGE_WRITECOPY:
+		case PAGE_EXECUTE_READ:
+		case PAGE_EXECUTE_READWRITE:
+		case PAGE_EXECUTE_WRITECOPY:
+			return true;
+		default:
+			return false;
+	}
 }
 
 } // namespace Core
@@ -3,19 +3,34 @@
 #include <Windows.h>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace WinProcessInspector {
 namespace Core {
 
+	enum class MemoryState : BYTE {
+		Unknown,
+		Commit,
+		Reserve,
+		Free
+	};
+
+	enum class MemoryType : BYTE {
+		Unknown,
+		Image,
+		Mapped,
+		Private
+	};
+
+	// One VirtualQueryEx result. Kept to plain codes so large address
+	// spaces stay cheap to enumerate; text is produced when displayed.
 	struct MemoryRegionInfo {
 		ULONG_PTR BaseAddress = 0;
+		ULONG_PTR AllocationBase = 0;
 		SIZE_T RegionSize = 0;
-		DWORD State = 0;
 		DWORD Protect = 0;
-		DWORD Type = 0;
-		std::wstring ProtectionString;
-		std::wstring StateString;
-		std::wstring TypeString;
+		MemoryState State = MemoryState::Unknown;
+		MemoryType Type = MemoryType::Unknown;
 	};
 
 	class MemoryManager {
@@ -30,14 +45,23 @@ namespace Core {
 
 		std::vector<MemoryRegionInfo> EnumerateMemoryRegions(DWORD processId) const;
 
-		static std::wstring ProtectionToString(DWORD protect);
+		static MemoryState StateFromFlags(DWORD state);
+		static MemoryType TypeFromFlags(DWORD type);
 
-		static std::wstring StateToString(DWORD state);
+		// Views of static, null-terminated strings.
+		static std::wstring_view StateToString(MemoryState state);
+		static std::wstring_view TypeToString(MemoryType type);
+		// Base protection only, without the Guard, No Cache and Write Combine
+		// modifiers.
+		static std::wstring_view ProtectionBaseToString(DWORD protect);
 
-		static std::wstring TypeToString(DWORD type);
+		static std::wstring ProtectionToString(DWORD protect);
+		// Writes the full protection text into buffer, truncated to fit, and
+		// returns its length.
+		static size_t FormatProtection(DWORD protect, wchar_t* buffer, size_t bufferSize);
 
-	private:
-		static void FormatProtection(DWORD protect, std::wstring& result);
+		// Committed, readable and not a guard page; images are optional.
+		static bool IsReadable(const MemoryRegionInfo& region, bool includeImages);
 	};
 
 } // namespace Core
@@ -0,0 +1,605 @@
+#include "MinidumpFile.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const DWORD MinidumpSignature = 0x504D444D;
+	const DWORD MinidumpVersion = 0xA793;
+	const DWORD MiscInfoProcessId = 0x00000001;
+
+	// The on-disk layouts, from minidumpapiset.h.
+#pragma pack(push, 1)
+	struct DumpHeader {
+		DWORD Signature;
+		DWORD Version;
+		DWORD NumberOfStreams;
+		DWORD StreamDirectoryRva;
+		DWORD CheckSum;
+		DWORD TimeDateStamp;
+		ULONGLONG Flags;
+	};
+
+	struct DumpLocation {
+		DWORD DataSize;
+		DWORD Rva;
+	};
+
+	struct DumpDirectory {
+		DWORD StreamType;
+		DumpLocation Location;
+	};
+
+	struct DumpMemoryDescriptor {
+		ULONGLONG StartOfMemoryRange;
+		DumpLocation Memory;
+	};
+
+	struct DumpMemoryDescriptor64 {
+		ULONGLONG StartOfMemoryRange;
+		ULONGLONG DataSize;
+	};
+
+	struct DumpThread {
+		DWORD ThreadId;
+		DWORD SuspendCount;
+		DWORD PriorityClass;
+		DWORD Priority;
+		ULONGLONG Teb;
+		DumpMemoryDescriptor Stack;
+		DumpLocation ThreadContext;
+	};
+
+	struct DumpThreadInfo {
+		DWORD ThreadId;
+		DWORD DumpFlags;
+		DWORD DumpError;
+		DWORD ExitStatus;
+		ULONGLONG CreateTime;
+		ULONGLONG ExitTime;
+		ULONGLONG KernelTime;
+		ULONGLONG UserTime;
+		ULONGLONG StartAddress;
+		ULONGLONG Affinity;
+	};
+
+	struct DumpModule {
+		ULONGLONG BaseOfImage;
+		DWORD SizeOfImage;
+		DWORD CheckSum;
+		DWORD TimeDateStamp;
+		DWORD ModuleNameRva;
+		BYTE VersionInfo[52];
+		DumpLocation CvRecord;
+		DumpLocation MiscRecord;
+		ULONGLONG Reserved0;
+		ULONGLONG Reserved1;
+	};
+
+	struct DumpMemoryInfo {
+		ULONGLONG BaseAddress;
+		ULONGLONG AllocationBase;
+		DWORD AllocationProtect;
+		DWORD Alignment1;
+		ULONGLONG RegionSize;
+		DWORD State;
+		DWORD Protect;
+		DWORD Type;
+		DWORD Alignment2;
+	};
+
+	// Headers of the lists whose entries carry their own size.
+	struct DumpThreadInfoList {
+		DWORD SizeOfHeader;
+		DWORD SizeOfEntry;
+		DWORD NumberOfEntries;
+	};
+
+	struct DumpMemoryInfoList {
+		DWORD SizeOfHeader;
+		DWORD SizeOfEntry;
+		ULONGLONG NumberOfEntries;
+	};
+
+	struct DumpMemory64List {
+		ULONGLONG NumberOfMemoryRanges;
+		ULONGLONG BaseRva;
+	};
+
+	struct DumpMiscInfo {
+		DWORD SizeOfInfo;
+		DWORD Flags1;
+		DWORD ProcessId;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(DumpThread) == 48, "MINIDUMP_THREAD layout");
+	static_assert(sizeof(DumpModule) == 108, "MINIDUMP_MODULE layout");
+	static_assert(sizeof(DumpMemoryInfo) == 48, "MINIDUMP_MEMORY_INFO layout");
+
+	// Views are not aligned, so fields are copied out.
+	template <typename T>
+	T Load(const BYTE* data) {
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	// Entries of a list that starts with a 32-bit count. Some writers pad
+	// the count to eight bytes, which shows as four spare bytes.
+	const BYTE* ListEntries(const MinidumpStream& stream, size_t entrySize, size_t& count) {
+		count = 0;
+		if (stream.Size < sizeof(DWORD)) {
+			return nullptr;
+		}
+		DWORD declared = Load<DWORD>(stream.Data);
+		ULONGLONG needed = sizeof(DWORD) + static_cast<ULONGLONG>(declared) * entrySize;
+		if (needed + sizeof(DWORD) == stream.Size) {
+			needed += sizeof(DWORD);
+		}
+		if (needed > stream.Size) {
+			declared = static_cast<DWORD>((stream.Size - sizeof(DWORD)) / entrySize);
+			needed = sizeof(DWORD) + static_cast<ULONGLONG>(declared) * entrySize;
+		}
+		count = declared;
+		return stream.Data + (needed - static_cast<ULONGLONG>(declared) * entrySize);
+	}
+
+	bool FitsAddressSpace(ULONGLONG base, ULONGLONG size) {
+		ULONGLONG last = base + size - 1;
+		return size != 0 && last >= base && static_cast<ULONG_PTR>(last) == last;
+	}
+
+#if !defined(_WIN32)
+	std::string ToUtf8(const std::wstring& text) {
+		std::string result;
+		for (wchar_t c : text) {
+			unsigned long code = static_cast<unsigned long>(c);
+			if (code < 0x80) {
+				result += static_cast<char>(code);
+			} else if (code < 0x800) {
+				result += static_cast<char>(0xC0 | (code >> 6));
+				result += static_cast<char>(0x80 | (code & 0x3F));
+			} else if (code < 0x10000) {
+				result += static_cast<char>(0xE0 | (code >> 12));
+				result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				result += static_cast<char>(0x80 | (code & 0x3F));
+			} else {
+				result += static_cast<char>(0xF0 | (code >> 18));
+				result += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				result += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+		return result;
+	}
+#endif
+
+}
+
+MinidumpFile::~MinidumpFile() {
+	Close();
+}
+
+bool MinidumpFile::Open(const std::wstring& filePath) {
+	Close();
+
+#if defined(_WIN32)
+	m_File.Reset(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+	LARGE_INTEGER size = {};
+	if (!m_File.IsValid() || !GetFileSizeEx(m_File.Get(), &size) || size.QuadPart == 0 ||
+		static_cast<ULONGLONG>(size.QuadPart) != static_cast<SIZE_T>(size.QuadPart)) {
+		Close();
+		return false;
+	}
+	m_Mapping.Reset(CreateFileMappingW(m_File.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	if (!m_Mapping.IsValid()) {
+		Close();
+		return false;
+	}
+	m_View = static_cast<const BYTE*>(MapViewOfFile(m_Mapping.Get(), FILE_MAP_READ, 0, 0, 0));
+	m_Size = static_cast<ULONGLONG>(size.QuadPart);
+#else
+	m_File = open(ToUtf8(filePath).c_str(), O_RDONLY);
+	struct stat status = {};
+	if (m_File < 0 || fstat(m_File, &status) != 0 || status.st_size == 0 ||
+		static_cast<ULONGLONG>(status.st_size) != static_cast<size_t>(status.st_size)) {
+		Close();
+		return false;
+	}
+	void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, m_File, 0);
+	m_View = view != MAP_FAILED ? static_cast<const BYTE*>(view) : nullptr;
+	m_Size = static_cast<ULONGLONG>(status.st_size);
+#endif
+
+	if (!m_View || !Parse()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MinidumpFile::Close() {
+#if defined(_WIN32)
+	if (m_View) {
+		UnmapViewOfFile(m_View);
+	}
+	m_Mapping.Reset();
+	m_File.Reset();
+#else
+	if (m_View) {
+		munmap(const_cast<BYTE*>(m_View), static_cast<size_t>(m_Size));
+	}
+	if (m_File >= 0) {
+		close(m_File);
+		m_File = -1;
+	}
+#endif
+	m_View = nullptr;
+	m_Size = 0;
+
+	m_ProcessId = 0;
+	m_TimeDateStamp = 0;
+	m_Streams.clear();
+	m_Modules.clear();
+	m_Threads.clear();
+	m_Regions.clear();
+	m_HasMemoryInfo = false;
+	m_Ranges.clear();
+	m_MemorySize = 0;
+	m_Stacks.clear();
+	m_Tebs.clear();
+}
+
+const BYTE* MinidumpFile::At(ULONGLONG offset, ULONGLONG size) const {
+	if (offset > m_Size || size > m_Size - offset) {
+		return nullptr;
+	}
+	return m_View + offset;
+}
+
+bool MinidumpFile::Parse() {
+	const BYTE* headerData = At(0, sizeof(DumpHeader));
+	if (!headerData) {
+		return false;
+	}
+	DumpHeader header = Load<DumpHeader>(headerData);
+	if (header.Signature != MinidumpSignature || (header.Version & 0xFFFF) != MinidumpVersion) {
+		return false;
+	}
+	const BYTE* directory = At(header.StreamDirectoryRva, static_cast<ULONGLONG>(header.NumberOfStreams) * sizeof(DumpDirectory));
+	if (!directory) {
+		return false;
+	}
+	m_TimeDateStamp = header.TimeDateStamp;
+
+	// Streams that point past the end of the file are left out.
+	for (DWORD i = 0; i < header.NumberOfStreams; ++i) {
+		DumpDirectory entry = Load<DumpDirectory>(directory + i * sizeof(DumpDirectory));
+		const BYTE* data = At(entry.Location.Rva, entry.Location.DataSize);
+		if (entry.StreamType == 0 || !data) {
+			continue;
+		}
+		MinidumpStream stream;
+		stream.Type = entry.StreamType;
+		stream.Data = data;
+		stream.Size = entry.Location.DataSize;
+		m_Streams.push_back(stream);
+	}
+
+	for (const auto& stream : m_Streams) {
+		switch (static_cast<MinidumpStreamType>(stream.Type)) {
+			case MinidumpStreamType::MiscInfo:
+				ParseMiscInfo(stream);
+				break;
+			case MinidumpStreamType::ModuleList:
+				ParseModules(stream);
+				break;
+			case MinidumpStreamType::MemoryList:
+				ParseMemory(stream);
+				break;
+			case MinidumpStreamType::Memory64List:
+				ParseMemory64(stream);
+				break;
+			case MinidumpStreamType::MemoryInfoList:
+				ParseMemoryInfo(stream);
+				break;
+			default:
+				break;
+		}
+	}
+	// Threads need the process ID, and start addresses come from a
+	// separate list.
+	if (const MinidumpStream* stream = FindStream(MinidumpStreamType::ThreadList)) {
+		ParseThreads(*stream);
+	}
+	if (const MinidumpStream* stream = FindStream(MinidumpStreamType::ThreadInfoList)) {
+		ParseThreadInfo(*stream);
+	}
+
+	std::sort(m_Ranges.begin(), m_Ranges.end(), [](const MinidumpMemoryRange& a, const MinidumpMemoryRange& b) {
+		return a.BaseAddress < b.BaseAddress;
+	});
+	for (const auto& range : m_Ranges) {
+		m_MemorySize += range.Size;
+	}
+
+	if (!m_HasMemoryInfo) {
+		// Ranges inside a module's image are marked as image memory.
+		std::vector<std::pair<ULONG_PTR, ULONG_PTR>> images;
+		for (const auto& module : m_Modules) {
+			images.emplace_back(module.BaseAddress, module.BaseAddress + module.Size);
+		}
+		std::sort(images.begin(), images.end());
+
+		for (const auto& range : m_Ranges) {
+			MemoryRegionInfo region;
+			region.BaseAddress = range.BaseAddress;
+			region.AllocationBase = range.BaseAddress;
+			region.RegionSize = range.Size;
+			region.Protect = PAGE_READONLY;
+			region.State = MemoryState::Commit;
+			region.Type = MemoryType::Private;
+			auto image = std::upper_bound(images.begin(), images.end(), std::make_pair(range.BaseAddress, ~static_cast<ULONG_PTR>(0)));
+			if (image != images.begin() && range.BaseAddress < (--image)->second) {
+				region.AllocationBase = image->first;
+				region.Type = MemoryType::Image;
+			}
+			m_Regions.push_back(region);
+		}
+	}
+	return true;
+}
+
+const MinidumpStream* MinidumpFile::FindStream(MinidumpStreamType type) const {
+	for (const auto& stream : m_Streams) {
+		if (stream.Type == static_cast<DWORD>(type)) {
+			return &stream;
+		}
+	}
+	return nullptr;
+}
+
+void MinidumpFile::ParseMiscInfo(const MinidumpStream& stream) {
+	if (stream.Size < sizeof(DumpMiscInfo)) {
+		return;
+	}
+	DumpMiscInfo info = Load<DumpMiscInfo>(stream.Data);
+	if (info.Flags1 & MiscInfoProcessId) {
+		m_ProcessId = info.ProcessId;
+	}
+}
+
+void MinidumpFile::ParseThreads(const MinidumpStream& stream) {
+	size_t count = 0;
+	const BYTE* entries = ListEntries(stream, sizeof(DumpThread), count);
+	m_Threads.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		DumpThread thread = Load<DumpThread>(entries + i * sizeof(DumpThread));
+		ThreadInfo info;
+		info.ThreadId = thread.ThreadId;
+		info.ProcessId = m_ProcessId;
+		info.Priority = static_cast<int>(thread.Priority);
+		m_Threads.push_back(info);
+
+		if (FitsAddressSpace(thread.Stack.StartOfMemoryRange, 1)) {
+			m_Stacks.push_back(static_cast<ULONG_PTR>(thread.Stack.StartOfMemoryRange));
+		}
+		if (thread.Teb != 0 && FitsAddressSpace(thread.Teb, 1)) {
+			m_Tebs.push_back(static_cast<ULONG_PTR>(thread.Teb));
+		}
+	}
+}
+
+void MinidumpFile::ParseThreadInfo(const MinidumpStream& stream) {
+	if (stream.Size < sizeof(DumpThreadInfoList)) {
+		return;
+	}
+	DumpThreadInfoList list = Load<DumpThreadInfoList>(stream.Data);
+	if (list.SizeOfEntry < sizeof(DumpThreadInfo) || list.SizeOfHeader > stream.Size) {
+		return;
+	}
+	ULONGLONG count = std::min<ULONGLONG>(list.NumberOfEntries, (stream.Size - list.SizeOfHeader) / list.SizeOfEntry);
+
+	std::unordered_map<DWORD, size_t> threadIndex;
+	for (size_t i = 0; i < m_Threads.size(); ++i) {
+		threadIndex[m_Threads[i].ThreadId] = i;
+	}
+	for (ULONGLONG i = 0; i < count; ++i) {
+		DumpThreadInfo info = Load<DumpThreadInfo>(stream.Data + list.SizeOfHeader + i * list.SizeOfEntry);
+		auto it = threadIndex.find(info.ThreadId);
+		if (it != threadIndex.end() && FitsAddressSpace(info.StartAddress, 1)) {
+			m_Threads[it->second].StartAddress = static_cast<ULONG_PTR>(info.StartAddress);
+		}
+	}
+}
+
+void MinidumpFile::ParseModules(const MinidumpStream& stream) {
+	size_t count = 0;
+	const BYTE* entries = ListEntries(stream, sizeof(DumpModule), count);
+	m_Modules.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		DumpModule module = Load<DumpModule>(entries + i * sizeof(DumpModule));
+		if (!FitsAddressSpace(module.BaseOfImage, std::max<ULONGLONG>(module.SizeOfImage, 1))) {
+			continue;
+		}
+
+		ModuleInfo info;
+		info.BaseAddress = static_cast<ULONG_PTR>(module.BaseOfImage);
+		info.Size = module.SizeOfImage;
+
+		// MINIDUMP_STRING: a byte length, then UTF-16 without the terminator.
+		const BYTE* name = At(module.ModuleNameRva, sizeof(DWORD));
+		if (name) {
+			DWORD length = Load<DWORD>(name);
+			const BYTE* units = At(static_cast<ULONGLONG>(module.ModuleNameRva) + sizeof(DWORD), length);
+			for (DWORD offset = 0; units && offset + 1 < length; offset += 2) {
+				unsigned long code = Load<WORD>(units + offset);
+				if (sizeof(wchar_t) == 4 && code >= 0xD800 && code < 0xDC00 && offset + 3 < length) {
+					unsigned long low = Load<WORD>(units + offset + 2);
+					if (low >= 0xDC00 && low < 0xE000) {
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						offset += 2;
+					}
+				}
+				info.FullPath.push_back(static_cast<wchar_t>(code));
+			}
+		}
+		size_t separator = info.FullPath.find_last_of(L"\\/");
+		info.Name = separator != std::wstring::npos ? info.FullPath.substr(separator + 1) : info.FullPath;
+		m_Modules.push_back(std::move(info));
+	}
+}
+
+void MinidumpFile::ParseMemory(const MinidumpStream& stream) {
+	size_t count = 0;
+	const BYTE* entries = ListEntries(stream, sizeof(DumpMemoryDescriptor), count);
+	for (size_t i = 0; i < count; ++i) {
+		DumpMemoryDescriptor descriptor = Load<DumpMemoryDescriptor>(entries + i * sizeof(DumpMemoryDescriptor));
+		const BYTE* data = At(descriptor.Memory.Rva, descriptor.Memory.DataSize);
+		if (!data || !FitsAddressSpace(descriptor.StartOfMemoryRange, descriptor.Memory.DataSize)) {
+			continue;
+		}
+		m_Ranges.push_back({ static_cast<ULONG_PTR>(descriptor.StartOfMemoryRange), descriptor.Memory.DataSize, data });
+	}
+}
+
+void MinidumpFile::ParseMemory64(const MinidumpStream& stream) {
+	if (stream.Size < sizeof(DumpMemory64List)) {
+		return;
+	}
+	DumpMemory64List list = Load<DumpMemory64List>(stream.Data);
+	ULONGLONG count = std::min<ULONGLONG>(list.NumberOfMemoryRanges, (stream.Size - sizeof(DumpMemory64List)) / sizeof(DumpMemoryDescriptor64));
+
+	// Full memory dumps store every range back to back from BaseRva.
+	ULONGLONG offset = list.BaseRva;
+	m_Ranges.reserve(m_Ranges.size() + static_cast<size_t>(count));
+	for (ULONGLONG i = 0; i < count; ++i) {
+		DumpMemoryDescriptor64 descriptor = Load<DumpMemoryDescriptor64>(stream.Data + sizeof(DumpMemory64List) + i * sizeof(DumpMemoryDescriptor64));
+		const BYTE* data = At(offset, descriptor.DataSize);
+		if (!data) {
+			break;
+		}
+		offset += descriptor.DataSize;
+		if (!FitsAddressSpace(descriptor.StartOfMemoryRange, descriptor.DataSize)) {
+			continue;
+		}
+		m_Ranges.push_back({ static_cast<ULONG_PTR>(descriptor.StartOfMemoryRange), static_cast<SIZE_T>(descriptor.DataSize), data });
+	}
+}
+
+void MinidumpFile::ParseMemoryInfo(const MinidumpStream& stream) {
+	if (stream.Size < sizeof(DumpMemoryInfoList)) {
+		return;
+	}
+	DumpMemoryInfoList list = Load<DumpMemoryInfoList>(stream.Data);
+	if (list.SizeOfEntry < sizeof(DumpMemoryInfo) || list.SizeOfHeader > stream.Size) {
+		return;
+	}
+	ULONGLONG count = std::min<ULONGLONG>(list.NumberOfEntries, (stream.Size - list.SizeOfHeader) / list.SizeOfEntry);
+
+	m_Regions.reserve(static_cast<size_t>(count));
+	for (ULONGLONG i = 0; i < count; ++i) {
+		DumpMemoryInfo info = Load<DumpMemoryInfo>(stream.Data + list.SizeOfHeader + i * list.SizeOfEntry);
+		if (!FitsAddressSpace(info.BaseAddress, info.RegionSize)) {
+			continue;
+		}
+		MemoryRegionInfo region;
+		region.BaseAddress = static_cast<ULONG_PTR>(info.BaseAddress);
+		region.AllocationBase = static_cast<ULONG_PTR>(info.AllocationBase);
+		region.RegionSize = static_cast<SIZE_T>(info.RegionSize);
+		region.Protect = info.Protect;
+		region.State = MemoryManager::StateFromFlags(info.State);
+		region.Type = MemoryManager::TypeFromFlags(info.Type);
+		m_Regions.push_back(region);
+	}
+	m_HasMemoryInfo = true;
+}
+
+AddressSpaceHints MinidumpFile::GetAddressSpaceHints() const {
+	AddressSpaceHints hints;
+	hints.Stacks = m_Stacks;
+	hints.Tebs = m_Tebs;
+	return hints;
+}
+
+const BYTE* MinidumpFile::GetView(ULONG_PTR address, size_t size) const {
+	auto it = std::upper_bound(m_Ranges.begin(), m_Ranges.end(), address, [](ULONG_PTR value, const MinidumpMemoryRange& range) {
+		return value < range.BaseAddress;
+	});
+	if (it == m_Ranges.begin()) {
+		return nullptr;
+	}
+	--it;
+	ULONG_PTR offset = address - it->BaseAddress;
+	if (offset >= it->Size || size > it->Size - offset) {
+		return nullptr;
+	}
+	return it->Data + offset;
+}
+
+bool MinidumpFile::Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) const {
+	if (!m_View || size == 0) {
+		return false;
+	}
+	ResetFailedPages(failedPages, address, size);
+	const BYTE* view = GetView(address, size);
+	if (view) {
+		memcpy(buffer, view, size);
+		return true;
+	}
+
+	BYTE* out = static_cast<BYTE*>(buffer);
+	memset(out, 0, size);
+	ULONG_PTR end = address + size;
+	if (end < address) {
+		end = static_cast<ULONG_PTR>(-1);
+	}
+
+	auto it = std::upper_bound(m_Ranges.begin(), m_Ranges.end(), address, [](ULONG_PTR value, const MinidumpMemoryRange& range) {
+		return value < range.BaseAddress;
+	});
+	if (it != m_Ranges.begin()) {
+		--it;
+	}
+	// Gaps between the ranges read are the bytes that were not saved.
+	bool anyRead = false;
+	ULONG_PTR covered = address;
+	for (; it != m_Ranges.end() && it->BaseAddress < end; ++it) {
+		ULONG_PTR start = std::max(address, it->BaseAddress);
+		ULONG_PTR stop = std::min<ULONG_PTR>(end, it->BaseAddress + it->Size);
+		if (start >= stop) {
+			continue;
+		}
+		if (start > covered) {
+			MarkFailedPages(failedPages, address, covered, start - covered);
+		}
+		memcpy(out + (start - address), it->Data + (start - it->BaseAddress), stop - start);
+		covered = std::max(covered, stop);
+		anyRead = true;
+	}
+	if (covered < end) {
+		MarkFailedPages(failedPages, address, covered, end - covered);
+	}
+	return anyRead;
+}
+
+MemoryReadFunction MinidumpFile::GetReadFunction() const {
+	return [this](ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) {
+		return Read(address, buffer, size, failedPages);
+	};
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
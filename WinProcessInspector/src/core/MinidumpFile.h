@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include "HandleWrapper.h"
+#include "AddressSpaceSummary.h"
+#include "MemoryManager.h"
+#include "ModuleManager.h"
+#include "ProcessManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class MinidumpStreamType : DWORD {
+		ThreadList = 3,
+		ModuleList = 4,
+		MemoryList = 5,
+		SystemInfo = 7,
+		Memory64List = 9,
+		MiscInfo = 15,
+		MemoryInfoList = 16,
+		ThreadInfoList = 17
+	};
+
+	// A stream of the dump, viewed in place in the mapped file.
+	struct MinidumpStream {
+		DWORD Type = 0;
+		const BYTE* Data = nullptr;
+		DWORD Size = 0;
+	};
+
+	// Process memory saved in the dump, viewed in place in the mapped file.
+	struct MinidumpMemoryRange {
+		ULONG_PTR BaseAddress = 0;
+		SIZE_T Size = 0;
+		const BYTE* Data = nullptr;
+	};
+
+	// Reads minidump files, such as those from MiniDumpWriteDump, without
+	// dbghelp. The file is mapped rather than read: opening parses the
+	// stream directory and the thread, module and memory lists, and memory
+	// is returned as views into the mapping, so a dump of many gigabytes
+	// opens in the time its lists take and only pages that are read are
+	// loaded. The format is parsed from its own little-endian layouts rather
+	// than through dbghelp, and off Windows the file is mapped with mmap, so
+	// dumps also open on analysis machines that only have the Windows types
+	// from a shim header. Results use the models of live processes so the
+	// same analysis runs on both.
+	class MinidumpFile {
+	public:
+		MinidumpFile() = default;
+		~MinidumpFile();
+
+		MinidumpFile(const MinidumpFile&) = delete;
+		MinidumpFile& operator=(const MinidumpFile&) = delete;
+
+		bool Open(const std::wstring& filePath);
+		void Close();
+		bool IsOpen() const { return m_View != nullptr; }
+
+		// Zero if the dump does not record it.
+		DWORD GetProcessId() const { return m_ProcessId; }
+		// Seconds since 1970, as written by the dumping tool.
+		DWORD GetTimeDateStamp() const { return m_TimeDateStamp; }
+		ULONGLONG GetFileSize() const { return m_Size; }
+
+		const std::vector<MinidumpStream>& GetStreams() const { return m_Streams; }
+		const MinidumpStream* FindStream(MinidumpStreamType type) const;
+
+		const std::vector<ModuleInfo>& GetModules() const { return m_Modules; }
+		const std::vector<ThreadInfo>& GetThreads() const { return m_Threads; }
+		// The memory info list when the dump has one; otherwise one committed
+		// region per saved memory range.
+		const std::vector<MemoryRegionInfo>& GetRegions() const { return m_Regions; }
+		bool HasMemoryInfo() const { return m_HasMemoryInfo; }
+		// Sorted by address.
+		const std::vector<MinidumpMemoryRange>& GetMemoryRanges() const { return m_Ranges; }
+		ULONGLONG GetMemorySize() const { return m_MemorySize; }
+		// Thread stacks and TEBs, for AddressSpaceSummary.
+		AddressSpaceHints GetAddressSpaceHints() const;
+
+		// The saved bytes at address, or nullptr unless one range holds all
+		// size of them.
+		const BYTE* GetView(ULONG_PTR address, size_t size) const;
+		// Bytes that were not saved come back as zeros, with their pages
+		// flagged in failedPages. Fails if none were saved.
+		bool Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages = nullptr) const;
+		// Bound to this dump, which must outlive it.
+		MemoryReadFunction GetReadFunction() const;
+
+	private:
+		bool Parse();
+		void ParseThreads(const MinidumpStream& stream);
+		void ParseThreadInfo(const MinidumpStream& stream);
+		void ParseModules(const MinidumpStream& stream);
+		void ParseMemory(const MinidumpStream& stream);
+		void ParseMemory64(const MinidumpStream& stream);
+		void ParseMemoryInfo(const MinidumpStream& stream);
+		void ParseMiscInfo(const MinidumpStream& stream);
+		// size bytes of the file at offset, or nullptr if they run past its
+		// end.
+		const BYTE* At(ULONGLONG offset, ULONGLONG size) const;
+
+#if defined(_WIN32)
+		HandleWrapper m_File;
+		HandleWrapper m_Mapping;
+#else
+		int m_File = -1;
+#endif
+		const BYTE* m_View = nullptr;
+		ULONGLONG m_Size = 0;
+
+		DWORD m_ProcessId = 0;
+		DWORD m_TimeDateStamp = 0;
+		std::vector<MinidumpStream> m_Streams;
+		std::vector<ModuleInfo> m_Modules;
+		std::vector<ThreadInfo> m_Threads;
+		std::vector<MemoryRegionInfo> m_Regions;
+		bool m_HasMemoryInfo = false;
+		std::vector<MinidumpMemoryRange> m_Ranges;
+		ULONGLONG m_MemorySize = 0;
+		std::vector<ULONG_PTR> m_Stacks;
+		std::vector<ULONG_PTR> m_Tebs;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
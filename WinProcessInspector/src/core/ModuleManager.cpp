@@ -14,7 +14,7 @@
 namespace WinProcessInspector {
 namespace Core {
 
-std::vector<ModuleInfo> ModuleManager::EnumerateModules(DWORD processId) const {
+std::vector<ModuleInfo> ModuleManager::EnumerateModules(DWORD processId, bool checkFiles) const {
 	std::vector<ModuleInfo> modules;
 
 	HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId));
@@ -48,10 +48,12 @@ std::vector<ModuleInfo> ModuleManager::EnumerateModules(DWORD processId) const {
 				info.Size = modInfo.SizeOfImage;
 			}
 
-			info.IsMissing = IsFileMissing(info.FullPath);
+			if (checkFiles) {
+				info.IsMissing = IsFileMissing(info.FullPath);
 
-			if (!info.IsMissing) {
-				info.IsSigned = IsModuleSigned(info.FullPath, info.SignatureInfo);
+				if (!info.IsMissing) {
+					info.IsSigned = IsModuleSigned(info.FullPath, info.SignatureInfo);
+				}
 			}
 
 			modules.push_back(info);
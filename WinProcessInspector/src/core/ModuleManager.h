@@ -27,7 +27,9 @@ namespace Core {
 		ModuleManager(ModuleManager&&) = default;
 		ModuleManager& operator=(ModuleManager&&) = default;
 
-		std::vector<ModuleInfo> EnumerateModules(DWORD processId) const;
+		// checkFiles adds the existence and signature checks, which read
+		// every module file.
+		std::vector<ModuleInfo> EnumerateModules(DWORD processId, bool checkFiles = true) const;
 
 		bool IsFileMissing(const std::wstring& filePath) const;
 
@@ -0,0 +1,259 @@
+#include "ObjectCorrelation.h"
+#include "ObjectTypeTable.h"
+#include "HandleWrapper.h"
+#include "../utils/StringConversion.h"
+#include <psapi.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <cstdio>
+
+#pragma comment(lib, "psapi.lib")
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const DWORD NoGroup = static_cast<DWORD>(-1);
+	const DWORD InitialProcessCapacity = 1024;
+
+}
+
+bool ObjectCorrelation::Capture(HandleSnapshot& snapshot) {
+	std::vector<DWORD> processIds(InitialProcessCapacity);
+	DWORD bytesReturned = 0;
+	for (;;) {
+		DWORD bytes = static_cast<DWORD>(processIds.size() * sizeof(DWORD));
+		if (!EnumProcesses(processIds.data(), bytes, &bytesReturned)) {
+			return false;
+		}
+		if (bytesReturned < bytes) {
+			break;
+		}
+		processIds.resize(processIds.size() * 2);
+	}
+	processIds.resize(bytesReturned / sizeof(DWORD));
+
+	// Handles opened here land in the snapshot under this process, which
+	// ties each process object's address to its id.
+	DWORD selfId = GetCurrentProcessId();
+	std::vector<HandleWrapper> opened;
+	opened.reserve(processIds.size());
+	std::unordered_map<ULONG_PTR, DWORD> handleTargets;
+	for (DWORD processId : processIds) {
+		if (processId == 0 || processId == selfId) {
+			continue;
+		}
+		HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+		if (hProcess.IsValid()) {
+			handleTargets[reinterpret_cast<ULONG_PTR>(hProcess.Get())] = processId;
+			opened.push_back(std::move(hProcess));
+		}
+	}
+
+	if (!snapshot.Capture()) {
+		return false;
+	}
+
+	m_ProcessAddresses.clear();
+	size_t ownCount = 0;
+	const HandleEntry* own = snapshot.GetProcessHandles(selfId, ownCount);
+	for (size_t i = 0; i < ownCount; ++i) {
+		auto it = handleTargets.find(own[i].HandleValue);
+		if (it != handleTargets.end()) {
+			m_ProcessAddresses[own[i].ObjectAddress] = it->second;
+		}
+	}
+
+	Build(snapshot, selfId);
+	return true;
+}
+
+void ObjectCorrelation::Build(const HandleSnapshot& snapshot, DWORD excludedProcessId) {
+	m_Objects.clear();
+	m_Holders.clear();
+	m_ProcessObjects.clear();
+
+	const std::vector<HandleEntry>& handles = snapshot.GetHandles();
+
+	// Number each address on first sight and count its handles.
+	std::unordered_map<ULONG_PTR, DWORD> groups;
+	groups.reserve(handles.size());
+	std::vector<DWORD> groupOf(handles.size(), NoGroup);
+	std::vector<DWORD> groupSizes;
+	for (size_t i = 0; i < handles.size(); ++i) {
+		const HandleEntry& entry = handles[i];
+		if (entry.ObjectAddress == 0 || entry.ProcessId == excludedProcessId) {
+			continue;
+		}
+		auto result = groups.emplace(entry.ObjectAddress, static_cast<DWORD>(groupSizes.size()));
+		if (result.second) {
+			groupSizes.push_back(0);
+		}
+		groupOf[i] = result.first->second;
+		++groupSizes[groupOf[i]];
+	}
+
+	// Scatter handles into their groups. The snapshot is ordered by
+	// process, so each group's handles are too.
+	std::vector<size_t> groupStart(groupSizes.size() + 1, 0);
+	for (size_t g = 0; g < groupSizes.size(); ++g) {
+		groupStart[g + 1] = groupStart[g] + groupSizes[g];
+	}
+	std::vector<DWORD> order(groupStart.back());
+	std::vector<size_t> cursor(groupStart.begin(), groupStart.end() - 1);
+	for (size_t i = 0; i < handles.size(); ++i) {
+		if (groupOf[i] != NoGroup) {
+			order[cursor[groupOf[i]]++] = static_cast<DWORD>(i);
+		}
+	}
+
+	for (size_t g = 0; g < groupSizes.size(); ++g) {
+		size_t first = groupStart[g];
+		size_t last = groupStart[g + 1];
+		const HandleEntry& head = handles[order[first]];
+
+		DWORD processCount = 0;
+		DWORD previous = NoGroup;
+		for (size_t k = first; k < last; ++k) {
+			DWORD processId = handles[order[k]].ProcessId;
+			if (processId != previous) {
+				++processCount;
+				previous = processId;
+			}
+		}
+
+		DWORD target = 0;
+		auto targetIt = m_ProcessAddresses.find(head.ObjectAddress);
+		if (targetIt != m_ProcessAddresses.end()) {
+			target = targetIt->second;
+		}
+		bool linksTarget = target != 0 && !(processCount == 1 && head.ProcessId == target);
+		if (processCount < 2 && !linksTarget) {
+			continue;
+		}
+
+		DWORD objectIndex = static_cast<DWORD>(m_Objects.size());
+		SharedObjectInfo object;
+		object.ObjectAddress = head.ObjectAddress;
+		object.ObjectTypeIndex = head.ObjectTypeIndex;
+		object.TargetProcessId = target;
+		object.FirstHolder = m_Holders.size();
+		object.HolderCount = static_cast<DWORD>(last - first);
+		object.ProcessCount = processCount;
+		m_Objects.push_back(object);
+
+		bool targetHolds = false;
+		previous = NoGroup;
+		for (size_t k = first; k < last; ++k) {
+			const HandleEntry& entry = handles[order[k]];
+			ObjectHolder holder;
+			holder.ProcessId = entry.ProcessId;
+			holder.HandleValue = entry.HandleValue;
+			holder.AccessMask = entry.AccessMask;
+			m_Holders.push_back(holder);
+
+			if (entry.ProcessId != previous) {
+				m_ProcessObjects[entry.ProcessId].push_back(objectIndex);
+				previous = entry.ProcessId;
+				targetHolds = targetHolds || entry.ProcessId == target;
+			}
+		}
+		if (linksTarget && !targetHolds) {
+			m_ProcessObjects[target].push_back(objectIndex);
+		}
+	}
+}
+
+void ObjectCorrelation::Clear() {
+	m_Objects.clear();
+	m_Holders.clear();
+	m_ProcessObjects.clear();
+	m_ProcessAddresses.clear();
+}
+
+const ObjectHolder* ObjectCorrelation::GetHolders(const SharedObjectInfo& object, size_t& count) const {
+	count = object.HolderCount;
+	return count > 0 ? &m_Holders[object.FirstHolder] : nullptr;
+}
+
+std::vector<size_t> ObjectCorrelation::GetProcessObjects(DWORD processId) const {
+	std::vector<size_t> objects;
+	auto it = m_ProcessObjects.find(processId);
+	if (it != m_ProcessObjects.end()) {
+		objects.assign(it->second.begin(), it->second.end());
+	}
+	return objects;
+}
+
+std::vector<ProcessLink> ObjectCorrelation::GetLinks(DWORD processId) const {
+	std::vector<ProcessLink> links;
+	auto it = m_ProcessObjects.find(processId);
+	if (it == m_ProcessObjects.end()) {
+		return links;
+	}
+
+	std::map<std::tuple<DWORD, ObjectLinkKind, WORD>, DWORD> counts;
+	for (DWORD objectIndex : it->second) {
+		const SharedObjectInfo& object = m_Objects[objectIndex];
+		if (object.TargetProcessId != 0 && object.TargetProcessId != processId) {
+			++counts[std::make_tuple(object.TargetProcessId, ObjectLinkKind::HoldsProcess, object.ObjectTypeIndex)];
+			continue;
+		}
+
+		ObjectLinkKind kind = object.TargetProcessId == processId ? ObjectLinkKind::HeldByProcess : ObjectLinkKind::SharedObject;
+		DWORD previous = processId;
+		for (DWORD i = 0; i < object.HolderCount; ++i) {
+			DWORD holder = m_Holders[object.FirstHolder + i].ProcessId;
+			if (holder != processId && holder != previous) {
+				++counts[std::make_tuple(holder, kind, object.ObjectTypeIndex)];
+			}
+			previous = holder;
+		}
+	}
+
+	for (const auto& entry : counts) {
+		ProcessLink link;
+		link.OtherProcessId = std::get<0>(entry.first);
+		link.Kind = std::get<1>(entry.first);
+		link.ObjectTypeIndex = std::get<2>(entry.first);
+		link.ObjectCount = entry.second;
+		links.push_back(link);
+	}
+	std::stable_sort(links.begin(), links.end(), [](const ProcessLink& a, const ProcessLink& b) {
+		return a.ObjectCount > b.ObjectCount;
+	});
+	return links;
+}
+
+bool ObjectCorrelation::ExportCsv(const std::wstring& filePath) const {
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, filePath.c_str(), L"wb") != 0 || !file) {
+		return false;
+	}
+
+	fprintf(file, "\xEF\xBB\xBF");
+	fprintf(file, "Object Address,Type,Target PID,Processes,Holder PID,Handle,Access\n");
+
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	for (const auto& object : m_Objects) {
+		std::string typeName = Utils::StringConversion::ToUtf8(types.GetName(object.ObjectTypeIndex));
+		for (DWORD i = 0; i < object.HolderCount; ++i) {
+			const ObjectHolder& holder = m_Holders[object.FirstHolder + i];
+			fprintf(file, "0x%llX,%s,", static_cast<ULONGLONG>(object.ObjectAddress), typeName.c_str());
+			if (object.TargetProcessId != 0) {
+				fprintf(file, "%lu", object.TargetProcessId);
+			}
+			fprintf(file, ",%lu,%lu,0x%llX,0x%08lX\n", object.ProcessCount, holder.ProcessId,
+				static_cast<ULONGLONG>(holder.HandleValue), holder.AccessMask);
+		}
+	}
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "HandleSnapshot.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class ObjectLinkKind : BYTE {
+		// Both processes hold handles to the same object.
+		SharedObject,
+		// The process holds a handle to the other process.
+		HoldsProcess,
+		// The other process holds a handle to this one.
+		HeldByProcess
+	};
+
+	struct ObjectHolder {
+		DWORD ProcessId = 0;
+		ULONG_PTR HandleValue = 0;
+		DWORD AccessMask = 0;
+	};
+
+	struct SharedObjectInfo {
+		ULONG_PTR ObjectAddress = 0;
+		WORD ObjectTypeIndex = 0;
+		// The process a process object refers to, when its address was
+		// resolved; 0 otherwise.
+		DWORD TargetProcessId = 0;
+		size_t FirstHolder = 0;
+		DWORD HolderCount = 0;
+		DWORD ProcessCount = 0;
+	};
+
+	struct ProcessLink {
+		DWORD OtherProcessId = 0;
+		ObjectLinkKind Kind = ObjectLinkKind::SharedObject;
+		WORD ObjectTypeIndex = 0;
+		DWORD ObjectCount = 0;
+	};
+
+	// Graph of kernel objects held by more than one process, built by
+	// joining a handle snapshot on object address. Process objects are
+	// matched to the process they refer to through handles this process
+	// opens for the capture, so "A holds a handle to B" is an edge too.
+	class ObjectCorrelation {
+	public:
+		ObjectCorrelation() = default;
+		~ObjectCorrelation() = default;
+
+		ObjectCorrelation(const ObjectCorrelation&) = delete;
+		ObjectCorrelation& operator=(const ObjectCorrelation&) = delete;
+		ObjectCorrelation(ObjectCorrelation&&) = default;
+		ObjectCorrelation& operator=(ObjectCorrelation&&) = default;
+
+		// Opens every process, captures snapshot and builds the graph with
+		// this process left out.
+		bool Capture(HandleSnapshot& snapshot);
+		// One pass over the snapshot. Handles of excludedProcessId are ignored.
+		void Build(const HandleSnapshot& snapshot, DWORD excludedProcessId = 0);
+		void Clear();
+
+		const std::vector<SharedObjectInfo>& GetObjects() const { return m_Objects; }
+		const ObjectHolder* GetHolders(const SharedObjectInfo& object, size_t& count) const;
+		// Indices into GetObjects() of the shared objects processId holds.
+		std::vector<size_t> GetProcessObjects(DWORD processId) const;
+		// Processes linked to processId, most shared objects first.
+		std::vector<ProcessLink> GetLinks(DWORD processId) const;
+
+		// One row per holder of every shared object.
+		bool ExportCsv(const std::wstring& filePath) const;
+
+	private:
+		std::vector<SharedObjectInfo> m_Objects;
+		std::vector<ObjectHolder> m_Holders;
+		std::unordered_map<DWORD, std::vector<DWORD>> m_ProcessObjects;
+		// Process object address to the process id it refers to.
+		std::unordered_map<ULONG_PTR, DWORD> m_ProcessAddresses;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,285 @@
+#include "ObjectSearchIndex.h"
+#include "ProcessSearchIndex.h"
+#include <algorithm>
+#include <cwctype>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t NotFound = static_cast<size_t>(-1);
+	const size_t TrigramLength = 3;
+	// Unreferenced texts are kept, so a name that comes back needs no
+	// reindexing, until they outnumber this and the live ones.
+	const size_t MinDeadTextsToCompact = 4096;
+
+	ULONGLONG MakeTrigram(const wchar_t* text) {
+		return (static_cast<ULONGLONG>(static_cast<WORD>(text[0])) << 32)
+			| (static_cast<ULONGLONG>(static_cast<WORD>(text[1])) << 16)
+			| static_cast<WORD>(text[2]);
+	}
+
+	std::wstring Fold(const std::wstring& text) {
+		std::wstring folded(text.size(), L'\0');
+		for (size_t i = 0; i < text.size(); ++i) {
+			folded[i] = static_cast<wchar_t>(::towlower(text[i]));
+		}
+		return folded;
+	}
+
+}
+
+void ObjectSearchIndex::Clear() {
+	m_Processes.clear();
+	m_EntryCount = 0;
+	m_Texts.clear();
+	m_DeadTexts = 0;
+	m_TextIds.clear();
+	m_Folded.clear();
+	m_Postings.clear();
+}
+
+void ObjectSearchIndex::UpdateHandles(DWORD processId, ULONGLONG signature, const std::vector<HandleInfo>& handles) {
+	ProcessEntries& process = m_Processes[processId];
+	Release(process.Handles);
+
+	process.HandleSignature = signature;
+	for (const auto& handle : handles) {
+		if (handle.ObjectName.empty()) {
+			continue;
+		}
+
+		Entry entry;
+		entry.Value = reinterpret_cast<ULONG_PTR>(handle.HandleValue);
+		entry.TextId = AddText(handle.ObjectName);
+		entry.ObjectTypeIndex = handle.ObjectTypeIndex;
+		entry.Kind = ObjectSearchKind::Handle;
+		process.Handles.push_back(entry);
+	}
+	m_EntryCount += process.Handles.size();
+
+	CompactIfNeeded();
+}
+
+void ObjectSearchIndex::UpdateModules(DWORD processId, const std::vector<ModuleInfo>& modules) {
+	ProcessEntries& process = m_Processes[processId];
+	Release(process.Modules);
+
+	for (const auto& module : modules) {
+		if (module.FullPath.empty()) {
+			continue;
+		}
+
+		Entry entry;
+		entry.Value = module.BaseAddress;
+		entry.TextId = AddText(module.FullPath);
+		entry.ObjectTypeIndex = 0;
+		entry.Kind = ObjectSearchKind::Module;
+		process.Modules.push_back(entry);
+	}
+	m_EntryCount += process.Modules.size();
+
+	CompactIfNeeded();
+}
+
+bool ObjectSearchIndex::IsCurrent(DWORD processId, ULONGLONG signature) const {
+	auto it = m_Processes.find(processId);
+	return it != m_Processes.end() && it->second.HandleSignature == signature;
+}
+
+ULONGLONG ObjectSearchIndex::GetSignature(DWORD processId) const {
+	auto it = m_Processes.find(processId);
+	return it != m_Processes.end() ? it->second.HandleSignature : 0;
+}
+
+void ObjectSearchIndex::RemoveMissing(const std::vector<DWORD>& liveProcessIds) {
+	for (auto it = m_Processes.begin(); it != m_Processes.end();) {
+		if (std::binary_search(liveProcessIds.begin(), liveProcessIds.end(), it->first)) {
+			++it;
+			continue;
+		}
+		Release(it->second.Handles);
+		Release(it->second.Modules);
+		it = m_Processes.erase(it);
+	}
+	CompactIfNeeded();
+}
+
+std::vector<ObjectSearchMatch> ObjectSearchIndex::Find(const std::wstring& pattern, size_t maxResults, size_t& totalMatches,
+	const WORD* objectTypeIndex) const {
+	std::vector<ObjectSearchMatch> matches;
+	totalMatches = 0;
+	if ((pattern.empty() && !objectTypeIndex) || m_Texts.empty()) {
+		return matches;
+	}
+
+	std::wstring folded = Fold(pattern);
+	std::vector<char> matched(m_Texts.size(), 0);
+
+	if (folded.size() < TrigramLength) {
+		// Too short for trigrams; scan the distinct texts instead.
+		for (DWORD id = 0; id < m_Texts.size(); ++id) {
+			matched[id] = m_Texts[id].References > 0 && (folded.empty() || Contains(id, folded));
+		}
+	} else {
+		std::vector<const std::vector<DWORD>*> lists;
+		for (size_t i = 0; i + TrigramLength <= folded.size(); ++i) {
+			auto it = m_Postings.find(MakeTrigram(folded.data() + i));
+			if (it == m_Postings.end()) {
+				return matches;
+			}
+			lists.push_back(&it->second);
+		}
+		std::sort(lists.begin(), lists.end());
+		lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+		std::sort(lists.begin(), lists.end(), [](const std::vector<DWORD>* a, const std::vector<DWORD>* b) {
+			return a->size() < b->size();
+		});
+
+		// Intersect from the rarest trigram up.
+		std::vector<DWORD> candidates = *lists[0];
+		std::vector<DWORD> next;
+		for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+			next.clear();
+			std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+			candidates.swap(next);
+		}
+
+		// Trigrams do not check order or adjacency, so each survivor is
+		// confirmed against its text.
+		for (DWORD id : candidates) {
+			matched[id] = m_Texts[id].References > 0 && Contains(id, folded);
+		}
+	}
+
+	for (const auto& process : m_Processes) {
+		for (const auto* entries : { &process.second.Handles, &process.second.Modules }) {
+			if (objectTypeIndex && entries == &process.second.Modules) {
+				continue;
+			}
+			for (const auto& entry : *entries) {
+				if (!matched[entry.TextId] || (objectTypeIndex && entry.ObjectTypeIndex != *objectTypeIndex)) {
+					continue;
+				}
+				if (matches.size() < maxResults) {
+					ObjectSearchMatch match;
+					match.Kind = entry.Kind;
+					match.ProcessId = process.first;
+					match.Value = entry.Value;
+					match.ObjectTypeIndex = entry.ObjectTypeIndex;
+					match.Text = m_Texts[entry.TextId].Original;
+					matches.push_back(std::move(match));
+				}
+				++totalMatches;
+			}
+		}
+	}
+	return matches;
+}
+
+ULONGLONG ObjectSearchIndex::ComputeSignature(const HandleEntry* handles, size_t count) {
+	ULONGLONG hash = 14695981039346656037ULL;
+	auto mix = [&hash](ULONGLONG value) {
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	};
+	for (size_t i = 0; i < count; ++i) {
+		mix(handles[i].HandleValue);
+		mix(handles[i].ObjectAddress);
+		mix(handles[i].ObjectTypeIndex);
+	}
+	mix(count);
+	return hash;
+}
+
+DWORD ObjectSearchIndex::AddText(const std::wstring& text) {
+	auto it = m_TextIds.find(text);
+	if (it != m_TextIds.end()) {
+		Text& existing = m_Texts[it->second];
+		if (existing.References++ == 0) {
+			--m_DeadTexts;
+		}
+		return it->second;
+	}
+
+	DWORD id = static_cast<DWORD>(m_Texts.size());
+	Text entry;
+	entry.Original = text;
+	entry.Offset = m_Folded.size();
+	entry.References = 1;
+	m_Texts.push_back(std::move(entry));
+	m_TextIds.emplace(text, id);
+
+	for (wchar_t ch : text) {
+		m_Folded.push_back(static_cast<wchar_t>(::towlower(ch)));
+	}
+	m_Folded.push_back(L'\0');
+
+	IndexText(id);
+	return id;
+}
+
+void ObjectSearchIndex::Release(std::vector<Entry>& entries) {
+	for (const auto& entry : entries) {
+		if (--m_Texts[entry.TextId].References == 0) {
+			++m_DeadTexts;
+		}
+	}
+	m_EntryCount -= entries.size();
+	entries.clear();
+}
+
+void ObjectSearchIndex::CompactIfNeeded() {
+	size_t live = m_Texts.size() - m_DeadTexts;
+	if (m_DeadTexts < MinDeadTextsToCompact || m_DeadTexts < live) {
+		return;
+	}
+
+	std::vector<Text> texts;
+	texts.swap(m_Texts);
+	m_TextIds.clear();
+	m_Folded.clear();
+	m_Postings.clear();
+	m_DeadTexts = 0;
+
+	std::vector<DWORD> remap(texts.size(), 0);
+	for (DWORD id = 0; id < texts.size(); ++id) {
+		if (texts[id].References == 0) {
+			continue;
+		}
+		DWORD references = texts[id].References;
+		remap[id] = AddText(texts[id].Original);
+		m_Texts[remap[id]].References = references;
+	}
+
+	for (auto& process : m_Processes) {
+		for (auto* entries : { &process.second.Handles, &process.second.Modules }) {
+			for (auto& entry : *entries) {
+				entry.TextId = remap[entry.TextId];
+			}
+		}
+	}
+}
+
+void ObjectSearchIndex::IndexText(DWORD textId) {
+	const Text& text = m_Texts[textId];
+	const wchar_t* folded = m_Folded.data() + text.Offset;
+	size_t length = text.Original.size();
+	for (size_t i = 0; i + TrigramLength <= length; ++i) {
+		std::vector<DWORD>& postings = m_Postings[MakeTrigram(folded + i)];
+		// Ids only grow, so the list stays sorted; repeats within one text
+		// are skipped.
+		if (postings.empty() || postings.back() != textId) {
+			postings.push_back(textId);
+		}
+	}
+}
+
+bool ObjectSearchIndex::Contains(DWORD textId, const std::wstring& folded) const {
+	const Text& text = m_Texts[textId];
+	return ProcessSearchIndex::Find(m_Folded.data() + text.Offset, text.Original.size(), folded.data(), folded.size()) != NotFound;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include "HandleManager.h"
+#include "ModuleManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class ObjectSearchKind : BYTE {
+		Handle,
+		Module
+	};
+
+	struct ObjectSearchMatch {
+		ObjectSearchKind Kind = ObjectSearchKind::Handle;
+		DWORD ProcessId = 0;
+		// Handle value, or module base address.
+		ULONG_PTR Value = 0;
+		WORD ObjectTypeIndex = 0;
+		std::wstring Text;
+	};
+
+	// System-wide reverse index from handle object names and module paths to
+	// the processes holding them. Each distinct text is stored once, case
+	// folded, and every trigram maps to the sorted ids of the texts that
+	// contain it. A substring query intersects the postings of its trigrams
+	// and only verifies the survivors. Processes are replaced one at a time,
+	// so unchanged processes need not be indexed again.
+	class ObjectSearchIndex {
+	public:
+		ObjectSearchIndex() = default;
+		~ObjectSearchIndex() = default;
+
+		ObjectSearchIndex(const ObjectSearchIndex&) = delete;
+		ObjectSearchIndex& operator=(const ObjectSearchIndex&) = delete;
+		ObjectSearchIndex(ObjectSearchIndex&&) = default;
+		ObjectSearchIndex& operator=(ObjectSearchIndex&&) = default;
+
+		void Clear();
+
+		// signature identifies the handle table that was indexed; see
+		// ComputeSignature.
+		void UpdateHandles(DWORD processId, ULONGLONG signature, const std::vector<HandleInfo>& handles);
+		void UpdateModules(DWORD processId, const std::vector<ModuleInfo>& modules);
+		bool IsCurrent(DWORD processId, ULONGLONG signature) const;
+		// Zero if the process has not been indexed.
+		ULONGLONG GetSignature(DWORD processId) const;
+		// Drops every process not in liveProcessIds, which must be sorted.
+		void RemoveMissing(const std::vector<DWORD>& liveProcessIds);
+
+		// Case-insensitive substring search. Returns at most maxResults
+		// matches ordered by process; totalMatches counts them all. With
+		// objectTypeIndex only handles of that type match, and an empty
+		// pattern matches every named one.
+		std::vector<ObjectSearchMatch> Find(const std::wstring& pattern, size_t maxResults, size_t& totalMatches,
+			const WORD* objectTypeIndex = nullptr) const;
+
+		size_t GetProcessCount() const { return m_Processes.size(); }
+		size_t GetEntryCount() const { return m_EntryCount; }
+		size_t GetTextCount() const { return m_Texts.size() - m_DeadTexts; }
+
+		static ULONGLONG ComputeSignature(const HandleEntry* handles, size_t count);
+
+	private:
+		struct Entry {
+			ULONG_PTR Value;
+			DWORD TextId;
+			WORD ObjectTypeIndex;
+			ObjectSearchKind Kind;
+		};
+
+		struct ProcessEntries {
+			ULONGLONG HandleSignature = 0;
+			std::vector<Entry> Handles;
+			std::vector<Entry> Modules;
+		};
+
+		struct Text {
+			std::wstring Original;
+			size_t Offset;
+			DWORD References;
+		};
+
+		DWORD AddText(const std::wstring& text);
+		void Release(std::vector<Entry>& entries);
+		void CompactIfNeeded();
+		void IndexText(DWORD textId);
+		bool Contains(DWORD textId, const std::wstring& folded) const;
+
+		std::map<DWORD, ProcessEntries> m_Processes;
+		size_t m_EntryCount = 0;
+
+		std::vector<Text> m_Texts;
+		size_t m_DeadTexts = 0;
+		std::unordered_map<std::wstring, DWORD> m_TextIds;
+		// Case-folded texts, each followed by a null.
+		std::vector<wchar_t> m_Folded;
+		std::unordered_map<ULONGLONG, std::vector<DWORD>> m_Postings;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,178 @@
+#define WIN32_NO_STATUS
+#include <Windows.h>
+#undef WIN32_NO_STATUS
+
+#include <winternl.h>
+#include <ntstatus.h>
+
+#include "ObjectTypeTable.h"
+#include <cstring>
+#include <cwctype>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const ULONG ObjectTypesInformation = 3;
+	const ULONG InitialBufferSize = 32 * 1024;
+	const ULONG MaxBufferSize = 4 * 1024 * 1024;
+	const int MaxQueryAttempts = 4;
+	// Types are numbered from 2 on systems that do not report the index.
+	const WORD FirstTypeIndex = 2;
+
+	size_t AlignUp(size_t value) {
+		return (value + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1);
+	}
+
+	bool EqualsIgnoreCase(const std::wstring& a, const std::wstring& b) {
+		if (a.size() != b.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (std::towlower(a[i]) != std::towlower(b[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
+
+bool ObjectTypeTable::Load() {
+	typedef NTSTATUS (WINAPI* pNtQueryObject)(
+		HANDLE Handle,
+		ULONG ObjectInformationClass,
+		PVOID ObjectInformation,
+		ULONG ObjectInformationLength,
+		PULONG ReturnLength
+	);
+
+	HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+	if (!hNtdll) {
+		return false;
+	}
+	pNtQueryObject NtQueryObject = reinterpret_cast<pNtQueryObject>(GetProcAddress(hNtdll, "NtQueryObject"));
+	if (!NtQueryObject) {
+		return false;
+	}
+
+	std::vector<BYTE> buffer(InitialBufferSize);
+	for (int attempt = 0; attempt < MaxQueryAttempts; ++attempt) {
+		ULONG returnLength = 0;
+		NTSTATUS status = NtQueryObject(nullptr, ObjectTypesInformation, buffer.data(), static_cast<ULONG>(buffer.size()), &returnLength);
+		if (NT_SUCCESS(status)) {
+			return Parse(buffer.data(), buffer.size());
+		}
+		if (status != STATUS_INFO_LENGTH_MISMATCH || buffer.size() >= MaxBufferSize) {
+			return false;
+		}
+		buffer.resize(returnLength > buffer.size() ? returnLength : buffer.size() * 2);
+	}
+	return false;
+}
+
+bool ObjectTypeTable::Parse(const void* buffer, size_t size) {
+	m_Types.clear();
+	m_TypeCount = 0;
+
+	const BYTE* bytes = static_cast<const BYTE*>(buffer);
+	if (!bytes || size < sizeof(ULONG)) {
+		return false;
+	}
+
+	ULONG typeCount = 0;
+	memcpy(&typeCount, bytes, sizeof(typeCount));
+
+	// Captured buffers may be truncated or from another build, so every
+	// count, length and index is checked before it is used.
+	size_t offset = AlignUp(sizeof(ULONG));
+	if (offset > size || typeCount > (size - offset) / sizeof(ObjectTypeInformationEntry)) {
+		return false;
+	}
+
+	for (ULONG i = 0; i < typeCount; ++i) {
+		if (offset + sizeof(ObjectTypeInformationEntry) > size) {
+			m_Types.clear();
+			return false;
+		}
+
+		ObjectTypeInformationEntry entry;
+		memcpy(&entry, bytes + offset, sizeof(entry));
+		size_t nameOffset = offset + sizeof(entry);
+		if (entry.TypeName.Length == 0 || entry.TypeName.Length % sizeof(WCHAR) != 0 ||
+			entry.TypeName.Length > entry.TypeName.MaximumLength || nameOffset + entry.TypeName.MaximumLength > size) {
+			m_Types.clear();
+			return false;
+		}
+
+		// Two entries claiming one index would leave GetName ambiguous.
+		WORD index = entry.TypeIndex != 0 ? entry.TypeIndex : static_cast<WORD>(i + FirstTypeIndex);
+		if (index >= m_Types.size()) {
+			m_Types.resize(index + 1);
+		} else if (!m_Types[index].Name.empty()) {
+			m_Types.clear();
+			return false;
+		}
+
+		ObjectTypeInfo& type = m_Types[index];
+		type.Index = index;
+		type.Name.assign(entry.TypeName.Length / sizeof(WCHAR), L'\0');
+		memcpy(&type.Name[0], bytes + nameOffset, type.Name.size() * sizeof(WCHAR));
+		type.TotalObjects = entry.TotalNumberOfObjects;
+		type.TotalHandles = entry.TotalNumberOfHandles;
+		type.HighWaterHandles = entry.HighWaterNumberOfHandles;
+		type.ValidAccessMask = entry.ValidAccessMask;
+
+		offset = AlignUp(nameOffset + entry.TypeName.MaximumLength);
+	}
+
+	m_TypeCount = typeCount;
+	return true;
+}
+
+const ObjectTypeTable& ObjectTypeTable::GetSystem() {
+	static const ObjectTypeTable table = []() {
+		ObjectTypeTable loaded;
+		loaded.Load();
+		return loaded;
+	}();
+	return table;
+}
+
+const ObjectTypeInfo* ObjectTypeTable::GetType(WORD index) const {
+	if (index >= m_Types.size() || m_Types[index].Name.empty()) {
+		return nullptr;
+	}
+	return &m_Types[index];
+}
+
+std::wstring ObjectTypeTable::GetName(WORD index) const {
+	const ObjectTypeInfo* type = GetType(index);
+	return type ? type->Name : L"Type" + std::to_wstring(index);
+}
+
+bool ObjectTypeTable::Find(const std::wstring& name, WORD& index) const {
+	for (const auto& type : m_Types) {
+		if (!type.Name.empty() && EqualsIgnoreCase(type.Name, name)) {
+			index = type.Index;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<size_t> ObjectTypeTable::CountHandles(const HandleEntry* handles, size_t count) const {
+	std::vector<size_t> counts(m_Types.size());
+	for (size_t i = 0; i < count; ++i) {
+		WORD index = handles[i].ObjectTypeIndex;
+		if (index >= counts.size()) {
+			counts.resize(index + 1);
+		}
+		++counts[index];
+	}
+	return counts;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
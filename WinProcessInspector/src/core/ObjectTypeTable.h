@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include "HandleSnapshot.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Layout returned by NtQueryObject(ObjectTypesInformation): a ULONG type
+	// count, then one entry per type aligned to a pointer, each followed by
+	// its name.
+	struct ObjectTypeNameString {
+		USHORT Length;
+		USHORT MaximumLength;
+		PWSTR Buffer;
+	};
+
+	struct ObjectTypeInformationEntry {
+		ObjectTypeNameString TypeName;
+		ULONG TotalNumberOfObjects;
+		ULONG TotalNumberOfHandles;
+		ULONG TotalPagedPoolUsage;
+		ULONG TotalNonPagedPoolUsage;
+		ULONG TotalNamePoolUsage;
+		ULONG TotalHandleTableUsage;
+		ULONG HighWaterNumberOfObjects;
+		ULONG HighWaterNumberOfHandles;
+		ULONG HighWaterPagedPoolUsage;
+		ULONG HighWaterNonPagedPoolUsage;
+		ULONG HighWaterNamePoolUsage;
+		ULONG HighWaterHandleTableUsage;
+		ULONG InvalidAttributes;
+		ULONG GenericMapping[4];
+		ULONG ValidAccessMask;
+		BOOLEAN SecurityRequired;
+		BOOLEAN MaintainHandleCount;
+		// Zero before Windows 8.1, where types are numbered from 2 in order.
+		UCHAR TypeIndex;
+		CHAR ReservedByte;
+		ULONG PoolType;
+		ULONG DefaultPagedPoolCharge;
+		ULONG DefaultNonPagedPoolCharge;
+	};
+
+	struct ObjectTypeInfo {
+		WORD Index = 0;
+		std::wstring Name;
+		ULONG TotalObjects = 0;
+		ULONG TotalHandles = 0;
+		ULONG HighWaterHandles = 0;
+		ULONG ValidAccessMask = 0;
+	};
+
+	// Object types of the running system, stored densely by type index.
+	// Indices differ between Windows builds, so they are read from the
+	// kernel rather than assumed.
+	class ObjectTypeTable {
+	public:
+		ObjectTypeTable() = default;
+		~ObjectTypeTable() = default;
+
+		ObjectTypeTable(const ObjectTypeTable&) = default;
+		ObjectTypeTable& operator=(const ObjectTypeTable&) = default;
+		ObjectTypeTable(ObjectTypeTable&&) = default;
+		ObjectTypeTable& operator=(ObjectTypeTable&&) = default;
+
+		bool Load();
+		// Names are read from the bytes after each entry, not through its
+		// Buffer pointer, so captured buffers parse anywhere.
+		bool Parse(const void* buffer, size_t size);
+
+		// The table loaded on first use. Type names and indices are fixed
+		// until reboot; the counts are those at load time.
+		static const ObjectTypeTable& GetSystem();
+
+		bool IsEmpty() const { return m_TypeCount == 0; }
+		size_t GetTypeCount() const { return m_TypeCount; }
+		// Entries with Name empty are unused indices.
+		const std::vector<ObjectTypeInfo>& GetTypes() const { return m_Types; }
+		const ObjectTypeInfo* GetType(WORD index) const;
+
+		// "Type<index>" for indices the table does not know.
+		std::wstring GetName(WORD index) const;
+		// Case-insensitive; returns false when no type has that name.
+		bool Find(const std::wstring& name, WORD& index) const;
+
+		// Handles per type index, counted from a snapshot.
+		std::vector<size_t> CountHandles(const HandleEntry* handles, size_t count) const;
+
+	private:
+		std::vector<ObjectTypeInfo> m_Types;
+		size_t m_TypeCount = 0;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,408 @@
+#include "PageDedupAnalyzer.h"
+#include "PageHashSnapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t MaxWorkers = 8;
+	const DWORD PagesPerChunk = 256;
+	const size_t PageSize = PageHashSnapshot::PageSize;
+	// Shards are picked by the top bits of a hash and samples by the low
+	// bits, so sampling thins every shard evenly.
+	const unsigned ShardBits = 6;
+	const size_t ShardCount = size_t(1) << ShardBits;
+	const size_t MinShardEntries = 1024;
+
+	struct PageRun {
+		ULONG_PTR BaseAddress;
+		DWORD PageCount;
+		DWORD FirstPage;
+	};
+
+	struct Chunk {
+		size_t Run;
+		DWORD FirstPage;
+		DWORD PageCount;
+	};
+
+	struct HashedPage {
+		ULONGLONG Hash;
+		ULONG_PTR Address;
+	};
+
+	struct PageEntry {
+		// Zero marks an empty slot.
+		ULONGLONG Hash;
+		DWORD Copies;
+		DWORD Processes;
+		DWORD LastSource;
+		DWORD FirstProcessId;
+		ULONG_PTR FirstAddress;
+	};
+
+	inline size_t ShardOf(ULONGLONG hash) {
+		return static_cast<size_t>(hash >> (64 - ShardBits));
+	}
+
+	inline bool IsSampled(ULONGLONG hash, unsigned shift) {
+		return (hash & ((1ULL << shift) - 1)) == 0;
+	}
+
+	// Open addressing with linear probing. Callers hold Lock.
+	class PageShard {
+	public:
+		std::mutex Lock;
+		unsigned Shift = 0;
+
+		size_t GetCount() const { return m_Used; }
+
+		void Insert(const HashedPage& page, DWORD source, DWORD processId) {
+			if ((m_Used + 1) * 4 > m_Slots.size() * 3) {
+				Rehash(std::max<size_t>(m_Slots.size() * 2, 64));
+			}
+			size_t mask = m_Slots.size() - 1;
+			size_t index = static_cast<size_t>(page.Hash >> 20) & mask;
+			for (;;) {
+				PageEntry& entry = m_Slots[index];
+				if (entry.Hash == 0) {
+					entry.Hash = page.Hash;
+					entry.Copies = 1;
+					entry.Processes = 1;
+					entry.LastSource = source;
+					entry.FirstProcessId = processId;
+					entry.FirstAddress = page.Address;
+					++m_Used;
+					return;
+				}
+				if (entry.Hash == page.Hash) {
+					++entry.Copies;
+					if (entry.LastSource != source) {
+						entry.LastSource = source;
+						++entry.Processes;
+					}
+					return;
+				}
+				index = (index + 1) & mask;
+			}
+		}
+
+		const PageEntry* Find(ULONGLONG hash) const {
+			if (m_Slots.empty()) {
+				return nullptr;
+			}
+			size_t mask = m_Slots.size() - 1;
+			size_t index = static_cast<size_t>(hash >> 20) & mask;
+			while (m_Slots[index].Hash != 0) {
+				if (m_Slots[index].Hash == hash) {
+					return &m_Slots[index];
+				}
+				index = (index + 1) & mask;
+			}
+			return nullptr;
+		}
+
+		// Drops the entries the new sampling level no longer keeps.
+		void Resample(unsigned shift) {
+			Shift = shift;
+			Rehash(m_Slots.size());
+		}
+
+		template <typename Visit>
+		void ForEach(Visit visit) const {
+			for (const auto& entry : m_Slots) {
+				if (entry.Hash != 0) {
+					visit(entry);
+				}
+			}
+		}
+
+	private:
+		void Rehash(size_t capacity) {
+			std::vector<PageEntry> old;
+			old.swap(m_Slots);
+			m_Slots.assign(capacity, PageEntry());
+			m_Used = 0;
+			size_t mask = capacity - 1;
+			for (const auto& entry : old) {
+				if (entry.Hash == 0 || !IsSampled(entry.Hash, Shift)) {
+					continue;
+				}
+				size_t index = static_cast<size_t>(entry.Hash >> 20) & mask;
+				while (m_Slots[index].Hash != 0) {
+					index = (index + 1) & mask;
+				}
+				m_Slots[index] = entry;
+				++m_Used;
+			}
+		}
+
+		std::vector<PageEntry> m_Slots;
+		size_t m_Used = 0;
+	};
+
+}
+
+PageDedupResult PageDedupAnalyzer::Analyze(const std::vector<PageDedupSource>& sources, const PageDedupOptions& options,
+	const std::atomic<bool>* cancelled) const {
+	PageDedupResult result;
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<PageShard> shards(ShardCount);
+	std::atomic<unsigned> globalShift(0);
+	size_t shardLimit = std::max(options.MaxTrackedPages / ShardCount, MinShardEntries);
+
+	std::vector<BYTE> zeroPage(PageSize, 0);
+	ULONGLONG zeroHash = PageHashSnapshot::HashPage64(zeroPage.data());
+
+	// Per source, the hash of every page in run order, zero for zero pages
+	// and pages that could not be read.
+	std::vector<std::vector<ULONGLONG>> pageHashes(sources.size());
+	std::vector<std::vector<PageRun>> sourceRuns(sources.size());
+	bool keepPageHashes = true;
+	ULONGLONG keptPages = 0;
+
+	std::atomic<ULONGLONG> scanned(0);
+	std::atomic<ULONGLONG> zeros(0);
+
+	for (size_t s = 0; s < sources.size(); ++s) {
+		if (cancelled && *cancelled) {
+			break;
+		}
+		const PageDedupSource& source = sources[s];
+		if (!source.Read) {
+			continue;
+		}
+
+		std::vector<PageRun>& runs = sourceRuns[s];
+		std::vector<Chunk> chunks;
+		DWORD pageTotal = 0;
+		for (const auto& region : source.Regions) {
+			if (!MemoryManager::IsReadable(region, !options.PrivateOnly)) {
+				continue;
+			}
+			if (options.PrivateOnly && region.Type != MemoryType::Private) {
+				continue;
+			}
+			DWORD pages = static_cast<DWORD>(region.RegionSize / PageSize);
+			if (pages == 0) {
+				continue;
+			}
+			for (DWORD first = 0; first < pages; first += PagesPerChunk) {
+				chunks.push_back({ runs.size(), first, std::min(PagesPerChunk, pages - first) });
+			}
+			runs.push_back({ region.BaseAddress, pages, pageTotal });
+			pageTotal += pages;
+		}
+		if (runs.empty()) {
+			continue;
+		}
+		++result.Processes;
+
+		if (keepPageHashes && keptPages + pageTotal > options.MaxTrackedPages * 2ULL) {
+			keepPageHashes = false;
+			for (auto& hashes : pageHashes) {
+				std::vector<ULONGLONG>().swap(hashes);
+			}
+		}
+		ULONGLONG* recorded = nullptr;
+		if (keepPageHashes) {
+			pageHashes[s].assign(pageTotal, 0);
+			recorded = pageHashes[s].data();
+			keptPages += pageTotal;
+		}
+
+		DWORD sourceIndex = static_cast<DWORD>(s);
+		std::atomic<size_t> nextChunk(0);
+		auto worker = [&]() {
+			std::vector<BYTE> buffer(PagesPerChunk * PageSize);
+			std::vector<bool> failedPages;
+			std::vector<HashedPage> batch;
+			batch.reserve(PagesPerChunk);
+
+			for (;;) {
+				if (cancelled && *cancelled) {
+					break;
+				}
+				size_t index = nextChunk++;
+				if (index >= chunks.size()) {
+					break;
+				}
+
+				const Chunk& chunk = chunks[index];
+				const PageRun& run = runs[chunk.Run];
+				ULONG_PTR address = run.BaseAddress + chunk.FirstPage * PageSize;
+				if (!source.Read(address, buffer.data(), chunk.PageCount * PageSize, &failedPages)) {
+					continue;
+				}
+
+				// Pages the read zero filled are skipped, not counted as zero.
+				batch.clear();
+				ULONGLONG zeroCount = 0;
+				ULONGLONG readCount = 0;
+				for (DWORD page = 0; page < chunk.PageCount; ++page) {
+					if (page < failedPages.size() && failedPages[page]) {
+						continue;
+					}
+					++readCount;
+					ULONGLONG hash = PageHashSnapshot::HashPage64(buffer.data() + page * PageSize);
+					if (hash == zeroHash) {
+						++zeroCount;
+						continue;
+					}
+					hash = hash != 0 ? hash : 1;
+					if (recorded) {
+						recorded[run.FirstPage + chunk.FirstPage + page] = hash;
+					}
+					batch.push_back({ hash, address + page * PageSize });
+				}
+				zeros += zeroCount;
+				scanned += readCount;
+
+				// One lock per shard touched rather than one per page.
+				std::sort(batch.begin(), batch.end(), [](const HashedPage& a, const HashedPage& b) {
+					return a.Hash < b.Hash;
+				});
+				size_t first = 0;
+				while (first < batch.size()) {
+					size_t shardIndex = ShardOf(batch[first].Hash);
+					size_t last = first;
+					while (last < batch.size() && ShardOf(batch[last].Hash) == shardIndex) {
+						++last;
+					}
+
+					PageShard& shard = shards[shardIndex];
+					std::lock_guard<std::mutex> lock(shard.Lock);
+					for (size_t i = first; i < last; ++i) {
+						unsigned shift = globalShift.load();
+						if (shard.Shift < shift) {
+							shard.Resample(shift);
+						}
+						if (!IsSampled(batch[i].Hash, shard.Shift)) {
+							continue;
+						}
+						shard.Insert(batch[i], sourceIndex, source.ProcessId);
+						if (shard.GetCount() >= shardLimit) {
+							unsigned next = shard.Shift + 1;
+							unsigned expected = globalShift.load();
+							while (expected < next && !globalShift.compare_exchange_weak(expected, next)) {
+							}
+							shard.Resample(std::max(next, expected));
+						}
+					}
+					first = last;
+				}
+			}
+		};
+
+		// Sources run one at a time so a page's process count only has to
+		// remember the last source that added it.
+		size_t workerCount = options.WorkerCount;
+		if (workerCount == 0) {
+			workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+		}
+		workerCount = std::min(workerCount, chunks.size());
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < workerCount; ++i) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+	unsigned finalShift = globalShift.load();
+	std::vector<DuplicatePage> duplicates;
+	ULONGLONG distinct = 0;
+	ULONGLONG duplicatePages = 0;
+	ULONGLONG crossProcess = 0;
+	for (auto& shard : shards) {
+		if (shard.Shift < finalShift) {
+			shard.Resample(finalShift);
+		}
+		shard.ForEach([&](const PageEntry& entry) {
+			++distinct;
+			if (entry.Copies < 2) {
+				return;
+			}
+			duplicatePages += entry.Copies - 1;
+			if (entry.Processes > 1) {
+				crossProcess += entry.Copies - 1;
+			}
+			DuplicatePage page;
+			page.Hash = entry.Hash;
+			page.Copies = entry.Copies;
+			page.Processes = entry.Processes;
+			page.ProcessId = entry.FirstProcessId;
+			page.Address = entry.FirstAddress;
+			duplicates.push_back(page);
+		});
+	}
+
+	size_t topPages = std::min(options.TopCount, duplicates.size());
+	std::partial_sort(duplicates.begin(), duplicates.begin() + topPages, duplicates.end(), [](const DuplicatePage& a, const DuplicatePage& b) {
+		return a.Copies > b.Copies;
+	});
+	duplicates.resize(topPages);
+
+	// Unsampled pages leave gaps in every run, so ranges need a full count.
+	std::vector<DuplicateRange> ranges;
+	if (finalShift == 0 && keepPageHashes) {
+		for (size_t s = 0; s < sources.size(); ++s) {
+			const std::vector<ULONGLONG>& hashes = pageHashes[s];
+			if (hashes.empty()) {
+				continue;
+			}
+			DuplicateRange current;
+			for (const auto& run : sourceRuns[s]) {
+				for (DWORD page = 0; page < run.PageCount; ++page) {
+					ULONGLONG hash = hashes[run.FirstPage + page];
+					const PageEntry* entry = hash != 0 ? shards[ShardOf(hash)].Find(hash) : nullptr;
+					ULONG_PTR address = run.BaseAddress + page * PageSize;
+					if (entry && entry->Copies > 1) {
+						if (current.PageCount != 0 && current.Address + current.PageCount * PageSize == address) {
+							++current.PageCount;
+						} else {
+							if (current.PageCount != 0) {
+								ranges.push_back(current);
+							}
+							current.ProcessId = sources[s].ProcessId;
+							current.Address = address;
+							current.PageCount = 1;
+						}
+					}
+				}
+			}
+			if (current.PageCount != 0) {
+				ranges.push_back(current);
+			}
+		}
+
+		size_t topRanges = std::min(options.TopCount, ranges.size());
+		std::partial_sort(ranges.begin(), ranges.begin() + topRanges, ranges.end(), [](const DuplicateRange& a, const DuplicateRange& b) {
+			return a.PageCount > b.PageCount;
+		});
+		ranges.resize(topRanges);
+	}
+
+	result.SampleRate = 1ULL << finalShift;
+	result.PagesScanned = scanned;
+	result.ZeroPages = zeros;
+	result.DistinctPages = distinct * result.SampleRate;
+	result.DuplicatePages = duplicatePages * result.SampleRate;
+	result.CrossProcessDuplicatePages = crossProcess * result.SampleRate;
+	result.TopPages = std::move(duplicates);
+	result.TopRanges = std::move(ranges);
+	result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return result;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <atomic>
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+#include "PageHashSnapshot.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct PageDedupSource {
+		DWORD ProcessId = 0;
+		MemoryReadFunction Read;
+		std::vector<MemoryRegionInfo> Regions;
+	};
+
+	struct PageDedupOptions {
+		// Private pages only; image and mapped pages are shared already.
+		bool PrivateOnly = true;
+		// 0 picks one worker per core, up to 8.
+		size_t WorkerCount = 0;
+		// Distinct pages tracked before the analysis falls back to sampling.
+		size_t MaxTrackedPages = 2 * 1024 * 1024;
+		size_t TopCount = 20;
+	};
+
+	// A page content seen more than once, with one place it was seen.
+	struct DuplicatePage {
+		ULONGLONG Hash = 0;
+		DWORD Copies = 0;
+		DWORD Processes = 0;
+		DWORD ProcessId = 0;
+		ULONG_PTR Address = 0;
+	};
+
+	// Adjacent pages of one process whose contents all appear elsewhere.
+	struct DuplicateRange {
+		DWORD ProcessId = 0;
+		ULONG_PTR Address = 0;
+		DWORD PageCount = 0;
+	};
+
+	struct PageDedupResult {
+		size_t Processes = 0;
+		ULONGLONG PagesScanned = 0;
+		ULONGLONG ZeroPages = 0;
+		// The counts below are estimates, scaled by SampleRate.
+		ULONGLONG DistinctPages = 0;
+		// Copies beyond the first of each non-zero page.
+		ULONGLONG DuplicatePages = 0;
+		// As DuplicatePages, for contents found in more than one process.
+		ULONGLONG CrossProcessDuplicatePages = 0;
+		// 1 when every page was counted; otherwise one page content in
+		// SampleRate was.
+		ULONGLONG SampleRate = 1;
+		double Seconds = 0.0;
+		std::vector<DuplicatePage> TopPages;
+		// Only found when SampleRate is 1.
+		std::vector<DuplicateRange> TopRanges;
+
+		ULONGLONG GetSavingsBytes() const { return DuplicatePages * PageHashSnapshot::PageSize; }
+	};
+
+	// Counts identical pages across processes. Pages are hashed on worker
+	// threads and added to a table split into shards, each with its own
+	// lock, that holds one entry per distinct content. The table is
+	// bounded: when a shard fills, only contents whose hash has one more low
+	// bit clear are kept from then on, in every shard. Identical pages share
+	// a hash, so a content is counted in full or not at all and the totals
+	// scale by the sample rate. Page hashes are also kept per process, for
+	// finding duplicated ranges, while they fit the same budget.
+	class PageDedupAnalyzer {
+	public:
+		PageDedupAnalyzer() = default;
+		~PageDedupAnalyzer() = default;
+
+		PageDedupAnalyzer(const PageDedupAnalyzer&) = delete;
+		PageDedupAnalyzer& operator=(const PageDedupAnalyzer&) = delete;
+
+		// Sources are read one after another, each by all workers.
+		PageDedupResult Analyze(const std::vector<PageDedupSource>& sources, const PageDedupOptions& options,
+			const std::atomic<bool>* cancelled = nullptr) const;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,302 @@
+#include "PageHashSnapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t MaxWorkers = 8;
+	const DWORD PagesPerChunk = 256;
+
+	const ULONGLONG Prime1 = 0x9E3779B185EBCA87ULL;
+	const ULONGLONG Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	const ULONGLONG Prime3 = 0x165667B19E3779F9ULL;
+
+	struct Chunk {
+		size_t Region;
+		DWORD FirstPage;
+		DWORD PageCount;
+	};
+
+	inline ULONGLONG RotateLeft(ULONGLONG value, int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline ULONGLONG Round(ULONGLONG accumulator, ULONGLONG input) {
+		accumulator += input * Prime2;
+		return RotateLeft(accumulator, 31) * Prime1;
+	}
+
+}
+
+DWORD PageHashSnapshot::HashPage(const BYTE* page) {
+	ULONGLONG hash = HashPage64(page);
+	DWORD folded = static_cast<DWORD>(hash);
+	return folded != 0 ? folded : 1;
+}
+
+ULONGLONG PageHashSnapshot::HashPage64(const BYTE* page) {
+	// xxHash64 rounds over four independent lanes.
+	ULONGLONG lane0 = Prime1 + Prime2;
+	ULONGLONG lane1 = Prime2;
+	ULONGLONG lane2 = 0;
+	ULONGLONG lane3 = 0 - Prime1;
+	for (size_t i = 0; i < PageSize; i += 32) {
+		ULONGLONG words[4];
+		memcpy(words, page + i, sizeof(words));
+		lane0 = Round(lane0, words[0]);
+		lane1 = Round(lane1, words[1]);
+		lane2 = Round(lane2, words[2]);
+		lane3 = Round(lane3, words[3]);
+	}
+
+	ULONGLONG hash = RotateLeft(lane0, 1) + RotateLeft(lane1, 7) + RotateLeft(lane2, 12) + RotateLeft(lane3, 18);
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+bool PageHashSnapshot::Capture(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions, const PageCaptureOptions& options,
+	const std::atomic<bool>* cancelled) {
+	Clear();
+	if (!read) {
+		return false;
+	}
+
+	std::vector<PageHashRegion> layout;
+	std::vector<Chunk> chunks;
+	ULONGLONG pageTotal = 0;
+	for (const auto& region : regions) {
+		if (!MemoryManager::IsReadable(region, options.IncludeImages)) {
+			continue;
+		}
+		DWORD pages = static_cast<DWORD>(region.RegionSize / PageSize);
+		if (pages == 0) {
+			continue;
+		}
+
+		PageHashRegion entry;
+		entry.BaseAddress = region.BaseAddress;
+		entry.PageCount = pages;
+		entry.FirstPage = static_cast<DWORD>(pageTotal);
+		entry.Protect = region.Protect;
+		entry.Type = region.Type;
+		for (DWORD first = 0; first < pages; first += PagesPerChunk) {
+			chunks.push_back({ layout.size(), first, std::min(PagesPerChunk, pages - first) });
+		}
+		layout.push_back(entry);
+		pageTotal += pages;
+	}
+	if (pageTotal == 0 || pageTotal > MAXDWORD) {
+		return false;
+	}
+
+	std::vector<DWORD> hashes(static_cast<size_t>(pageTotal), 0);
+	std::vector<BYTE> contents;
+	bool keepContents = options.KeepContentsLimit != 0 && pageTotal * PageSize <= options.KeepContentsLimit;
+	if (keepContents) {
+		contents.resize(static_cast<size_t>(pageTotal * PageSize));
+	}
+
+	// Chunks map to disjoint slots of hashes and contents, so workers write
+	// without locking.
+	std::atomic<size_t> nextChunk(0);
+	auto worker = [&]() {
+		std::vector<BYTE> buffer;
+		std::vector<bool> failedPages;
+		for (;;) {
+			if (cancelled && *cancelled) {
+				break;
+			}
+			size_t index = nextChunk++;
+			if (index >= chunks.size()) {
+				break;
+			}
+
+			const Chunk& chunk = chunks[index];
+			const PageHashRegion& region = layout[chunk.Region];
+			size_t firstPage = region.FirstPage + chunk.FirstPage;
+			size_t size = chunk.PageCount * PageSize;
+			BYTE* target = nullptr;
+			if (keepContents) {
+				target = contents.data() + firstPage * PageSize;
+			} else {
+				buffer.resize(size);
+				target = buffer.data();
+			}
+
+			if (!read(region.BaseAddress + chunk.FirstPage * PageSize, target, size, &failedPages)) {
+				if (keepContents) {
+					memset(target, 0, size);
+				}
+				continue;
+			}
+			// Pages the read zero filled keep the hash of an unreadable page.
+			for (DWORD page = 0; page < chunk.PageCount; ++page) {
+				if (page >= failedPages.size() || !failedPages[page]) {
+					hashes[firstPage + page] = HashPage(target + page * PageSize);
+				}
+			}
+		}
+	};
+
+	size_t workerCount = options.WorkerCount;
+	if (workerCount == 0) {
+		workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+	}
+	workerCount = std::min(workerCount, chunks.size());
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workerCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	if (cancelled && *cancelled) {
+		return false;
+	}
+
+	m_Regions = std::move(layout);
+	m_Hashes = std::move(hashes);
+	m_Contents = std::move(contents);
+	return true;
+}
+
+void PageHashSnapshot::Clear() {
+	m_Regions.clear();
+	m_Hashes.clear();
+	m_Contents.clear();
+	m_Regions.shrink_to_fit();
+	m_Hashes.shrink_to_fit();
+	m_Contents.shrink_to_fit();
+}
+
+size_t PageHashSnapshot::GetMemoryUsage() const {
+	return m_Regions.capacity() * sizeof(PageHashRegion) + m_Hashes.capacity() * sizeof(DWORD) + m_Contents.capacity();
+}
+
+bool PageHashSnapshot::GetPage(ULONG_PTR address, BYTE* buffer) const {
+	if (m_Contents.empty()) {
+		return false;
+	}
+
+	auto it = std::upper_bound(m_Regions.begin(), m_Regions.end(), address, [](ULONG_PTR value, const PageHashRegion& region) {
+		return value < region.BaseAddress;
+	});
+	if (it == m_Regions.begin()) {
+		return false;
+	}
+	--it;
+	ULONG_PTR page = (address - it->BaseAddress) / PageSize;
+	if (page >= it->PageCount) {
+		return false;
+	}
+	memcpy(buffer, m_Contents.data() + (it->FirstPage + page) * PageSize, PageSize);
+	return true;
+}
+
+std::vector<PageChange> PageHashSnapshot::Diff(const PageHashSnapshot& before, const PageHashSnapshot& after) {
+	std::vector<PageChange> changes;
+	auto append = [&changes](ULONG_PTR address, size_t pages, PageChangeKind kind) {
+		if (!changes.empty()) {
+			PageChange& last = changes.back();
+			if (last.Kind == kind && last.Address + last.PageCount * PageSize == address) {
+				last.PageCount += static_cast<DWORD>(pages);
+				return;
+			}
+		}
+		PageChange change;
+		change.Address = address;
+		change.PageCount = static_cast<DWORD>(pages);
+		change.Kind = kind;
+		changes.push_back(change);
+	};
+
+	// Walk both captures as sorted runs of pages, taking the shared part of
+	// the two current runs at each step.
+	const auto& regionsBefore = before.m_Regions;
+	const auto& regionsAfter = after.m_Regions;
+	size_t regionA = 0;
+	size_t regionB = 0;
+	size_t pageA = 0;
+	size_t pageB = 0;
+	while (regionA < regionsBefore.size() || regionB < regionsAfter.size()) {
+		bool hasA = regionA < regionsBefore.size();
+		bool hasB = regionB < regionsAfter.size();
+		ULONG_PTR addressA = hasA ? regionsBefore[regionA].BaseAddress + pageA * PageSize : 0;
+		ULONG_PTR addressB = hasB ? regionsAfter[regionB].BaseAddress + pageB * PageSize : 0;
+		size_t leftA = hasA ? regionsBefore[regionA].PageCount - pageA : 0;
+		size_t leftB = hasB ? regionsAfter[regionB].PageCount - pageB : 0;
+
+		size_t countA = 0;
+		size_t countB = 0;
+		if (hasA && hasB && addressA == addressB) {
+			countA = countB = std::min(leftA, leftB);
+			const DWORD* hashesA = before.m_Hashes.data() + regionsBefore[regionA].FirstPage + pageA;
+			const DWORD* hashesB = after.m_Hashes.data() + regionsAfter[regionB].FirstPage + pageB;
+			for (size_t i = 0; i < countA; ++i) {
+				if (hashesA[i] == 0 || hashesB[i] == 0) {
+					append(addressA + i * PageSize, 1, PageChangeKind::Unreadable);
+				} else if (hashesA[i] != hashesB[i]) {
+					append(addressA + i * PageSize, 1, PageChangeKind::Changed);
+				}
+			}
+		} else if (hasA && (!hasB || addressA < addressB)) {
+			countA = hasB ? std::min<size_t>(leftA, std::max<size_t>((addressB - addressA) / PageSize, 1)) : leftA;
+			append(addressA, countA, PageChangeKind::Removed);
+		} else {
+			countB = hasA ? std::min<size_t>(leftB, std::max<size_t>((addressA - addressB) / PageSize, 1)) : leftB;
+			append(addressB, countB, PageChangeKind::Added);
+		}
+
+		pageA += countA;
+		if (hasA && pageA == regionsBefore[regionA].PageCount) {
+			++regionA;
+			pageA = 0;
+		}
+		pageB += countB;
+		if (hasB && pageB == regionsAfter[regionB].PageCount) {
+			++regionB;
+			pageB = 0;
+		}
+	}
+	return changes;
+}
+
+std::vector<ByteRange> PageHashSnapshot::CompareBytes(const BYTE* before, const BYTE* after, size_t size) {
+	std::vector<ByteRange> ranges;
+	size_t i = 0;
+	while (i < size) {
+		while (i + 8 <= size && memcmp(before + i, after + i, 8) == 0) {
+			i += 8;
+		}
+		if (i >= size) {
+			break;
+		}
+		if (before[i] == after[i]) {
+			++i;
+			continue;
+		}
+
+		ByteRange range;
+		range.Offset = i;
+		while (i < size && before[i] != after[i]) {
+			++i;
+		}
+		range.Length = i - range.Offset;
+		ranges.push_back(range);
+	}
+	return ranges;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
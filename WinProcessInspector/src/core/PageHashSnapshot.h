@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <atomic>
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct PageHashRegion {
+		ULONG_PTR BaseAddress = 0;
+		DWORD PageCount = 0;
+		// Index of the region's first page in the snapshot's hash array.
+		DWORD FirstPage = 0;
+		DWORD Protect = 0;
+		MemoryType Type = MemoryType::Unknown;
+	};
+
+	enum class PageChangeKind : BYTE {
+		Changed,
+		Added,
+		Removed,
+		// Present in both captures but unreadable in at least one, so
+		// whether it changed is unknown.
+		Unreadable
+	};
+
+	// A run of adjacent pages with the same kind of change.
+	struct PageChange {
+		ULONG_PTR Address = 0;
+		DWORD PageCount = 0;
+		PageChangeKind Kind = PageChangeKind::Changed;
+	};
+
+	struct ByteRange {
+		size_t Offset = 0;
+		size_t Length = 0;
+	};
+
+	struct PageCaptureOptions {
+		bool IncludeImages = true;
+		// 0 picks one worker per core, up to 8.
+		size_t WorkerCount = 0;
+		// Page contents are kept too, for byte-level diffs, when the readable
+		// total is at most this many bytes. 0 keeps hashes only.
+		ULONGLONG KeepContentsLimit = 0;
+	};
+
+	// Hashes of every committed, readable page of a process at one point in
+	// time, four bytes per page. Pages are hashed on worker threads, each
+	// taking up to a megabyte of a region at a time and writing into its
+	// own slots of the hash array. Two captures are compared page by page
+	// in one merged walk over their sorted regions.
+	class PageHashSnapshot {
+	public:
+		static const size_t PageSize = 0x1000;
+
+		PageHashSnapshot() = default;
+		~PageHashSnapshot() = default;
+
+		PageHashSnapshot(const PageHashSnapshot&) = delete;
+		PageHashSnapshot& operator=(const PageHashSnapshot&) = delete;
+		PageHashSnapshot(PageHashSnapshot&&) = default;
+		PageHashSnapshot& operator=(PageHashSnapshot&&) = default;
+
+		// Regions must be sorted by address, as EnumerateMemoryRegions returns
+		// them. Pages that cannot be read hash to zero. Fails if
+		// cancelled is set before every page is hashed.
+		bool Capture(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions, const PageCaptureOptions& options,
+			const std::atomic<bool>* cancelled = nullptr);
+		void Clear();
+
+		bool IsEmpty() const { return m_Hashes.empty(); }
+		size_t GetPageCount() const { return m_Hashes.size(); }
+		const std::vector<PageHashRegion>& GetRegions() const { return m_Regions; }
+		// Bytes held by the capture, including any kept contents.
+		size_t GetMemoryUsage() const;
+
+		bool HasContents() const { return !m_Contents.empty(); }
+		// Copies the captured page holding address into buffer, which must
+		// hold PageSize bytes. Fails without contents or outside the capture.
+		bool GetPage(ULONG_PTR address, BYTE* buffer) const;
+
+		// Changes from before to after in address order.
+		static std::vector<PageChange> Diff(const PageHashSnapshot& before, const PageHashSnapshot& after);
+		// Runs of differing bytes between two buffers of the same size.
+		static std::vector<ByteRange> CompareBytes(const BYTE* before, const BYTE* after, size_t size);
+		// Never zero, which marks an unreadable page.
+		static DWORD HashPage(const BYTE* page);
+		// Full width hash that HashPage folds, for tables of many pages.
+		static ULONGLONG HashPage64(const BYTE* page);
+
+	private:
+		std::vector<PageHashRegion> m_Regions;
+		std::vector<DWORD> m_Hashes;
+		std::vector<BYTE> m_Contents;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
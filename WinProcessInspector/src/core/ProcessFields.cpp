@@ -0,0 +1,52 @@
+#include "ProcessFields.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const double CostSmoothing = 0.25;
+
+}
+
+void ProcessFieldCosts::Update(const ProcessFieldTimings& timings, ProcessFieldMask collected) {
+	if (timings.ProcessCount == 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < ProcessFieldCount; ++i) {
+		if (!(collected & (1u << i))) {
+			continue;
+		}
+		double perProcess = timings.Microseconds[i] / static_cast<double>(timings.ProcessCount);
+		if (m_Measured & (1u << i)) {
+			m_CostUs[i] += CostSmoothing * (perProcess - m_CostUs[i]);
+		} else {
+			m_CostUs[i] = perProcess;
+			m_Measured |= 1u << i;
+		}
+	}
+}
+
+double ProcessFieldCosts::GetMicroseconds(ProcessFieldMask fields, size_t processCount) const {
+	double total = 0.0;
+	for (size_t i = 0; i < ProcessFieldCount; ++i) {
+		if (fields & m_Measured & (1u << i)) {
+			total += m_CostUs[i];
+		}
+	}
+	return total * static_cast<double>(processCount);
+}
+
+size_t ProcessFieldCosts::GetFieldIndex(ProcessField field) {
+	size_t index = 0;
+	DWORD bits = static_cast<DWORD>(field);
+	while (bits > 1) {
+		bits >>= 1;
+		++index;
+	}
+	return index;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
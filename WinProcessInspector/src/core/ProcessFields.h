@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Windows.h>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Groups of ProcessInfo members that need their own query per process.
+	// Id, parent, name, thread count and creation time are always collected.
+	enum ProcessField : DWORD {
+		ProcessFieldArchitecture = 1 << 0,
+		ProcessFieldSession = 1 << 1,
+		ProcessFieldIntegrity = 1 << 2,
+		ProcessFieldUser = 1 << 3,
+		ProcessFieldCommandLine = 1 << 4,
+		ProcessFieldHandleCount = 1 << 5,
+		ProcessFieldGuiObjects = 1 << 6,
+		ProcessFieldIoCounters = 1 << 7,
+		ProcessFieldMemoryCounters = 1 << 8,
+		ProcessFieldMitigations = 1 << 9,
+		ProcessFieldIsolation = 1 << 10,
+		ProcessFieldPriority = 1 << 11,
+		ProcessFieldAffinity = 1 << 12
+	};
+
+	typedef DWORD ProcessFieldMask;
+
+	const size_t ProcessFieldCount = 13;
+	const ProcessFieldMask ProcessFieldNone = 0;
+	const ProcessFieldMask ProcessFieldAll = (1u << ProcessFieldCount) - 1;
+
+	// Time spent on each field during one enumeration.
+	struct ProcessFieldTimings {
+		double Microseconds[ProcessFieldCount] = {};
+		size_t ProcessCount = 0;
+	};
+
+	// Per-process cost of each field, measured whenever the field is
+	// collected. Used to report the time saved by fields that were skipped;
+	// fields never collected are left out of that rather than guessed.
+	class ProcessFieldCosts {
+	public:
+		ProcessFieldCosts() = default;
+		~ProcessFieldCosts() = default;
+
+		ProcessFieldCosts(const ProcessFieldCosts&) = default;
+		ProcessFieldCosts& operator=(const ProcessFieldCosts&) = default;
+
+		void Update(const ProcessFieldTimings& timings, ProcessFieldMask collected);
+
+		// Cost of the measured fields among fields for processCount processes.
+		double GetMicroseconds(ProcessFieldMask fields, size_t processCount) const;
+
+		static size_t GetFieldIndex(ProcessField field);
+
+	private:
+		double m_CostUs[ProcessFieldCount] = {};
+		ProcessFieldMask m_Measured = ProcessFieldNone;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
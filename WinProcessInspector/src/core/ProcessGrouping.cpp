@@ -0,0 +1,332 @@
+#include "ProcessGrouping.h"
+#include "HandleWrapper.h"
+#include "ObjectTypeTable.h"
+#include <sddl.h>
+#include <algorithm>
+#include <unordered_set>
+#include <cctype>
+#include <cwctype>
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t NoLeader = static_cast<size_t>(-1);
+	const size_t NoJob = static_cast<size_t>(-1);
+
+	ULONGLONG ToTicks(const FILETIME& time) {
+		return (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	}
+
+	std::wstring GetAppContainerSid(HANDLE hToken) {
+		std::wstring result;
+		DWORD length = 0;
+		GetTokenInformation(hToken, TokenAppContainerSid, nullptr, 0, &length);
+		if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || length == 0) {
+			return result;
+		}
+
+		std::vector<BYTE> buffer(length);
+		PTOKEN_APPCONTAINER_INFORMATION pAppContainer = reinterpret_cast<PTOKEN_APPCONTAINER_INFORMATION>(buffer.data());
+		if (!GetTokenInformation(hToken, TokenAppContainerSid, pAppContainer, length, &length) ||
+			pAppContainer->TokenAppContainer == nullptr) {
+			return result;
+		}
+
+		LPWSTR sidString = nullptr;
+		if (ConvertSidToStringSidW(pAppContainer->TokenAppContainer, &sidString)) {
+			result = sidString;
+			LocalFree(sidString);
+		}
+		return result;
+	}
+
+	std::wstring GetPackageName(HANDLE hProcess) {
+		typedef LONG (WINAPI* pGetPackageFullName)(
+			HANDLE hProcess,
+			UINT32* packageFullNameLength,
+			PWSTR packageFullName
+		);
+
+		static pGetPackageFullName GetPackageFullNameFn = []() -> pGetPackageFullName {
+			HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
+			return hKernel32 ? reinterpret_cast<pGetPackageFullName>(GetProcAddress(hKernel32, "GetPackageFullName")) : nullptr;
+		}();
+
+		if (!GetPackageFullNameFn) {
+			return std::wstring();
+		}
+
+		UINT32 length = 0;
+		if (GetPackageFullNameFn(hProcess, &length, nullptr) != ERROR_INSUFFICIENT_BUFFER || length == 0) {
+			return std::wstring();
+		}
+
+		std::wstring name(length, L'\0');
+		if (GetPackageFullNameFn(hProcess, &length, &name[0]) != ERROR_SUCCESS) {
+			return std::wstring();
+		}
+		name.resize(length > 0 ? length - 1 : 0);
+		return name;
+	}
+
+}
+
+ProcessGroupAttributes ProcessGrouping::CollectAttributes(const ProcessInfo& process) {
+	ProcessGroupAttributes attributes;
+	attributes.ProcessId = process.ProcessId;
+	attributes.CreationTime = ToTicks(process.CreationTime);
+	attributes.SessionId = process.SessionId;
+	attributes.UserSid = process.UserSid;
+
+	if (process.ProcessId == 0) {
+		return attributes;
+	}
+
+	HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process.ProcessId));
+	if (!hProcess.IsValid()) {
+		return attributes;
+	}
+
+	BOOL isInJob = FALSE;
+	if (::IsProcessInJob(hProcess.Get(), nullptr, &isInJob)) {
+		attributes.IsInJob = isInJob != FALSE;
+	}
+
+	attributes.PackageFullName = GetPackageName(hProcess.Get());
+
+	HANDLE hToken = nullptr;
+	if (OpenProcessToken(hProcess.Get(), TOKEN_QUERY, &hToken)) {
+		attributes.AppContainerSid = GetAppContainerSid(hToken);
+		CloseHandle(hToken);
+	}
+
+	return attributes;
+}
+
+void ProcessGrouping::Clear() {
+	m_Rows.clear();
+	m_Cache.clear();
+	m_Handles.Clear();
+	m_JobsResolved = false;
+}
+
+std::wstring ProcessGrouping::GetServiceHostGroup(const ProcessInfo& process) {
+	std::string name = process.ProcessName;
+	std::transform(name.begin(), name.end(), name.begin(), [](char ch) { return static_cast<char>(::tolower(static_cast<unsigned char>(ch))); });
+	if (name != "svchost.exe") {
+		return std::wstring();
+	}
+
+	std::wstring commandLine = process.CommandLine;
+	std::transform(commandLine.begin(), commandLine.end(), commandLine.begin(), ::towlower);
+
+	size_t option = commandLine.find(L" -k ");
+	if (option == std::wstring::npos) {
+		return L"svchost";
+	}
+
+	size_t start = commandLine.find_first_not_of(L' ', option + 4);
+	if (start == std::wstring::npos) {
+		return L"svchost";
+	}
+	size_t end = commandLine.find(L' ', start);
+	return commandLine.substr(start, end == std::wstring::npos ? std::wstring::npos : end - start);
+}
+
+void ProcessGrouping::Update(const std::vector<ProcessInfo>& processes, const ServiceSnapshot* services, bool resolveJobs) {
+	std::unordered_map<DWORD, ProcessGroupAttributes> cache;
+	cache.reserve(processes.size());
+	m_Rows.clear();
+	m_Rows.reserve(processes.size());
+
+	for (const auto& proc : processes) {
+		ULONGLONG creationTime = ToTicks(proc.CreationTime);
+		auto it = m_Cache.find(proc.ProcessId);
+		if (it != m_Cache.end() && it->second.CreationTime == creationTime) {
+			// Session and user are already in the snapshot and may have been
+			// resolved later than the cached entry.
+			it->second.SessionId = proc.SessionId;
+			it->second.UserSid = proc.UserSid;
+			m_Rows.push_back(it->second);
+		} else {
+			m_Rows.push_back(CollectAttributes(proc));
+		}
+		cache[proc.ProcessId] = m_Rows.back();
+
+		if (services && services->HostsServices(proc.ProcessId)) {
+			m_Rows.back().ServiceGroup = GetServiceHostGroup(proc);
+		} else {
+			m_Rows.back().ServiceGroup.clear();
+		}
+	}
+
+	m_Cache = std::move(cache);
+
+	m_JobsResolved = resolveJobs;
+	if (resolveJobs) {
+		ResolveJobs();
+	}
+}
+
+void ProcessGrouping::ResolveJobs() {
+	for (auto& row : m_Rows) {
+		row.JobKey.clear();
+	}
+	bool anyInJob = std::any_of(m_Rows.begin(), m_Rows.end(), [](const ProcessGroupAttributes& row) { return row.IsInJob; });
+	WORD jobType = 0;
+	if (!anyInJob || !ObjectTypeTable::GetSystem().Find(L"Job", jobType) || !m_Handles.Capture()) {
+		return;
+	}
+
+	// One handle per job object. Object addresses may be hidden, in which
+	// case handles to the same job are all kept; they have the same members,
+	// so the first of them wins below.
+	struct JobCandidate {
+		std::wstring Key;
+		HandleWrapper Handle;
+		std::vector<size_t> Rows;
+	};
+	std::vector<JobCandidate> jobs;
+	std::unordered_set<ULONG_PTR> seenObjects;
+	std::unordered_map<DWORD, HandleWrapper> holders;
+	for (const HandleEntry& entry : m_Handles.GetHandles()) {
+		if (entry.ObjectTypeIndex != jobType || (entry.ObjectAddress != 0 && !seenObjects.insert(entry.ObjectAddress).second)) {
+			continue;
+		}
+		auto holder = holders.find(entry.ProcessId);
+		if (holder == holders.end()) {
+			holder = holders.emplace(entry.ProcessId, HandleWrapper(::OpenProcess(PROCESS_DUP_HANDLE, FALSE, entry.ProcessId))).first;
+		}
+		HANDLE hJob = nullptr;
+		if (!holder->second.IsValid() || !DuplicateHandle(holder->second.Get(), reinterpret_cast<HANDLE>(entry.HandleValue),
+			GetCurrentProcess(), &hJob, JOB_OBJECT_QUERY, FALSE, 0)) {
+			continue;
+		}
+
+		wchar_t key[64];
+		if (entry.ObjectAddress != 0) {
+			swprintf_s(key, L"Job 0x%llx", static_cast<ULONGLONG>(entry.ObjectAddress));
+		} else {
+			swprintf_s(key, L"Job %lu:0x%llx", entry.ProcessId, static_cast<ULONGLONG>(entry.HandleValue));
+		}
+		JobCandidate job;
+		job.Key = key;
+		job.Handle.Reset(hJob);
+		jobs.push_back(std::move(job));
+	}
+	m_Handles.Clear();
+
+	for (size_t row = 0; row < m_Rows.size(); ++row) {
+		if (!m_Rows[row].IsInJob) {
+			continue;
+		}
+		HandleWrapper hProcess(::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, m_Rows[row].ProcessId));
+		if (!hProcess.IsValid()) {
+			continue;
+		}
+		for (auto& job : jobs) {
+			BOOL inJob = FALSE;
+			if (::IsProcessInJob(hProcess.Get(), job.Handle.Get(), &inJob) && inJob) {
+				job.Rows.push_back(row);
+			}
+		}
+	}
+
+	// Jobs nest, so a process is in every job above its own; the one with
+	// the fewest members is the innermost.
+	std::vector<size_t> innermost(m_Rows.size(), NoJob);
+	for (size_t index = 0; index < jobs.size(); ++index) {
+		for (size_t row : jobs[index].Rows) {
+			if (innermost[row] == NoJob || jobs[index].Rows.size() < jobs[innermost[row]].Rows.size()) {
+				innermost[row] = index;
+			}
+		}
+	}
+	for (size_t row = 0; row < m_Rows.size(); ++row) {
+		if (innermost[row] != NoJob) {
+			m_Rows[row].JobKey = jobs[innermost[row]].Key;
+		}
+	}
+}
+
+std::wstring ProcessGrouping::GetGroupKey(const ProcessGroupAttributes& attributes, ProcessGroupKind kind) {
+	switch (kind) {
+		case ProcessGroupKind::AppContainer:
+			return attributes.AppContainerSid;
+		case ProcessGroupKind::Package:
+			return attributes.PackageFullName;
+		case ProcessGroupKind::Job:
+			return attributes.JobKey;
+		case ProcessGroupKind::Session:
+			return L"Session " + std::to_wstring(attributes.SessionId);
+		case ProcessGroupKind::User:
+			return attributes.UserSid;
+		case ProcessGroupKind::ServiceGroup:
+			return attributes.ServiceGroup;
+		default:
+			return std::wstring();
+	}
+}
+
+std::vector<ProcessGroup> ProcessGrouping::Group(ProcessGroupKind kind, size_t minimumSize) const {
+	std::vector<ProcessGroup> groups;
+	if (kind == ProcessGroupKind::None) {
+		return groups;
+	}
+
+	std::unordered_map<std::wstring, size_t> buckets;
+	for (size_t row = 0; row < m_Rows.size(); ++row) {
+		std::wstring key = GetGroupKey(m_Rows[row], kind);
+		if (key.empty()) {
+			continue;
+		}
+
+		auto inserted = buckets.emplace(key, groups.size());
+		if (inserted.second) {
+			ProcessGroup group;
+			group.Key = std::move(key);
+			groups.push_back(std::move(group));
+		}
+		groups[inserted.first->second].Rows.push_back(row);
+	}
+
+	if (minimumSize > 1) {
+		std::vector<ProcessGroup> kept;
+		for (auto& group : groups) {
+			if (group.Rows.size() >= minimumSize) {
+				kept.push_back(std::move(group));
+			}
+		}
+		groups = std::move(kept);
+	}
+
+	return groups;
+}
+
+std::vector<size_t> ProcessGrouping::GetGroupLeaders(ProcessGroupKind kind) const {
+	std::vector<size_t> leaders(m_Rows.size(), NoLeader);
+	for (const auto& group : Group(kind, 2)) {
+		// The oldest member leads, so the layout does not change with sorting.
+		size_t leader = group.Rows.front();
+		for (size_t row : group.Rows) {
+			const auto& candidate = m_Rows[row];
+			const auto& current = m_Rows[leader];
+			if (candidate.CreationTime < current.CreationTime ||
+				(candidate.CreationTime == current.CreationTime && candidate.ProcessId < current.ProcessId)) {
+				leader = row;
+			}
+		}
+
+		for (size_t row : group.Rows) {
+			leaders[row] = leader;
+		}
+	}
+	return leaders;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
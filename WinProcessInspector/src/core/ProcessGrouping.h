@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "ProcessManager.h"
+#include "ServiceSnapshot.h"
+#include "HandleSnapshot.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class ProcessGroupKind {
+		None,
+		AppContainer,
+		Package,
+		Job,
+		Session,
+		User,
+		ServiceGroup
+	};
+
+	struct ProcessGroupAttributes {
+		DWORD ProcessId = 0;
+		ULONGLONG CreationTime = 0;
+		std::wstring AppContainerSid;
+		std::wstring PackageFullName;
+		bool IsInJob = false;
+		// Identifies the innermost job the process runs in; empty until jobs
+		// are resolved, or if no handle to its job could be opened.
+		std::wstring JobKey;
+		DWORD SessionId = 0;
+		std::wstring UserSid;
+		std::wstring ServiceGroup;
+	};
+
+	struct ProcessGroup {
+		std::wstring Key;
+		std::vector<size_t> Rows;
+	};
+
+	// Grouping attributes of a process snapshot. Each process is opened once
+	// and its token read once; the result is reused on later snapshots for as
+	// long as the same process (PID and creation time) is still running.
+	// Opening processes is slow, so this runs on the snapshot worker.
+	class ProcessGrouping {
+	public:
+		ProcessGrouping() = default;
+		~ProcessGrouping() = default;
+
+		ProcessGrouping(const ProcessGrouping&) = delete;
+		ProcessGrouping& operator=(const ProcessGrouping&) = delete;
+		ProcessGrouping(ProcessGrouping&&) = default;
+		ProcessGrouping& operator=(ProcessGrouping&&) = default;
+
+		// services, when given, is used to find the svchost instances that host
+		// services; they are grouped by their "-k" service group. resolveJobs
+		// also finds which job object each process in a job belongs to, from
+		// the job handles in a system-wide handle capture.
+		void Update(const std::vector<ProcessInfo>& processes, const ServiceSnapshot* services = nullptr, bool resolveJobs = false);
+		void Clear();
+
+		bool HasJobs() const { return m_JobsResolved; }
+
+		size_t GetRowCount() const { return m_Rows.size(); }
+		const ProcessGroupAttributes& GetAttributes(size_t row) const { return m_Rows[row]; }
+
+		// Groups rows by the given attribute. Rows without a value for it (no
+		// AppContainer, no package, not in a job) are left out. Groups and their
+		// rows follow snapshot order.
+		std::vector<ProcessGroup> Group(ProcessGroupKind kind, size_t minimumSize = 1) const;
+
+		// For every row, the oldest row of its group, or -1 if the row is not in
+		// a group of at least two.
+		std::vector<size_t> GetGroupLeaders(ProcessGroupKind kind) const;
+
+		static std::wstring GetGroupKey(const ProcessGroupAttributes& attributes, ProcessGroupKind kind);
+		static ProcessGroupAttributes CollectAttributes(const ProcessInfo& process);
+		static std::wstring GetServiceHostGroup(const ProcessInfo& process);
+
+	private:
+		void ResolveJobs();
+
+		std::vector<ProcessGroupAttributes> m_Rows;
+		std::unordered_map<DWORD, ProcessGroupAttributes> m_Cache;
+		HandleSnapshot m_Handles;
+		bool m_JobsResolved = false;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
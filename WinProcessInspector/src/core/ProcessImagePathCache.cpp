@@ -0,0 +1,66 @@
+#include "ProcessImagePathCache.h"
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	// Doubles up to about four minutes, where processes that can never be
+	// opened settle.
+	const ULONGLONG FirstRetryMs = 2000;
+	const DWORD MaxRetryShift = 7;
+
+}
+
+void ProcessImagePathCache::Update(std::vector<ProcessInfo>& processes, const ProcessManager& processManager) {
+	std::unordered_map<DWORD, Entry> paths;
+	paths.reserve(processes.size());
+	ULONGLONG now = GetTickCount64();
+
+	for (auto& process : processes) {
+		ULONGLONG creationTime = (static_cast<ULONGLONG>(process.CreationTime.dwHighDateTime) << 32) |
+			process.CreationTime.dwLowDateTime;
+
+		auto it = m_Paths.find(process.ProcessId);
+		if (it != m_Paths.end() && it->second.CreationTime == creationTime) {
+			if (it->second.RetryTick != 0 && now >= it->second.RetryTick) {
+				Query(process.ProcessId, it->second, processManager, now);
+			}
+			process.ImagePath = it->second.Path;
+			paths.emplace(process.ProcessId, std::move(it->second));
+			continue;
+		}
+
+		// A new process, or a reused PID.
+		Entry entry;
+		entry.CreationTime = creationTime;
+		if (process.ProcessId != 0) {
+			Query(process.ProcessId, entry, processManager, now);
+		}
+		process.ImagePath = entry.Path;
+		paths.emplace(process.ProcessId, std::move(entry));
+	}
+
+	// Processes missing from the snapshot have exited.
+	m_Paths = std::move(paths);
+}
+
+void ProcessImagePathCache::Query(DWORD processId, Entry& entry, const ProcessManager& processManager, ULONGLONG now) {
+	entry.Path = processManager.GetProcessImagePath(processId);
+	if (!entry.Path.empty()) {
+		entry.RetryTick = 0;
+		entry.Failures = 0;
+		return;
+	}
+
+	entry.RetryTick = now + (FirstRetryMs << std::min<DWORD>(entry.Failures, MaxRetryShift));
+	++entry.Failures;
+}
+
+void ProcessImagePathCache::Clear() {
+	m_Paths.clear();
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
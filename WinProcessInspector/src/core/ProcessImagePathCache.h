@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "ProcessManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Image path of every running process. A path is queried once, when its
+	// process (PID and creation time) is first seen, and dropped when the
+	// process exits. A failed query is not final: it is retried after a delay
+	// that doubles with every failure, so protected processes cost little
+	// and a process that was briefly unavailable still gets its path.
+	class ProcessImagePathCache {
+	public:
+		ProcessImagePathCache() = default;
+		~ProcessImagePathCache() = default;
+
+		ProcessImagePathCache(const ProcessImagePathCache&) = delete;
+		ProcessImagePathCache& operator=(const ProcessImagePathCache&) = delete;
+		ProcessImagePathCache(ProcessImagePathCache&&) = default;
+		ProcessImagePathCache& operator=(ProcessImagePathCache&&) = default;
+
+		// Sets ImagePath of every process in the snapshot.
+		void Update(std::vector<ProcessInfo>& processes, const ProcessManager& processManager);
+		void Clear();
+
+	private:
+		struct Entry {
+			ULONGLONG CreationTime = 0;
+			std::wstring Path;
+			// Set while Path is empty because the query failed.
+			ULONGLONG RetryTick = 0;
+			DWORD Failures = 0;
+		};
+
+		void Query(DWORD processId, Entry& entry, const ProcessManager& processManager, ULONGLONG now);
+
+		std::unordered_map<DWORD, Entry> m_Paths;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
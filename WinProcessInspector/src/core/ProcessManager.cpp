@@ -54,17 +54,28 @@ namespace Core {
 
 std::vector<ProcessInfo> ProcessManager::EnumerateAllProcesses() const {
 	std::vector<ProcessInfo> processes;
+	EnumerateAllProcesses(processes);
+	return processes;
+}
+
+bool ProcessManager::EnumerateAllProcesses(std::vector<ProcessInfo>& processes, const std::atomic<bool>* cancelled,
+	ProcessFieldMask fields, ProcessFieldTimings* timings) const {
+	processes.clear();
 
 	PROCESSENTRY32W pe32 = {};
 	pe32.dwSize = sizeof(PROCESSENTRY32W);
 
 	HandleWrapper hSnap(CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
 	if (!hSnap.IsValid() || hSnap.Get() == INVALID_HANDLE_VALUE) {
-		return processes;
+		return false;
 	}
 
 	if (Process32FirstW(hSnap.Get(), &pe32)) {
 		do {
+			if (cancelled && cancelled->load()) {
+				return false;
+			}
+
 			ProcessInfo info;
 			info.ProcessId = pe32.th32ProcessID;
 			info.ParentProcessId = pe32.th32ParentProcessID;
@@ -77,57 +88,107 @@ std::vector<ProcessInfo> ProcessManager::EnumerateAllProcesses() const {
 				info.ProcessName = processName;
 			}
 
-			info.Architecture = GetProcessArchitecture(pe32.th32ProcessID);
-			info.SessionId = GetProcessSessionId(pe32.th32ProcessID);
-			
-			Security::SecurityManager secMgr;
-			info.IntegrityLevel = secMgr.GetProcessIntegrityLevel(pe32.th32ProcessID);
-			
-			GetProcessUser(pe32.th32ProcessID, info.UserSid, info.UserName, info.UserDomain);
-			
-			info.CommandLine = GetProcessCommandLine(pe32.th32ProcessID);
 			info.ThreadCount = pe32.cntThreads;
-			
+
 			FILETIME creationTime, exitTime, kernelTime, userTime;
 			if (GetProcessTimes(pe32.th32ProcessID, creationTime, exitTime, kernelTime, userTime)) {
 				info.CreationTime = creationTime;
 			}
-			
-			DWORD threadCount, handleCount;
-			if (GetProcessCounts(pe32.th32ProcessID, threadCount, handleCount)) {
-				info.HandleCount = handleCount;
-			}
-			
-			GetProcessGdiUserCounts(pe32.th32ProcessID, info.GdiObjectCount, info.UserObjectCount);
-			GetProcessIoCounters(pe32.th32ProcessID, info.ReadOperationCount, info.WriteOperationCount, 
-				info.ReadTransferCount, info.WriteTransferCount);
-			
-			HandleWrapper hProc = OpenProcess(pe32.th32ProcessID, PROCESS_QUERY_INFORMATION);
-			if (hProc.IsValid()) {
-				PROCESS_MEMORY_COUNTERS_EX pmc = {};
-				pmc.cb = sizeof(pmc);
-				if (GetProcessMemoryInfo(hProc.Get(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc))) {
-					info.PeakWorkingSetSize = pmc.PeakWorkingSetSize;
-					info.PageFaultCount = pmc.PageFaultCount;
-				}
-			}
-			
-			GetProcessMitigations(pe32.th32ProcessID, info.DEPEnabled, info.ASLREnabled, info.CFGEnabled);
-			info.IsVirtualized = IsProcessVirtualized(pe32.th32ProcessID);
-			info.IsAppContainer = IsProcessAppContainer(pe32.th32ProcessID);
-			info.IsInJob = IsProcessInJob(pe32.th32ProcessID);
-			
-			GetProcessPriorityClass(pe32.th32ProcessID, info.PriorityClass);
-			DWORD_PTR processAffinity, systemAffinity;
-			if (GetProcessAffinityMask(pe32.th32ProcessID, processAffinity, systemAffinity)) {
-				info.AffinityMask = processAffinity;
-			}
 
-			processes.push_back(info);
+			CollectProcessFields(info, fields, timings);
+
+			processes.push_back(std::move(info));
 		} while (Process32NextW(hSnap.Get(), &pe32));
 	}
 
-	return processes;
+	if (timings) {
+		timings->ProcessCount = processes.size();
+	}
+	return true;
+}
+
+void ProcessManager::CollectProcessFields(ProcessInfo& info, ProcessFieldMask fields, ProcessFieldTimings* timings) const {
+	const DWORD processId = info.ProcessId;
+	LARGE_INTEGER frequency = {};
+	LARGE_INTEGER start = {};
+	if (timings) {
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	// Runs one field's query if it was asked for and adds its time.
+	auto collect = [&](ProcessField field, auto&& query) {
+		if (!(fields & field)) {
+			return;
+		}
+		if (timings) {
+			QueryPerformanceCounter(&start);
+		}
+		query();
+		if (timings && frequency.QuadPart > 0) {
+			LARGE_INTEGER end = {};
+			QueryPerformanceCounter(&end);
+			timings->Microseconds[ProcessFieldCosts::GetFieldIndex(field)] +=
+				static_cast<double>(end.QuadPart - start.QuadPart) * 1000000.0 / static_cast<double>(frequency.QuadPart);
+		}
+	};
+
+	collect(ProcessFieldArchitecture, [&]() {
+		info.Architecture = GetProcessArchitecture(processId);
+	});
+	collect(ProcessFieldSession, [&]() {
+		info.SessionId = GetProcessSessionId(processId);
+	});
+	collect(ProcessFieldIntegrity, [&]() {
+		Security::SecurityManager secMgr;
+		info.IntegrityLevel = secMgr.GetProcessIntegrityLevel(processId);
+	});
+	collect(ProcessFieldUser, [&]() {
+		GetProcessUser(processId, info.UserSid, info.UserName, info.UserDomain);
+	});
+	collect(ProcessFieldCommandLine, [&]() {
+		info.CommandLine = GetProcessCommandLine(processId);
+	});
+	collect(ProcessFieldHandleCount, [&]() {
+		DWORD threadCount, handleCount;
+		if (GetProcessCounts(processId, threadCount, handleCount)) {
+			info.HandleCount = handleCount;
+		}
+	});
+	collect(ProcessFieldGuiObjects, [&]() {
+		GetProcessGdiUserCounts(processId, info.GdiObjectCount, info.UserObjectCount);
+	});
+	collect(ProcessFieldIoCounters, [&]() {
+		GetProcessIoCounters(processId, info.ReadOperationCount, info.WriteOperationCount,
+			info.ReadTransferCount, info.WriteTransferCount);
+	});
+	collect(ProcessFieldMemoryCounters, [&]() {
+		HandleWrapper hProc = OpenProcess(processId, PROCESS_QUERY_INFORMATION);
+		if (hProc.IsValid()) {
+			PROCESS_MEMORY_COUNTERS_EX pmc = {};
+			pmc.cb = sizeof(pmc);
+			if (GetProcessMemoryInfo(hProc.Get(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc))) {
+				info.PeakWorkingSetSize = pmc.PeakWorkingSetSize;
+				info.PageFaultCount = pmc.PageFaultCount;
+			}
+		}
+	});
+	collect(ProcessFieldMitigations, [&]() {
+		GetProcessMitigations(processId, info.DEPEnabled, info.ASLREnabled, info.CFGEnabled);
+	});
+	collect(ProcessFieldIsolation, [&]() {
+		info.IsVirtualized = IsProcessVirtualized(processId);
+		info.IsAppContainer = IsProcessAppContainer(processId);
+		info.IsInJob = IsProcessInJob(processId);
+	});
+	collect(ProcessFieldPriority, [&]() {
+		GetProcessPriorityClass(processId, info.PriorityClass);
+	});
+	collect(ProcessFieldAffinity, [&]() {
+		DWORD_PTR processAffinity, systemAffinity;
+		if (GetProcessAffinityMask(processId, processAffinity, systemAffinity)) {
+			info.AffinityMask = processAffinity;
+		}
+	});
 }
 
 ProcessInfo ProcessManager::GetProcessDetails(DWORD processId) const {
@@ -142,6 +203,7 @@ ProcessInfo ProcessManager::GetProcessDetails(DWORD processId) const {
 	WCHAR processName[MAX_PATH] = {};
 	DWORD processNameLen = MAX_PATH;
 	if (QueryFullProcessImageNameW(hProcess.Get(), 0, processName, &processNameLen)) {
+		info.ImagePath = processName;
 		int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, processName, -1, nullptr, 0, nullptr, nullptr);
 		if (sizeNeeded > 0) {
 			std::string name(sizeNeeded, 0);
@@ -384,6 +446,22 @@ bool ProcessManager::GetThreadState(HANDLE hThread, DWORD& state, DWORD& waitRea
 	return false;
 }
 
+std::wstring ProcessManager::GetProcessImagePath(DWORD processId) const {
+	// Limited access is enough for the image name and is granted for
+	// protected processes as well.
+	HandleWrapper hProcess = OpenProcess(processId, PROCESS_QUERY_LIMITED_INFORMATION);
+	if (!hProcess.IsValid()) {
+		return L"";
+	}
+
+	WCHAR imagePath[MAX_PATH] = {};
+	DWORD pathLen = MAX_PATH;
+	if (QueryFullProcessImageNameW(hProcess.Get(), 0, imagePath, &pathLen)) {
+		return std::wstring(imagePath, pathLen);
+	}
+	return L"";
+}
+
 std::wstring ProcessManager::GetProcessCommandLine(DWORD processId) const {
 	HandleWrapper hProcess = OpenProcess(processId, PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ);
 	if (!hProcess.IsValid()) {
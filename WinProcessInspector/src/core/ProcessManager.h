@@ -5,7 +5,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <atomic>
 #include "HandleWrapper.h"
+#include "ProcessFields.h"
 #include "../security/SecurityManager.h"
 
 namespace WinProcessInspector {
@@ -22,6 +24,7 @@ namespace Core {
 		std::wstring UserName;
 		std::wstring UserDomain;
 		std::wstring CommandLine;
+		std::wstring ImagePath;
 		FILETIME CreationTime = {};
 		DWORD ThreadCount = 0;
 		DWORD HandleCount = 0;
@@ -63,6 +66,13 @@ namespace Core {
 		ProcessManager& operator=(ProcessManager&&) = default;
 
 		std::vector<ProcessInfo> EnumerateAllProcesses() const;
+		// Refills processes, keeping its capacity, with only the requested
+		// fields. Returns false if the snapshot could not be taken or cancelled
+		// was set part way through.
+		bool EnumerateAllProcesses(std::vector<ProcessInfo>& processes, const std::atomic<bool>* cancelled = nullptr,
+			ProcessFieldMask fields = ProcessFieldAll, ProcessFieldTimings* timings = nullptr) const;
+		// Queries the given fields of one process.
+		void CollectProcessFields(ProcessInfo& info, ProcessFieldMask fields, ProcessFieldTimings* timings = nullptr) const;
 
 		ProcessInfo GetProcessDetails(DWORD processId) const;
 
@@ -79,6 +89,7 @@ namespace Core {
 		bool GetProcessUser(DWORD processId, std::wstring& userSid, std::wstring& userName, std::wstring& userDomain) const;
 		
 		std::wstring GetProcessCommandLine(DWORD processId) const;
+		std::wstring GetProcessImagePath(DWORD processId) const;
 		bool GetProcessTimes(DWORD processId, FILETIME& creationTime, FILETIME& exitTime, FILETIME& kernelTime, FILETIME& userTime) const;
 		bool GetProcessCounts(DWORD processId, DWORD& threadCount, DWORD& handleCount) const;
 		bool GetProcessGdiUserCounts(DWORD processId, DWORD& gdiCount, DWORD& userCount) const;
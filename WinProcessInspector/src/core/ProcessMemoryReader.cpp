@@ -0,0 +1,79 @@
+#include "ProcessMemoryReader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const ULONG_PTR PageSize = 0x1000;
+
+}
+
+void ResetFailedPages(std::vector<bool>* failedPages, ULONG_PTR address, size_t size) {
+	if (failedPages) {
+		ULONG_PTR first = address & ~(PageSize - 1);
+		failedPages->assign(static_cast<size_t>((address - first + size + PageSize - 1) / PageSize), false);
+	}
+}
+
+void MarkFailedPages(std::vector<bool>* failedPages, ULONG_PTR address, ULONG_PTR start, size_t length) {
+	if (!failedPages || length == 0) {
+		return;
+	}
+	ULONG_PTR first = address & ~(PageSize - 1);
+	size_t begin = static_cast<size_t>((start - first) / PageSize);
+	size_t end = std::min(static_cast<size_t>((start - first + length + PageSize - 1) / PageSize), failedPages->size());
+	for (size_t page = begin; page < end; ++page) {
+		(*failedPages)[page] = true;
+	}
+}
+
+bool ProcessMemoryReader::Open(DWORD processId, DWORD desiredAccess) {
+	m_Process.Reset(::OpenProcess(desiredAccess, FALSE, processId));
+	return m_Process.IsValid();
+}
+
+void ProcessMemoryReader::Close() {
+	m_Process.Reset();
+}
+
+bool ProcessMemoryReader::Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) const {
+	if (!m_Process.IsValid() || size == 0) {
+		return false;
+	}
+
+	ResetFailedPages(failedPages, address, size);
+	SIZE_T bytesRead = 0;
+	if (ReadProcessMemory(m_Process.Get(), reinterpret_cast<LPCVOID>(address), buffer, size, &bytesRead) && bytesRead == size) {
+		return true;
+	}
+
+	// One bad page fails the whole read, so fall back to single pages.
+	BYTE* out = static_cast<BYTE*>(buffer);
+	bool anyRead = false;
+	size_t offset = 0;
+	while (offset < size) {
+		ULONG_PTR current = address + offset;
+		size_t length = std::min<size_t>(size - offset, PageSize - (current & (PageSize - 1)));
+		bytesRead = 0;
+		if (ReadProcessMemory(m_Process.Get(), reinterpret_cast<LPCVOID>(current), out + offset, length, &bytesRead) && bytesRead == length) {
+			anyRead = true;
+		} else {
+			memset(out + offset, 0, length);
+			MarkFailedPages(failedPages, address, current, length);
+		}
+		offset += length;
+	}
+	return anyRead;
+}
+
+MemoryReadFunction ProcessMemoryReader::GetReadFunction() const {
+	return [this](ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) {
+		return Read(address, buffer, size, failedPages);
+	};
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
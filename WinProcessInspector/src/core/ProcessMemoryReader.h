@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Windows.h>
+#include <functional>
+#include <vector>
+#include "HandleWrapper.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Reads size bytes at address into buffer. Pages that cannot be read
+	// are zero filled; returns false only when nothing could be read.
+	// Unless failedPages is null, it receives one flag per page the read
+	// touches, from the page holding address, set for the pages that were
+	// zero filled. Scanners take this instead of a process handle so they
+	// can run over any source of bytes, such as a dump or a file.
+	typedef std::function<bool(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages)> MemoryReadFunction;
+
+	// For readers filling failedPages: sizes it for a read of size bytes at
+	// address with no page failed, then flags the pages holding the bytes
+	// from start for length.
+	void ResetFailedPages(std::vector<bool>* failedPages, ULONG_PTR address, size_t size);
+	void MarkFailedPages(std::vector<bool>* failedPages, ULONG_PTR address, ULONG_PTR start, size_t length);
+
+	class ProcessMemoryReader {
+	public:
+		ProcessMemoryReader() = default;
+		~ProcessMemoryReader() = default;
+
+		ProcessMemoryReader(const ProcessMemoryReader&) = delete;
+		ProcessMemoryReader& operator=(const ProcessMemoryReader&) = delete;
+		ProcessMemoryReader(ProcessMemoryReader&&) = default;
+		ProcessMemoryReader& operator=(ProcessMemoryReader&&) = default;
+
+		bool Open(DWORD processId, DWORD desiredAccess = PROCESS_QUERY_INFORMATION | PROCESS_VM_READ);
+		void Close();
+		bool IsOpen() const { return m_Process.IsValid(); }
+		HANDLE GetHandle() const { return m_Process.Get(); }
+
+		// Safe to call from several threads at once.
+		bool Read(ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages = nullptr) const;
+		// Bound to this reader, which must outlive it.
+		MemoryReadFunction GetReadFunction() const;
+
+	private:
+		HandleWrapper m_Process;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
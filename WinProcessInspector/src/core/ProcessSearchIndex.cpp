@@ -0,0 +1,253 @@
+#include "ProcessSearchIndex.h"
+#include <algorithm>
+#include <cwctype>
+#include <cwchar>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t NotFound = static_cast<size_t>(-1);
+
+#if defined(_M_X64) || defined(_M_IX86)
+	unsigned long LowestSetBit(unsigned long mask) {
+		unsigned long index = 0;
+		_BitScanForward(&index, mask);
+		return index;
+	}
+
+	bool MiddleMatches(const wchar_t* candidate, const wchar_t* pattern, size_t patternLength) {
+		return patternLength <= 2 || wmemcmp(candidate + 1, pattern + 1, patternLength - 2) == 0;
+	}
+#endif
+
+	ProcessSearchIndex::Kernel DetectKernel() {
+#if defined(_M_X64) || defined(_M_IX86)
+		int info[4] = {};
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		if (maxLeaf < 1) {
+			return ProcessSearchIndex::Kernel::Scalar;
+		}
+
+		__cpuid(info, 1);
+		bool hasSse2 = (info[3] & (1 << 26)) != 0;
+		bool hasOsXsave = (info[2] & (1 << 27)) != 0;
+		bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+		if (maxLeaf >= 7 && hasOsXsave && hasAvx && (_xgetbv(0) & 0x6) == 0x6) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 5)) != 0) {
+				return ProcessSearchIndex::Kernel::AVX2;
+			}
+		}
+
+		return hasSse2 ? ProcessSearchIndex::Kernel::SSE2 : ProcessSearchIndex::Kernel::Scalar;
+#else
+		return ProcessSearchIndex::Kernel::Scalar;
+#endif
+	}
+
+}
+
+void ProcessSearchIndex::Clear() {
+	m_Text.clear();
+	m_RowOffsets.clear();
+}
+
+void ProcessSearchIndex::Reserve(size_t rowCount, size_t charCount) {
+	m_RowOffsets.reserve(rowCount);
+	m_Text.reserve(charCount);
+}
+
+void ProcessSearchIndex::BeginRow() {
+	m_RowOffsets.push_back(m_Text.size());
+}
+
+void ProcessSearchIndex::AddField(const std::wstring& text) {
+	if (m_RowOffsets.empty()) {
+		BeginRow();
+	}
+
+	for (wchar_t ch : text) {
+		m_Text.push_back(static_cast<wchar_t>(::towlower(ch)));
+	}
+	m_Text.push_back(L'\0');
+}
+
+void ProcessSearchIndex::AddField(const std::string& text) {
+	if (m_RowOffsets.empty()) {
+		BeginRow();
+	}
+
+	for (char ch : text) {
+		m_Text.push_back(static_cast<wchar_t>(::towlower(static_cast<unsigned char>(ch))));
+	}
+	m_Text.push_back(L'\0');
+}
+
+std::vector<size_t> ProcessSearchIndex::FindRows(const std::wstring& pattern) const {
+	std::vector<size_t> rows;
+	if (m_RowOffsets.empty()) {
+		return rows;
+	}
+
+	if (pattern.empty()) {
+		rows.resize(m_RowOffsets.size());
+		for (size_t i = 0; i < rows.size(); ++i) {
+			rows[i] = i;
+		}
+		return rows;
+	}
+
+	std::wstring patternLower = pattern;
+	std::transform(patternLower.begin(), patternLower.end(), patternLower.begin(), ::towlower);
+	if (patternLower.find(L'\0') != std::wstring::npos) {
+		return rows;
+	}
+
+	const wchar_t* text = m_Text.data();
+	const size_t length = m_Text.size();
+	size_t start = 0;
+
+	while (start < length) {
+		size_t hit = Find(text + start, length - start, patternLower.data(), patternLower.size());
+		if (hit == NotFound) {
+			break;
+		}
+
+		size_t position = start + hit;
+		auto rowIt = std::upper_bound(m_RowOffsets.begin(), m_RowOffsets.end(), position);
+		size_t row = static_cast<size_t>(rowIt - m_RowOffsets.begin()) - 1;
+		rows.push_back(row);
+
+		if (rowIt == m_RowOffsets.end()) {
+			break;
+		}
+		start = *rowIt;
+	}
+
+	return rows;
+}
+
+ProcessSearchIndex::Kernel ProcessSearchIndex::GetActiveKernel() {
+	static const Kernel kernel = DetectKernel();
+	return kernel;
+}
+
+size_t ProcessSearchIndex::Find(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength) {
+	if (patternLength == 0) {
+		return 0;
+	}
+	if (patternLength > length) {
+		return NotFound;
+	}
+
+	switch (GetActiveKernel()) {
+		case Kernel::AVX2:
+			return FindAvx2(text, length, pattern, patternLength);
+		case Kernel::SSE2:
+			return FindSse2(text, length, pattern, patternLength);
+		default:
+			return FindScalar(text, length, pattern, patternLength);
+	}
+}
+
+size_t ProcessSearchIndex::FindScalar(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength) {
+	if (patternLength == 0) {
+		return 0;
+	}
+	if (patternLength > length) {
+		return NotFound;
+	}
+
+	const size_t lastStart = length - patternLength;
+	size_t i = 0;
+	while (i <= lastStart) {
+		const wchar_t* candidate = wmemchr(text + i, pattern[0], lastStart - i + 1);
+		if (!candidate) {
+			return NotFound;
+		}
+
+		i = static_cast<size_t>(candidate - text);
+		if (wmemcmp(candidate, pattern, patternLength) == 0) {
+			return i;
+		}
+		++i;
+	}
+
+	return NotFound;
+}
+
+// Both SIMD kernels compare a block of text against the first and the last
+// pattern character at once and only verify the middle on double hits, which
+// skips most candidate positions without a per-character branch.
+size_t ProcessSearchIndex::FindSse2(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength) {
+#if defined(_M_X64) || defined(_M_IX86)
+	static_assert(sizeof(wchar_t) == 2, "SIMD kernels expect UTF-16 code units");
+	const size_t lanes = 8;
+	const __m128i first = _mm_set1_epi16(static_cast<short>(pattern[0]));
+	const __m128i last = _mm_set1_epi16(static_cast<short>(pattern[patternLength - 1]));
+
+	size_t i = 0;
+	for (; i + patternLength - 1 + lanes <= length; i += lanes) {
+		__m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		__m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + patternLength - 1));
+		__m128i hits = _mm_and_si128(_mm_cmpeq_epi16(blockFirst, first), _mm_cmpeq_epi16(blockLast, last));
+
+		unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(hits));
+		while (mask != 0) {
+			unsigned long bit = LowestSetBit(mask);
+			size_t position = i + bit / 2;
+			if (MiddleMatches(text + position, pattern, patternLength)) {
+				return position;
+			}
+			mask &= ~(3ul << bit);
+		}
+	}
+
+	size_t tail = FindScalar(text + i, length - i, pattern, patternLength);
+	return tail == NotFound ? NotFound : i + tail;
+#else
+	return FindScalar(text, length, pattern, patternLength);
+#endif
+}
+
+size_t ProcessSearchIndex::FindAvx2(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength) {
+#if defined(_M_X64) || defined(_M_IX86)
+	const size_t lanes = 16;
+	const __m256i first = _mm256_set1_epi16(static_cast<short>(pattern[0]));
+	const __m256i last = _mm256_set1_epi16(static_cast<short>(pattern[patternLength - 1]));
+
+	size_t i = 0;
+	for (; i + patternLength - 1 + lanes <= length; i += lanes) {
+		__m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+		__m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + patternLength - 1));
+		__m256i hits = _mm256_and_si256(_mm256_cmpeq_epi16(blockFirst, first), _mm256_cmpeq_epi16(blockLast, last));
+
+		unsigned long mask = static_cast<unsigned long>(static_cast<unsigned int>(_mm256_movemask_epi8(hits)));
+		while (mask != 0) {
+			unsigned long bit = LowestSetBit(mask);
+			size_t position = i + bit / 2;
+			if (MiddleMatches(text + position, pattern, patternLength)) {
+				return position;
+			}
+			mask &= ~(3ul << bit);
+		}
+	}
+
+	size_t tail = FindSse2(text + i, length - i, pattern, patternLength);
+	return tail == NotFound ? NotFound : i + tail;
+#else
+	return FindScalar(text, length, pattern, patternLength);
+#endif
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
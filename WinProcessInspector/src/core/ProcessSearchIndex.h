@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Case-folded text of every searchable field of a process snapshot, packed
+	// into one buffer. Fields are separated by a null character so a match can
+	// never span two fields or two rows.
+	class ProcessSearchIndex {
+	public:
+		enum class Kernel {
+			Scalar,
+			SSE2,
+			AVX2
+		};
+
+		ProcessSearchIndex() = default;
+		~ProcessSearchIndex() = default;
+
+		ProcessSearchIndex(const ProcessSearchIndex&) = delete;
+		ProcessSearchIndex& operator=(const ProcessSearchIndex&) = delete;
+		ProcessSearchIndex(ProcessSearchIndex&&) = default;
+		ProcessSearchIndex& operator=(ProcessSearchIndex&&) = default;
+
+		void Clear();
+		void Reserve(size_t rowCount, size_t charCount);
+
+		void BeginRow();
+		void AddField(const std::wstring& text);
+		void AddField(const std::string& text);
+
+		size_t GetRowCount() const { return m_RowOffsets.size(); }
+		bool IsEmpty() const { return m_RowOffsets.empty(); }
+
+		std::vector<size_t> FindRows(const std::wstring& pattern) const;
+
+		static Kernel GetActiveKernel();
+		static size_t Find(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength);
+
+		// The kernels Find dispatches to, callable directly so each can be
+		// tested and timed on its own. The caller must check the CPU supports
+		// the kernel and that the pattern is not empty; on other architectures
+		// the SIMD ones run the scalar code.
+		static size_t FindScalar(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength);
+		static size_t FindSse2(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength);
+		static size_t FindAvx2(const wchar_t* text, size_t length, const wchar_t* pattern, size_t patternLength);
+
+	private:
+		std::vector<wchar_t> m_Text;
+		std::vector<size_t> m_RowOffsets;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,164 @@
+#include "ProcessSnapshotWorker.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+ProcessSnapshotWorker::~ProcessSnapshotWorker() {
+	Stop();
+}
+
+bool ProcessSnapshotWorker::Start(HWND notifyWindow, UINT notifyMessage, Collector collector) {
+	if (m_Worker.joinable() || !collector) {
+		return m_Worker.joinable();
+	}
+
+	LARGE_INTEGER frequency = {};
+	QueryPerformanceFrequency(&frequency);
+	m_Frequency = frequency.QuadPart > 0 ? frequency.QuadPart : 1;
+
+	m_NotifyWindow = notifyWindow;
+	m_NotifyMessage = notifyMessage;
+	m_Collector = std::move(collector);
+	m_Stopping = false;
+	m_Cancelled = false;
+
+	m_Worker = std::thread(&ProcessSnapshotWorker::WorkerThread, this);
+	return true;
+}
+
+void ProcessSnapshotWorker::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_RequestPending = false;
+	}
+	m_Cancelled = true;
+	m_Wakeup.notify_all();
+
+	if (m_Worker.joinable()) {
+		m_Worker.join();
+	}
+}
+
+void ProcessSnapshotWorker::Request() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Stopping) {
+			return;
+		}
+		if (m_RequestPending) {
+			++m_PendingCoalesced;
+			return;
+		}
+		m_RequestPending = true;
+		m_RequestTime = Now();
+	}
+	m_Wakeup.notify_one();
+}
+
+void ProcessSnapshotWorker::Cancel() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_RequestPending = false;
+	m_PendingCoalesced = 0;
+	if (m_Collecting) {
+		m_Cancelled = true;
+	}
+}
+
+ProcessSnapshot* ProcessSnapshotWorker::TakeSnapshot() {
+	return m_Published.exchange(nullptr);
+}
+
+void ProcessSnapshotWorker::Release(ProcessSnapshot* snapshot) {
+	if (!snapshot) {
+		return;
+	}
+
+	LONGLONG displayed = Now();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		double latency = ToMilliseconds(displayed - snapshot->RequestTime);
+		m_Latency.LastMilliseconds = latency;
+		m_Latency.LastCollectMilliseconds = ToMilliseconds(snapshot->CollectedTime - snapshot->RequestTime);
+		m_Latency.MaxMilliseconds = latency > m_Latency.MaxMilliseconds ? latency : m_Latency.MaxMilliseconds;
+		m_Latency.AverageMilliseconds += (latency - m_Latency.AverageMilliseconds) / static_cast<double>(++m_Latency.Count);
+		m_Latency.CoalescedRequests += snapshot->CoalescedRequests;
+
+		m_BufferInUse[snapshot - m_Buffers] = false;
+	}
+	m_Wakeup.notify_one();
+}
+
+bool ProcessSnapshotWorker::IsBusy() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_RequestPending || m_Collecting;
+}
+
+RefreshLatency ProcessSnapshotWorker::GetLatency() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Latency;
+}
+
+void ProcessSnapshotWorker::WorkerThread() {
+	for (;;) {
+		ProcessSnapshot* buffer = nullptr;
+		{
+			// A new collection waits until the window has released the buffer
+			// it is showing; requests made meanwhile are merged.
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait(lock, [this]() {
+				return m_Stopping || (m_RequestPending && (!m_BufferInUse[0] || !m_BufferInUse[1]));
+			});
+			if (m_Stopping) {
+				break;
+			}
+
+			size_t index = m_BufferInUse[0] ? 1 : 0;
+			m_BufferInUse[index] = true;
+			buffer = &m_Buffers[index];
+			buffer->RequestTime = m_RequestTime;
+			buffer->CoalescedRequests = m_PendingCoalesced;
+			m_RequestPending = false;
+			m_PendingCoalesced = 0;
+			m_Collecting = true;
+			m_Cancelled = false;
+		}
+
+		bool completed = m_Collector(*buffer, m_Cancelled) && !m_Cancelled;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Collecting = false;
+			if (!completed) {
+				m_BufferInUse[buffer - m_Buffers] = false;
+				continue;
+			}
+			buffer->Sequence = ++m_Sequence;
+			buffer->CollectedTime = Now();
+		}
+
+		// A snapshot the window never picked up is superseded and reused.
+		ProcessSnapshot* superseded = m_Published.exchange(buffer);
+		if (superseded) {
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_BufferInUse[superseded - m_Buffers] = false;
+		}
+
+		if (m_NotifyWindow) {
+			PostMessageW(m_NotifyWindow, m_NotifyMessage, 0, 0);
+		}
+	}
+}
+
+double ProcessSnapshotWorker::ToMilliseconds(LONGLONG ticks) const {
+	return static_cast<double>(ticks) * 1000.0 / static_cast<double>(m_Frequency);
+}
+
+LONGLONG ProcessSnapshotWorker::Now() {
+	LARGE_INTEGER counter = {};
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
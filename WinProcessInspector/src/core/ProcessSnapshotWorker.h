@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include "ProcessManager.h"
+#include "ServiceSnapshot.h"
+#include "ProcessGrouping.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct ProcessSnapshot {
+		std::vector<ProcessInfo> Processes;
+		// Fields that were collected, and what each of them cost. Timings
+		// cover TimedFields, which may add fields timed but not kept.
+		ProcessFieldMask Fields = ProcessFieldAll;
+		ProcessFieldMask TimedFields = ProcessFieldAll;
+		ProcessFieldTimings Timings;
+		// Refreshed only when ServicesCollected; otherwise left empty.
+		ServiceSnapshot Services;
+		bool ServicesCollected = false;
+		// Empty unless the collector was asked for a grouping.
+		ProcessGrouping Grouping;
+		ULONGLONG Sequence = 0;
+		// QueryPerformanceCounter ticks of the first request served by this
+		// snapshot and of the end of collection.
+		LONGLONG RequestTime = 0;
+		LONGLONG CollectedTime = 0;
+		// Requests that arrived while this one was pending.
+		size_t CoalescedRequests = 0;
+	};
+
+	struct RefreshLatency {
+		double LastMilliseconds = 0.0;
+		double AverageMilliseconds = 0.0;
+		double MaxMilliseconds = 0.0;
+		double LastCollectMilliseconds = 0.0;
+		ULONGLONG Count = 0;
+		ULONGLONG CoalescedRequests = 0;
+	};
+
+	// Long-lived thread that collects process snapshots on request. Two
+	// snapshot buffers are reused: the worker fills one while the window
+	// shows the other, and a finished snapshot is handed over with an atomic
+	// pointer swap. Requests made while one is pending are merged into it.
+	class ProcessSnapshotWorker {
+	public:
+		// Fills the snapshot and returns false if it stopped because cancelled
+		// was set.
+		typedef std::function<bool(ProcessSnapshot& snapshot, const std::atomic<bool>& cancelled)> Collector;
+
+		ProcessSnapshotWorker() = default;
+		~ProcessSnapshotWorker();
+
+		ProcessSnapshotWorker(const ProcessSnapshotWorker&) = delete;
+		ProcessSnapshotWorker& operator=(const ProcessSnapshotWorker&) = delete;
+
+		// notifyMessage is posted without parameters when a snapshot is ready.
+		bool Start(HWND notifyWindow, UINT notifyMessage, Collector collector);
+		void Stop();
+
+		void Request();
+		// Drops a pending request and abandons the collection in progress.
+		void Cancel();
+
+		// The latest finished snapshot, or nullptr if none was published since
+		// the last call. The caller owns it until Release.
+		ProcessSnapshot* TakeSnapshot();
+		// Returns the buffer and records the request-to-display latency.
+		void Release(ProcessSnapshot* snapshot);
+
+		bool IsBusy() const;
+		RefreshLatency GetLatency() const;
+
+	private:
+		void WorkerThread();
+		double ToMilliseconds(LONGLONG ticks) const;
+		static LONGLONG Now();
+
+		HWND m_NotifyWindow = nullptr;
+		UINT m_NotifyMessage = 0;
+		Collector m_Collector;
+		LONGLONG m_Frequency = 1;
+
+		ProcessSnapshot m_Buffers[2];
+		bool m_BufferInUse[2] = { false, false };
+		std::atomic<ProcessSnapshot*> m_Published{ nullptr };
+
+		std::thread m_Worker;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Wakeup;
+		std::atomic<bool> m_Cancelled{ false };
+		bool m_Stopping = false;
+		bool m_Collecting = false;
+		bool m_RequestPending = false;
+		LONGLONG m_RequestTime = 0;
+		size_t m_PendingCoalesced = 0;
+		ULONGLONG m_Sequence = 0;
+		RefreshLatency m_Latency;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,146 @@
+#include "ProcessSortOrder.h"
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t NoRank = static_cast<size_t>(-1);
+
+	int CompareKeys(const SortKey& a, const SortKey& b) {
+		if (a.Number != b.Number) {
+			return a.Number < b.Number ? -1 : 1;
+		}
+		return a.Collation.compare(b.Collation);
+	}
+
+	bool SameKey(const SortKey& a, const SortKey& b) {
+		return a.Number == b.Number && a.Collation == b.Collation;
+	}
+
+}
+
+void ProcessSortOrder::Reset() {
+	m_PreviousIds.clear();
+	m_PreviousKeys.clear();
+	m_PreviousRank.clear();
+	m_Order.clear();
+	m_KeyKind = -1;
+	m_Collations.clear();
+}
+
+bool ProcessSortOrder::Less(const Entry& a, const Entry& b, const std::vector<SortKey>& keys) const {
+	int cmp = CompareKeys(keys[a.Index], keys[b.Index]);
+	if (cmp != 0) {
+		return m_Ascending ? cmp < 0 : cmp > 0;
+	}
+	return a.Rank < b.Rank;
+}
+
+const std::vector<size_t>& ProcessSortOrder::Update(const std::vector<DWORD>& ids, const std::vector<SortKey>& keys,
+	int keyKind, bool ascending) {
+	const size_t count = std::min(ids.size(), keys.size());
+	const bool sameOrdering = keyKind == m_KeyKind && ascending == m_Ascending;
+	m_KeyKind = keyKind;
+	m_Ascending = ascending;
+
+	// Rows that were already displayed rank by their previous position, new
+	// rows go after them in arrival order, so equal keys never swap places.
+	std::vector<size_t> slots(m_PreviousIds.size(), NoRank);
+	std::vector<Entry> changed;
+	size_t nextNewRank = m_PreviousIds.size();
+
+	for (size_t i = 0; i < count; ++i) {
+		auto it = m_PreviousRank.find(ids[i]);
+		if (it == m_PreviousRank.end() || slots[it->second] != NoRank) {
+			changed.push_back({ i, nextNewRank++ });
+			continue;
+		}
+
+		size_t rank = it->second;
+		if (sameOrdering && SameKey(keys[i], m_PreviousKeys[rank])) {
+			slots[rank] = i;
+		} else {
+			changed.push_back({ i, rank });
+		}
+	}
+
+	std::vector<Entry> unchanged;
+	unchanged.reserve(count - changed.size());
+	for (size_t rank = 0; rank < slots.size(); ++rank) {
+		if (slots[rank] != NoRank) {
+			unchanged.push_back({ slots[rank], rank });
+		}
+	}
+
+	auto less = [this, &keys](const Entry& a, const Entry& b) { return Less(a, b, keys); };
+
+	std::vector<Entry> merged;
+	merged.reserve(count);
+	if (changed.size() * 2 < count) {
+		std::sort(changed.begin(), changed.end(), less);
+		std::merge(unchanged.begin(), unchanged.end(), changed.begin(), changed.end(), std::back_inserter(merged), less);
+	} else {
+		merged = std::move(unchanged);
+		merged.insert(merged.end(), changed.begin(), changed.end());
+		std::sort(merged.begin(), merged.end(), less);
+	}
+
+	m_Order.resize(merged.size());
+	m_PreviousIds.resize(merged.size());
+	m_PreviousKeys.resize(merged.size());
+	m_PreviousRank.clear();
+	m_PreviousRank.reserve(merged.size());
+
+	for (size_t pos = 0; pos < merged.size(); ++pos) {
+		size_t index = merged[pos].Index;
+		m_Order[pos] = index;
+		m_PreviousIds[pos] = ids[index];
+		m_PreviousKeys[pos] = keys[index];
+		m_PreviousRank.emplace(ids[index], pos);
+	}
+
+	for (auto it = m_Collations.begin(); it != m_Collations.end();) {
+		if (m_PreviousRank.count(it->first) == 0) {
+			it = m_Collations.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	return m_Order;
+}
+
+const std::string& ProcessSortOrder::GetCollationKey(DWORD processId, ULONGLONG creationTime, const std::wstring& text) {
+	CachedCollation& cached = m_Collations[processId];
+	if (cached.CreationTime != creationTime || cached.Text != text) {
+		cached.CreationTime = creationTime;
+		cached.Text = text;
+		cached.Key = MakeCollationKey(text);
+	}
+	return cached.Key;
+}
+
+std::string ProcessSortOrder::MakeCollationKey(const std::wstring& text) {
+	std::string key;
+	if (text.empty()) {
+		return key;
+	}
+
+	const DWORD flags = LCMAP_SORTKEY | LINGUISTIC_IGNORECASE;
+	int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, text.c_str(), static_cast<int>(text.size()),
+		nullptr, 0, nullptr, nullptr, 0);
+	if (size <= 0) {
+		return key;
+	}
+
+	key.resize(static_cast<size_t>(size));
+	size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, text.c_str(), static_cast<int>(text.size()),
+		reinterpret_cast<LPWSTR>(&key[0]), size, nullptr, nullptr, 0);
+	key.resize(size > 0 ? static_cast<size_t>(size - 1) : 0);
+	return key;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct SortKey {
+		ULONGLONG Number = 0;
+		std::string Collation;
+	};
+
+	class ProcessSortOrder {
+	public:
+		ProcessSortOrder() = default;
+		~ProcessSortOrder() = default;
+
+		ProcessSortOrder(const ProcessSortOrder&) = delete;
+		ProcessSortOrder& operator=(const ProcessSortOrder&) = delete;
+		ProcessSortOrder(ProcessSortOrder&&) = default;
+		ProcessSortOrder& operator=(ProcessSortOrder&&) = default;
+
+		void Reset();
+
+		// Returns the positions of ids/keys in sorted order. Rows whose key did
+		// not change since the previous call keep their relative order and only
+		// the changed rows are sorted and merged in. Ties keep the previous order.
+		const std::vector<size_t>& Update(const std::vector<DWORD>& ids, const std::vector<SortKey>& keys,
+			int keyKind, bool ascending);
+
+		// Collation key of text for a process, kept while the process (PID and
+		// creation time) and the text stay the same. Keys of processes missing
+		// from the last Update are dropped by it.
+		const std::string& GetCollationKey(DWORD processId, ULONGLONG creationTime, const std::wstring& text);
+
+		static std::string MakeCollationKey(const std::wstring& text);
+
+	private:
+		struct Entry {
+			size_t Index;
+			size_t Rank;
+		};
+
+		struct CachedCollation {
+			ULONGLONG CreationTime = 0;
+			std::wstring Text;
+			std::string Key;
+		};
+
+		bool Less(const Entry& a, const Entry& b, const std::vector<SortKey>& keys) const;
+
+		std::vector<DWORD> m_PreviousIds;
+		std::vector<SortKey> m_PreviousKeys;
+		std::unordered_map<DWORD, size_t> m_PreviousRank;
+		std::vector<size_t> m_Order;
+		int m_KeyKind = -1;
+		bool m_Ascending = true;
+		std::unordered_map<DWORD, CachedCollation> m_Collations;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
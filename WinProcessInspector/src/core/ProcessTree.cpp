@@ -0,0 +1,277 @@
+#include "ProcessTree.h"
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	ULONGLONG ToTicks(const FILETIME& time) {
+		return (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	}
+
+}
+
+const size_t ProcessTree::NoNode;
+
+void ProcessTree::Clear() {
+	m_ProcessIds.clear();
+	m_ParentIds.clear();
+	m_CreationTimes.clear();
+	m_GroupLeaders.clear();
+	m_NodeById.clear();
+	m_Parent.clear();
+	m_ChildOffsets.clear();
+	m_Children.clear();
+	m_Roots.clear();
+	m_Preorder.clear();
+	m_Enter.clear();
+	m_Exit.clear();
+	m_Depth.clear();
+	m_SelfMetrics.clear();
+	m_SubtreeMetrics.clear();
+}
+
+bool ProcessTree::IsSameStructure(const std::vector<ProcessInfo>& processes, const std::vector<size_t>& groupLeaders) const {
+	if (processes.size() != m_ProcessIds.size() || groupLeaders != m_GroupLeaders) {
+		return false;
+	}
+
+	for (size_t i = 0; i < processes.size(); ++i) {
+		if (processes[i].ProcessId != m_ProcessIds[i] ||
+			processes[i].ParentProcessId != m_ParentIds[i] ||
+			ToTicks(processes[i].CreationTime) != m_CreationTimes[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ProcessTree::Update(const std::vector<ProcessInfo>& processes, const std::vector<size_t>& groupLeaders) {
+	if (!m_ChildOffsets.empty() && IsSameStructure(processes, groupLeaders)) {
+		return false;
+	}
+
+	const size_t count = processes.size();
+	m_ProcessIds.resize(count);
+	m_ParentIds.resize(count);
+	m_CreationTimes.resize(count);
+	m_NodeById.clear();
+	m_NodeById.reserve(count);
+	m_GroupLeaders = groupLeaders;
+	if (!m_GroupLeaders.empty()) {
+		m_GroupLeaders.resize(count, NoNode);
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		m_ProcessIds[i] = processes[i].ProcessId;
+		m_ParentIds[i] = processes[i].ParentProcessId;
+		m_CreationTimes[i] = ToTicks(processes[i].CreationTime);
+		m_NodeById.emplace(processes[i].ProcessId, i);
+	}
+
+	LinkParents(processes);
+	LinkGroups();
+	BreakCycles();
+	BuildChildren();
+	BuildPreorder();
+
+	ProcessTreeMetrics self;
+	self.ProcessCount = 1;
+	m_SelfMetrics.assign(count, self);
+	RecomputeSubtreeMetrics();
+	return true;
+}
+
+size_t ProcessTree::FindNode(DWORD processId) const {
+	auto it = m_NodeById.find(processId);
+	return it != m_NodeById.end() ? it->second : NoNode;
+}
+
+void ProcessTree::LinkParents(const std::vector<ProcessInfo>& processes) {
+	m_Parent.assign(processes.size(), NoNode);
+
+	for (size_t i = 0; i < processes.size(); ++i) {
+		const ProcessInfo& proc = processes[i];
+		if (proc.ParentProcessId == 0 || proc.ParentProcessId == proc.ProcessId) {
+			continue;
+		}
+
+		size_t parent = FindNode(proc.ParentProcessId);
+		if (parent == NoNode) {
+			continue;
+		}
+
+		// A parent that started after its child is a different process that
+		// reused the PID of the real, already exited parent.
+		ULONGLONG parentTime = m_CreationTimes[parent];
+		ULONGLONG childTime = m_CreationTimes[i];
+		if (parentTime != 0 && childTime != 0 && parentTime > childTime) {
+			continue;
+		}
+
+		m_Parent[i] = parent;
+	}
+}
+
+void ProcessTree::LinkGroups() {
+	for (size_t i = 0; i < m_GroupLeaders.size(); ++i) {
+		size_t leader = m_GroupLeaders[i];
+		if (leader == NoNode || leader == i || leader >= m_Parent.size()) {
+			continue;
+		}
+
+		size_t parent = m_Parent[i];
+		if (parent == NoNode || m_GroupLeaders[parent] != leader) {
+			m_Parent[i] = leader;
+		}
+	}
+}
+
+void ProcessTree::BreakCycles() {
+	// 0 = not visited, 1 = on the current parent chain, 2 = known to reach a root.
+	std::vector<unsigned char> state(m_Parent.size(), 0);
+	std::vector<size_t> chain;
+
+	for (size_t start = 0; start < m_Parent.size(); ++start) {
+		chain.clear();
+		size_t node = start;
+		while (node != NoNode && state[node] == 0) {
+			state[node] = 1;
+			chain.push_back(node);
+
+			size_t parent = m_Parent[node];
+			if (parent != NoNode && state[parent] == 1) {
+				m_Parent[node] = NoNode;
+				break;
+			}
+			node = parent;
+		}
+
+		for (size_t visited : chain) {
+			state[visited] = 2;
+		}
+	}
+}
+
+void ProcessTree::BuildChildren() {
+	const size_t count = m_Parent.size();
+	m_ChildOffsets.assign(count + 1, 0);
+	m_Roots.clear();
+
+	for (size_t i = 0; i < count; ++i) {
+		if (m_Parent[i] == NoNode) {
+			m_Roots.push_back(i);
+		} else {
+			++m_ChildOffsets[m_Parent[i] + 1];
+		}
+	}
+	for (size_t i = 0; i < count; ++i) {
+		m_ChildOffsets[i + 1] += m_ChildOffsets[i];
+	}
+
+	// Children keep snapshot order, so siblings follow the current sort.
+	m_Children.resize(m_ChildOffsets[count]);
+	std::vector<size_t> next(m_ChildOffsets.begin(), m_ChildOffsets.end() - 1);
+	for (size_t i = 0; i < count; ++i) {
+		if (m_Parent[i] != NoNode) {
+			m_Children[next[m_Parent[i]]++] = i;
+		}
+	}
+}
+
+void ProcessTree::BuildPreorder() {
+	const size_t count = m_Parent.size();
+	m_Preorder.clear();
+	m_Preorder.reserve(count);
+	m_Enter.assign(count, 0);
+	m_Exit.assign(count, 0);
+	m_Depth.assign(count, 0);
+
+	std::vector<size_t> stack;
+	for (auto root = m_Roots.rbegin(); root != m_Roots.rend(); ++root) {
+		stack.push_back(*root);
+	}
+
+	// Subtree sizes are filled in afterwards from the back of the preorder,
+	// where every child has been seen before its parent.
+	while (!stack.empty()) {
+		size_t node = stack.back();
+		stack.pop_back();
+
+		m_Enter[node] = m_Preorder.size();
+		m_Preorder.push_back(node);
+		if (m_Parent[node] != NoNode) {
+			m_Depth[node] = m_Depth[m_Parent[node]] + 1;
+		}
+
+		for (size_t i = m_ChildOffsets[node + 1]; i > m_ChildOffsets[node]; --i) {
+			stack.push_back(m_Children[i - 1]);
+		}
+	}
+
+	std::vector<size_t> size(count, 1);
+	for (size_t pos = m_Preorder.size(); pos > 0; --pos) {
+		size_t node = m_Preorder[pos - 1];
+		if (m_Parent[node] != NoNode) {
+			size[m_Parent[node]] += size[node];
+		}
+		m_Exit[node] = m_Enter[node] + size[node];
+	}
+}
+
+void ProcessTree::SetMetrics(size_t node, const ProcessTreeMetrics& metrics) {
+	ProcessTreeMetrics& self = m_SelfMetrics[node];
+	bool cpuChanged = metrics.CpuPercent != self.CpuPercent;
+	ULONGLONG memoryDelta = metrics.MemoryBytes - self.MemoryBytes;
+	ULONGLONG handleDelta = metrics.HandleCount - self.HandleCount;
+	if (!cpuChanged && memoryDelta == 0 && handleDelta == 0) {
+		return;
+	}
+
+	self.CpuPercent = metrics.CpuPercent;
+	self.MemoryBytes = metrics.MemoryBytes;
+	self.HandleCount = metrics.HandleCount;
+
+	// Unsigned wrap-around makes the addition below work for decreases too.
+	for (size_t current = node; current != NoNode; current = m_Parent[current]) {
+		ProcessTreeMetrics& total = m_SubtreeMetrics[current];
+		if (cpuChanged) {
+			double cpu = m_SelfMetrics[current].CpuPercent;
+			for (size_t i = m_ChildOffsets[current]; i < m_ChildOffsets[current + 1]; ++i) {
+				cpu += m_SubtreeMetrics[m_Children[i]].CpuPercent;
+			}
+			total.CpuPercent = cpu;
+		}
+		total.MemoryBytes += memoryDelta;
+		total.HandleCount += handleDelta;
+	}
+}
+
+void ProcessTree::InitializeMetrics(size_t node, const ProcessTreeMetrics& metrics) {
+	ProcessTreeMetrics& self = m_SelfMetrics[node];
+	self.CpuPercent = metrics.CpuPercent;
+	self.MemoryBytes = metrics.MemoryBytes;
+	self.HandleCount = metrics.HandleCount;
+}
+
+void ProcessTree::RecomputeSubtreeMetrics() {
+	m_SubtreeMetrics = m_SelfMetrics;
+	for (size_t pos = m_Preorder.size(); pos > 0; --pos) {
+		size_t node = m_Preorder[pos - 1];
+		size_t parent = m_Parent[node];
+		if (parent == NoNode) {
+			continue;
+		}
+
+		ProcessTreeMetrics& total = m_SubtreeMetrics[parent];
+		const ProcessTreeMetrics& child = m_SubtreeMetrics[node];
+		total.CpuPercent += child.CpuPercent;
+		total.MemoryBytes += child.MemoryBytes;
+		total.HandleCount += child.HandleCount;
+		total.ProcessCount += child.ProcessCount;
+	}
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <unordered_map>
+#include "ProcessManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct ProcessTreeMetrics {
+		double CpuPercent = 0.0;
+		ULONGLONG MemoryBytes = 0;
+		ULONGLONG HandleCount = 0;
+		ULONGLONG ProcessCount = 0;
+	};
+
+	// Parent/child index over a process snapshot. Node i is the i-th process of
+	// the snapshot passed to Update. Children are stored in one flat array
+	// (compressed sparse rows) and every node knows its range in the preorder,
+	// so subtree membership is a range check and traversal needs no recursion.
+	class ProcessTree {
+	public:
+		static const size_t NoNode = static_cast<size_t>(-1);
+
+		ProcessTree() = default;
+		~ProcessTree() = default;
+
+		ProcessTree(const ProcessTree&) = delete;
+		ProcessTree& operator=(const ProcessTree&) = delete;
+		ProcessTree(ProcessTree&&) = default;
+		ProcessTree& operator=(ProcessTree&&) = default;
+
+		// Returns true when the structure was rebuilt. Metrics are reset to zero
+		// in that case and have to be set again. groupLeaders optionally holds,
+		// per row, the first row of the row's group (see ProcessGrouping); group
+		// members whose parent is outside the group are attached to the leader.
+		bool Update(const std::vector<ProcessInfo>& processes,
+			const std::vector<size_t>& groupLeaders = std::vector<size_t>());
+		void Clear();
+
+		size_t GetNodeCount() const { return m_ProcessIds.size(); }
+		size_t FindNode(DWORD processId) const;
+		DWORD GetProcessId(size_t node) const { return m_ProcessIds[node]; }
+
+		size_t GetParent(size_t node) const { return m_Parent[node]; }
+		size_t GetDepth(size_t node) const { return m_Depth[node]; }
+		size_t GetChildCount(size_t node) const { return m_ChildOffsets[node + 1] - m_ChildOffsets[node]; }
+		size_t GetChild(size_t node, size_t index) const { return m_Children[m_ChildOffsets[node] + index]; }
+		const std::vector<size_t>& GetRoots() const { return m_Roots; }
+
+		// Nodes in depth-first order; the subtree of a node is the range
+		// [GetPreorderIndex(node), GetPreorderIndex(node) + GetSubtreeSize(node)).
+		const std::vector<size_t>& GetPreorder() const { return m_Preorder; }
+		size_t GetPreorderIndex(size_t node) const { return m_Enter[node]; }
+		size_t GetSubtreeSize(size_t node) const { return m_Exit[node] - m_Enter[node]; }
+
+		// Applies the difference to the node and all of its ancestors. Their CPU
+		// totals are summed again from their children, so rounding does not
+		// build up over refreshes.
+		void SetMetrics(size_t node, const ProcessTreeMetrics& metrics);
+		// Sets only the node's own values; call RecomputeSubtreeMetrics afterwards.
+		void InitializeMetrics(size_t node, const ProcessTreeMetrics& metrics);
+		const ProcessTreeMetrics& GetMetrics(size_t node) const { return m_SelfMetrics[node]; }
+		const ProcessTreeMetrics& GetSubtreeMetrics(size_t node) const { return m_SubtreeMetrics[node]; }
+		void RecomputeSubtreeMetrics();
+
+	private:
+		bool IsSameStructure(const std::vector<ProcessInfo>& processes, const std::vector<size_t>& groupLeaders) const;
+		void LinkParents(const std::vector<ProcessInfo>& processes);
+		void LinkGroups();
+		void BreakCycles();
+		void BuildChildren();
+		void BuildPreorder();
+
+		std::vector<DWORD> m_ProcessIds;
+		std::vector<DWORD> m_ParentIds;
+		std::vector<ULONGLONG> m_CreationTimes;
+		std::vector<size_t> m_GroupLeaders;
+		std::unordered_map<DWORD, size_t> m_NodeById;
+
+		std::vector<size_t> m_Parent;
+		std::vector<size_t> m_ChildOffsets;
+		std::vector<size_t> m_Children;
+		std::vector<size_t> m_Roots;
+		std::vector<size_t> m_Preorder;
+		std::vector<size_t> m_Enter;
+		std::vector<size_t> m_Exit;
+		std::vector<size_t> m_Depth;
+
+		std::vector<ProcessTreeMetrics> m_SelfMetrics;
+		std::vector<ProcessTreeMetrics> m_SubtreeMetrics;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
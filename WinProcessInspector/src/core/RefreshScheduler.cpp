@@ -0,0 +1,76 @@
+#include "RefreshScheduler.h"
+#include <algorithm>
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	// Weight of the newest cycle in the smoothed cost.
+	const double CostSmoothing = 0.3;
+
+}
+
+RefreshScheduler::RefreshScheduler(const RefreshSchedulerSettings& settings)
+	: m_Settings(settings) {
+}
+
+void RefreshScheduler::OnRefreshCompleted(ULONGLONG now, ULONGLONG cpuTimeMs) {
+	if (m_HasRefreshed && cpuTimeMs >= m_LastCpuTimeMs) {
+		double cost = static_cast<double>(cpuTimeMs - m_LastCpuTimeMs);
+		m_AverageCostMs = m_AverageCostMs > 0.0
+			? m_AverageCostMs + CostSmoothing * (cost - m_AverageCostMs)
+			: cost;
+	}
+
+	m_LastRefreshTime = now;
+	m_LastCpuTimeMs = cpuTimeMs;
+	m_HasRefreshed = true;
+}
+
+void RefreshScheduler::Reset() {
+	m_LastRefreshTime = 0;
+	m_LastCpuTimeMs = 0;
+	m_HasRefreshed = false;
+	m_AverageCostMs = 0.0;
+}
+
+ULONGLONG RefreshScheduler::GetStateInterval(ULONGLONG now) const {
+	if (!m_Visible) {
+		return m_Settings.HiddenIntervalMs;
+	}
+	if (now >= m_LastInputTime && now - m_LastInputTime >= m_Settings.IdleAfterMs) {
+		return m_Settings.IdleIntervalMs;
+	}
+	return m_Watching ? m_Settings.WatchingIntervalMs : m_Settings.NormalIntervalMs;
+}
+
+ULONGLONG RefreshScheduler::GetBudgetInterval() const {
+	if (m_Settings.CpuBudget <= 0.0 || m_AverageCostMs <= 0.0) {
+		return 0;
+	}
+	// A cycle costing c ms stays within budget b if it repeats no more often
+	// than every c / b ms.
+	return static_cast<ULONGLONG>(m_AverageCostMs / m_Settings.CpuBudget);
+}
+
+ULONGLONG RefreshScheduler::GetInterval(ULONGLONG now) const {
+	ULONGLONG interval = std::max(GetStateInterval(now), GetBudgetInterval());
+	return std::min(std::max(interval, m_Settings.MinIntervalMs), std::max(m_Settings.MaxIntervalMs, m_Settings.MinIntervalMs));
+}
+
+ULONGLONG RefreshScheduler::GetDelay(ULONGLONG now) const {
+	if (!m_HasRefreshed) {
+		return 0;
+	}
+
+	ULONGLONG due = m_LastRefreshTime + GetInterval(now);
+	return due > now ? due - now : 0;
+}
+
+bool RefreshScheduler::IsBudgetLimited(ULONGLONG now) const {
+	return GetBudgetInterval() > GetStateInterval(now);
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
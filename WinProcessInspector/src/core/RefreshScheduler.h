@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Windows.h>
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct RefreshSchedulerSettings {
+		ULONGLONG NormalIntervalMs = 2000;
+		// The window is in the foreground with a process selected.
+		ULONGLONG WatchingIntervalMs = 1000;
+		// No keyboard or mouse input for IdleAfterMs.
+		ULONGLONG IdleIntervalMs = 5000;
+		ULONGLONG IdleAfterMs = 60000;
+		// The window is minimized or hidden.
+		ULONGLONG HiddenIntervalMs = 15000;
+		ULONGLONG MinIntervalMs = 500;
+		ULONGLONG MaxIntervalMs = 60000;
+		// Share of one core the tool may spend, averaged over a refresh cycle.
+		double CpuBudget = 0.01;
+	};
+
+	// Decides when the next automatic refresh is due. It holds no clock of its
+	// own: every call takes the current time in milliseconds, so the policy
+	// can be driven by a simulated clock.
+	class RefreshScheduler {
+	public:
+		RefreshScheduler() = default;
+		explicit RefreshScheduler(const RefreshSchedulerSettings& settings);
+		~RefreshScheduler() = default;
+
+		RefreshScheduler(const RefreshScheduler&) = default;
+		RefreshScheduler& operator=(const RefreshScheduler&) = default;
+
+		void SetSettings(const RefreshSchedulerSettings& settings) { m_Settings = settings; }
+		const RefreshSchedulerSettings& GetSettings() const { return m_Settings; }
+
+		void SetVisible(bool visible) { m_Visible = visible; }
+		void SetWatching(bool watching) { m_Watching = watching; }
+		void SetLastInputTime(ULONGLONG now) { m_LastInputTime = now; }
+
+		// cpuTimeMs is the tool's total CPU time (all threads) when the
+		// refresh finished; the difference to the previous refresh is the
+		// cost of one cycle.
+		void OnRefreshCompleted(ULONGLONG now, ULONGLONG cpuTimeMs);
+		void Reset();
+
+		ULONGLONG GetInterval(ULONGLONG now) const;
+		// Milliseconds from now until the next refresh, 0 if it is overdue.
+		ULONGLONG GetDelay(ULONGLONG now) const;
+
+		// Smoothed CPU time spent per refresh cycle.
+		double GetAverageCostMs() const { return m_AverageCostMs; }
+		bool IsBudgetLimited(ULONGLONG now) const;
+
+	private:
+		ULONGLONG GetStateInterval(ULONGLONG now) const;
+		ULONGLONG GetBudgetInterval() const;
+
+		RefreshSchedulerSettings m_Settings;
+		bool m_Visible = true;
+		bool m_Watching = false;
+		ULONGLONG m_LastInputTime = 0;
+		ULONGLONG m_LastRefreshTime = 0;
+		ULONGLONG m_LastCpuTimeMs = 0;
+		bool m_HasRefreshed = false;
+		double m_AverageCostMs = 0.0;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
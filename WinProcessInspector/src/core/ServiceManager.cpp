@@ -3,6 +3,7 @@
 #undef WIN32_NO_STATUS
 
 #include "ServiceManager.h"
+#include "ServiceSnapshot.h"
 #include <winsvc.h>
 #include <sstream>
 
@@ -45,12 +46,7 @@ std::vector<ServiceInfo> ServiceManager::EnumerateServices() const {
 			info.Type = static_cast<ServiceType>(pServices[i].ServiceStatusProcess.dwServiceType);
 			info.ProcessId = pServices[i].ServiceStatusProcess.dwProcessId;
 
-			SC_HANDLE hService = OpenServiceW(hSCManager, pServices[i].lpServiceName, SERVICE_QUERY_CONFIG | SERVICE_QUERY_STATUS);
-			if (hService) {
-				PopulateServiceInfo(hService, info);
-				CloseServiceHandle(hService);
-			}
-
+			QueryServiceDetails(hSCManager, info);
 			services.push_back(info);
 		}
 	}
@@ -59,19 +55,40 @@ std::vector<ServiceInfo> ServiceManager::EnumerateServices() const {
 	return services;
 }
 
-std::vector<ServiceInfo> ServiceManager::GetServicesForProcess(DWORD processId) const {
-	std::vector<ServiceInfo> allServices = EnumerateServices();
+std::vector<ServiceInfo> ServiceManager::GetServicesForProcess(const ServiceSnapshot& snapshot, DWORD processId) const {
 	std::vector<ServiceInfo> result;
+	std::vector<const ServiceInfo*> hosted = snapshot.GetServicesForProcess(processId);
+	if (hosted.empty()) {
+		return result;
+	}
 
-	for (const auto& service : allServices) {
-		if (service.ProcessId == processId) {
-			result.push_back(service);
+	// Only the services of this process are opened for their configuration.
+	SC_HANDLE hSCManager = OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
+	for (const ServiceInfo* service : hosted) {
+		ServiceInfo info = *service;
+		if (hSCManager) {
+			QueryServiceDetails(hSCManager, info);
 		}
+		result.push_back(std::move(info));
 	}
 
+	if (hSCManager) {
+		CloseServiceHandle(hSCManager);
+	}
 	return result;
 }
 
+bool ServiceManager::QueryServiceDetails(SC_HANDLE hSCManager, ServiceInfo& info) const {
+	SC_HANDLE hService = OpenServiceW(hSCManager, info.Name.c_str(), SERVICE_QUERY_CONFIG | SERVICE_QUERY_STATUS);
+	if (!hService) {
+		return false;
+	}
+
+	PopulateServiceInfo(hService, info);
+	CloseServiceHandle(hService);
+	return true;
+}
+
 bool ServiceManager::StartService(const std::wstring& serviceName) const {
 	SC_HANDLE hSCManager = OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
 	if (!hSCManager) {
@@ -43,6 +43,8 @@ namespace Core {
 		std::vector<std::wstring> Dependencies;
 	};
 
+	class ServiceSnapshot;
+
 	class ServiceManager {
 	public:
 		ServiceManager() = default;
@@ -54,7 +56,9 @@ namespace Core {
 		ServiceManager& operator=(ServiceManager&&) = default;
 
 		std::vector<ServiceInfo> EnumerateServices() const;
-		std::vector<ServiceInfo> GetServicesForProcess(DWORD processId) const;
+		// The services that snapshot lists for the process, with their
+		// configuration filled in.
+		std::vector<ServiceInfo> GetServicesForProcess(const ServiceSnapshot& snapshot, DWORD processId) const;
 		bool StartService(const std::wstring& serviceName) const;
 		bool StopService(const std::wstring& serviceName) const;
 		bool PauseService(const std::wstring& serviceName) const;
@@ -64,6 +68,7 @@ namespace Core {
 		static std::wstring GetTypeString(ServiceType type);
 
 	private:
+		bool QueryServiceDetails(SC_HANDLE hSCManager, ServiceInfo& info) const;
 		void PopulateServiceInfo(SC_HANDLE hService, ServiceInfo& info) const;
 		std::vector<std::wstring> GetServiceDependencies(SC_HANDLE hService) const;
 	};
@@ -0,0 +1,168 @@
+#include "ServiceSnapshot.h"
+#include <winsvc.h>
+#include <algorithm>
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace WinProcessInspector {
+namespace Core {
+
+void ServiceSnapshot::Clear() {
+	m_Services.clear();
+	m_IndexByName.clear();
+	m_ServicesByProcess.clear();
+}
+
+bool ServiceSnapshot::Refresh() {
+	SC_HANDLE hSCManager = OpenSCManagerW(nullptr, nullptr, SC_MANAGER_ENUMERATE_SERVICE | SC_MANAGER_CONNECT);
+	if (!hSCManager) {
+		return false;
+	}
+
+	DWORD bytesNeeded = 0;
+	DWORD servicesReturned = 0;
+	DWORD resumeHandle = 0;
+	bool enumerated = false;
+
+	// The buffer is kept between refreshes, so the size probe only runs when
+	// the service list has grown.
+	for (int attempt = 0; attempt < 3 && !enumerated; ++attempt) {
+		if (m_Buffer.empty()) {
+			m_Buffer.resize(64 * 1024);
+		}
+
+		resumeHandle = 0;
+		if (EnumServicesStatusExW(hSCManager, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_STATE_ALL,
+			m_Buffer.data(), static_cast<DWORD>(m_Buffer.size()), &bytesNeeded, &servicesReturned, &resumeHandle, nullptr)) {
+			enumerated = true;
+		} else if (GetLastError() == ERROR_MORE_DATA && bytesNeeded > 0) {
+			m_Buffer.resize(m_Buffer.size() + bytesNeeded + 4096);
+		} else {
+			break;
+		}
+	}
+
+	CloseServiceHandle(hSCManager);
+	if (!enumerated) {
+		return false;
+	}
+
+	const ENUM_SERVICE_STATUS_PROCESSW* entries = reinterpret_cast<const ENUM_SERVICE_STATUS_PROCESSW*>(m_Buffer.data());
+	std::vector<bool> seen(m_Services.size(), false);
+	bool processesChanged = false;
+	bool servicesRemoved = false;
+
+	for (DWORD i = 0; i < servicesReturned; ++i) {
+		const ENUM_SERVICE_STATUS_PROCESSW& entry = entries[i];
+		const SERVICE_STATUS_PROCESS& status = entry.ServiceStatusProcess;
+		ServiceState state = static_cast<ServiceState>(status.dwCurrentState);
+		ServiceType type = static_cast<ServiceType>(status.dwServiceType);
+
+		auto it = m_IndexByName.find(entry.lpServiceName);
+		if (it == m_IndexByName.end()) {
+			ServiceInfo info;
+			info.Name = entry.lpServiceName;
+			info.DisplayName = entry.lpDisplayName ? entry.lpDisplayName : L"";
+			info.State = state;
+			info.Type = type;
+			info.ProcessId = status.dwProcessId;
+			m_IndexByName.emplace(info.Name, m_Services.size());
+			m_Services.push_back(std::move(info));
+			seen.push_back(true);
+			processesChanged = processesChanged || status.dwProcessId != 0;
+			continue;
+		}
+
+		ServiceInfo& info = m_Services[it->second];
+		seen[it->second] = true;
+		processesChanged = processesChanged || info.ProcessId != status.dwProcessId;
+		info.State = state;
+		info.Type = type;
+		info.ProcessId = status.dwProcessId;
+	}
+
+	for (size_t i = 0; i < seen.size(); ++i) {
+		if (!seen[i]) {
+			servicesRemoved = true;
+			break;
+		}
+	}
+
+	if (servicesRemoved) {
+		std::vector<ServiceInfo> kept;
+		kept.reserve(m_Services.size());
+		for (size_t i = 0; i < m_Services.size(); ++i) {
+			if (seen[i]) {
+				kept.push_back(std::move(m_Services[i]));
+			}
+		}
+		m_Services = std::move(kept);
+
+		m_IndexByName.clear();
+		for (size_t i = 0; i < m_Services.size(); ++i) {
+			m_IndexByName.emplace(m_Services[i].Name, i);
+		}
+	}
+
+	if (processesChanged || servicesRemoved) {
+		RebuildProcessIndex();
+	}
+
+	return true;
+}
+
+void ServiceSnapshot::RebuildProcessIndex() {
+	m_ServicesByProcess.clear();
+	for (size_t i = 0; i < m_Services.size(); ++i) {
+		if (m_Services[i].ProcessId != 0) {
+			m_ServicesByProcess.emplace_back(m_Services[i].ProcessId, i);
+		}
+	}
+	std::sort(m_ServicesByProcess.begin(), m_ServicesByProcess.end());
+}
+
+std::pair<ServiceSnapshot::ProcessIterator, ServiceSnapshot::ProcessIterator> ServiceSnapshot::FindProcess(DWORD processId) const {
+	return std::equal_range(m_ServicesByProcess.begin(), m_ServicesByProcess.end(), std::make_pair(processId, size_t(0)),
+		[](const std::pair<DWORD, size_t>& a, const std::pair<DWORD, size_t>& b) { return a.first < b.first; });
+}
+
+std::vector<const ServiceInfo*> ServiceSnapshot::GetServicesForProcess(DWORD processId) const {
+	std::vector<const ServiceInfo*> result;
+	if (processId == 0) {
+		return result;
+	}
+
+	auto range = FindProcess(processId);
+	for (auto it = range.first; it != range.second; ++it) {
+		result.push_back(&m_Services[it->second]);
+	}
+	return result;
+}
+
+std::wstring ServiceSnapshot::GetServiceNames(DWORD processId) const {
+	std::wstring names;
+	if (processId == 0) {
+		return names;
+	}
+
+	auto range = FindProcess(processId);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (!names.empty()) {
+			names += L", ";
+		}
+		names += m_Services[it->second].Name;
+	}
+	return names;
+}
+
+bool ServiceSnapshot::HostsServices(DWORD processId) const {
+	if (processId == 0) {
+		return false;
+	}
+
+	auto range = FindProcess(processId);
+	return range.first != range.second;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "ServiceManager.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	// Name, state and hosting process of every Win32 service, read with a
+	// single EnumServicesStatusExW call. Configuration fields of ServiceInfo
+	// are left empty; see ServiceManager::GetServicesForProcess.
+	class ServiceSnapshot {
+	public:
+		ServiceSnapshot() = default;
+		~ServiceSnapshot() = default;
+
+		ServiceSnapshot(const ServiceSnapshot&) = delete;
+		ServiceSnapshot& operator=(const ServiceSnapshot&) = delete;
+		ServiceSnapshot(ServiceSnapshot&&) = default;
+		ServiceSnapshot& operator=(ServiceSnapshot&&) = default;
+
+		// Re-reads the service status list and applies only the differences.
+		// Returns false if the service control manager could not be queried.
+		bool Refresh();
+		void Clear();
+
+		const std::vector<ServiceInfo>& GetServices() const { return m_Services; }
+
+		std::vector<const ServiceInfo*> GetServicesForProcess(DWORD processId) const;
+		std::wstring GetServiceNames(DWORD processId) const;
+		bool HostsServices(DWORD processId) const;
+
+	private:
+		typedef std::vector<std::pair<DWORD, size_t>>::const_iterator ProcessIterator;
+
+		std::pair<ProcessIterator, ProcessIterator> FindProcess(DWORD processId) const;
+		void RebuildProcessIndex();
+
+		std::vector<ServiceInfo> m_Services;
+		std::unordered_map<std::wstring, size_t> m_IndexByName;
+		// (process id, service index) sorted by process id: a flat multimap.
+		std::vector<std::pair<DWORD, size_t>> m_ServicesByProcess;
+		std::vector<BYTE> m_Buffer;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
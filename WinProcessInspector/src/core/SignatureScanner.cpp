@@ -0,0 +1,570 @@
+#include "SignatureScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t MaxWorkers = 8;
+	const size_t BatchSize = 256;
+	const size_t MinChunkSize = 64 * 1024;
+	// Longer literal runs add states without making hits rarer; the rest
+	// of the pattern is checked on verification.
+	const size_t MaxAnchorLength = 16;
+	const size_t MaxAnchorStartBytes = 4;
+
+	struct Chunk {
+		ULONG_PTR Start;
+		size_t Length;
+		ULONG_PTR RegionEnd;
+	};
+
+	// Zero fill, 0xFF fill and the most common code and text bytes make
+	// poor anchor starts.
+	int ByteRarity(BYTE value) {
+		switch (value) {
+			case 0x00:
+			case 0xFF:
+				return 0;
+			case 0x01:
+			case 0x20:
+			case 0x48:
+			case 0x8B:
+			case 0x90:
+			case 0xCC:
+				return 1;
+			default:
+				return 2;
+		}
+	}
+
+	// Ranks every literal window by length up to four bytes, then by how
+	// rare its first byte is, then by length.
+	bool ChooseAnchor(const SignaturePattern& pattern, size_t& offset, size_t& length) {
+		std::tuple<size_t, int, size_t> best(0, 0, 0);
+		length = 0;
+		size_t size = pattern.Bytes.size();
+		size_t i = 0;
+		while (i < size) {
+			if (pattern.Mask[i] != 0xFF) {
+				++i;
+				continue;
+			}
+			size_t runEnd = i;
+			while (runEnd < size && pattern.Mask[runEnd] == 0xFF) {
+				++runEnd;
+			}
+			for (size_t start = i; start < runEnd; ++start) {
+				size_t windowLength = std::min(runEnd - start, MaxAnchorLength);
+				std::tuple<size_t, int, size_t> key(std::min<size_t>(windowLength, 4), ByteRarity(pattern.Bytes[start]), windowLength);
+				if (length == 0 || key > best) {
+					best = key;
+					offset = start;
+					length = windowLength;
+				}
+			}
+			i = runEnd;
+		}
+		return length != 0;
+	}
+
+	bool MatchesAt(const SignaturePattern& pattern, const BYTE* data) {
+		size_t size = pattern.Bytes.size();
+		for (size_t i = 0; i < size; ++i) {
+			if ((data[i] & pattern.Mask[i]) != pattern.Bytes[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int HexValue(wchar_t ch) {
+		if (ch >= L'0' && ch <= L'9') return ch - L'0';
+		if (ch >= L'a' && ch <= L'f') return ch - L'a' + 10;
+		if (ch >= L'A' && ch <= L'F') return ch - L'A' + 10;
+		return -1;
+	}
+
+	std::wstring Trim(const std::wstring& text) {
+		size_t first = text.find_first_not_of(L" \t\r\n");
+		if (first == std::wstring::npos) {
+			return std::wstring();
+		}
+		size_t last = text.find_last_not_of(L" \t\r\n");
+		return text.substr(first, last - first + 1);
+	}
+
+	bool ParseString(const std::wstring& body, bool wide, SignaturePattern& pattern) {
+		size_t i = wide ? 2 : 1;
+		while (i < body.size()) {
+			wchar_t ch = body[i++];
+			unsigned int value = ch;
+			if (ch == L'"') {
+				return i == body.size();
+			}
+			if (ch == L'\\') {
+				if (i >= body.size()) {
+					return false;
+				}
+				wchar_t escape = body[i++];
+				if (escape == L'x') {
+					if (i + 2 > body.size() || HexValue(body[i]) < 0 || HexValue(body[i + 1]) < 0) {
+						return false;
+					}
+					value = static_cast<unsigned int>(HexValue(body[i]) * 16 + HexValue(body[i + 1]));
+					i += 2;
+				} else if (escape == L'\\' || escape == L'"') {
+					value = escape;
+				} else {
+					return false;
+				}
+			}
+
+			if (wide) {
+				if (value > 0xFFFF) {
+					return false;
+				}
+				pattern.Bytes.push_back(static_cast<BYTE>(value));
+				pattern.Bytes.push_back(static_cast<BYTE>(value >> 8));
+				pattern.Mask.push_back(0xFF);
+				pattern.Mask.push_back(0xFF);
+			} else {
+				if (value > 0xFF) {
+					return false;
+				}
+				pattern.Bytes.push_back(static_cast<BYTE>(value));
+				pattern.Mask.push_back(0xFF);
+			}
+		}
+		return false;
+	}
+
+	bool ParseHex(const std::wstring& body, SignaturePattern& pattern) {
+		size_t i = 0;
+		while (i < body.size()) {
+			if (body[i] == L' ' || body[i] == L'\t') {
+				++i;
+				continue;
+			}
+			if (i + 2 > body.size()) {
+				return false;
+			}
+			if (body[i] == L'?' && body[i + 1] == L'?') {
+				pattern.Bytes.push_back(0);
+				pattern.Mask.push_back(0);
+			} else {
+				int high = HexValue(body[i]);
+				int low = HexValue(body[i + 1]);
+				if (high < 0 || low < 0) {
+					return false;
+				}
+				pattern.Bytes.push_back(static_cast<BYTE>(high * 16 + low));
+				pattern.Mask.push_back(0xFF);
+			}
+			i += 2;
+		}
+		return true;
+	}
+
+}
+
+bool SignatureScanner::Compile(const std::vector<SignaturePattern>& patterns) {
+	m_Patterns.clear();
+	m_AnchorOffsets.clear();
+	m_AnchorLengths.clear();
+	m_MaxPatternLength = 0;
+	m_Transitions.clear();
+	m_OutputStart.clear();
+	m_Outputs.clear();
+	m_AnchorStartBytes.clear();
+	m_AnchorStartPairs.clear();
+	std::fill(std::begin(m_IsAnchorStart), std::end(m_IsAnchorStart), false);
+
+	if (patterns.empty()) {
+		return false;
+	}
+
+	std::vector<SignaturePattern> compiled = patterns;
+	std::vector<size_t> anchorOffsets(compiled.size());
+	std::vector<size_t> anchorLengths(compiled.size());
+	size_t maxPatternLength = 0;
+	for (size_t i = 0; i < compiled.size(); ++i) {
+		SignaturePattern& pattern = compiled[i];
+		if (pattern.Bytes.empty() || pattern.Bytes.size() != pattern.Mask.size()) {
+			return false;
+		}
+		for (size_t k = 0; k < pattern.Bytes.size(); ++k) {
+			pattern.Mask[k] = pattern.Mask[k] ? 0xFF : 0;
+			pattern.Bytes[k] &= pattern.Mask[k];
+		}
+		if (!ChooseAnchor(pattern, anchorOffsets[i], anchorLengths[i])) {
+			return false;
+		}
+		maxPatternLength = std::max(maxPatternLength, pattern.Bytes.size());
+	}
+
+	// Trie of anchors; a zero transition means none yet, since no edge
+	// leads back to the root.
+	std::vector<DWORD> transitions(256, 0);
+	std::vector<std::vector<DWORD>> outputs(1);
+	for (size_t i = 0; i < compiled.size(); ++i) {
+		DWORD state = 0;
+		for (size_t k = 0; k < anchorLengths[i]; ++k) {
+			BYTE value = compiled[i].Bytes[anchorOffsets[i] + k];
+			DWORD next = transitions[state * 256 + value];
+			if (next == 0) {
+				next = static_cast<DWORD>(transitions.size() / 256);
+				transitions[state * 256 + value] = next;
+				transitions.resize(transitions.size() + 256, 0);
+				outputs.emplace_back();
+			}
+			state = next;
+		}
+		outputs[state].push_back(static_cast<DWORD>(i));
+	}
+
+	// Breadth first, so a state's failure link is complete before the
+	// state itself. Missing edges are filled from the failure state, which
+	// turns the trie into a table with one lookup per byte.
+	size_t stateCount = transitions.size() / 256;
+	std::vector<DWORD> failure(stateCount, 0);
+	std::vector<DWORD> queue;
+	queue.reserve(stateCount);
+	for (size_t value = 0; value < 256; ++value) {
+		if (transitions[value] != 0) {
+			queue.push_back(transitions[value]);
+		}
+	}
+	for (size_t head = 0; head < queue.size(); ++head) {
+		DWORD state = queue[head];
+		DWORD fallback = failure[state];
+		outputs[state].insert(outputs[state].end(), outputs[fallback].begin(), outputs[fallback].end());
+		for (size_t value = 0; value < 256; ++value) {
+			DWORD& next = transitions[state * 256 + value];
+			if (next != 0) {
+				failure[next] = transitions[fallback * 256 + value];
+				queue.push_back(next);
+			} else {
+				next = transitions[fallback * 256 + value];
+			}
+		}
+	}
+
+	m_OutputStart.reserve(stateCount + 1);
+	for (const auto& list : outputs) {
+		m_OutputStart.push_back(static_cast<DWORD>(m_Outputs.size()));
+		m_Outputs.insert(m_Outputs.end(), list.begin(), list.end());
+	}
+	m_OutputStart.push_back(static_cast<DWORD>(m_Outputs.size()));
+
+	for (size_t value = 0; value < 256; ++value) {
+		if (transitions[value] != 0) {
+			m_IsAnchorStart[value] = true;
+			m_AnchorStartBytes.push_back(static_cast<BYTE>(value));
+		}
+	}
+	if (m_AnchorStartBytes.size() > MaxAnchorStartBytes) {
+		m_AnchorStartBytes.clear();
+	}
+
+	// Walking the table from the root costs a dependent load per byte; the
+	// pair bitmap fits in L1 and each position is tested on its own.
+	if (*std::min_element(anchorLengths.begin(), anchorLengths.end()) >= 2) {
+		m_AnchorStartPairs.assign(65536 / 64, 0);
+		for (size_t i = 0; i < compiled.size(); ++i) {
+			const BYTE* anchor = compiled[i].Bytes.data() + anchorOffsets[i];
+			size_t pair = anchor[0] | (anchor[1] << 8);
+			m_AnchorStartPairs[pair / 64] |= 1ULL << (pair % 64);
+		}
+	}
+
+	// Store each next state as its row offset, with bit 0 marking states
+	// where an anchor ends, so the scan loop needs no multiply and no
+	// separate lookup to see whether there is output.
+	for (auto& next : transitions) {
+		next = (next * 256) | (outputs[next].empty() ? 0 : 1);
+	}
+
+	m_Patterns = std::move(compiled);
+	m_AnchorOffsets = std::move(anchorOffsets);
+	m_AnchorLengths = std::move(anchorLengths);
+	m_MaxPatternLength = maxPatternLength;
+	m_Transitions = std::move(transitions);
+	return true;
+}
+
+size_t SignatureScanner::SkipToAnchorStart(const BYTE* data, size_t position, size_t size) const {
+#if defined(_M_X64) || defined(_M_IX86)
+	if (!m_AnchorStartBytes.empty()) {
+		__m128i needles[MaxAnchorStartBytes];
+		size_t needleCount = m_AnchorStartBytes.size();
+		for (size_t i = 0; i < needleCount; ++i) {
+			needles[i] = _mm_set1_epi8(static_cast<char>(m_AnchorStartBytes[i]));
+		}
+		for (; position + 16 <= size; position += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+			__m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+			for (size_t i = 1; i < needleCount; ++i) {
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+			}
+			unsigned long bits = static_cast<unsigned long>(_mm_movemask_epi8(hits));
+			if (bits != 0) {
+				unsigned long index = 0;
+				_BitScanForward(&index, bits);
+				return position + index;
+			}
+		}
+	}
+#endif
+
+	if (!m_AnchorStartPairs.empty()) {
+		const ULONGLONG* pairs = m_AnchorStartPairs.data();
+		for (; position + 1 < size; ++position) {
+			size_t pair = data[position] | (data[position + 1] << 8);
+			if (pairs[pair / 64] & (1ULL << (pair % 64))) {
+				return position;
+			}
+		}
+		return size;
+	}
+
+	while (position < size && !m_IsAnchorStart[data[position]]) {
+		++position;
+	}
+	return position;
+}
+
+void SignatureScanner::ScanBuffer(const BYTE* data, size_t size, size_t reportLimit, ULONG_PTR baseAddress,
+	std::vector<SignatureMatch>& matches) const {
+	if (!IsCompiled()) {
+		return;
+	}
+
+	const DWORD* transitions = m_Transitions.data();
+	const DWORD* outputStart = m_OutputStart.data();
+	DWORD state = 0;
+	size_t position = 0;
+	while (position < size) {
+		if (state == 0) {
+			position = SkipToAnchorStart(data, position, size);
+			if (position >= size) {
+				break;
+			}
+		}
+
+		state = transitions[(state & ~0xFFu) + data[position]];
+		++position;
+		if ((state & 1) == 0) {
+			continue;
+		}
+
+		DWORD stateIndex = state >> 8;
+		for (DWORD output = outputStart[stateIndex]; output < outputStart[stateIndex + 1]; ++output) {
+			size_t index = m_Outputs[output];
+			size_t back = m_AnchorOffsets[index] + m_AnchorLengths[index];
+			if (position < back) {
+				continue;
+			}
+			size_t start = position - back;
+			const SignaturePattern& pattern = m_Patterns[index];
+			if (start < reportLimit && start + pattern.Bytes.size() <= size && MatchesAt(pattern, data + start)) {
+				SignatureMatch match;
+				match.Address = baseAddress + start;
+				match.PatternIndex = index;
+				matches.push_back(match);
+			}
+		}
+	}
+}
+
+SignatureScanStatistics SignatureScanner::Scan(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+	const SignatureScanOptions& options, const MatchSink& sink, const std::atomic<bool>* cancelled) const {
+	SignatureScanStatistics statistics;
+	if (!read || !sink || !IsCompiled()) {
+		return statistics;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	size_t chunkSize = std::max(options.ChunkSize, MinChunkSize);
+
+	std::vector<Chunk> chunks;
+	for (const auto& region : regions) {
+		if (!MemoryManager::IsReadable(region, options.IncludeImages)) {
+			continue;
+		}
+		++statistics.Regions;
+		ULONG_PTR regionEnd = region.BaseAddress + region.RegionSize;
+		for (SIZE_T offset = 0; offset < region.RegionSize; offset += chunkSize) {
+			chunks.push_back({ region.BaseAddress + offset, std::min<size_t>(chunkSize, region.RegionSize - offset), regionEnd });
+		}
+	}
+
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<size_t> found(0);
+	std::atomic<ULONGLONG> scanned(0);
+	std::atomic<bool> stop(false);
+	std::mutex sinkMutex;
+
+	auto worker = [&]() {
+		std::vector<BYTE> buffer;
+		std::vector<SignatureMatch> matches;
+
+		for (;;) {
+			if (stop || (cancelled && *cancelled)) {
+				break;
+			}
+			size_t index = nextChunk++;
+			if (index >= chunks.size()) {
+				break;
+			}
+
+			const Chunk& chunk = chunks[index];
+			size_t overlap = std::min<size_t>(m_MaxPatternLength - 1, chunk.RegionEnd - (chunk.Start + chunk.Length));
+			size_t readSize = chunk.Length + overlap;
+			buffer.resize(readSize);
+			if (!read(chunk.Start, buffer.data(), readSize, nullptr)) {
+				continue;
+			}
+			scanned += chunk.Length;
+
+			size_t before = matches.size();
+			ScanBuffer(buffer.data(), readSize, chunk.Length, chunk.Start, matches);
+			size_t added = matches.size() - before;
+			size_t previous = found.fetch_add(added);
+			if (options.MaxResults != 0 && previous + added >= options.MaxResults) {
+				matches.resize(before + (previous < options.MaxResults ? options.MaxResults - previous : 0));
+				stop = true;
+			}
+
+			if (matches.size() >= BatchSize) {
+				std::lock_guard<std::mutex> lock(sinkMutex);
+				sink(matches);
+				matches.clear();
+			}
+		}
+
+		if (!matches.empty()) {
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			sink(matches);
+		}
+	};
+
+	size_t workerCount = options.WorkerCount;
+	if (workerCount == 0) {
+		workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+	}
+	workerCount = std::min(workerCount, std::max<size_t>(chunks.size(), 1));
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workerCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	statistics.BytesScanned = scanned;
+	statistics.Matches = options.MaxResults != 0 ? std::min(found.load(), options.MaxResults) : found.load();
+	statistics.Truncated = stop;
+	statistics.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return statistics;
+}
+
+bool SignatureScanner::ParsePattern(const std::wstring& definition, SignaturePattern& pattern) {
+	size_t colon = definition.find(L':');
+	if (colon == std::wstring::npos) {
+		return false;
+	}
+
+	pattern.Name = Trim(definition.substr(0, colon));
+	pattern.Bytes.clear();
+	pattern.Mask.clear();
+	if (pattern.Name.empty()) {
+		return false;
+	}
+
+	std::wstring body = Trim(definition.substr(colon + 1));
+	bool parsed = false;
+	if (body.compare(0, 2, L"u\"") == 0) {
+		parsed = ParseString(body, true, pattern);
+	} else if (body.compare(0, 1, L"\"") == 0) {
+		parsed = ParseString(body, false, pattern);
+	} else {
+		parsed = ParseHex(body, pattern);
+	}
+	return parsed && !pattern.Bytes.empty();
+}
+
+bool SignatureScanner::LoadPatterns(const std::wstring& filePath, std::vector<SignaturePattern>& patterns, size_t* errorLine) {
+	patterns.clear();
+	if (errorLine) {
+		*errorLine = 0;
+	}
+
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, filePath.c_str(), L"rb") != 0 || !file) {
+		return false;
+	}
+	std::string content;
+	char block[4096];
+	size_t bytesRead = 0;
+	while ((bytesRead = fread(block, 1, sizeof(block), file)) > 0) {
+		content.append(block, bytesRead);
+	}
+	fclose(file);
+
+	if (content.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+		content.erase(0, 3);
+	}
+
+	size_t lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < content.size()) {
+		size_t lineEnd = content.find('\n', lineStart);
+		if (lineEnd == std::string::npos) {
+			lineEnd = content.size();
+		}
+		std::string line = content.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		++lineNumber;
+
+		std::wstring text;
+		if (!line.empty()) {
+			int length = MultiByteToWideChar(CP_UTF8, 0, line.data(), static_cast<int>(line.size()), nullptr, 0);
+			text.resize(length > 0 ? length : 0);
+			if (length > 0) {
+				MultiByteToWideChar(CP_UTF8, 0, line.data(), static_cast<int>(line.size()), &text[0], length);
+			}
+		}
+		text = Trim(text);
+		if (text.empty() || text[0] == L'#') {
+			continue;
+		}
+
+		SignaturePattern pattern;
+		if (!ParsePattern(text, pattern)) {
+			if (errorLine) {
+				*errorLine = lineNumber;
+			}
+			patterns.clear();
+			return false;
+		}
+		patterns.push_back(std::move(pattern));
+	}
+	return true;
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <functional>
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	struct SignaturePattern {
+		std::wstring Name;
+		// Wildcard positions hold zero.
+		std::vector<BYTE> Bytes;
+		// 0xFF where the byte must match, 0 for a wildcard.
+		std::vector<BYTE> Mask;
+	};
+
+	struct SignatureMatch {
+		ULONG_PTR Address = 0;
+		size_t PatternIndex = 0;
+	};
+
+	struct SignatureScanOptions {
+		bool IncludeImages = true;
+		size_t ChunkSize = 1024 * 1024;
+		// 0 picks one worker per core, up to 8.
+		size_t WorkerCount = 0;
+		// Stops after this many matches; 0 for no limit.
+		size_t MaxResults = 0;
+	};
+
+	struct SignatureScanStatistics {
+		size_t Regions = 0;
+		ULONGLONG BytesScanned = 0;
+		size_t Matches = 0;
+		bool Truncated = false;
+		double Seconds = 0.0;
+
+		double GetGigabytesPerSecond() const {
+			return Seconds > 0.0 ? static_cast<double>(BytesScanned) / Seconds / 1e9 : 0.0;
+		}
+	};
+
+	// Finds many byte patterns, with wildcards, in one pass. Each pattern
+	// contributes its most selective literal run (its anchor) to an
+	// Aho-Corasick automaton stored as a full transition table; anchor hits
+	// are then checked against the whole pattern. Anchors are chosen to
+	// start on bytes that are rare in memory, and while the automaton is at
+	// its root the scan skips ahead to the next place one can start: with
+	// SSE2 when only a few bytes can, otherwise by the first two bytes.
+	class SignatureScanner {
+	public:
+		// Receives matches in batches, from worker threads but never from two
+		// at once. Batches are not in address order.
+		typedef std::function<void(std::vector<SignatureMatch>& batch)> MatchSink;
+
+		SignatureScanner() = default;
+		~SignatureScanner() = default;
+
+		SignatureScanner(const SignatureScanner&) = delete;
+		SignatureScanner& operator=(const SignatureScanner&) = delete;
+		SignatureScanner(SignatureScanner&&) = default;
+		SignatureScanner& operator=(SignatureScanner&&) = default;
+
+		// Fails if there are no patterns or one has no literal byte.
+		bool Compile(const std::vector<SignaturePattern>& patterns);
+		bool IsCompiled() const { return !m_Patterns.empty(); }
+		const std::vector<SignaturePattern>& GetPatterns() const { return m_Patterns; }
+		size_t GetStateCount() const { return m_Transitions.size() / 256; }
+
+		// Appends matches in data that start before reportLimit, addressed
+		// from baseAddress.
+		void ScanBuffer(const BYTE* data, size_t size, size_t reportLimit, ULONG_PTR baseAddress,
+			std::vector<SignatureMatch>& matches) const;
+
+		// Scans regions in chunks on worker threads. Each read extends past its
+		// chunk by the longest pattern, so a match across a boundary is found
+		// by the chunk it starts in. Blocks until done, MaxResults is reached
+		// or cancelled is set.
+		SignatureScanStatistics Scan(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+			const SignatureScanOptions& options, const MatchSink& sink, const std::atomic<bool>* cancelled = nullptr) const;
+
+		// Parses "name: 48 8B ?? 05", "name: \"text\"" or "name: u\"text\"",
+		// the last being UTF-16LE. Strings accept \\, \" and \xHH escapes.
+		static bool ParsePattern(const std::wstring& definition, SignaturePattern& pattern);
+		// One definition per line; blank lines and lines starting with # are
+		// skipped. On a bad line, errorLine receives its 1-based number.
+		static bool LoadPatterns(const std::wstring& filePath, std::vector<SignaturePattern>& patterns, size_t* errorLine = nullptr);
+
+	private:
+		size_t SkipToAnchorStart(const BYTE* data, size_t position, size_t size) const;
+
+		std::vector<SignaturePattern> m_Patterns;
+		std::vector<size_t> m_AnchorOffsets;
+		std::vector<size_t> m_AnchorLengths;
+		size_t m_MaxPatternLength = 0;
+
+		// 256 next states per state; state 0 is the root. Each entry is the
+		// next state's index times 256, with bit 0 set if anchors end there.
+		std::vector<DWORD> m_Transitions;
+		// Patterns whose anchor ends at state s are
+		// m_Outputs[m_OutputStart[s] .. m_OutputStart[s + 1]).
+		std::vector<DWORD> m_OutputStart;
+		std::vector<DWORD> m_Outputs;
+
+		bool m_IsAnchorStart[256] = {};
+		// Filled only when few enough bytes start an anchor to compare
+		// against all of them at once.
+		std::vector<BYTE> m_AnchorStartBytes;
+		// Bit (first | second << 8) is set for the first two bytes of every
+		// anchor. Empty when an anchor is a single byte.
+		std::vector<ULONGLONG> m_AnchorStartPairs;
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,295 @@
+#include "StringExtractor.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace WinProcessInspector {
+namespace Core {
+
+namespace {
+
+	const size_t MaxWorkers = 8;
+	const size_t BatchSize = 256;
+	const size_t MinChunkSize = 64 * 1024;
+	// Read before each chunk so a run that started in the previous chunk
+	// is recognised as one; two bytes keep UTF-16 units aligned.
+	const ULONG_PTR LeadBytes = 2;
+
+	struct Chunk {
+		ULONG_PTR Start;
+		size_t Length;
+		ULONG_PTR RegionBase;
+		ULONG_PTR RegionEnd;
+	};
+
+	bool IsPrintable(unsigned int value) {
+		return (value >= 0x20 && value <= 0x7E) || value == '\t';
+	}
+
+	unsigned long TrailingZeros(ULONGLONG value) {
+#if defined(_M_X64)
+		unsigned long index = 0;
+		_BitScanForward64(&index, value);
+		return index;
+#elif defined(_M_IX86)
+		unsigned long index = 0;
+		if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+			return index;
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+		return index + 32;
+#else
+		unsigned long index = 0;
+		while ((value & 1) == 0) {
+			value >>= 1;
+			++index;
+		}
+		return index;
+#endif
+	}
+
+	// Calls found(start, length) for every run of at least minLength set
+	// bits among the first units bits of mask.
+	template <typename Found>
+	void ForEachRun(const std::vector<ULONGLONG>& mask, size_t units, size_t minLength, Found found) {
+		size_t position = 0;
+		while (position < units) {
+			size_t word = position / 64;
+			ULONGLONG bits = mask[word] & (~0ULL << (position % 64));
+			while (bits == 0) {
+				if (++word >= mask.size()) {
+					return;
+				}
+				bits = mask[word];
+			}
+			size_t start = word * 64 + TrailingZeros(bits);
+			if (start >= units) {
+				return;
+			}
+
+			size_t end = units;
+			bits = ~mask[word] & (~0ULL << (start % 64));
+			for (;;) {
+				if (bits != 0) {
+					end = std::min(units, word * 64 + TrailingZeros(bits));
+					break;
+				}
+				if (++word >= mask.size()) {
+					break;
+				}
+				bits = ~mask[word];
+			}
+
+			if (end - start >= minLength) {
+				found(start, end - start);
+			}
+			position = end;
+		}
+	}
+
+}
+
+StringExtractionStatistics StringExtractor::Extract(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+	const StringExtractorOptions& options, const ResultSink& sink, const std::atomic<bool>* cancelled) const {
+	StringExtractionStatistics statistics;
+	if (!read || !sink || (!options.Ascii && !options.Utf16)) {
+		return statistics;
+	}
+
+	size_t chunkSize = std::max(options.ChunkSize, MinChunkSize) & ~static_cast<size_t>(1);
+	size_t minLength = std::max<size_t>(options.MinLength, 1);
+	size_t maxLength = std::max(options.MaxLength, minLength);
+
+	std::vector<Chunk> chunks;
+	for (const auto& region : regions) {
+		if (!MemoryManager::IsReadable(region, options.IncludeImages)) {
+			continue;
+		}
+		++statistics.Regions;
+		ULONG_PTR regionEnd = region.BaseAddress + region.RegionSize;
+		for (SIZE_T offset = 0; offset < region.RegionSize; offset += chunkSize) {
+			chunks.push_back({ region.BaseAddress + offset, std::min<size_t>(chunkSize, region.RegionSize - offset), region.BaseAddress, regionEnd });
+		}
+	}
+
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<size_t> found(0);
+	std::atomic<ULONGLONG> scanned(0);
+	std::atomic<bool> stop(false);
+	std::mutex sinkMutex;
+
+	auto worker = [&]() {
+		std::vector<BYTE> buffer;
+		std::vector<ULONGLONG> mask;
+		std::vector<ExtractedString> batch;
+
+		auto flush = [&]() {
+			if (!batch.empty()) {
+				std::lock_guard<std::mutex> lock(sinkMutex);
+				sink(batch);
+				batch.clear();
+			}
+		};
+
+		// Runs are kept only when they start inside the chunk; earlier ones
+		// belong to the previous chunk and later ones to the next.
+		auto emit = [&](ULONG_PTR address, StringEncoding encoding, const BYTE* text, size_t length) {
+			size_t index = found++;
+			if (options.MaxResults != 0 && index >= options.MaxResults) {
+				stop = true;
+				return;
+			}
+
+			ExtractedString result;
+			result.Address = address;
+			result.Encoding = encoding;
+			result.Text.resize(length);
+			for (size_t i = 0; i < length; ++i) {
+				result.Text[i] = encoding == StringEncoding::Ascii ? static_cast<wchar_t>(text[i])
+					: static_cast<wchar_t>(text[i * 2] | (text[i * 2 + 1] << 8));
+			}
+			batch.push_back(std::move(result));
+		};
+
+		for (;;) {
+			if (stop || (cancelled && *cancelled)) {
+				break;
+			}
+			size_t index = nextChunk++;
+			if (index >= chunks.size()) {
+				break;
+			}
+
+			const Chunk& chunk = chunks[index];
+			ULONG_PTR lead = std::min(LeadBytes, chunk.Start - chunk.RegionBase);
+			ULONG_PTR readStart = chunk.Start - lead;
+			size_t overlap = std::min<size_t>(maxLength * 2, chunk.RegionEnd - (chunk.Start + chunk.Length));
+			size_t readSize = lead + chunk.Length + overlap;
+			size_t ownedEnd = lead + chunk.Length;
+
+			buffer.resize(readSize);
+			if (!read(readStart, buffer.data(), readSize, nullptr)) {
+				continue;
+			}
+			scanned += chunk.Length;
+
+			if (options.Ascii) {
+				BuildAsciiMask(buffer.data(), readSize, mask);
+				ForEachRun(mask, readSize, minLength, [&](size_t start, size_t length) {
+					if (start >= lead && start < ownedEnd && !stop) {
+						emit(readStart + start, StringEncoding::Ascii, buffer.data() + start, std::min(length, maxLength));
+					}
+				});
+			}
+			if (options.Utf16) {
+				BuildUtf16Mask(buffer.data(), readSize, mask);
+				ForEachRun(mask, readSize / 2, minLength, [&](size_t start, size_t length) {
+					size_t offset = start * 2;
+					if (offset >= lead && offset < ownedEnd && !stop) {
+						emit(readStart + offset, StringEncoding::Utf16, buffer.data() + offset, std::min(length, maxLength));
+					}
+				});
+			}
+
+			if (batch.size() >= BatchSize) {
+				flush();
+			}
+		}
+		flush();
+	};
+
+	size_t workerCount = options.WorkerCount;
+	if (workerCount == 0) {
+		workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxWorkers);
+	}
+	workerCount = std::min(workerCount, std::max<size_t>(chunks.size(), 1));
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < workerCount; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	statistics.BytesScanned = scanned;
+	statistics.Strings = options.MaxResults != 0 ? std::min(found.load(), options.MaxResults) : found.load();
+	statistics.Truncated = stop;
+	return statistics;
+}
+
+std::string StringExtractor::FormatLine(const ExtractedString& result) {
+	char prefix[40];
+	snprintf(prefix, sizeof(prefix), "0x%llX\t%c\t", static_cast<ULONGLONG>(result.Address),
+		result.Encoding == StringEncoding::Ascii ? 'A' : 'U');
+	std::string line = prefix;
+	for (wchar_t ch : result.Text) {
+		line += static_cast<char>(ch);
+	}
+	line += '\n';
+	return line;
+}
+
+void StringExtractor::BuildAsciiMask(const BYTE* data, size_t size, std::vector<ULONGLONG>& mask) {
+	mask.assign((size + 63) / 64, 0);
+	size_t i = 0;
+
+#if defined(_M_X64) || defined(_M_IX86)
+	// 0x20..0x7E is one unsigned range after subtracting 0x20.
+	const __m128i offset = _mm_set1_epi8(0x20);
+	const __m128i range = _mm_set1_epi8(0x7E - 0x20);
+	const __m128i tab = _mm_set1_epi8('\t');
+	for (; i + 16 <= size; i += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i shifted = _mm_sub_epi8(bytes, offset);
+		__m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+		__m128i printable = _mm_or_si128(inRange, _mm_cmpeq_epi8(bytes, tab));
+		ULONGLONG bits = static_cast<unsigned int>(_mm_movemask_epi8(printable));
+		mask[i / 64] |= bits << (i % 64);
+	}
+#endif
+
+	for (; i < size; ++i) {
+		if (IsPrintable(data[i])) {
+			mask[i / 64] |= 1ULL << (i % 64);
+		}
+	}
+}
+
+void StringExtractor::BuildUtf16Mask(const BYTE* data, size_t size, std::vector<ULONGLONG>& mask) {
+	size_t units = size / 2;
+	mask.assign((units + 63) / 64, 0);
+	size_t i = 0;
+
+#if defined(_M_X64) || defined(_M_IX86)
+	// Units from 0x8000 compare as negative and fail the lower bound.
+	const __m128i low = _mm_set1_epi16(0x1F);
+	const __m128i high = _mm_set1_epi16(0x7F);
+	const __m128i tab = _mm_set1_epi16('\t');
+	for (; i + 8 <= units; i += 8) {
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+		__m128i printable = _mm_or_si128(
+			_mm_and_si128(_mm_cmpgt_epi16(values, low), _mm_cmplt_epi16(values, high)),
+			_mm_cmpeq_epi16(values, tab));
+		// Narrow each 16-bit lane to a byte so the move mask has one bit per unit.
+		ULONGLONG bits = static_cast<unsigned int>(_mm_movemask_epi8(_mm_packs_epi16(printable, _mm_setzero_si128()))) & 0xFF;
+		mask[i / 64] |= bits << (i % 64);
+	}
+#endif
+
+	for (; i < units; ++i) {
+		if (IsPrintable(data[i * 2] | (data[i * 2 + 1] << 8))) {
+			mask[i / 64] |= 1ULL << (i % 64);
+		}
+	}
+}
+
+} // namespace Core
+} // namespace WinProcessInspector
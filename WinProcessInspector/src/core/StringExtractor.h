@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <functional>
+#include "MemoryManager.h"
+#include "ProcessMemoryReader.h"
+
+namespace WinProcessInspector {
+namespace Core {
+
+	enum class StringEncoding : BYTE {
+		Ascii,
+		Utf16
+	};
+
+	struct ExtractedString {
+		ULONG_PTR Address = 0;
+		StringEncoding Encoding = StringEncoding::Ascii;
+		std::wstring Text;
+	};
+
+	struct StringExtractorOptions {
+		size_t MinLength = 5;
+		// Longer runs are cut to this many characters.
+		size_t MaxLength = 1024;
+		bool Ascii = true;
+		bool Utf16 = true;
+		bool IncludeImages = true;
+		size_t ChunkSize = 1024 * 1024;
+		// 0 picks one worker per core, up to 8.
+		size_t WorkerCount = 0;
+		// Stops after this many strings; 0 for no limit.
+		size_t MaxResults = 0;
+	};
+
+	struct StringExtractionStatistics {
+		size_t Regions = 0;
+		ULONGLONG BytesScanned = 0;
+		size_t Strings = 0;
+		bool Truncated = false;
+	};
+
+	// Pulls printable ASCII and UTF-16LE runs out of the committed, readable
+	// regions of an address space. Regions are cut into chunks that worker
+	// threads take in turn, each reading into a buffer it reuses. Chunks
+	// overlap by the maximum string length so runs across a boundary are
+	// found once, by the chunk they start in. Printable bytes are found 16
+	// at a time into a bitmap that is then walked word by word.
+	class StringExtractor {
+	public:
+		// Receives results in batches, from worker threads but never from two
+		// at once. Batches are not in address order.
+		typedef std::function<void(std::vector<ExtractedString>& batch)> ResultSink;
+
+		StringExtractor() = default;
+		~StringExtractor() = default;
+
+		StringExtractor(const StringExtractor&) = delete;
+		StringExtractor& operator=(const StringExtractor&) = delete;
+
+		// Blocks until every region is scanned, MaxResults is reached or
+		// cancelled is set.
+		StringExtractionStatistics Extract(const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions,
+			const StringExtractorOptions& options, const ResultSink& sink, const std::atomic<bool>* cancelled = nullptr) const;
+
+		// One line of a strings file: the address, A or U, and the text.
+		// Extracted text is printable ASCII in either encoding, so it is
+		// written byte for byte.
+		static std::string FormatLine(const ExtractedString& result);
+
+		// Bit i of mask is set when byte i (ASCII) or UTF-16 unit i is
+		// printable. Exposed for testing the SIMD paths.
+		static void BuildAsciiMask(const BYTE* data, size_t size, std::vector<ULONGLONG>& mask);
+		static void BuildUtf16Mask(const BYTE* data, size_t size, std::vector<ULONGLONG>& mask);
+	};
+
+} // namespace Core
+} // namespace WinProcessInspector
@@ -0,0 +1,503 @@
+#include "IconLoader.h"
+#include "../utils/CacheFile.h"
+#include <shellapi.h>
+#include <objbase.h>
+#include <algorithm>
+#include <cwctype>
+
+#pragma comment(lib, "shell32.lib")
+#pragma comment(lib, "ole32.lib")
+
+namespace WinProcessInspector {
+namespace GUI {
+
+namespace {
+
+	const DWORD CacheMagic = 0x43495057; // "WPIC"
+	const DWORD CacheVersion = 1;
+	const size_t MaxCacheEntries = 4096;
+	// How long a file that gave no icon is left alone before its stamp is
+	// checked again.
+	const ULONGLONG FailureRetryMs = 60 * 1000;
+
+	struct CacheHeader {
+		DWORD Magic;
+		DWORD Version;
+		DWORD SmallSize;
+		DWORD LargeSize;
+		DWORD BlobCount;
+		DWORD EntryCount;
+	};
+
+	size_t HashPixels(const std::vector<DWORD>& pixels) {
+		ULONGLONG hash = 14695981039346656037ULL;
+		for (DWORD pixel : pixels) {
+			hash ^= pixel;
+			hash *= 1099511628211ULL;
+		}
+		return static_cast<size_t>(hash);
+	}
+
+	template <typename T>
+	bool ReadValue(const std::vector<BYTE>& buffer, size_t& offset, T& value) {
+		if (offset + sizeof(T) > buffer.size()) {
+			return false;
+		}
+		memcpy(&value, buffer.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	void WriteValue(std::vector<BYTE>& buffer, const T& value) {
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+}
+
+IconLoader::~IconLoader() {
+	Stop();
+}
+
+bool IconLoader::Start(HWND notifyWindow, UINT notifyMessage, int smallSize, int largeSize, const std::wstring& cachePath) {
+	if (m_Worker.joinable()) {
+		return true;
+	}
+
+	m_NotifyWindow = notifyWindow;
+	m_NotifyMessage = notifyMessage;
+	m_SmallSize = smallSize;
+	m_LargeSize = largeSize;
+	m_CachePath = cachePath;
+	m_Stopping = false;
+
+	LoadCache();
+
+	m_Worker = std::thread(&IconLoader::WorkerThread, this);
+	return true;
+}
+
+void IconLoader::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_Queue.clear();
+		m_Pending.clear();
+	}
+	m_Wakeup.notify_all();
+
+	if (m_Worker.joinable()) {
+		m_Worker.join();
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_CacheDirty) {
+		SaveCache();
+	}
+}
+
+bool IconLoader::Request(const std::wstring& path, IconPixels& pixels) {
+	if (path.empty()) {
+		return false;
+	}
+
+	std::wstring key = MakeKey(path);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto entry = m_Entries.find(key);
+	if (entry != m_Entries.end() && entry->second.Verified && CopyBlobLocked(entry->second, pixels)) {
+		pixels.Path = path;
+		return true;
+	}
+
+	auto failed = m_Failed.find(key);
+	if (failed != m_Failed.end() && GetTickCount64() - failed->second.CheckedTick < FailureRetryMs) {
+		return false;
+	}
+
+	if (!m_Stopping && m_Pending.insert(key).second) {
+		m_Queue.push_back(path);
+		m_Wakeup.notify_one();
+	}
+	return false;
+}
+
+std::vector<IconPixels> IconLoader::TakeResults() {
+	std::vector<IconPixels> results;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	results.swap(m_Results);
+	return results;
+}
+
+void IconLoader::WorkerThread() {
+	// The shell may use COM to resolve icon handlers.
+	HRESULT hrInit = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+
+	for (;;) {
+		std::wstring path;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+			if (m_Stopping) {
+				break;
+			}
+			path = std::move(m_Queue.front());
+			m_Queue.pop_front();
+		}
+
+		std::wstring key = MakeKey(path);
+		ULONGLONG fileSize = 0;
+		ULONGLONG lastWriteTime = 0;
+		bool hasStamp = Utils::CacheFile::GetFileStamp(path, fileSize, lastWriteTime);
+
+		IconPixels pixels;
+		bool found = false;
+		bool knownFailure = false;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			found = hasStamp && LookupLocked(key, fileSize, lastWriteTime, pixels);
+			auto failed = m_Failed.find(key);
+			if (!found && failed != m_Failed.end() && failed->second.FileSize == fileSize &&
+				failed->second.LastWriteTime == lastWriteTime) {
+				// Unchanged since it last failed, so the shell is not asked again.
+				failed->second.CheckedTick = GetTickCount64();
+				knownFailure = true;
+			}
+		}
+
+		if (!found && !knownFailure) {
+			found = ExtractIcon(path, pixels);
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (found) {
+				if (m_Entries.size() >= MaxCacheEntries) {
+					m_Entries.clear();
+					m_Blobs.clear();
+					m_BlobsByHash.clear();
+				}
+
+				// Without a stamp the entry still serves this session, but
+				// never matches once loaded from the file.
+				CacheEntry entry;
+				entry.FileSize = fileSize;
+				entry.LastWriteTime = lastWriteTime;
+				entry.Blob = StoreBlob(pixels);
+				entry.Verified = true;
+				m_Entries[key] = entry;
+				m_Failed.erase(key);
+				m_CacheDirty = true;
+			} else {
+				if (m_Failed.size() >= MaxCacheEntries) {
+					m_Failed.clear();
+				}
+
+				FailedEntry failure;
+				failure.FileSize = fileSize;
+				failure.LastWriteTime = lastWriteTime;
+				failure.CheckedTick = GetTickCount64();
+				m_Failed[key] = failure;
+			}
+		}
+
+		bool notify = false;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Pending.erase(key);
+			if (found && !m_Stopping) {
+				pixels.Path = path;
+				m_Results.push_back(std::move(pixels));
+				notify = m_Results.size() == 1;
+			}
+		}
+
+		// One message per batch; the window drains every result queued so far.
+		if (notify && m_NotifyWindow) {
+			PostMessageW(m_NotifyWindow, m_NotifyMessage, 0, 0);
+		}
+	}
+
+	if (SUCCEEDED(hrInit)) {
+		CoUninitialize();
+	}
+}
+
+bool IconLoader::ExtractIcon(const std::wstring& path, IconPixels& pixels) const {
+	SHFILEINFOW sfi = {};
+	if (!SHGetFileInfoW(path.c_str(), FILE_ATTRIBUTE_NORMAL, &sfi, sizeof(sfi), SHGFI_ICON | SHGFI_SMALLICON) || !sfi.hIcon) {
+		return false;
+	}
+	bool converted = IconToPixels(sfi.hIcon, m_SmallSize, pixels.Small);
+	DestroyIcon(sfi.hIcon);
+	if (!converted) {
+		return false;
+	}
+
+	sfi = {};
+	if (SHGetFileInfoW(path.c_str(), FILE_ATTRIBUTE_NORMAL, &sfi, sizeof(sfi), SHGFI_ICON | SHGFI_LARGEICON) && sfi.hIcon) {
+		IconToPixels(sfi.hIcon, m_LargeSize, pixels.Large);
+		DestroyIcon(sfi.hIcon);
+	}
+	if (pixels.Large.empty()) {
+		pixels.Large.assign(static_cast<size_t>(m_LargeSize) * m_LargeSize, 0);
+	}
+
+	pixels.SmallSize = m_SmallSize;
+	pixels.LargeSize = m_LargeSize;
+	return true;
+}
+
+bool IconLoader::IconToPixels(HICON hIcon, int size, std::vector<DWORD>& pixels) {
+	HDC hdc = CreateCompatibleDC(nullptr);
+	if (!hdc) {
+		return false;
+	}
+
+	BITMAPINFO bmi = {};
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = size;
+	bmi.bmiHeader.biHeight = -size;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = nullptr;
+	HBITMAP hDib = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+	if (!hDib || !bits) {
+		DeleteDC(hdc);
+		return false;
+	}
+
+	const size_t count = static_cast<size_t>(size) * size;
+	DWORD* dibPixels = static_cast<DWORD*>(bits);
+	HGDIOBJ hOld = SelectObject(hdc, hDib);
+
+	memset(dibPixels, 0, count * sizeof(DWORD));
+	DrawIconEx(hdc, 0, 0, hIcon, size, size, 0, nullptr, DI_NORMAL);
+	GdiFlush();
+	pixels.assign(dibPixels, dibPixels + count);
+
+	// Icons without an alpha channel get it from their mask.
+	bool hasAlpha = std::any_of(pixels.begin(), pixels.end(), [](DWORD pixel) { return (pixel & 0xFF000000) != 0; });
+	if (!hasAlpha) {
+		memset(dibPixels, 0, count * sizeof(DWORD));
+		DrawIconEx(hdc, 0, 0, hIcon, size, size, 0, nullptr, DI_MASK);
+		GdiFlush();
+		for (size_t i = 0; i < count; ++i) {
+			if ((dibPixels[i] & 0x00FFFFFF) == 0) {
+				pixels[i] |= 0xFF000000;
+			} else {
+				pixels[i] = 0;
+			}
+		}
+	}
+
+	SelectObject(hdc, hOld);
+	DeleteObject(hDib);
+	DeleteDC(hdc);
+	return true;
+}
+
+HICON IconLoader::CreateIconFromPixels(const std::vector<DWORD>& pixels, int size) {
+	const size_t count = static_cast<size_t>(size) * size;
+	if (size <= 0 || pixels.size() < count) {
+		return nullptr;
+	}
+
+	BITMAPINFO bmi = {};
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = size;
+	bmi.bmiHeader.biHeight = -size;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = nullptr;
+	HBITMAP hColor = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+	if (!hColor || !bits) {
+		return nullptr;
+	}
+	memcpy(bits, pixels.data(), count * sizeof(DWORD));
+
+	// The colour bitmap carries alpha, so an all-opaque mask is enough.
+	std::vector<BYTE> maskBits(static_cast<size_t>((size + 15) / 16) * 2 * size, 0);
+	HBITMAP hMask = CreateBitmap(size, size, 1, 1, maskBits.data());
+
+	ICONINFO iconInfo = {};
+	iconInfo.fIcon = TRUE;
+	iconInfo.hbmColor = hColor;
+	iconInfo.hbmMask = hMask;
+	HICON hIcon = hMask ? CreateIconIndirect(&iconInfo) : nullptr;
+
+	if (hMask) {
+		DeleteObject(hMask);
+	}
+	DeleteObject(hColor);
+	return hIcon;
+}
+
+size_t IconLoader::StoreBlob(const IconPixels& pixels) {
+	std::vector<DWORD> blob;
+	blob.reserve(pixels.Small.size() + pixels.Large.size());
+	blob.insert(blob.end(), pixels.Small.begin(), pixels.Small.end());
+	blob.insert(blob.end(), pixels.Large.begin(), pixels.Large.end());
+
+	size_t hash = HashPixels(blob);
+	auto range = m_BlobsByHash.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (m_Blobs[it->second] == blob) {
+			return it->second;
+		}
+	}
+
+	m_Blobs.push_back(std::move(blob));
+	m_BlobsByHash.emplace(hash, m_Blobs.size() - 1);
+	return m_Blobs.size() - 1;
+}
+
+bool IconLoader::LookupLocked(const std::wstring& key, ULONGLONG fileSize, ULONGLONG lastWriteTime, IconPixels& pixels) {
+	auto it = m_Entries.find(key);
+	if (it == m_Entries.end() || it->second.FileSize != fileSize || it->second.LastWriteTime != lastWriteTime ||
+		!CopyBlobLocked(it->second, pixels)) {
+		return false;
+	}
+
+	it->second.Verified = true;
+	return true;
+}
+
+bool IconLoader::CopyBlobLocked(const CacheEntry& entry, IconPixels& pixels) const {
+	if (entry.Blob >= m_Blobs.size()) {
+		return false;
+	}
+
+	const std::vector<DWORD>& blob = m_Blobs[entry.Blob];
+	const size_t smallCount = static_cast<size_t>(m_SmallSize) * m_SmallSize;
+	if (blob.size() < smallCount) {
+		return false;
+	}
+
+	pixels.SmallSize = m_SmallSize;
+	pixels.LargeSize = m_LargeSize;
+	pixels.Small.assign(blob.begin(), blob.begin() + smallCount);
+	pixels.Large.assign(blob.begin() + smallCount, blob.end());
+	return true;
+}
+
+bool IconLoader::LoadCache() {
+	if (m_CachePath.empty()) {
+		return false;
+	}
+
+	HANDLE hFile = CreateFileW(m_CachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	std::vector<BYTE> buffer;
+	if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart < 64 * 1024 * 1024) {
+		buffer.resize(static_cast<size_t>(fileSize.QuadPart));
+		DWORD bytesRead = 0;
+		if (!ReadFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &bytesRead, nullptr) || bytesRead != buffer.size()) {
+			buffer.clear();
+		}
+	}
+	CloseHandle(hFile);
+
+	size_t offset = 0;
+	CacheHeader header = {};
+	if (!ReadValue(buffer, offset, header) || header.Magic != CacheMagic || header.Version != CacheVersion ||
+		header.SmallSize != static_cast<DWORD>(m_SmallSize) || header.LargeSize != static_cast<DWORD>(m_LargeSize)) {
+		return false;
+	}
+
+	const size_t blobPixels = static_cast<size_t>(m_SmallSize) * m_SmallSize + static_cast<size_t>(m_LargeSize) * m_LargeSize;
+	const size_t blobBytes = blobPixels * sizeof(DWORD);
+	if (header.BlobCount > (buffer.size() - offset) / blobBytes) {
+		return false;
+	}
+
+	std::vector<std::vector<DWORD>> blobs(header.BlobCount);
+	for (auto& blob : blobs) {
+		blob.resize(blobPixels);
+		memcpy(blob.data(), buffer.data() + offset, blobBytes);
+		offset += blobBytes;
+	}
+
+	std::unordered_map<std::wstring, CacheEntry> entries;
+	for (DWORD i = 0; i < header.EntryCount; ++i) {
+		DWORD pathLength = 0;
+		if (!ReadValue(buffer, offset, pathLength) || pathLength > (buffer.size() - offset) / sizeof(wchar_t)) {
+			return false;
+		}
+		std::wstring key(reinterpret_cast<const wchar_t*>(buffer.data() + offset), pathLength);
+		offset += pathLength * sizeof(wchar_t);
+
+		CacheEntry entry;
+		DWORD blob = 0;
+		if (!ReadValue(buffer, offset, entry.FileSize) || !ReadValue(buffer, offset, entry.LastWriteTime) ||
+			!ReadValue(buffer, offset, blob) || blob >= blobs.size()) {
+			return false;
+		}
+		entry.Blob = blob;
+		entries[key] = entry;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Blobs = std::move(blobs);
+	m_Entries = std::move(entries);
+	m_BlobsByHash.clear();
+	for (size_t i = 0; i < m_Blobs.size(); ++i) {
+		m_BlobsByHash.emplace(HashPixels(m_Blobs[i]), i);
+	}
+	m_CacheDirty = false;
+	return true;
+}
+
+bool IconLoader::SaveCache() {
+	if (m_CachePath.empty()) {
+		return false;
+	}
+
+	CacheHeader header = {};
+	header.Magic = CacheMagic;
+	header.Version = CacheVersion;
+	header.SmallSize = static_cast<DWORD>(m_SmallSize);
+	header.LargeSize = static_cast<DWORD>(m_LargeSize);
+	header.BlobCount = static_cast<DWORD>(m_Blobs.size());
+	header.EntryCount = static_cast<DWORD>(m_Entries.size());
+
+	std::vector<BYTE> buffer;
+	WriteValue(buffer, header);
+	for (const auto& blob : m_Blobs) {
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(blob.data());
+		buffer.insert(buffer.end(), bytes, bytes + blob.size() * sizeof(DWORD));
+	}
+	for (const auto& entry : m_Entries) {
+		WriteValue(buffer, static_cast<DWORD>(entry.first.size()));
+		const BYTE* path = reinterpret_cast<const BYTE*>(entry.first.data());
+		buffer.insert(buffer.end(), path, path + entry.first.size() * sizeof(wchar_t));
+		WriteValue(buffer, entry.second.FileSize);
+		WriteValue(buffer, entry.second.LastWriteTime);
+		WriteValue(buffer, static_cast<DWORD>(entry.second.Blob));
+	}
+
+	if (!Utils::CacheFile::Write(m_CachePath, buffer)) {
+		return false;
+	}
+
+	m_CacheDirty = false;
+	return true;
+}
+
+std::wstring IconLoader::MakeKey(const std::wstring& path) {
+	std::wstring key = path;
+	std::transform(key.begin(), key.end(), key.begin(), ::towlower);
+	return key;
+}
+
+std::wstring IconLoader::GetDefaultCachePath() {
+	return Utils::CacheFile::GetDefaultPath(L"IconCache.bin");
+}
+
+} // namespace GUI
+} // namespace WinProcessInspector
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace WinProcessInspector {
+namespace GUI {
+
+	// 32-bit BGRA pixels of one image's small and large icon, top-down rows.
+	struct IconPixels {
+		std::wstring Path;
+		int SmallSize = 0;
+		int LargeSize = 0;
+		std::vector<DWORD> Small;
+		std::vector<DWORD> Large;
+	};
+
+	// Extracts file icons on a background thread. Finished icons are queued
+	// and the owner window is notified with a posted message. Decoded pixels
+	// are kept in a small file keyed by path, file size and last write time,
+	// so icons seen in a previous session need no shell call. Files are only
+	// touched on the loader thread, and files without an icon are remembered
+	// by their stamp so they are not extracted again until they change.
+	class IconLoader {
+	public:
+		IconLoader() = default;
+		~IconLoader();
+
+		IconLoader(const IconLoader&) = delete;
+		IconLoader& operator=(const IconLoader&) = delete;
+
+		bool Start(HWND notifyWindow, UINT notifyMessage, int smallSize, int largeSize, const std::wstring& cachePath);
+		void Stop();
+
+		// Fills pixels and returns true when the cache holds an icon whose
+		// file stamp was checked this session. Otherwise queues one lookup per
+		// path, unless the file recently failed to give an icon.
+		bool Request(const std::wstring& path, IconPixels& pixels);
+		std::vector<IconPixels> TakeResults();
+
+		static std::wstring GetDefaultCachePath();
+		static HICON CreateIconFromPixels(const std::vector<DWORD>& pixels, int size);
+
+	private:
+		struct CacheEntry {
+			ULONGLONG FileSize = 0;
+			ULONGLONG LastWriteTime = 0;
+			size_t Blob = 0;
+			// Set once the loader thread has checked the stamp this session.
+			bool Verified = false;
+		};
+
+		struct FailedEntry {
+			ULONGLONG FileSize = 0;
+			ULONGLONG LastWriteTime = 0;
+			ULONGLONG CheckedTick = 0;
+		};
+
+		void WorkerThread();
+		bool ExtractIcon(const std::wstring& path, IconPixels& pixels) const;
+		size_t StoreBlob(const IconPixels& pixels);
+		bool LookupLocked(const std::wstring& key, ULONGLONG fileSize, ULONGLONG lastWriteTime, IconPixels& pixels);
+		bool CopyBlobLocked(const CacheEntry& entry, IconPixels& pixels) const;
+		bool LoadCache();
+		bool SaveCache();
+
+		static std::wstring MakeKey(const std::wstring& path);
+		static bool IconToPixels(HICON hIcon, int size, std::vector<DWORD>& pixels);
+
+		HWND m_NotifyWindow = nullptr;
+		UINT m_NotifyMessage = 0;
+		int m_SmallSize = 16;
+		int m_LargeSize = 32;
+		std::wstring m_CachePath;
+
+		std::thread m_Worker;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Wakeup;
+		bool m_Stopping = false;
+		bool m_CacheDirty = false;
+
+		std::deque<std::wstring> m_Queue;
+		std::unordered_set<std::wstring> m_Pending;
+		std::vector<IconPixels> m_Results;
+
+		// Identical bitmaps (many executables share the default icon) are
+		// stored once and referenced by every path that uses them.
+		std::unordered_map<std::wstring, CacheEntry> m_Entries;
+		std::vector<std::vector<DWORD>> m_Blobs;
+		std::unordered_multimap<size_t, size_t> m_BlobsByHash;
+		// Files that gave no icon, by the stamp they had then. Not saved.
+		std::unordered_map<std::wstring, FailedEntry> m_Failed;
+	};
+
+} // namespace GUI
+} // namespace WinProcessInspector
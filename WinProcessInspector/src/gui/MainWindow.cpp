@@ -3,7 +3,13 @@
 #include "../core/ProcessManager.h"
 #include "../core/SystemInfo.h"
 #include "../core/NetworkManager.h"
+#include "../core/ObjectTypeTable.h"
+#include "../core/SignatureScanner.h"
+#include "../core/PageDedupAnalyzer.h"
+#include "../core/MinidumpFile.h"
+#include "../core/StringExtractor.h"
 #include "../utils/Logger.h"
+#include "../utils/StringConversion.h"
 #include "../security/SecurityManager.h"
 #include "../injection/InjectionEngine.h"
 #include "../../resource.h"
@@ -15,9 +21,7 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
-#include <thread>
 #include <chrono>
-#include <functional>
 #include <unordered_set>
 #include <psapi.h>
 #include <wintrust.h>
@@ -52,9 +56,37 @@ enum ProcessListColumns {
 	COL_IMAGEPATH,
 	COL_COMMANDLINE,
 	COL_COMPANY,
+	COL_SERVICES,
 	COL_COUNT
 };
 
+// Snapshot fields each column is computed from. Description, company,
+// image path and services come from caches keyed by the image path and
+// the service snapshot; CPU and memory are sampled separately.
+const ProcessFieldMask ColumnFields[COL_COUNT] = {
+	ProcessFieldNone,			// COL_NAME
+	ProcessFieldNone,			// COL_PID
+	ProcessFieldNone,			// COL_PPID
+	ProcessFieldNone,			// COL_CPU
+	ProcessFieldNone,			// COL_MEMORY
+	ProcessFieldSession,		// COL_SESSION
+	ProcessFieldIntegrity,		// COL_INTEGRITY
+	ProcessFieldUser,			// COL_USER
+	ProcessFieldArchitecture,	// COL_ARCHITECTURE
+	ProcessFieldNone,			// COL_DESCRIPTION
+	ProcessFieldNone,			// COL_IMAGEPATH
+	ProcessFieldCommandLine,	// COL_COMMANDLINE
+	ProcessFieldNone,			// COL_COMPANY
+	ProcessFieldNone			// COL_SERVICES
+};
+
+// Fields written by the CSV, JSON and text exports.
+const ProcessFieldMask ExportFields = ProcessFieldSession | ProcessFieldIntegrity | ProcessFieldUser |
+	ProcessFieldArchitecture | ProcessFieldPriority | ProcessFieldAffinity;
+
+// Fields shown in the status bar for the selected process.
+const ProcessFieldMask SelectionFields = ProcessFieldHandleCount | ProcessFieldGuiObjects | ProcessFieldMitigations;
+
 
 MainWindow::MainWindow(HINSTANCE hInstance)
 	: m_hWnd(nullptr)
@@ -67,6 +99,7 @@ MainWindow::MainWindow(HINSTANCE hInstance)
 	, m_hSearchLabel(nullptr)
 	, m_hMenu(nullptr)
 	, m_hContextMenu(nullptr)
+	, m_hGroupByMenu(nullptr)
 	, m_hAccel(nullptr)
 	, m_SelectedProcessId(0)
 	, m_SortColumn(COL_NAME)
@@ -76,14 +109,36 @@ MainWindow::MainWindow(HINSTANCE hInstance)
 	, m_SearchBarVisible(true)
 	, m_TreeViewEnabled(false)
 	, m_RefreshTimerId(0)
-	, m_IsRefreshing(false)
-	, m_LastRefreshTime(0)
+	, m_SearchIndexValid(false)
+	, m_ProcessTreeMetricsValid(false)
+	, m_GroupKind(WinProcessInspector::Core::ProcessGroupKind::None)
 	, m_LastCpuUpdateTime(0)
 	, m_hProcessIconList(nullptr)
 	, m_DefaultIconIndex(-1)
 	, m_ColumnVisible(COL_COUNT, true)
+	, m_RequiredFields(ProcessFieldAll)
+	, m_CollectedFields(ProcessFieldNone)
+	, m_ServicesRequired(false)
+	, m_ServicesCollected(false)
+	, m_GroupingRequired(WinProcessInspector::Core::ProcessGroupKind::None)
+	, m_ObjectSearchRequested(false)
+	, m_ObjectSearchReady(false)
+	, m_ObjectQueryTypeIndex(0)
+	, m_ObjectQueryTypeFilter(false)
+	, m_ObjectQueryPending(false)
 	, m_TotalSystemMemory(0)
 	, m_CurrentProcessId(GetCurrentProcessId())
+	, m_DumpCancelled(false)
+	, m_DumpVerifying(false)
+	, m_DumpProcessId(0)
+	, m_DumpPercent(0)
+	, m_ScanCancelled(false)
+	, m_ScanProcesses(0)
+	, m_ScanPercent(0)
+	, m_DedupCancelled(false)
+	, m_MinidumpCancelled(false)
+	, m_MinidumpJobCaption(L"")
+	, m_MinidumpJobFailed(false)
 {
 	m_ColumnVisible[COL_PPID] = false;
 	m_ColumnVisible[COL_SESSION] = false;
@@ -91,6 +146,7 @@ MainWindow::MainWindow(HINSTANCE hInstance)
 	m_ColumnVisible[COL_IMAGEPATH] = false;
 	m_ColumnVisible[COL_COMMANDLINE] = false;
 	m_ColumnVisible[COL_COMPANY] = true;
+	m_ColumnVisible[COL_SERVICES] = false;
 	
 	MEMORYSTATUSEX memStatus = {};
 	memStatus.dwLength = sizeof(memStatus);
@@ -119,6 +175,8 @@ bool MainWindow::Initialize() {
 		return false;
 	}
 
+	m_FileMetadata.Open(FileMetadataCache::GetDefaultCachePath());
+
 	if (!CreateMainWindow()) {
 		return false;
 	}
@@ -178,7 +236,51 @@ bool MainWindow::Initialize() {
 	GetClientRect(m_hWnd, &rc);
 	SendMessage(m_hWnd, WM_SIZE, SIZE_RESTORED, MAKELPARAM(rc.right, rc.bottom));
 
-	m_FilteredProcesses = m_Processes;
+	m_RequiredFields = ComputeRequiredFields();
+	m_ServicesRequired = ComputeServicesRequired();
+	m_SnapshotWorker.Start(m_hWnd, WM_USER + 1, [this, timedFields = ProcessFieldNone](ProcessSnapshot& snapshot,
+		const std::atomic<bool>& cancelled) mutable {
+		snapshot.Fields = m_RequiredFields.load();
+		snapshot.TimedFields = snapshot.Fields;
+		snapshot.Timings = ProcessFieldTimings();
+		if (!m_ProcessManager.EnumerateAllProcesses(snapshot.Processes, &cancelled, snapshot.Fields, &snapshot.Timings)) {
+			return false;
+		}
+		// Fields skipped from the start are queried once and thrown away, so
+		// the time reported as saved on them is measured, not guessed.
+		ProcessFieldMask untimed = ProcessFieldAll & ~snapshot.Fields & ~timedFields;
+		if (untimed != ProcessFieldNone) {
+			for (const ProcessInfo& process : snapshot.Processes) {
+				if (cancelled) {
+					return false;
+				}
+				ProcessInfo scratch;
+				scratch.ProcessId = process.ProcessId;
+				m_ProcessManager.CollectProcessFields(scratch, untimed, &snapshot.Timings);
+			}
+			snapshot.TimedFields |= untimed;
+		}
+		timedFields |= snapshot.TimedFields;
+		m_ImagePaths.Update(snapshot.Processes, m_ProcessManager);
+		snapshot.ServicesCollected = m_ServicesRequired.load() && snapshot.Services.Refresh();
+		if (!snapshot.ServicesCollected) {
+			snapshot.Services.Clear();
+		}
+		// Grouping opens every new process, and every process when grouping
+		// by job.
+		ProcessGroupKind groupKind = m_GroupingRequired.load();
+		if (groupKind != ProcessGroupKind::None) {
+			snapshot.Grouping.Update(snapshot.Processes, snapshot.ServicesCollected ? &snapshot.Services : nullptr,
+				groupKind == ProcessGroupKind::Job);
+		} else {
+			snapshot.Grouping.Clear();
+		}
+		if (m_ObjectSearchRequested.exchange(false)) {
+			UpdateObjectSearchIndex(cancelled);
+			m_ObjectSearchReady = true;
+		}
+		return true;
+	});
 
 	RefreshProcessList();
 	Logger::GetInstance().LogInfo("Application initialized successfully");
@@ -376,6 +478,19 @@ bool MainWindow::CreateMenuBar() {
 		return false;
 	}
 	AppendMenuW(hViewMenu, MF_STRING, IDM_VIEW_TREEVIEW, L"&Tree View");
+	m_hGroupByMenu = CreatePopupMenu();
+	if (m_hGroupByMenu) {
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_NONE, L"&None");
+		AppendMenuW(m_hGroupByMenu, MF_SEPARATOR, 0, nullptr);
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_APPCONTAINER, L"&AppContainer");
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_PACKAGE, L"&Package");
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_JOB, L"&Job");
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_SESSION, L"&Session");
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_USER, L"&User");
+		AppendMenuW(m_hGroupByMenu, MF_STRING, IDM_VIEW_GROUP_SERVICE, L"Service &Host Group");
+		CheckMenuRadioItem(m_hGroupByMenu, IDM_VIEW_GROUP_NONE, IDM_VIEW_GROUP_SERVICE, IDM_VIEW_GROUP_NONE, MF_BYCOMMAND);
+		AppendMenuW(hViewMenu, MF_POPUP, reinterpret_cast<UINT_PTR>(m_hGroupByMenu), L"&Group By");
+	}
 	AppendMenuW(hViewMenu, MF_STRING | MF_CHECKED, IDM_VIEW_TOOLBAR, L"Tool&bar");
 	AppendMenuW(hViewMenu, MF_STRING | MF_CHECKED, IDM_VIEW_SEARCHBAR, L"&Search Bar\tCtrl+F");
 	AppendMenuW(hViewMenu, MF_SEPARATOR, 0, nullptr);
@@ -394,6 +509,15 @@ bool MainWindow::CreateMenuBar() {
 	}
 	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_NETWORK, L"&Network Connections...");
 	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_SYSTEM_INFO, L"&System Information...");
+	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_FIND_OBJECT, L"&Find Handle or DLL...");
+	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_SCAN_SIGNATURES, L"Scan Memory for Si&gnatures...");
+	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_DUPLICATE_PAGES, L"Find &Duplicate Pages...");
+	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_OPEN_MINIDUMP, L"Open &Minidump...");
+	// Enabled once a minidump is open.
+	AppendMenuW(hToolsMenu, MF_STRING | MF_GRAYED, IDM_TOOLS_SCAN_MINIDUMP, L"Scan Minidump for Signa&tures...");
+	AppendMenuW(hToolsMenu, MF_STRING | MF_GRAYED, IDM_TOOLS_MINIDUMP_STRINGS, L"Extract Minidump St&rings...");
+	AppendMenuW(hToolsMenu, MF_STRING | MF_GRAYED, IDM_TOOLS_COMPARE_MINIDUMPS, L"Compare Minidump &Pages...");
+	AppendMenuW(hToolsMenu, MF_STRING, IDM_TOOLS_OPEN_COMPRESSED_DUMP, L"Open &Compressed Dump...");
 
 	HMENU hHelpMenu = CreatePopupMenu();
 	if (!hHelpMenu) {
@@ -494,6 +618,7 @@ bool MainWindow::CreateProcessListView() {
 			DestroyIcon(sfi.hIcon);
 		}
 		ListView_SetImageList(m_hProcessListView, m_hProcessIconList, LVSIL_SMALL);
+		m_IconLoader.Start(m_hWnd, WM_USER + 2, iconSize, GetSystemMetrics(SM_CXICON), IconLoader::GetDefaultCachePath());
 	}
 
 	LVCOLUMNW lvc = {};
@@ -569,6 +694,11 @@ bool MainWindow::CreateProcessListView() {
 	lvc.cx = 150;
 	ListView_InsertColumn(m_hProcessListView, COL_COMPANY, &lvc);
 
+	lvc.iSubItem = COL_SERVICES;
+	lvc.pszText = const_cast<LPWSTR>(L"Services");
+	lvc.cx = 200;
+	ListView_InsertColumn(m_hProcessListView, COL_SERVICES, &lvc);
+
 	for (int i = 0; i < COL_COUNT; ++i) {
 		if (!m_ColumnVisible[i]) {
 			ListView_SetColumnWidth(m_hProcessListView, i, 0);
@@ -744,11 +874,35 @@ bool MainWindow::CreateSearchFilter() {
 }
 
 void MainWindow::Cleanup() {
+	m_SnapshotWorker.Stop();
+
+	if (m_DumpThread.joinable()) {
+		m_DumpCancelled = true;
+		m_DumpThread.join();
+	}
+	if (m_ScanThread.joinable()) {
+		m_ScanCancelled = true;
+		m_ScanThread.join();
+	}
+	if (m_DedupThread.joinable()) {
+		m_DedupCancelled = true;
+		m_DedupThread.join();
+	}
+	if (m_MinidumpThread.joinable()) {
+		m_MinidumpCancelled = true;
+		m_MinidumpThread.join();
+	}
+	m_Minidump.reset();
+
 	if (m_RefreshTimerId) {
 		KillTimer(m_hWnd, m_RefreshTimerId);
 		m_RefreshTimerId = 0;
 	}
 
+	m_IconLoader.Stop();
+	m_PendingIconRows.clear();
+	m_FileMetadata.Close();
+
 	if (m_hProcessIconList) {
 		ImageList_Destroy(m_hProcessIconList);
 		m_hProcessIconList = nullptr;
@@ -978,6 +1132,27 @@ LRESULT MainWindow::OnCommand(WPARAM wParam, LPARAM lParam) {
 		case IDM_VIEW_TREEVIEW:
 			OnViewTreeView();
 			break;
+		case IDM_VIEW_GROUP_NONE:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::None);
+			break;
+		case IDM_VIEW_GROUP_APPCONTAINER:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::AppContainer);
+			break;
+		case IDM_VIEW_GROUP_PACKAGE:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::Package);
+			break;
+		case IDM_VIEW_GROUP_JOB:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::Job);
+			break;
+		case IDM_VIEW_GROUP_SESSION:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::Session);
+			break;
+		case IDM_VIEW_GROUP_USER:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::User);
+			break;
+		case IDM_VIEW_GROUP_SERVICE:
+			OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind::ServiceGroup);
+			break;
 		case IDM_VIEW_TOOLBAR:
 			OnViewToolbar();
 			break;
@@ -998,6 +1173,30 @@ LRESULT MainWindow::OnCommand(WPARAM wParam, LPARAM lParam) {
 		case IDM_TOOLS_SYSTEM_INFO:
 			ShowSystemInformationWindow();
 			break;
+		case IDM_TOOLS_FIND_OBJECT:
+			ShowFindObjectWindow();
+			break;
+		case IDM_TOOLS_SCAN_SIGNATURES:
+			ShowSignatureScanWindow(false);
+			break;
+		case IDM_TOOLS_DUPLICATE_PAGES:
+			ShowDuplicatePagesWindow();
+			break;
+		case IDM_TOOLS_OPEN_MINIDUMP:
+			ShowMinidumpWindow();
+			break;
+		case IDM_TOOLS_SCAN_MINIDUMP:
+			ShowSignatureScanWindow(true);
+			break;
+		case IDM_TOOLS_MINIDUMP_STRINGS:
+			ExtractMinidumpStrings();
+			break;
+		case IDM_TOOLS_COMPARE_MINIDUMPS:
+			CompareMinidumpPages();
+			break;
+		case IDM_TOOLS_OPEN_COMPRESSED_DUMP:
+			ShowCompressedDumpWindow();
+			break;
 		case IDM_HELP_ABOUT:
 			OnHelpAbout();
 			break;
@@ -1100,7 +1299,7 @@ LRESULT MainWindow::OnNotify(WPARAM wParam, LPARAM lParam) {
 				ListView_GetItem(m_hProcessListView, &lvi);
 				DWORD processId = static_cast<DWORD>(lvi.lParam);
 				
-				m_ExpandedProcesses[processId] = !m_ExpandedProcesses[processId];
+				m_ExpandedProcesses[processId] = !IsProcessExpanded(processId);
 				UpdateProcessList();
 			}
 		}
@@ -1134,30 +1333,133 @@ LRESULT MainWindow::OnContextMenu(WPARAM wParam, LPARAM lParam) {
 LRESULT MainWindow::OnTimer(WPARAM wParam) {
 	if (wParam == IDT_REFRESH_TIMER) {
 		RefreshProcessList();
+		// Fallback in case the snapshot is cancelled; a completed refresh
+		// reschedules from its own finish time.
+		if (m_AutoRefresh) {
+			m_RefreshTimerId = SetTimer(m_hWnd, IDT_REFRESH_TIMER,
+				static_cast<UINT>(m_RefreshScheduler.GetInterval(GetTickCount64())), nullptr);
+		}
 		return 0;
 	}
 	return DefWindowProc(m_hWnd, WM_TIMER, wParam, 0);
 }
 
 void MainWindow::RefreshProcessList() {
-	if (m_IsRefreshing) {
+	// Requests made while a snapshot is being collected are merged into the
+	// next one, so timer ticks and manual refreshes never queue up.
+	m_SnapshotWorker.Request();
+}
+
+void MainWindow::ScheduleRefresh() {
+	if (!m_AutoRefresh || !m_hWnd) {
 		return;
 	}
 
-	ULONGLONG currentTime = GetTickCount64();
-	if (m_LastRefreshTime > 0 && (currentTime - m_LastRefreshTime) < 500) {
+	ULONGLONG now = GetTickCount64();
+	m_RefreshScheduler.SetVisible(IsWindowVisible(m_hWnd) && !IsIconic(m_hWnd));
+	m_RefreshScheduler.SetWatching(GetForegroundWindow() == m_hWnd && m_SelectedProcessId != 0);
+
+	LASTINPUTINFO lii = {};
+	lii.cbSize = sizeof(lii);
+	if (GetLastInputInfo(&lii)) {
+		DWORD idleMs = GetTickCount() - lii.dwTime;
+		m_RefreshScheduler.SetLastInputTime(now > idleMs ? now - idleMs : 0);
+	}
+
+	// While a snapshot is being collected its completion reschedules.
+	if (m_SnapshotWorker.IsBusy()) {
 		return;
 	}
 
-	m_IsRefreshing = true;
-	m_LastRefreshTime = currentTime;
+	ULONGLONG delay = m_RefreshScheduler.GetDelay(now);
+	m_RefreshTimerId = SetTimer(m_hWnd, IDT_REFRESH_TIMER, static_cast<UINT>(std::max<ULONGLONG>(delay, USER_TIMER_MINIMUM)), nullptr);
+}
 
-	std::thread refreshThread([this]() {
-		std::vector<ProcessInfo> processes = m_ProcessManager.EnumerateAllProcesses();
-		
-		PostMessage(m_hWnd, WM_USER + 1, 0, reinterpret_cast<LPARAM>(new std::vector<ProcessInfo>(std::move(processes))));
-	});
-	refreshThread.detach();
+ULONGLONG MainWindow::GetOwnCpuTimeMs() {
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+		return 0;
+	}
+
+	ULONGLONG kernel = (static_cast<ULONGLONG>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	ULONGLONG user = (static_cast<ULONGLONG>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+	return (kernel + user) / 10000;
+}
+
+void MainWindow::OnSnapshotReady() {
+	ProcessSnapshot* snapshot = m_SnapshotWorker.TakeSnapshot();
+	if (!snapshot) {
+		return;
+	}
+
+	std::unordered_set<DWORD> newPids;
+	newPids.reserve(snapshot->Processes.size());
+	for (const auto& p : snapshot->Processes) {
+		newPids.insert(p.ProcessId);
+	}
+
+	for (const auto& p : m_Processes) {
+		if (newPids.find(p.ProcessId) == newPids.end()) {
+			m_SystemProcessCache.erase(p.ProcessId);
+			m_ProcessCpuTime.erase(p.ProcessId);
+			m_ProcessCpuPercent.erase(p.ProcessId);
+			m_ProcessMemory.erase(p.ProcessId);
+		}
+	}
+
+	// The previous snapshot's storage goes back to the worker for reuse.
+	m_Processes.swap(snapshot->Processes);
+	m_SearchIndexValid = false;
+
+	m_CollectedFields = snapshot->Fields;
+	m_FieldCosts.Update(snapshot->Timings, snapshot->TimedFields);
+	// From the fields' costs when last collected, so only an estimate.
+	double skippedMs = m_FieldCosts.GetMicroseconds(ProcessFieldAll & ~snapshot->Fields, m_Processes.size()) / 1000.0;
+
+	// The worker refreshed this buffer's services; the previous ones go back
+	// with it to be diffed against next time.
+	std::swap(m_ServiceSnapshot, snapshot->Services);
+	m_ServicesCollected = snapshot->ServicesCollected;
+	std::swap(m_ProcessGrouping, snapshot->Grouping);
+
+	CalculateCpuUsage();
+	UpdateMemoryUsage();
+	ApplySortOrder();
+	UpdateProcessList();
+
+	m_SnapshotWorker.Release(snapshot);
+	RefreshLatency latency = m_SnapshotWorker.GetLatency();
+
+	m_RefreshScheduler.OnRefreshCompleted(GetTickCount64(), GetOwnCpuTimeMs());
+	ScheduleRefresh();
+
+	std::wostringstream oss;
+	if (m_FilterText.empty()) {
+		oss << L"Processes: " << m_Processes.size();
+	} else {
+		oss << L"Processes: " << m_FilteredRows.size() << L" (filtered from " << m_Processes.size() << L")";
+	}
+	oss << L" | Refresh: " << static_cast<int>(latency.LastMilliseconds + 0.5) << L" ms";
+	if (skippedMs >= 1.0) {
+		oss << L" (about " << static_cast<int>(skippedMs + 0.5) << L" ms saved on hidden fields)";
+	}
+	if (m_AutoRefresh && m_RefreshScheduler.IsBudgetLimited(GetTickCount64())) {
+		oss << L", every " << (m_RefreshScheduler.GetInterval(GetTickCount64()) / 1000) << L" s to stay within the CPU budget";
+	}
+	// The index is only touched again after a new search request.
+	bool objectSearchReady = m_ObjectQueryPending && m_ObjectSearchReady.exchange(false);
+	if (m_ObjectQueryPending && !objectSearchReady) {
+		oss << L" | Indexing handles and modules...";
+	}
+	if (m_hStatusBar) {
+		std::wstring statusText = oss.str();
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(statusText.c_str()));
+	}
+
+	if (objectSearchReady) {
+		m_ObjectQueryPending = false;
+		ShowObjectSearchResults();
+	}
 }
 
 LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
@@ -1167,7 +1469,13 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
 		case WM_DESTROY:
 			return OnDestroy();
 		case WM_SIZE:
+			if (wParam == SIZE_MINIMIZED || wParam == SIZE_RESTORED || wParam == SIZE_MAXIMIZED) {
+				ScheduleRefresh();
+			}
 			return OnSize();
+		case WM_ACTIVATE:
+			ScheduleRefresh();
+			return DefWindowProc(m_hWnd, uMsg, wParam, lParam);
 		case WM_COMMAND:
 			return OnCommand(wParam, lParam);
 		case WM_NOTIFY:
@@ -1185,69 +1493,35 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
 			}
 			return DefWindowProc(m_hWnd, uMsg, wParam, lParam);
 		case WM_USER + 1:
-			{
-				std::vector<ProcessInfo>* processes = reinterpret_cast<std::vector<ProcessInfo>*>(lParam);
-				if (processes) {
-					std::unordered_set<DWORD> oldPids;
-					for (const auto& p : m_Processes) {
-						oldPids.insert(p.ProcessId);
-					}
-					
-					std::unordered_set<DWORD> newPids;
-					for (const auto& p : *processes) {
-						newPids.insert(p.ProcessId);
-					}
-					
-					for (DWORD pid : oldPids) {
-						if (newPids.find(pid) == newPids.end()) {
-							m_SystemProcessCache.erase(pid);
-							m_ProcessCpuTime.erase(pid);
-							m_ProcessCpuPercent.erase(pid);
-							m_ProcessMemory.erase(pid);
-						}
-					}
-					
-					m_Processes = std::move(*processes);
-					delete processes;
-					
-					CalculateCpuUsage();
-					UpdateMemoryUsage();
-					UpdateProcessList();
-					
-					std::wostringstream oss;
-					if (m_FilterText.empty()) {
-						oss << L"Processes: " << m_Processes.size();
-					} else {
-						oss << L"Processes: " << m_FilteredProcesses.size() << L" (filtered from " << m_Processes.size() << L")";
-					}
-					if (m_hStatusBar) {
-						std::wstring statusText = oss.str();
-						SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(statusText.c_str()));
-					}
-					m_IsRefreshing = false;
-				}
-			}
+			OnSnapshotReady();
+			return 0;
+		case WM_USER + 2:
+			OnIconsLoaded();
+			return 0;
+		case WM_USER + 3:
+			OnDumpProgress(static_cast<int>(wParam));
+			return 0;
+		case WM_USER + 4:
+			OnDumpFinished();
+			return 0;
+		case WM_USER + 5:
+			OnSignatureScanProgress(static_cast<int>(wParam));
+			return 0;
+		case WM_USER + 6:
+			OnSignatureScanFinished();
+			return 0;
+		case WM_USER + 7:
+			OnDuplicatePagesFinished();
+			return 0;
+		case WM_USER + 8:
+			OnMinidumpJobFinished();
 			return 0;
 		default:
 			return DefWindowProc(m_hWnd, uMsg, wParam, lParam);
 	}
 }
 
-std::wstring MainWindow::GetProcessImagePath(DWORD processId) {
-	HandleWrapper hProcess = m_ProcessManager.OpenProcess(processId, PROCESS_QUERY_INFORMATION | PROCESS_VM_READ);
-	if (!hProcess.IsValid()) {
-		return L"";
-	}
-
-	WCHAR imagePath[MAX_PATH] = {};
-	DWORD pathLen = MAX_PATH;
-	if (QueryFullProcessImageNameW(hProcess.Get(), 0, imagePath, &pathLen)) {
-		return std::wstring(imagePath);
-	}
-	return L"";
-}
-
-int MainWindow::GetProcessIconIndex(const std::wstring& imagePath) {
+int MainWindow::GetProcessIconIndex(const std::wstring& imagePath, DWORD processId) {
 	if (imagePath.empty() || !m_hProcessIconList) {
 		return m_DefaultIconIndex;
 	}
@@ -1257,242 +1531,255 @@ int MainWindow::GetProcessIconIndex(const std::wstring& imagePath) {
 		return it->second;
 	}
 
-	SHFILEINFOW sfi = {};
-	DWORD_PTR result = SHGetFileInfoW(
-		imagePath.c_str(),
-		FILE_ATTRIBUTE_NORMAL,
-		&sfi,
-		sizeof(sfi),
-		SHGFI_ICON | SHGFI_SMALLICON
-	);
+	IconPixels pixels;
+	if (!m_IconLoader.Request(imagePath, pixels)) {
+		m_PendingIconRows[imagePath].push_back(processId);
+		return m_DefaultIconIndex;
+	}
 
 	int iconIndex = m_DefaultIconIndex;
-	if (result && sfi.hIcon) {
-		iconIndex = ImageList_AddIcon(m_hProcessIconList, sfi.hIcon);
+	HICON hIcon = IconLoader::CreateIconFromPixels(pixels.Small, pixels.SmallSize);
+	if (hIcon) {
+		iconIndex = ImageList_AddIcon(m_hProcessIconList, hIcon);
 		if (iconIndex >= 0) {
 			m_IconCache[imagePath] = iconIndex;
 		} else {
 			iconIndex = m_DefaultIconIndex;
 		}
-		DestroyIcon(sfi.hIcon);
+		DestroyIcon(hIcon);
 	}
 
 	return iconIndex;
 }
 
-void MainWindow::BuildProcessHierarchy() {
-	m_ProcessChildren.clear();
-	m_ProcessDepth.clear();
-	std::unordered_map<DWORD, const ProcessInfo*> processMap;
-	std::unordered_set<DWORD> rootProcessSet;
-	std::vector<const ProcessInfo*> rootProcesses;
-	
-	for (const auto& proc : m_Processes) {
-		processMap[proc.ProcessId] = &proc;
+void MainWindow::OnIconsLoaded() {
+	if (!m_hProcessIconList) {
+		return;
 	}
-	
-	for (const auto& proc : m_Processes) {
-		if (proc.ParentProcessId == 0 || proc.ParentProcessId == proc.ProcessId) {
-			if (rootProcessSet.find(proc.ProcessId) == rootProcessSet.end()) {
-				rootProcessSet.insert(proc.ProcessId);
-				rootProcesses.push_back(&proc);
-			}
-		} else {
-			auto parentIt = processMap.find(proc.ParentProcessId);
-			if (parentIt != processMap.end()) {
-				m_ProcessChildren[proc.ParentProcessId].push_back(proc.ProcessId);
-			} else {
-				if (rootProcessSet.find(proc.ProcessId) == rootProcessSet.end()) {
-					rootProcessSet.insert(proc.ProcessId);
-					rootProcesses.push_back(&proc);
-				}
+
+	for (const auto& pixels : m_IconLoader.TakeResults()) {
+		if (m_IconCache.find(pixels.Path) != m_IconCache.end()) {
+			continue;
+		}
+
+		HICON hIcon = IconLoader::CreateIconFromPixels(pixels.Small, pixels.SmallSize);
+		if (!hIcon) {
+			continue;
+		}
+		int iconIndex = ImageList_AddIcon(m_hProcessIconList, hIcon);
+		DestroyIcon(hIcon);
+		if (iconIndex < 0) {
+			continue;
+		}
+		m_IconCache[pixels.Path] = iconIndex;
+
+		auto pending = m_PendingIconRows.find(pixels.Path);
+		if (pending == m_PendingIconRows.end()) {
+			continue;
+		}
+		for (DWORD processId : pending->second) {
+			LVFINDINFOW findInfo = {};
+			findInfo.flags = LVFI_PARAM;
+			findInfo.lParam = processId;
+			int item = ListView_FindItem(m_hProcessListView, -1, &findInfo);
+			if (item < 0) {
+				continue;
 			}
+
+			LVITEMW lvi = {};
+			lvi.mask = LVIF_IMAGE;
+			lvi.iItem = item;
+			lvi.iImage = iconIndex;
+			ListView_SetItem(m_hProcessListView, &lvi);
 		}
+		m_PendingIconRows.erase(pending);
 	}
-	
-	std::unordered_set<DWORD> visibleProcesses;
-	std::unordered_set<DWORD> processedProcesses;
-	
-	auto markVisible = [&](DWORD pid) {
-		DWORD currentPid = pid;
-		while (currentPid != 0 && processedProcesses.find(currentPid) == processedProcesses.end()) {
-			if (processMap.find(currentPid) != processMap.end()) {
-				visibleProcesses.insert(currentPid);
-				processedProcesses.insert(currentPid);
-				const ProcessInfo* proc = processMap[currentPid];
-				currentPid = proc->ParentProcessId;
-				if (currentPid == proc->ProcessId) break;
-			} else {
-				break;
-			}
+}
+
+void MainWindow::BuildProcessHierarchy() {
+	std::vector<size_t> groupLeaders;
+	if (m_GroupKind != WinProcessInspector::Core::ProcessGroupKind::None && IsGroupingCollected()) {
+		// The grouping's rows are in snapshot order, the list's are sorted.
+		std::unordered_map<DWORD, size_t> rowsById;
+		rowsById.reserve(m_Processes.size());
+		for (size_t row = 0; row < m_Processes.size(); ++row) {
+			rowsById[m_Processes[row].ProcessId] = row;
 		}
-	};
-	
-	auto markDescendants = [&](DWORD pid) {
-		std::function<void(DWORD)> markChildren = [&](DWORD parentPid) {
-			auto it = m_ProcessChildren.find(parentPid);
-			if (it != m_ProcessChildren.end()) {
-				for (DWORD childPid : it->second) {
-					if (visibleProcesses.find(childPid) == visibleProcesses.end()) {
-						visibleProcesses.insert(childPid);
-						markChildren(childPid);
-					}
-				}
+		std::vector<size_t> leaders = m_ProcessGrouping.GetGroupLeaders(m_GroupKind);
+		groupLeaders.assign(m_Processes.size(), static_cast<size_t>(-1));
+		for (size_t row = 0; row < leaders.size(); ++row) {
+			if (leaders[row] == static_cast<size_t>(-1)) {
+				continue;
 			}
-		};
-		markChildren(pid);
-	};
-	
+			auto member = rowsById.find(m_ProcessGrouping.GetAttributes(row).ProcessId);
+			auto leader = rowsById.find(m_ProcessGrouping.GetAttributes(leaders[row]).ProcessId);
+			if (member != rowsById.end() && leader != rowsById.end()) {
+				groupLeaders[member->second] = leader->second;
+			}
+		}
+	}
+
+	if (m_ProcessTree.Update(m_Processes, groupLeaders)) {
+		m_ProcessTreeMetricsValid = false;
+	}
+	UpdateProcessTreeMetrics();
+
+	const size_t count = m_ProcessTree.GetNodeCount();
+	std::vector<bool> visible(count, m_FilterText.empty());
+
 	if (!m_FilterText.empty()) {
-		std::wstring filterLower = m_FilterText;
-		std::transform(filterLower.begin(), filterLower.end(), filterLower.begin(), ::towlower);
-		
-		for (const auto& proc : m_Processes) {
-			std::wstring nameW(proc.ProcessName.begin(), proc.ProcessName.end());
-			std::transform(nameW.begin(), nameW.end(), nameW.begin(), ::towlower);
-			
-			bool matches = false;
-			if (nameW.find(filterLower) != std::wstring::npos) {
-				matches = true;
-			} else {
-				std::wostringstream pidStr;
-				pidStr << proc.ProcessId;
-				if (pidStr.str().find(filterLower) != std::wstring::npos) {
-					matches = true;
-				} else {
-					std::wstring imagePath = GetProcessImagePath(proc.ProcessId);
-					if (!imagePath.empty()) {
-						std::transform(imagePath.begin(), imagePath.end(), imagePath.begin(), ::towlower);
-						if (imagePath.find(filterLower) != std::wstring::npos) {
-							matches = true;
-						}
-					}
-				}
+		RebuildSearchIndex();
+
+		// A match shows its ancestors and its whole subtree. Subtrees are
+		// contiguous in the preorder, so they are marked as ranges and
+		// resolved with one running sum.
+		const std::vector<size_t>& preorder = m_ProcessTree.GetPreorder();
+		std::vector<int> rangeDelta(count + 1, 0);
+		for (size_t row : m_SearchIndex.FindRows(m_FilterText)) {
+			size_t first = m_ProcessTree.GetPreorderIndex(row);
+			++rangeDelta[first];
+			--rangeDelta[first + m_ProcessTree.GetSubtreeSize(row)];
+
+			for (size_t node = m_ProcessTree.GetParent(row);
+				node != WinProcessInspector::Core::ProcessTree::NoNode && !visible[node];
+				node = m_ProcessTree.GetParent(node)) {
+				visible[node] = true;
 			}
-			
-			if (matches) {
-				markVisible(proc.ProcessId);
-				markDescendants(proc.ProcessId);
+		}
+
+		int covered = 0;
+		for (size_t pos = 0; pos < count; ++pos) {
+			covered += rangeDelta[pos];
+			if (covered > 0) {
+				visible[preorder[pos]] = true;
 			}
 		}
-	} else {
-		for (const auto& proc : m_Processes) {
-			visibleProcesses.insert(proc.ProcessId);
+	}
+
+	m_FilteredRows.clear();
+
+	std::vector<size_t> stack;
+	const std::vector<size_t>& roots = m_ProcessTree.GetRoots();
+	for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+		stack.push_back(*root);
+	}
+
+	while (!stack.empty()) {
+		size_t node = stack.back();
+		stack.pop_back();
+		if (!visible[node]) {
+			continue;
+		}
+
+		m_FilteredRows.push_back(node);
+
+		if (m_ProcessTree.GetDepth(node) == 0 || IsProcessExpanded(m_ProcessTree.GetProcessId(node))) {
+			for (size_t i = m_ProcessTree.GetChildCount(node); i > 0; --i) {
+				stack.push_back(m_ProcessTree.GetChild(node, i - 1));
+			}
 		}
 	}
-	
-	m_FilteredProcesses.clear();
-	std::unordered_set<DWORD> addedProcesses;
-	
-	std::function<void(const ProcessInfo*, int)> addProcess = [&](const ProcessInfo* proc, int depth) {
-		if (!proc) return;
-		
-		if (addedProcesses.find(proc->ProcessId) != addedProcesses.end()) {
-			return;
+}
+
+bool MainWindow::IsProcessExpanded(DWORD processId) const {
+	auto it = m_ExpandedProcesses.find(processId);
+	return it != m_ExpandedProcesses.end() && it->second;
+}
+
+void MainWindow::UpdateProcessTreeMetrics() {
+	for (size_t node = 0; node < m_ProcessTree.GetNodeCount(); ++node) {
+		const ProcessInfo& proc = m_Processes[node];
+		WinProcessInspector::Core::ProcessTreeMetrics metrics;
+		metrics.CpuPercent = GetCpuUsage(proc.ProcessId);
+		metrics.HandleCount = proc.HandleCount;
+		auto memIt = m_ProcessMemory.find(proc.ProcessId);
+		if (memIt != m_ProcessMemory.end()) {
+			metrics.MemoryBytes = memIt->second;
 		}
-		
-		if (visibleProcesses.find(proc->ProcessId) == visibleProcesses.end()) {
-			return;
+		// Totals are patched along the ancestors of each changed process;
+		// after a structural rebuild one bottom-up pass is cheaper.
+		if (m_ProcessTreeMetricsValid) {
+			m_ProcessTree.SetMetrics(node, metrics);
+		} else {
+			m_ProcessTree.InitializeMetrics(node, metrics);
 		}
-		
-		addedProcesses.insert(proc->ProcessId);
-		ProcessInfo procCopy = *proc;
-		m_FilteredProcesses.push_back(procCopy);
-		m_ProcessDepth[proc->ProcessId] = depth;
-		
-		bool isExpanded = (depth == 0) || m_ExpandedProcesses[proc->ProcessId];
-		if (isExpanded) {
-			auto it = m_ProcessChildren.find(proc->ProcessId);
-			if (it != m_ProcessChildren.end()) {
-				std::vector<DWORD> sortedChildren = it->second;
-				std::sort(sortedChildren.begin(), sortedChildren.end());
-				
-				for (DWORD childPid : sortedChildren) {
-					auto childIt = processMap.find(childPid);
-					if (childIt != processMap.end() && childIt->second != nullptr) {
-						addProcess(childIt->second, depth + 1);
-					}
-				}
-			}
+	}
+
+	if (!m_ProcessTreeMetricsValid) {
+		m_ProcessTree.RecomputeSubtreeMetrics();
+		m_ProcessTreeMetricsValid = true;
+	}
+}
+
+void MainWindow::RebuildSearchIndex() {
+	if (m_SearchIndexValid) {
+		return;
+	}
+
+	m_SearchIndex.Clear();
+	m_SearchIndex.Reserve(m_Processes.size(), m_Processes.size() * 128);
+
+	for (const auto& proc : m_Processes) {
+		const std::wstring& imagePath = proc.ImagePath;
+
+		m_SearchIndex.BeginRow();
+		m_SearchIndex.AddField(proc.ProcessName);
+		m_SearchIndex.AddField(std::to_wstring(proc.ProcessId));
+		m_SearchIndex.AddField(proc.UserName);
+		m_SearchIndex.AddField(m_ServiceSnapshot.GetServiceNames(proc.ProcessId));
+		if (!imagePath.empty()) {
+			m_SearchIndex.AddField(imagePath);
+			m_SearchIndex.AddField(GetFileDescription(imagePath));
+			m_SearchIndex.AddField(GetFileCompany(imagePath));
 		}
-	};
-	
-	std::sort(rootProcesses.begin(), rootProcesses.end(), 
-		[](const ProcessInfo* a, const ProcessInfo* b) { return a->ProcessId < b->ProcessId; });
-	
-	for (const auto* root : rootProcesses) {
-		addProcess(root, 0);
 	}
+
+	m_SearchIndexValid = true;
 }
 
 void MainWindow::UpdateProcessList() {
 	if (!m_hProcessListView) return;
 
+	UpdateRequiredFields();
+
 	ListView_DeleteAllItems(m_hProcessListView);
+	m_PendingIconRows.clear();
 
 	if (m_TreeViewEnabled) {
 		BuildProcessHierarchy();
 	} else {
-		m_FilteredProcesses.clear();
+		m_FilteredRows.clear();
 		if (m_FilterText.empty()) {
-			m_FilteredProcesses = m_Processes;
-		} else {
-			std::wstring filterLower = m_FilterText;
-			std::transform(filterLower.begin(), filterLower.end(), filterLower.begin(), ::towlower);
-			
-			for (const auto& proc : m_Processes) {
-				std::wstring nameW(proc.ProcessName.begin(), proc.ProcessName.end());
-				std::transform(nameW.begin(), nameW.end(), nameW.begin(), ::towlower);
-				
-				std::wstring pidStr = std::to_wstring(proc.ProcessId);
-				std::transform(pidStr.begin(), pidStr.end(), pidStr.begin(), ::towlower);
-				
-				std::wstring imagePath = GetProcessImagePath(proc.ProcessId);
-				std::wstring desc = imagePath.empty() ? L"" : GetFileDescription(imagePath);
-				std::transform(desc.begin(), desc.end(), desc.begin(), ::towlower);
-				
-				std::wstring company = imagePath.empty() ? L"" : GetFileCompany(imagePath);
-				std::transform(company.begin(), company.end(), company.begin(), ::towlower);
-				
-				std::wstring user = proc.UserName;
-				std::transform(user.begin(), user.end(), user.begin(), ::towlower);
-				
-				if (nameW.find(filterLower) != std::wstring::npos ||
-					pidStr.find(filterLower) != std::wstring::npos ||
-					desc.find(filterLower) != std::wstring::npos ||
-					company.find(filterLower) != std::wstring::npos ||
-					user.find(filterLower) != std::wstring::npos) {
-					m_FilteredProcesses.push_back(proc);
-				}
+			m_FilteredRows.resize(m_Processes.size());
+			for (size_t row = 0; row < m_FilteredRows.size(); ++row) {
+				m_FilteredRows[row] = row;
 			}
+		} else {
+			RebuildSearchIndex();
+			m_FilteredRows = m_SearchIndex.FindRows(m_FilterText);
 		}
 	}
 
-	for (size_t i = 0; i < m_FilteredProcesses.size(); ++i) {
-		const auto& proc = m_FilteredProcesses[i];
+	for (size_t i = 0; i < m_FilteredRows.size(); ++i) {
+		const size_t row = m_FilteredRows[i];
+		const auto& proc = m_Processes[row];
 
-		std::wstring imagePath = GetProcessImagePath(proc.ProcessId);
-		int iconIndex = GetProcessIconIndex(imagePath);
+		const std::wstring& imagePath = proc.ImagePath;
+		int iconIndex = GetProcessIconIndex(imagePath, proc.ProcessId);
 
 		std::wstring nameWStr(proc.ProcessName.begin(), proc.ProcessName.end());
 		std::wstring displayName;
 		
 		if (m_TreeViewEnabled) {
-			int depth = 0;
-			auto depthIt = m_ProcessDepth.find(proc.ProcessId);
-			if (depthIt != m_ProcessDepth.end()) {
-				depth = depthIt->second;
-			}
-			
-			bool hasChildren = m_ProcessChildren.find(proc.ProcessId) != m_ProcessChildren.end() && 
-			                  !m_ProcessChildren[proc.ProcessId].empty();
+			size_t depth = m_ProcessTree.GetDepth(row);
+			bool hasChildren = m_ProcessTree.GetChildCount(row) > 0;
 			
-			for (int d = 0; d < depth; ++d) {
+			for (size_t d = 0; d < depth; ++d) {
 				displayName += L"    ";
 			}
 			
 			if (hasChildren) {
-				displayName += m_ExpandedProcesses[proc.ProcessId] ? L"[-] " : L"[+] ";
+				displayName += IsProcessExpanded(proc.ProcessId) ? L"[-] " : L"[+] ";
 			} else {
 				displayName += L"    ";
 			}
@@ -1547,8 +1834,10 @@ void MainWindow::UpdateProcessList() {
 
 		std::wstring descriptionStr = L"";
 		std::wstring companyStr = L"";
-		if (!imagePath.empty()) {
+		if (!imagePath.empty() && m_ColumnVisible[COL_DESCRIPTION]) {
 			descriptionStr = GetFileDescription(imagePath);
+		}
+		if (!imagePath.empty() && m_ColumnVisible[COL_COMPANY]) {
 			companyStr = GetFileCompany(imagePath);
 		}
 		if (descriptionStr.empty()) descriptionStr = L"N/A";
@@ -1559,9 +1848,79 @@ void MainWindow::UpdateProcessList() {
 		std::wstring imagePathStr = imagePath.empty() ? L"N/A" : imagePath;
 		ListView_SetItemText(m_hProcessListView, i, COL_IMAGEPATH, const_cast<LPWSTR>(imagePathStr.c_str()));
 
-		ListView_SetItemText(m_hProcessListView, i, COL_COMMANDLINE, const_cast<LPWSTR>(L"N/A"));
+		std::wstring commandLineStr = proc.CommandLine.empty() ? L"N/A" : proc.CommandLine;
+		ListView_SetItemText(m_hProcessListView, i, COL_COMMANDLINE, const_cast<LPWSTR>(commandLineStr.c_str()));
 
 		ListView_SetItemText(m_hProcessListView, i, COL_COMPANY, const_cast<LPWSTR>(companyStr.c_str()));
+
+		if (m_ColumnVisible[COL_SERVICES]) {
+			std::wstring servicesStr = m_ServiceSnapshot.GetServiceNames(proc.ProcessId);
+			ListView_SetItemText(m_hProcessListView, i, COL_SERVICES, const_cast<LPWSTR>(servicesStr.c_str()));
+		}
+	}
+
+	// Files first seen by this pass (sort keys, search index and rows) join
+	// the lock-free table in one copy.
+	m_FileMetadata.Publish();
+}
+
+ProcessFieldMask MainWindow::ComputeRequiredFields() const {
+	// Rows are coloured by integrity level whether or not its column is shown.
+	ProcessFieldMask fields = ProcessFieldIntegrity;
+	for (int i = 0; i < COL_COUNT; ++i) {
+		if (m_ColumnVisible[i]) {
+			fields |= ColumnFields[i];
+		}
+	}
+	if (m_SortColumn >= 0 && m_SortColumn < COL_COUNT) {
+		fields |= ColumnFields[m_SortColumn];
+	}
+	if (!m_FilterText.empty()) {
+		// The search index covers the user name.
+		fields |= ProcessFieldUser;
+	}
+	if (m_TreeViewEnabled) {
+		fields |= ProcessFieldHandleCount;
+	}
+	switch (m_GroupKind) {
+		case WinProcessInspector::Core::ProcessGroupKind::Session:
+			fields |= ProcessFieldSession;
+			break;
+		case WinProcessInspector::Core::ProcessGroupKind::User:
+			fields |= ProcessFieldUser;
+			break;
+		case WinProcessInspector::Core::ProcessGroupKind::ServiceGroup:
+			fields |= ProcessFieldCommandLine;
+			break;
+		default:
+			break;
+	}
+	return fields;
+}
+
+bool MainWindow::ComputeServicesRequired() const {
+	// The search index covers service names too.
+	return m_ColumnVisible[COL_SERVICES] || m_SortColumn == COL_SERVICES || !m_FilterText.empty() ||
+		m_GroupKind == WinProcessInspector::Core::ProcessGroupKind::ServiceGroup;
+}
+
+bool MainWindow::IsGroupingCollected() const {
+	return m_ProcessGrouping.GetRowCount() == m_Processes.size() &&
+		(m_GroupKind != WinProcessInspector::Core::ProcessGroupKind::Job || m_ProcessGrouping.HasJobs());
+}
+
+void MainWindow::UpdateRequiredFields() {
+	ProcessFieldMask fields = ComputeRequiredFields();
+	m_RequiredFields = fields;
+	bool services = ComputeServicesRequired();
+	m_ServicesRequired = services;
+	m_GroupingRequired = m_GroupKind;
+	bool grouping = m_GroupKind != WinProcessInspector::Core::ProcessGroupKind::None && !IsGroupingCollected();
+
+	// A newly shown column, sort key or grouping needs data the current
+	// snapshot skipped.
+	if (!m_Processes.empty() && ((fields & ~m_CollectedFields) != ProcessFieldNone || (services && !m_ServicesCollected) || grouping)) {
+		RefreshProcessList();
 	}
 }
 
@@ -1569,57 +1928,76 @@ void MainWindow::SortProcessList(int column, bool ascending) {
 	m_SortColumn = column;
 	m_SortAscending = ascending;
 
-	auto& listToSort = m_FilterText.empty() ? m_Processes : m_FilteredProcesses;
-	std::sort(listToSort.begin(), listToSort.end(), [this, column, ascending](const ProcessInfo& a, const ProcessInfo& b) {
-		bool result = false;
-		switch (column) {
-			case COL_NAME:
-				result = a.ProcessName < b.ProcessName;
-				break;
+	ApplySortOrder();
+	UpdateProcessList();
+}
+
+void MainWindow::ApplySortOrder() {
+	std::vector<DWORD> ids;
+	std::vector<WinProcessInspector::Core::SortKey> keys(m_Processes.size());
+	ids.reserve(m_Processes.size());
+
+	for (size_t i = 0; i < m_Processes.size(); ++i) {
+		const auto& proc = m_Processes[i];
+		auto& key = keys[i];
+		ids.push_back(proc.ProcessId);
+		// Collation keys are only rebuilt for new processes and changed text.
+		ULONGLONG creationTime = (static_cast<ULONGLONG>(proc.CreationTime.dwHighDateTime) << 32) | proc.CreationTime.dwLowDateTime;
+		auto collate = [&](const std::wstring& text) {
+			return m_SortOrder.GetCollationKey(proc.ProcessId, creationTime, text);
+		};
+
+		switch (m_SortColumn) {
 			case COL_PID:
-				result = a.ProcessId < b.ProcessId;
+				key.Number = proc.ProcessId;
 				break;
 			case COL_PPID:
-				result = a.ParentProcessId < b.ParentProcessId;
+				key.Number = proc.ParentProcessId;
 				break;
 			case COL_CPU:
-				{
-					ULONGLONG cpuA = m_ProcessCpuTime.find(a.ProcessId) != m_ProcessCpuTime.end() ? m_ProcessCpuTime[a.ProcessId] : 0;
-					ULONGLONG cpuB = m_ProcessCpuTime.find(b.ProcessId) != m_ProcessCpuTime.end() ? m_ProcessCpuTime[b.ProcessId] : 0;
-					result = cpuA < cpuB;
-				}
+				// Tenths of a percent, the precision shown in the column, so rows
+				// that display the same value keep their order.
+				key.Number = static_cast<ULONGLONG>(GetCpuUsage(proc.ProcessId) * 10.0 + 0.5);
 				break;
 			case COL_MEMORY:
 				{
-					SIZE_T memA = m_ProcessMemory.find(a.ProcessId) != m_ProcessMemory.end() ? m_ProcessMemory[a.ProcessId] : 0;
-					SIZE_T memB = m_ProcessMemory.find(b.ProcessId) != m_ProcessMemory.end() ? m_ProcessMemory[b.ProcessId] : 0;
-					result = memA < memB;
+					auto memIt = m_ProcessMemory.find(proc.ProcessId);
+					key.Number = memIt != m_ProcessMemory.end() ? memIt->second : 0;
 				}
 				break;
 			case COL_SESSION:
-				result = a.SessionId < b.SessionId;
+				key.Number = proc.SessionId;
 				break;
 			case COL_INTEGRITY:
-				result = static_cast<DWORD>(a.IntegrityLevel) < static_cast<DWORD>(b.IntegrityLevel);
+				key.Number = static_cast<DWORD>(proc.IntegrityLevel);
 				break;
 			case COL_USER:
-				result = a.UserName < b.UserName;
+				key.Collation = collate(proc.UserName);
 				break;
 			case COL_ARCHITECTURE:
-				result = a.Architecture < b.Architecture;
+				key.Collation = collate(std::wstring(proc.Architecture.begin(), proc.Architecture.end()));
 				break;
-			case COL_DESCRIPTION:
-			case COL_IMAGEPATH:
-				result = a.ProcessName < b.ProcessName;
+			case COL_COMMANDLINE:
+				key.Collation = collate(proc.CommandLine);
+				break;
+			case COL_SERVICES:
+				key.Collation = collate(m_ServiceSnapshot.GetServiceNames(proc.ProcessId));
 				break;
 			default:
-				result = a.ProcessName < b.ProcessName;
+				key.Collation = collate(std::wstring(proc.ProcessName.begin(), proc.ProcessName.end()));
 				break;
 		}
-		return ascending ? result : !result;
-	});
+	}
 
-	UpdateProcessList();
+	const std::vector<size_t>& order = m_SortOrder.Update(ids, keys, m_SortColumn, m_SortAscending);
+
+	std::vector<ProcessInfo> sorted;
+	sorted.reserve(order.size());
+	for (size_t index : order) {
+		sorted.push_back(std::move(m_Processes[index]));
+	}
+	m_Processes = std::move(sorted);
+	m_SearchIndexValid = false;
 }
 
 void MainWindow::OnProcessListDoubleClick() {
@@ -1642,22 +2020,39 @@ void MainWindow::OnProcessListSelectionChanged() {
 		ListView_GetItem(m_hProcessListView, &lvi);
 		m_SelectedProcessId = static_cast<DWORD>(lvi.lParam);
 		
-		auto it = std::find_if(m_FilteredProcesses.begin(), m_FilteredProcesses.end(),
-			[this](const ProcessInfo& p) { return p.ProcessId == m_SelectedProcessId; });
+		const ProcessInfo* it = sel < static_cast<int>(m_FilteredRows.size()) ? &m_Processes[m_FilteredRows[sel]] : nullptr;
+		if (it && it->ProcessId != m_SelectedProcessId) {
+			it = nullptr;
+		}
 		
-		if (it != m_FilteredProcesses.end() && m_hStatusBar) {
+		if (it && m_hStatusBar) {
+			// These fields are queried for the selected process only.
+			ProcessInfo selected = *it;
+			m_ProcessManager.CollectProcessFields(selected, SelectionFields & ~m_CollectedFields);
+
 			std::wostringstream statusText;
 			statusText << L"PID: " << it->ProcessId
 				<< L" | Threads: " << it->ThreadCount
-				<< L" | Handles: " << it->HandleCount
-				<< L" | GDI: " << it->GdiObjectCount
-				<< L" | USER: " << it->UserObjectCount;
+				<< L" | Handles: " << selected.HandleCount
+				<< L" | GDI: " << selected.GdiObjectCount
+				<< L" | USER: " << selected.UserObjectCount;
 			
-			if (it->DEPEnabled || it->ASLREnabled || it->CFGEnabled) {
+			if (selected.DEPEnabled || selected.ASLREnabled || selected.CFGEnabled) {
 				statusText << L" | Mitigations: ";
-				if (it->DEPEnabled) statusText << L"DEP ";
-				if (it->ASLREnabled) statusText << L"ASLR ";
-				if (it->CFGEnabled) statusText << L"CFG";
+				if (selected.DEPEnabled) statusText << L"DEP ";
+				if (selected.ASLREnabled) statusText << L"ASLR ";
+				if (selected.CFGEnabled) statusText << L"CFG";
+			}
+
+			if (m_TreeViewEnabled) {
+				size_t node = m_FilteredRows[sel];
+				if (m_ProcessTree.GetSubtreeSize(node) > 1) {
+					const auto& subtree = m_ProcessTree.GetSubtreeMetrics(node);
+					statusText << L" | Tree: " << subtree.ProcessCount << L" processes, "
+						<< std::fixed << std::setprecision(1) << subtree.CpuPercent << L"% CPU, "
+						<< (subtree.MemoryBytes / 1024) << L" K, "
+						<< subtree.HandleCount << L" handles";
+				}
 			}
 			
 			SendMessageW(m_hStatusBar, SB_SETTEXT, 0, reinterpret_cast<LPARAM>(statusText.str().c_str()));
@@ -1666,6 +2061,7 @@ void MainWindow::OnProcessListSelectionChanged() {
 		m_SelectedProcessId = 0;
 	}
 	UpdateProcessMenuState();
+	ScheduleRefresh();
 }
 
 void MainWindow::ShowProcessContextMenu(int x, int y) {
@@ -1702,9 +2098,6 @@ void MainWindow::OnFileExport() {
 	
 	BuildProcessHierarchy();
 	
-	const auto& processesToExport = m_FilterText.empty() ? m_Processes : m_FilteredProcesses;
-
-	
 	OPENFILENAMEW ofn = {};
 	wchar_t szFile[260] = {};
 	wcscpy_s(szFile, L"processes.csv");
@@ -1732,6 +2125,25 @@ void MainWindow::OnFileExport() {
 		std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
 	}
 
+	// Fields the list did not need are queried for the exported rows only.
+	ProcessFieldMask missingFields = ExportFields & ~m_CollectedFields;
+	bool copyRows = !m_FilterText.empty() || missingFields != ProcessFieldNone;
+	std::vector<ProcessInfo> exportedProcesses;
+	if (copyRows) {
+		if (m_FilterText.empty()) {
+			exportedProcesses = m_Processes;
+		} else {
+			exportedProcesses.reserve(m_FilteredRows.size());
+			for (size_t row : m_FilteredRows) {
+				exportedProcesses.push_back(m_Processes[row]);
+			}
+		}
+		for (auto& proc : exportedProcesses) {
+			m_ProcessManager.CollectProcessFields(proc, missingFields);
+		}
+	}
+	const auto& processesToExport = copyRows ? exportedProcesses : m_Processes;
+
 	bool success = false;
 	if (extension == L"csv") {
 		success = ExportToCSV(filePath, processesToExport);
@@ -1764,26 +2176,6 @@ void MainWindow::OnFileExport() {
 	}
 }
 
-static std::wstring Utf8ToWide(const std::string& utf8) {
-	if (utf8.empty()) return L"";
-	int sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, nullptr, 0);
-	if (sizeNeeded <= 0) return L"";
-	std::wstring result(sizeNeeded, 0);
-	MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), -1, &result[0], sizeNeeded);
-	result.pop_back();
-	return result;
-}
-
-static std::string WideToUtf8(const std::wstring& wide) {
-	if (wide.empty()) return "";
-	int sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, nullptr, 0, nullptr, nullptr);
-	if (sizeNeeded <= 0) return "";
-	std::string result(sizeNeeded, 0);
-	WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, &result[0], sizeNeeded, nullptr, nullptr);
-	result.pop_back();
-	return result;
-}
-
 bool MainWindow::ExportToCSV(const std::wstring& filePath, const std::vector<WinProcessInspector::Core::ProcessInfo>& processes) {
 	if (processes.empty()) {
 		return false;
@@ -1812,13 +2204,14 @@ bool MainWindow::ExportToCSV(const std::wstring& filePath, const std::vector<Win
 	for (const auto& proc : processes) {
 		try {
 			std::string name = proc.ProcessName;
-			std::string user = WideToUtf8(proc.UserName.empty() ? L"N/A" : proc.UserName);
-			std::string integrity = WideToUtf8(FormatIntegrityLevel(proc.IntegrityLevel));
+			std::string user = StringConversion::ToUtf8(proc.UserName.empty() ? L"N/A" : proc.UserName);
+			std::string integrity = StringConversion::ToUtf8(FormatIntegrityLevel(proc.IntegrityLevel));
 			std::string arch = proc.Architecture;
 			
-			std::wstring imagePathW = GetProcessImagePath(proc.ProcessId);
-			std::string imagePath = WideToUtf8(imagePathW.empty() ? L"N/A" : imagePathW);
-			std::string description = "N/A";
+			const std::wstring& imagePathW = proc.ImagePath;
+			std::string imagePath = StringConversion::ToUtf8(imagePathW.empty() ? L"N/A" : imagePathW);
+			std::wstring descriptionW = imagePathW.empty() ? std::wstring() : m_FileMetadata.Get(imagePathW)->FileDescription;
+			std::string description = StringConversion::ToUtf8(descriptionW.empty() ? L"N/A" : descriptionW);
 			
 			double cpuUsage = 0.0;
 			try {
@@ -1833,7 +2226,7 @@ bool MainWindow::ExportToCSV(const std::wstring& filePath, const std::vector<Win
 				memory = memIt->second;
 			}
 
-			std::string priorityStr = WideToUtf8(m_ProcessManager.GetPriorityClassString(proc.PriorityClass));
+			std::string priorityStr = StringConversion::ToUtf8(m_ProcessManager.GetPriorityClassString(proc.PriorityClass));
 			std::ostringstream affinityStr;
 			affinityStr << "0x" << std::hex << proc.AffinityMask;
 			
@@ -1871,6 +2264,11 @@ bool MainWindow::ExportToJSON(const std::wstring& filePath, const std::vector<Wi
 		return false;
 	}
 
+	// Per-type handle counts come from one system-wide capture.
+	HandleSnapshot handleSnapshot;
+	bool haveHandles = handleSnapshot.Capture();
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+
 	fprintf(file, "{\n  \"processes\": [\n");
 
 	auto escapeJSON = [](const std::string& str) -> std::string {
@@ -1890,13 +2288,14 @@ bool MainWindow::ExportToJSON(const std::wstring& filePath, const std::vector<Wi
 		const auto& proc = processes[i];
 		try {
 			std::string name = proc.ProcessName;
-			std::string user = WideToUtf8(proc.UserName.empty() ? L"N/A" : proc.UserName);
-			std::string integrity = WideToUtf8(FormatIntegrityLevel(proc.IntegrityLevel));
+			std::string user = StringConversion::ToUtf8(proc.UserName.empty() ? L"N/A" : proc.UserName);
+			std::string integrity = StringConversion::ToUtf8(FormatIntegrityLevel(proc.IntegrityLevel));
 			std::string arch = proc.Architecture;
 			
-			std::wstring imagePathW = GetProcessImagePath(proc.ProcessId);
-			std::string imagePath = WideToUtf8(imagePathW.empty() ? L"N/A" : imagePathW);
-			std::string description = "N/A";
+			const std::wstring& imagePathW = proc.ImagePath;
+			std::string imagePath = StringConversion::ToUtf8(imagePathW.empty() ? L"N/A" : imagePathW);
+			std::wstring descriptionW = imagePathW.empty() ? std::wstring() : m_FileMetadata.Get(imagePathW)->FileDescription;
+			std::string description = StringConversion::ToUtf8(descriptionW.empty() ? L"N/A" : descriptionW);
 			
 			double cpuUsage = 0.0;
 			try {
@@ -1918,7 +2317,7 @@ bool MainWindow::ExportToJSON(const std::wstring& filePath, const std::vector<Wi
 			fprintf(file, "      \"cpuUsage\": %.2f,\n", cpuUsage);
 			fprintf(file, "      \"memory\": %llu,\n", static_cast<unsigned long long>(memory));
 			fprintf(file, "      \"sessionId\": %u,\n", proc.SessionId);
-			std::string priorityStr = WideToUtf8(m_ProcessManager.GetPriorityClassString(proc.PriorityClass));
+			std::string priorityStr = StringConversion::ToUtf8(m_ProcessManager.GetPriorityClassString(proc.PriorityClass));
 			std::ostringstream affinityStr;
 			affinityStr << "0x" << std::hex << proc.AffinityMask;
 			
@@ -1928,6 +2327,22 @@ bool MainWindow::ExportToJSON(const std::wstring& filePath, const std::vector<Wi
 			fprintf(file, "      \"priority\": \"%s\",\n", escapeJSON(priorityStr).c_str());
 			fprintf(file, "      \"affinity\": \"%s\",\n", escapeJSON(affinityStr.str()).c_str());
 			fprintf(file, "      \"description\": \"%s\",\n", escapeJSON(description).c_str());
+			if (haveHandles) {
+				size_t handleCount = 0;
+				const HandleEntry* handles = handleSnapshot.GetProcessHandles(proc.ProcessId, handleCount);
+				std::vector<size_t> counts = types.CountHandles(handles, handleCount);
+				fprintf(file, "      \"handlesByType\": {");
+				bool first = true;
+				for (size_t index = 0; index < counts.size(); ++index) {
+					if (counts[index] == 0) {
+						continue;
+					}
+					std::string typeName = StringConversion::ToUtf8(types.GetName(static_cast<WORD>(index)));
+					fprintf(file, "%s\"%s\": %zu", first ? "" : ", ", escapeJSON(typeName).c_str(), counts[index]);
+					first = false;
+				}
+				fprintf(file, "},\n");
+			}
 			fprintf(file, "      \"imagePath\": \"%s\"\n", escapeJSON(imagePath).c_str());
 			fprintf(file, "    }%s\n", (i < processes.size() - 1) ? "," : "");
 		} catch (...) {
@@ -1958,13 +2373,16 @@ bool MainWindow::ExportToText(const std::wstring& filePath, const std::vector<Wi
 	fwprintf(file, L"%s\n", std::wstring(150, L'-').c_str());
 
 	for (const auto& proc : processes) {
-		std::wstring name = Utf8ToWide(proc.ProcessName);
+		std::wstring name = StringConversion::FromUtf8(proc.ProcessName);
 		std::wstring user = proc.UserName.empty() ? L"N/A" : proc.UserName;
 		std::wstring integrity = FormatIntegrityLevel(proc.IntegrityLevel);
-		std::wstring arch = Utf8ToWide(proc.Architecture);
+		std::wstring arch = StringConversion::FromUtf8(proc.Architecture);
 		
-		std::wstring imagePath = GetProcessImagePath(proc.ProcessId);
-		std::wstring description = L"N/A";
+		const std::wstring& imagePath = proc.ImagePath;
+		std::wstring description = imagePath.empty() ? std::wstring() : m_FileMetadata.Get(imagePath)->FileDescription;
+		if (description.empty()) {
+			description = L"N/A";
+		}
 		
 		double cpuUsage = GetCpuUsage(proc.ProcessId);
 		SIZE_T memory = 0;
@@ -2007,7 +2425,7 @@ void MainWindow::OnViewAutoRefresh() {
 	}
 
 	if (m_AutoRefresh) {
-		m_RefreshTimerId = SetTimer(m_hWnd, IDT_REFRESH_TIMER, 2000, nullptr);
+		ScheduleRefresh();
 	} else {
 		if (m_RefreshTimerId) {
 			KillTimer(m_hWnd, m_RefreshTimerId);
@@ -2026,13 +2444,32 @@ void MainWindow::OnViewTreeView() {
 	
 	if (!m_TreeViewEnabled) {
 		m_ExpandedProcesses.clear();
-		m_ProcessChildren.clear();
-		m_ProcessDepth.clear();
+		m_ProcessTree.Clear();
 	}
 	
 	UpdateProcessList();
 }
 
+void MainWindow::OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind kind) {
+	m_GroupKind = kind;
+
+	if (m_hGroupByMenu) {
+		UINT checkedId = IDM_VIEW_GROUP_NONE + static_cast<UINT>(kind);
+		CheckMenuRadioItem(m_hGroupByMenu, IDM_VIEW_GROUP_NONE, IDM_VIEW_GROUP_SERVICE, checkedId, MF_BYCOMMAND);
+	}
+
+	if (kind == WinProcessInspector::Core::ProcessGroupKind::None) {
+		m_ProcessGrouping.Clear();
+	}
+
+	if (!m_TreeViewEnabled && kind != WinProcessInspector::Core::ProcessGroupKind::None) {
+		OnViewTreeView();
+		return;
+	}
+
+	UpdateProcessList();
+}
+
 void MainWindow::OnViewToolbar() {
 	m_ToolbarVisible = !m_ToolbarVisible;
 
@@ -2092,7 +2529,8 @@ INT_PTR CALLBACK ColumnChooserDialogProc(HWND hDlg, UINT uMsg, WPARAM wParam, LP
 			{ IDC_COLUMN_DESCRIPTION, COL_DESCRIPTION },
 			{ IDC_COLUMN_IMAGEPATH, COL_IMAGEPATH },
 			{ IDC_COLUMN_COMMANDLINE, COL_COMMANDLINE },
-			{ IDC_COLUMN_COMPANY, COL_COMPANY }
+			{ IDC_COLUMN_COMPANY, COL_COMPANY },
+			{ IDC_COLUMN_SERVICES, COL_SERVICES }
 		};
 		
 		std::vector<bool>& columnVisible = pMainWindow->GetColumnVisible();
@@ -2138,7 +2576,8 @@ INT_PTR CALLBACK ColumnChooserDialogProc(HWND hDlg, UINT uMsg, WPARAM wParam, LP
 					{ IDC_COLUMN_DESCRIPTION, COL_DESCRIPTION },
 					{ IDC_COLUMN_IMAGEPATH, COL_IMAGEPATH },
 					{ IDC_COLUMN_COMMANDLINE, COL_COMMANDLINE },
-					{ IDC_COLUMN_COMPANY, COL_COMPANY }
+					{ IDC_COLUMN_COMPANY, COL_COMPANY },
+					{ IDC_COLUMN_SERVICES, COL_SERVICES }
 				};
 				
 				std::vector<bool>& columnVisible = pMainWindow->GetColumnVisible();
@@ -2183,6 +2622,8 @@ void MainWindow::UpdateColumnVisibility() {
 			ListView_SetColumnWidth(m_hProcessListView, i, 0);
 		}
 	}
+
+	UpdateProcessList();
 }
 
 void MainWindow::OnHelpAbout() {
@@ -2661,7 +3102,27 @@ void MainWindow::SetProcessAffinity(DWORD processId) {
 	}
 }
 
+bool MainWindow::OfferToCancelDumpJob(const wchar_t* caption) {
+	if (!m_DumpThread.joinable()) {
+		return false;
+	}
+	std::wostringstream oss;
+	if (m_DumpVerifying) {
+		oss << L"The compressed dump " << m_DumpPath << L" is being checked (" << m_DumpPercent << L"%).\n\nCancel it?";
+	} else {
+		oss << L"A compressed dump of process " << m_DumpProcessId << L" is being written (" << m_DumpPercent << L"%).\n\nCancel it?";
+	}
+	if (MessageBoxW(m_hWnd, oss.str().c_str(), caption, MB_YESNO | MB_ICONQUESTION) == IDYES) {
+		m_DumpCancelled = true;
+	}
+	return true;
+}
+
 void MainWindow::CreateProcessDump(DWORD processId) {
+	if (OfferToCancelDumpJob(L"Create Dump")) {
+		return;
+	}
+
 	std::wstring errorMsg;
 	if (!ValidateProcess(processId, errorMsg)) {
 		MessageBoxW(m_hWnd, errorMsg.c_str(), L"Create Dump", MB_OK | MB_ICONERROR);
@@ -2674,7 +3135,7 @@ void MainWindow::CreateProcessDump(DWORD processId) {
 	ofn.hwndOwner = m_hWnd;
 	ofn.lpstrFile = szFile;
 	ofn.nMaxFile = MAX_PATH;
-	ofn.lpstrFilter = L"Dump Files\0*.dmp\0All Files\0*.*\0";
+	ofn.lpstrFilter = L"Dump Files\0*.dmp\0Compressed Memory Dumps\0*.wpdmp\0All Files\0*.*\0";
 	ofn.nFilterIndex = 1;
 	ofn.lpstrDefExt = L"dmp";
 	ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
@@ -2683,6 +3144,11 @@ void MainWindow::CreateProcessDump(DWORD processId) {
 		return;
 	}
 
+	if (ofn.nFilterIndex == 2) {
+		StartCompressedDump(processId, szFile);
+		return;
+	}
+
 	HandleWrapper hProcess = m_ProcessManager.OpenProcess(processId, PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | PROCESS_DUP_HANDLE);
 	if (!hProcess.IsValid()) {
 		MessageBoxW(m_hWnd, L"Failed to open process for dumping.", L"Create Dump", MB_OK | MB_ICONERROR);
@@ -2746,6 +3212,131 @@ void MainWindow::CreateProcessDump(DWORD processId) {
 	}
 }
 
+void MainWindow::StartCompressedDump(DWORD processId, const std::wstring& filePath) {
+	int choice = MessageBoxW(m_hWnd, L"Write only private writable memory, such as heaps and stacks?\n\n"
+		L"Choose No to write all readable memory except mapped images.", L"Create Dump", MB_YESNOCANCEL | MB_ICONQUESTION);
+	if (choice == IDCANCEL) {
+		return;
+	}
+
+	MemoryDumpOptions options;
+	options.ProcessId = processId;
+	options.IncludeImages = false;
+	if (choice == IDYES) {
+		options.IncludeMapped = false;
+		options.WritableOnly = true;
+	}
+
+	auto reader = std::make_unique<ProcessMemoryReader>();
+	if (!reader->Open(processId)) {
+		MessageBoxW(m_hWnd, L"Failed to open process for dumping.", L"Create Dump", MB_OK | MB_ICONERROR);
+		return;
+	}
+	std::vector<MemoryRegionInfo> regions = m_MemoryManager.EnumerateMemoryRegions(processId);
+	if (MemoryDumpWriter::SelectRegions(regions, options).empty()) {
+		MessageBoxW(m_hWnd, L"The process has no readable memory of the chosen kind.", L"Create Dump", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	m_DumpCancelled = false;
+	m_DumpVerifying = false;
+	m_DumpProcessId = processId;
+	m_DumpPath = filePath;
+	m_DumpPercent = 0;
+	OnDumpProgress(0);
+
+	// The window only hears about whole-percent steps, so a large dump does
+	// not flood the message queue.
+	HWND hWnd = m_hWnd;
+	m_DumpThread = std::thread([this, hWnd, filePath, options, reader = std::move(reader), regions = std::move(regions)]() {
+		int lastPercent = 0;
+		m_DumpStatistics = MemoryDumpWriter().Write(filePath, reader->GetReadFunction(), regions, options,
+			[hWnd, &lastPercent](ULONGLONG done, ULONGLONG total) {
+				int percent = total != 0 ? static_cast<int>(done * 100 / total) : 100;
+				if (percent != lastPercent) {
+					lastPercent = percent;
+					PostMessageW(hWnd, WM_USER + 3, static_cast<WPARAM>(percent), 0);
+				}
+			}, &m_DumpCancelled);
+		PostMessageW(hWnd, WM_USER + 4, 0, 0);
+	});
+}
+
+void MainWindow::OnDumpProgress(int percent) {
+	if (!m_DumpThread.joinable() && percent != 0) {
+		return;
+	}
+	m_DumpPercent = percent;
+	if (m_hStatusBar) {
+		std::wostringstream oss;
+		if (m_DumpVerifying) {
+			oss << L"Checking dump " << m_DumpPath << L": " << percent << L"%";
+		} else {
+			oss << L"Writing dump of process " << m_DumpProcessId << L": " << percent << L"%";
+		}
+		std::wstring statusText = oss.str();
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(statusText.c_str()));
+	}
+}
+
+void MainWindow::OnDumpFinished() {
+	if (!m_DumpThread.joinable()) {
+		return;
+	}
+	m_DumpThread.join();
+	const MemoryDumpStatistics& statistics = m_DumpStatistics;
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Ready"));
+	}
+
+	if (m_DumpVerifying) {
+		if (m_DumpCancelled) {
+			MessageBoxW(m_hWnd, L"The check was cancelled.", L"Open Compressed Dump", MB_OK | MB_ICONINFORMATION);
+		} else if (statistics.BadBlocks != 0) {
+			std::wostringstream oss;
+			oss << statistics.BadBlocks << (statistics.BadBlocks == 1 ? L" block" : L" blocks")
+				<< L" of the dump do not match their checksums and read as zeros.";
+			MessageBoxW(m_hWnd, oss.str().c_str(), L"Open Compressed Dump", MB_OK | MB_ICONWARNING);
+		} else {
+			MessageBoxW(m_hWnd, L"Every block of the dump matches its checksum.", L"Open Compressed Dump", MB_OK | MB_ICONINFORMATION);
+		}
+		return;
+	}
+
+	if (statistics.Cancelled) {
+		MessageBoxW(m_hWnd, L"The dump was cancelled.", L"Create Dump", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+	if (!statistics.Completed) {
+		MessageBoxW(m_hWnd, L"Failed to write the dump file.", L"Create Dump", MB_OK | MB_ICONERROR);
+		Logger::GetInstance().LogError("Failed to create compressed dump for process PID " + std::to_string(m_DumpProcessId));
+		return;
+	}
+
+	std::wostringstream oss;
+	oss << L"Process dump created successfully.\n\n";
+	oss << statistics.Regions << L" regions, " << FormatMemorySize(static_cast<SIZE_T>(statistics.BytesRead)) << L" of memory\n";
+	oss << L"Stored in " << FormatMemorySize(static_cast<SIZE_T>(statistics.BytesStored));
+	if (statistics.BytesStored != 0) {
+		oss << std::fixed << std::setprecision(1) << L" (" << static_cast<double>(statistics.BytesRead) / statistics.BytesStored << L":1)";
+	}
+	oss << L"\n";
+	oss << statistics.ZeroBlocks << L" zero and " << statistics.UnreadableBlocks << L" unreadable blocks of " << statistics.Blocks << L"\n";
+	oss << std::fixed << std::setprecision(2) << statistics.Seconds << L" s";
+	bool damaged = statistics.Verified && statistics.BadBlocks != 0;
+	if (statistics.Verified) {
+		oss << L"\n\n";
+		if (damaged) {
+			oss << L"Reading the dump back found " << statistics.BadBlocks << (statistics.BadBlocks == 1 ? L" block" : L" blocks")
+				<< L" that do not match the memory that was read.";
+		} else {
+			oss << L"The dump was read back and matches the memory that was read.";
+		}
+	}
+	MessageBoxW(m_hWnd, oss.str().c_str(), L"Create Dump", MB_OK | (damaged ? MB_ICONWARNING : MB_ICONINFORMATION));
+	Logger::GetInstance().LogInfo("Created compressed dump for process PID " + std::to_string(m_DumpProcessId));
+}
+
 void MainWindow::OpenProcessFileLocation(DWORD processId) {
 	ProcessInfo info = m_ProcessManager.GetProcessDetails(processId);
 	if (info.ProcessId == 0) {
@@ -3186,7 +3777,8 @@ void MainWindow::ShowSystemInformationWindow() {
 	}
 	message += L"\n";
 	
-	auto processes = m_ProcessManager.EnumerateAllProcesses();
+	std::vector<ProcessInfo> processes;
+	m_ProcessManager.EnumerateAllProcesses(processes, nullptr, ProcessFieldHandleCount);
 	DWORD totalThreads = 0;
 	DWORD totalHandles = 0;
 	SIZE_T totalMemory = 0;
@@ -3205,107 +3797,972 @@ void MainWindow::ShowSystemInformationWindow() {
 	message += L"  Total Threads: " + std::to_wstring(totalThreads) + L"\n";
 	message += L"  Total Handles: " + std::to_wstring(totalHandles) + L"\n";
 	message += L"  Total Memory: " + std::to_wstring(totalMemory / 1024 / 1024) + L" MB\n";
+
+	// Counts are read fresh; the shared table only holds them as of startup.
+	ObjectTypeTable objectTypes;
+	if (objectTypes.Load()) {
+		std::vector<const ObjectTypeInfo*> types;
+		for (const auto& type : objectTypes.GetTypes()) {
+			if (!type.Name.empty() && type.TotalHandles > 0) {
+				types.push_back(&type);
+			}
+		}
+		size_t shown = std::min<size_t>(types.size(), 8);
+		std::partial_sort(types.begin(), types.begin() + shown, types.end(), [](const ObjectTypeInfo* a, const ObjectTypeInfo* b) {
+			return a->TotalHandles > b->TotalHandles;
+		});
+
+		message += L"\nHandles by Type (" + std::to_wstring(objectTypes.GetTypeCount()) + L" types):\n";
+		for (size_t i = 0; i < shown; ++i) {
+			message += L"  " + types[i]->Name + L": " + std::to_wstring(types[i]->TotalHandles) + L"\n";
+		}
+	}
 	
 	MessageBoxW(m_hWnd, message.c_str(), L"System Information", MB_OK | MB_ICONINFORMATION);
 }
 
-void MainWindow::GroupSvchostServices(std::unordered_map<DWORD, std::vector<DWORD>>& processChildren) {
-	SC_HANDLE hSCManager = OpenSCManagerW(nullptr, nullptr, SC_MANAGER_ENUMERATE_SERVICE);
-	if (!hSCManager) {
+void MainWindow::ShowFindObjectWindow() {
+	wchar_t input[260] = {};
+	if (!GetInputBox(m_hWnd, L"Find Handle or DLL", L"Handle name or module path contains (\"type:File text\" for one handle type):", input, 260) || wcslen(input) == 0) {
 		return;
 	}
-	
-	DWORD bytesNeeded = 0;
-	DWORD servicesReturned = 0;
-	DWORD resumeHandle = 0;
-	
-	if (EnumServicesStatusExW(hSCManager, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_STATE_ALL, nullptr, 0, &bytesNeeded, &servicesReturned, &resumeHandle, nullptr) || GetLastError() == ERROR_MORE_DATA) {
-		if (bytesNeeded > 0 && bytesNeeded < 100 * 1024 * 1024) {
-			std::vector<BYTE> buffer(bytesNeeded);
-			ENUM_SERVICE_STATUS_PROCESSW* services = reinterpret_cast<ENUM_SERVICE_STATUS_PROCESSW*>(buffer.data());
-			
-			if (EnumServicesStatusExW(hSCManager, SC_ENUM_PROCESS_INFO, SERVICE_WIN32, SERVICE_STATE_ALL, reinterpret_cast<LPBYTE>(services), bytesNeeded, &bytesNeeded, &servicesReturned, &resumeHandle, nullptr)) {
-				for (DWORD i = 0; i < servicesReturned; ++i) {
-					if (services[i].ServiceStatusProcess.dwProcessId != 0) {
-						for (const auto& proc : m_Processes) {
-							std::wstring procName(proc.ProcessName.begin(), proc.ProcessName.end());
-							std::transform(procName.begin(), procName.end(), procName.begin(), ::towlower);
-							
-							if (procName == L"svchost.exe" && proc.ProcessId == services[i].ServiceStatusProcess.dwProcessId) {
-								processChildren[proc.ProcessId].push_back(proc.ProcessId);
-								break;
-							}
+
+	// "type:<name>" first limits the search to handles of that type.
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	std::wstring pattern = input;
+	WORD typeIndex = 0;
+	bool typeFilter = false;
+	if (pattern.size() > 5 && _wcsnicmp(pattern.c_str(), L"type:", 5) == 0) {
+		size_t end = pattern.find(L' ', 5);
+		std::wstring typeName = pattern.substr(5, end == std::wstring::npos ? std::wstring::npos : end - 5);
+		if (!types.Find(typeName, typeIndex)) {
+			MessageBoxW(m_hWnd, (L"Unknown object type \"" + typeName + L"\".").c_str(), L"Find Handle or DLL", MB_OK | MB_ICONERROR);
+			return;
+		}
+		typeFilter = true;
+		pattern = end == std::wstring::npos ? std::wstring() : pattern.substr(end + 1);
+	}
+
+	// The snapshot worker brings the index up to date, which can take
+	// seconds of waiting on handle names, and the results are shown once it
+	// has. A search made while one is pending replaces its query.
+	m_ObjectQueryInput = input;
+	m_ObjectQueryPattern = pattern;
+	m_ObjectQueryTypeIndex = typeIndex;
+	m_ObjectQueryTypeFilter = typeFilter;
+	if (m_ObjectQueryPending) {
+		return;
+	}
+	m_ObjectQueryPending = true;
+	m_ObjectSearchRequested = true;
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Indexing handles and modules..."));
+	}
+	m_SnapshotWorker.Request();
+}
+
+void MainWindow::ShowObjectSearchResults() {
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	auto start = std::chrono::steady_clock::now();
+	size_t totalMatches = 0;
+	auto matches = m_ObjectSearch.Find(m_ObjectQueryPattern, 40, totalMatches, m_ObjectQueryTypeFilter ? &m_ObjectQueryTypeIndex : nullptr);
+	double queryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::unordered_map<DWORD, std::wstring> processNames;
+	for (const auto& proc : m_Processes) {
+		processNames[proc.ProcessId] = std::wstring(proc.ProcessName.begin(), proc.ProcessName.end());
+	}
+
+	std::wostringstream oss;
+	oss << L"\"" << m_ObjectQueryInput << L"\": " << totalMatches << (totalMatches == 1 ? L" match" : L" matches");
+	oss << L" in " << m_ObjectSearch.GetProcessCount() << L" processes (" << std::fixed << std::setprecision(2) << queryMs << L" ms)\n\n";
+
+	for (const auto& match : matches) {
+		auto nameIt = processNames.find(match.ProcessId);
+		oss << (nameIt != processNames.end() ? nameIt->second : L"<unknown>") << L" (" << match.ProcessId << L") ";
+		if (match.Kind == ObjectSearchKind::Module) {
+			oss << L"Module 0x" << std::hex << match.Value << std::dec;
+		} else {
+			oss << types.GetName(match.ObjectTypeIndex) << L" 0x" << std::hex << match.Value << std::dec;
+		}
+		oss << L"\n    " << match.Text << L"\n";
+	}
+	if (totalMatches > matches.size()) {
+		oss << L"\n... and " << (totalMatches - matches.size()) << L" more.";
+	}
+
+	MessageBoxW(m_hWnd, oss.str().c_str(), L"Find Handle or DLL", MB_OK | MB_ICONINFORMATION);
+}
+
+void MainWindow::ShowSignatureScanWindow(bool scanMinidump) {
+	if (m_ScanThread.joinable()) {
+		std::wostringstream oss;
+		oss << L"A signature scan is running (" << m_ScanPercent << L"%).\n\nStop it and show the matches found so far?";
+		if (MessageBoxW(m_hWnd, oss.str().c_str(), L"Signature Scan", MB_YESNO | MB_ICONQUESTION) == IDYES) {
+			m_ScanCancelled = true;
+		}
+		return;
+	}
+	if (scanMinidump && !m_Minidump) {
+		MessageBoxW(m_hWnd, L"Open a minidump first.", L"Signature Scan", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[260] = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hWnd;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = sizeof(szFile) / sizeof(szFile[0]);
+	ofn.lpstrFilter = L"Signature Files\0*.txt;*.sig\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+	if (!GetOpenFileNameW(&ofn)) {
+		return;
+	}
+
+	std::vector<SignaturePattern> patterns;
+	size_t errorLine = 0;
+	if (!SignatureScanner::LoadPatterns(szFile, patterns, &errorLine)) {
+		std::wostringstream oss;
+		if (errorLine != 0) {
+			oss << L"Invalid signature on line " << errorLine << L".\n\nExpected \"name: 48 8B ?? 05\", \"name: \\\"text\\\"\" or \"name: u\\\"text\\\"\".";
+		} else {
+			oss << L"Failed to read the signature file.";
+		}
+		MessageBoxW(m_hWnd, oss.str().c_str(), L"Signature Scan", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	SignatureScanner scanner;
+	if (!scanner.Compile(patterns)) {
+		MessageBoxW(m_hWnd, L"The file has no signatures, or one is only wildcards.", L"Signature Scan", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	// A minidump is scanned as the one process it holds, named after its
+	// file.
+	std::vector<DWORD> processIds;
+	std::shared_ptr<MinidumpFile> dump = scanMinidump ? m_Minidump : nullptr;
+	m_ScanProcessNames.clear();
+	m_ScanMinidumpName.clear();
+	if (dump) {
+		size_t separator = m_MinidumpPath.find_last_of(L"\\/");
+		m_ScanMinidumpName = separator != std::wstring::npos ? m_MinidumpPath.substr(separator + 1) : m_MinidumpPath;
+		m_ScanProcessNames[dump->GetProcessId()] = StringConversion::ToUtf8(m_ScanMinidumpName);
+	} else {
+		for (const auto& proc : m_Processes) {
+			if (proc.ProcessId != 0 && proc.ProcessId != m_CurrentProcessId) {
+				processIds.push_back(proc.ProcessId);
+			}
+			m_ScanProcessNames[proc.ProcessId] = proc.ProcessName;
+		}
+	}
+
+	m_ScanCancelled = false;
+	m_ScanPatterns = patterns;
+	m_ScanMatches.clear();
+	m_ScanPatternCounts.assign(patterns.size(), 0);
+	m_ScanStatistics = SignatureScanStatistics();
+	m_ScanProcesses = 0;
+	m_ScanPercent = 0;
+	OnSignatureScanProgress(0);
+
+	// Progress is counted in processes, and only whole-percent steps are
+	// posted.
+	HWND hWnd = m_hWnd;
+	m_ScanThread = std::thread([this, hWnd, dump, processIds = std::move(processIds), scanner = std::move(scanner)]() {
+		auto scan = [this, &scanner](DWORD processId, const MemoryReadFunction& read, const std::vector<MemoryRegionInfo>& regions) {
+			const size_t maxKeptMatches = 10000;
+			SignatureScanStatistics statistics = scanner.Scan(read, regions, SignatureScanOptions(),
+				[this, processId](std::vector<SignatureMatch>& batch) {
+					for (const auto& match : batch) {
+						++m_ScanPatternCounts[match.PatternIndex];
+						if (m_ScanMatches.size() < maxKeptMatches) {
+							m_ScanMatches.push_back(std::make_pair(processId, match));
 						}
 					}
-				}
+				}, &m_ScanCancelled);
+			m_ScanStatistics.Matches += statistics.Matches;
+			m_ScanStatistics.BytesScanned += statistics.BytesScanned;
+			m_ScanStatistics.Seconds += statistics.Seconds;
+			++m_ScanProcesses;
+		};
+
+		if (dump) {
+			scan(dump->GetProcessId(), dump->GetReadFunction(), dump->GetRegions());
+			PostMessageW(hWnd, WM_USER + 6, 0, 0);
+			return;
+		}
+		int lastPercent = 0;
+		for (size_t i = 0; i < processIds.size() && !m_ScanCancelled; ++i) {
+			DWORD processId = processIds[i];
+			ProcessMemoryReader reader;
+			auto regions = reader.Open(processId) ? m_MemoryManager.EnumerateMemoryRegions(processId) : std::vector<MemoryRegionInfo>();
+			if (!regions.empty()) {
+				scan(processId, reader.GetReadFunction(), regions);
+			}
+			int percent = static_cast<int>((i + 1) * 100 / processIds.size());
+			if (percent != lastPercent) {
+				lastPercent = percent;
+				PostMessageW(hWnd, WM_USER + 5, static_cast<WPARAM>(percent), 0);
 			}
 		}
+		PostMessageW(hWnd, WM_USER + 6, 0, 0);
+	});
+}
+
+void MainWindow::OnSignatureScanProgress(int percent) {
+	if (!m_ScanThread.joinable() && percent != 0) {
+		return;
+	}
+	m_ScanPercent = percent;
+	if (m_hStatusBar) {
+		std::wostringstream oss;
+		oss << L"Scanning memory for signatures: " << percent << L"%";
+		std::wstring statusText = oss.str();
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(statusText.c_str()));
+	}
+}
+
+void MainWindow::OnSignatureScanFinished() {
+	if (!m_ScanThread.joinable()) {
+		return;
+	}
+	m_ScanThread.join();
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Ready"));
+	}
+
+	// Taken out of the members, since another scan may start while the
+	// results are shown.
+	std::vector<SignaturePattern> patterns;
+	patterns.swap(m_ScanPatterns);
+	std::vector<std::pair<DWORD, SignatureMatch>> found;
+	found.swap(m_ScanMatches);
+	std::vector<size_t> patternCounts;
+	patternCounts.swap(m_ScanPatternCounts);
+	std::unordered_map<DWORD, std::string> processNames;
+	processNames.swap(m_ScanProcessNames);
+	std::wstring minidumpName;
+	minidumpName.swap(m_ScanMinidumpName);
+	size_t totalMatches = m_ScanStatistics.Matches;
+	ULONGLONG bytesScanned = m_ScanStatistics.BytesScanned;
+	double seconds = m_ScanStatistics.Seconds;
+	std::sort(found.begin(), found.end(), [](const std::pair<DWORD, SignatureMatch>& a, const std::pair<DWORD, SignatureMatch>& b) {
+		return a.first != b.first ? a.first < b.first : a.second.Address < b.second.Address;
+	});
+
+	std::wostringstream oss;
+	if (m_ScanCancelled) {
+		oss << L"Stopped early. ";
+	}
+	oss << totalMatches << (totalMatches == 1 ? L" match" : L" matches") << L" for " << patterns.size()
+		<< (patterns.size() == 1 ? L" signature" : L" signatures") << L" in ";
+	if (!minidumpName.empty()) {
+		oss << minidumpName << L"\n";
+	} else {
+		oss << m_ScanProcesses << L" processes\n";
+	}
+	oss << std::fixed << std::setprecision(1) << static_cast<double>(bytesScanned) / (1024.0 * 1024.0) << L" MB scanned in "
+		<< std::setprecision(2) << seconds << L" s (" << (seconds > 0.0 ? static_cast<double>(bytesScanned) / seconds / 1e9 : 0.0) << L" GB/s)\n\n";
+
+	for (size_t i = 0; i < patterns.size(); ++i) {
+		if (patternCounts[i] != 0) {
+			oss << patterns[i].Name << L": " << patternCounts[i] << L"\n";
+		}
+	}
+	if (!found.empty()) {
+		oss << L"\n";
+	}
+	const size_t shownMatches = 30;
+	for (size_t i = 0; i < found.size() && i < shownMatches; ++i) {
+		auto nameIt = processNames.find(found[i].first);
+		std::wstring name = nameIt != processNames.end() ? std::wstring(nameIt->second.begin(), nameIt->second.end()) : L"<unknown>";
+		oss << name << L" (" << found[i].first << L") "
+			<< patterns[found[i].second.PatternIndex].Name << L" at 0x" << std::hex << found[i].second.Address << std::dec << L"\n";
+	}
+	if (found.size() > shownMatches) {
+		oss << L"... and " << (totalMatches - shownMatches) << L" more.\n";
+	}
+
+	if (found.empty()) {
+		MessageBoxW(m_hWnd, oss.str().c_str(), L"Signature Scan", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	oss << L"\nExport " << (found.size() < totalMatches ? L"the first " + std::to_wstring(found.size()) + L" matches" : std::wstring(L"the matches")) << L" to CSV?";
+	if (MessageBoxW(m_hWnd, oss.str().c_str(), L"Signature Scan", MB_YESNO | MB_ICONINFORMATION) != IDYES) {
+		return;
+	}
+
+	wchar_t szCsv[260] = {};
+	wcscpy_s(szCsv, L"signature_matches.csv");
+	OPENFILENAMEW saveOfn = {};
+	saveOfn.lStructSize = sizeof(saveOfn);
+	saveOfn.hwndOwner = m_hWnd;
+	saveOfn.lpstrFile = szCsv;
+	saveOfn.nMaxFile = sizeof(szCsv) / sizeof(szCsv[0]);
+	saveOfn.lpstrFilter = L"CSV Files\0*.csv\0All Files\0*.*\0";
+	saveOfn.nFilterIndex = 1;
+	saveOfn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+	if (!GetSaveFileNameW(&saveOfn)) {
+		return;
+	}
+
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, szCsv, L"wb") != 0 || !file) {
+		MessageBoxW(m_hWnd, L"Failed to create the CSV file.", L"Export Failed", MB_OK | MB_ICONERROR);
+		return;
+	}
+	fprintf(file, "\xEF\xBB\xBF");
+	fprintf(file, "Process ID,Process Name,Signature,Address\n");
+	auto escapeQuotes = [](const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			escaped += c;
+			if (c == '"') escaped += '"';
+		}
+		return escaped;
+	};
+	for (const auto& entry : found) {
+		auto nameIt = processNames.find(entry.first);
+		std::string name = escapeQuotes(nameIt != processNames.end() ? nameIt->second : std::string());
+		std::string signature = escapeQuotes(StringConversion::ToUtf8(patterns[entry.second.PatternIndex].Name));
+		fprintf(file, "%lu,\"%s\",\"%s\",0x%llX\n", entry.first, name.c_str(), signature.c_str(),
+			static_cast<ULONGLONG>(entry.second.Address));
+	}
+	bool written = ferror(file) == 0;
+	fclose(file);
+	if (!written) {
+		MessageBoxW(m_hWnd, L"Failed to write the CSV file.", L"Export Failed", MB_OK | MB_ICONERROR);
 	}
-	
-	CloseServiceHandle(hSCManager);
 }
 
-void MainWindow::GroupAppContainerProcesses(std::unordered_map<DWORD, std::vector<DWORD>>& processChildren) {
+void MainWindow::ShowDuplicatePagesWindow() {
+	if (m_DedupThread.joinable()) {
+		if (MessageBoxW(m_hWnd, L"Duplicate pages are still being counted. Stop now?", L"Find Duplicate Pages",
+			MB_YESNO | MB_ICONQUESTION) == IDYES) {
+			m_DedupCancelled = true;
+		}
+		return;
+	}
+
+	std::string selectedName;
+	if (m_SelectedProcessId != 0) {
+		for (const auto& proc : m_Processes) {
+			if (proc.ProcessId == m_SelectedProcessId) {
+				selectedName = proc.ProcessName;
+				break;
+			}
+		}
+	}
+
+	bool sameNameOnly = false;
+	if (!selectedName.empty()) {
+		std::wostringstream prompt;
+		prompt << L"Compare only the processes named " << std::wstring(selectedName.begin(), selectedName.end())
+			<< L"?\n\nChoose No to compare all processes.";
+		int choice = MessageBoxW(m_hWnd, prompt.str().c_str(), L"Find Duplicate Pages", MB_YESNOCANCEL | MB_ICONQUESTION);
+		if (choice == IDCANCEL) {
+			return;
+		}
+		sameNameOnly = choice == IDYES;
+	}
+
+	std::vector<DWORD> processIds;
+	m_DedupProcessNames.clear();
 	for (const auto& proc : m_Processes) {
-		if (proc.ProcessId == 0) continue;
-		
-		HandleWrapper hProcess = m_ProcessManager.OpenProcess(proc.ProcessId, PROCESS_QUERY_INFORMATION);
-		if (!hProcess.IsValid()) continue;
-		
-		HANDLE hToken = nullptr;
-		if (!OpenProcessToken(hProcess.Get(), TOKEN_QUERY, &hToken)) continue;
-		
-		DWORD length = 0;
-		GetTokenInformation(hToken, TokenAppContainerSid, nullptr, 0, &length);
-		if (GetLastError() == ERROR_INSUFFICIENT_BUFFER && length > 0 && length < 1024) {
-			std::vector<BYTE> buffer(length);
-			PTOKEN_APPCONTAINER_INFORMATION pAppContainer = reinterpret_cast<PTOKEN_APPCONTAINER_INFORMATION>(buffer.data());
-			
-			if (GetTokenInformation(hToken, TokenAppContainerSid, pAppContainer, length, &length)) {
-				if (pAppContainer->TokenAppContainer != nullptr) {
-					LPWSTR sidString = nullptr;
-					if (ConvertSidToStringSidW(pAppContainer->TokenAppContainer, &sidString)) {
-						std::wstring appContainerSid(sidString);
-						LocalFree(sidString);
-						
-						for (const auto& otherProc : m_Processes) {
-							if (otherProc.ProcessId == proc.ProcessId) continue;
-							
-							HandleWrapper hOtherProcess = m_ProcessManager.OpenProcess(otherProc.ProcessId, PROCESS_QUERY_INFORMATION);
-							if (!hOtherProcess.IsValid()) continue;
-							
-							HANDLE hOtherToken = nullptr;
-							if (OpenProcessToken(hOtherProcess.Get(), TOKEN_QUERY, &hOtherToken)) {
-								DWORD otherLength = 0;
-								GetTokenInformation(hOtherToken, TokenAppContainerSid, nullptr, 0, &otherLength);
-								if (GetLastError() == ERROR_INSUFFICIENT_BUFFER && otherLength > 0 && otherLength < 1024) {
-									std::vector<BYTE> otherBuffer(otherLength);
-									PTOKEN_APPCONTAINER_INFORMATION pOtherAppContainer = reinterpret_cast<PTOKEN_APPCONTAINER_INFORMATION>(otherBuffer.data());
-									
-									if (GetTokenInformation(hOtherToken, TokenAppContainerSid, pOtherAppContainer, otherLength, &otherLength)) {
-										if (pOtherAppContainer->TokenAppContainer != nullptr) {
-											LPWSTR otherSidString = nullptr;
-											if (ConvertSidToStringSidW(pOtherAppContainer->TokenAppContainer, &otherSidString)) {
-												std::wstring otherAppContainerSid(otherSidString);
-												LocalFree(otherSidString);
-												
-												if (appContainerSid == otherAppContainerSid && proc.ProcessId < otherProc.ProcessId) {
-													processChildren[proc.ProcessId].push_back(otherProc.ProcessId);
-												}
-											}
-										}
-									}
-								}
-								CloseHandle(hOtherToken);
-							}
-						}
+		m_DedupProcessNames[proc.ProcessId] = proc.ProcessName;
+		if (proc.ProcessId == 0 || proc.ProcessId == m_CurrentProcessId) {
+			continue;
+		}
+		if (sameNameOnly && _stricmp(proc.ProcessName.c_str(), selectedName.c_str()) != 0) {
+			continue;
+		}
+		processIds.push_back(proc.ProcessId);
+	}
+
+	m_DedupCancelled = false;
+	m_DedupResult = PageDedupResult();
+	if (m_hStatusBar) {
+		std::wstring statusText = L"Finding duplicate pages in " + std::to_wstring(processIds.size()) + L" processes...";
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(statusText.c_str()));
+	}
+
+	// Opening the processes and listing their regions is slow too, so it
+	// is done by the thread as well.
+	HWND hWnd = m_hWnd;
+	m_DedupThread = std::thread([this, hWnd, processIds = std::move(processIds)]() {
+		// Readers own the process handles the read functions use.
+		std::vector<std::unique_ptr<ProcessMemoryReader>> readers;
+		std::vector<PageDedupSource> sources;
+		for (DWORD processId : processIds) {
+			if (m_DedupCancelled) {
+				break;
+			}
+			auto reader = std::make_unique<ProcessMemoryReader>();
+			if (!reader->Open(processId)) {
+				continue;
+			}
+			PageDedupSource source;
+			source.ProcessId = processId;
+			source.Regions = m_MemoryManager.EnumerateMemoryRegions(processId);
+			if (source.Regions.empty()) {
+				continue;
+			}
+			source.Read = reader->GetReadFunction();
+			readers.push_back(std::move(reader));
+			sources.push_back(std::move(source));
+		}
+		m_DedupResult = PageDedupAnalyzer().Analyze(sources, PageDedupOptions(), &m_DedupCancelled);
+		PostMessageW(hWnd, WM_USER + 7, 0, 0);
+	});
+}
+
+void MainWindow::OnDuplicatePagesFinished() {
+	if (!m_DedupThread.joinable()) {
+		return;
+	}
+	m_DedupThread.join();
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Ready"));
+	}
+	if (m_DedupCancelled) {
+		MessageBoxW(m_hWnd, L"The search for duplicate pages was stopped.", L"Find Duplicate Pages", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	// Taken out of the members, since another search may start while the
+	// results are shown.
+	PageDedupResult result = std::move(m_DedupResult);
+	std::unordered_map<DWORD, std::string> processNames;
+	processNames.swap(m_DedupProcessNames);
+	if (result.PagesScanned == 0) {
+		MessageBoxW(m_hWnd, L"No private memory could be read.", L"Find Duplicate Pages", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	auto describe = [&processNames](DWORD processId) {
+		auto nameIt = processNames.find(processId);
+		std::wstring name = nameIt != processNames.end() ? std::wstring(nameIt->second.begin(), nameIt->second.end()) : L"<unknown>";
+		return name + L" (" + std::to_wstring(processId) + L")";
+	};
+	auto toMegabytes = [](ULONGLONG pages) {
+		return static_cast<double>(pages * PageHashSnapshot::PageSize) / (1024.0 * 1024.0);
+	};
+
+	std::wostringstream oss;
+	oss << std::fixed << std::setprecision(1);
+	oss << L"Private pages of " << result.Processes << L" processes: " << result.PagesScanned << L" ("
+		<< toMegabytes(result.PagesScanned) << L" MB) in " << std::setprecision(2) << result.Seconds << L" s\n"
+		<< std::setprecision(1);
+	oss << L"Zero pages: " << result.ZeroPages << L" (" << toMegabytes(result.ZeroPages) << L" MB)\n";
+	oss << L"Duplicate pages: " << result.DuplicatePages << L", " << result.CrossProcessDuplicatePages << L" across processes\n";
+	oss << L"Estimated savings from sharing: " << static_cast<double>(result.GetSavingsBytes()) / (1024.0 * 1024.0) << L" MB"
+		<< L" (zero pages add " << toMegabytes(result.ZeroPages) << L" MB)\n";
+	if (result.SampleRate > 1) {
+		oss << L"Estimated from 1 in " << result.SampleRate << L" page contents.\n";
+	}
+
+	const size_t shownEntries = 10;
+	if (!result.TopPages.empty()) {
+		oss << L"\nMost copied pages:\n";
+		for (size_t i = 0; i < result.TopPages.size() && i < shownEntries; ++i) {
+			const DuplicatePage& page = result.TopPages[i];
+			oss << page.Copies << L" copies in " << page.Processes << (page.Processes == 1 ? L" process" : L" processes")
+				<< L", e.g. " << describe(page.ProcessId) << L" at 0x" << std::hex << page.Address << std::dec << L"\n";
+		}
+	}
+	if (!result.TopRanges.empty()) {
+		oss << L"\nLargest duplicated ranges:\n";
+		for (size_t i = 0; i < result.TopRanges.size() && i < shownEntries; ++i) {
+			const DuplicateRange& range = result.TopRanges[i];
+			oss << describe(range.ProcessId) << L" at 0x" << std::hex << range.Address << std::dec << L": "
+				<< range.PageCount << (range.PageCount == 1 ? L" page\n" : L" pages\n");
+		}
+	}
+
+	MessageBoxW(m_hWnd, oss.str().c_str(), L"Find Duplicate Pages", MB_OK | MB_ICONINFORMATION);
+}
+
+void MainWindow::ShowMinidumpWindow() {
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[MAX_PATH] = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hWnd;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = MAX_PATH;
+	ofn.lpstrFilter = L"Dump Files\0*.dmp;*.mdmp\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+	if (!GetOpenFileNameW(&ofn)) {
+		return;
+	}
+
+	auto dump = std::make_shared<MinidumpFile>();
+	if (!dump->Open(szFile)) {
+		MessageBoxW(m_hWnd, L"The file is not a minidump, or it could not be read.", L"Open Minidump", MB_OK | MB_ICONERROR);
+		return;
+	}
+	// Kept open for the analysis commands until another dump is opened.
+	m_Minidump = dump;
+	m_MinidumpPath = szFile;
+	HMENU hMenu = GetMenu(m_hWnd);
+	for (UINT id : { IDM_TOOLS_SCAN_MINIDUMP, IDM_TOOLS_MINIDUMP_STRINGS, IDM_TOOLS_COMPARE_MINIDUMPS }) {
+		EnableMenuItem(hMenu, id, MF_BYCOMMAND | MF_ENABLED);
+	}
+
+	std::wostringstream oss;
+	if (dump->GetProcessId() != 0) {
+		oss << L"Process ID: " << dump->GetProcessId() << L"\n";
+	}
+	// TimeDateStamp counts seconds from 1970; FILETIME counts 100 ns
+	// intervals from 1601.
+	ULARGE_INTEGER time = {};
+	time.QuadPart = (static_cast<ULONGLONG>(dump->GetTimeDateStamp()) + 11644473600ULL) * 10000000ULL;
+	FILETIME captured = { time.LowPart, time.HighPart };
+	oss << L"Captured: " << FormatTime(captured) << L" UTC\n";
+	oss << L"Threads: " << dump->GetThreads().size() << L", modules: " << dump->GetModules().size() << L"\n";
+	oss << L"Saved memory: " << FormatMemorySize(static_cast<SIZE_T>(dump->GetMemorySize())) << L" in "
+		<< dump->GetMemoryRanges().size() << L" ranges, file " << FormatMemorySize(static_cast<SIZE_T>(dump->GetFileSize())) << L"\n";
+
+	if (dump->HasMemoryInfo()) {
+		AddressSpaceSummary summary;
+		summary.Build(dump->GetRegions(), dump->GetAddressSpaceHints());
+		oss << L"\nCommitted: " << FormatMemorySize(summary.GetCommitted()) << L", reserved: " << FormatMemorySize(summary.GetReserved()) << L"\n";
+		for (size_t i = static_cast<size_t>(AllocationKind::Image); i < static_cast<size_t>(AllocationKind::Count); ++i) {
+			AllocationKind kind = static_cast<AllocationKind>(i);
+			const AddressSpaceTotals& totals = summary.GetTotals(kind);
+			if (totals.Allocations != 0) {
+				oss << AddressSpaceSummary::KindToString(kind) << L": " << FormatMemorySize(totals.Committed) << L" committed in "
+					<< totals.Allocations << (totals.Allocations == 1 ? L" allocation\n" : L" allocations\n");
+			}
+		}
+	}
+
+	const size_t shownModules = 20;
+	if (!dump->GetModules().empty()) {
+		oss << L"\nModules:\n";
+	}
+	for (size_t i = 0; i < dump->GetModules().size() && i < shownModules; ++i) {
+		const ModuleInfo& module = dump->GetModules()[i];
+		oss << module.Name << L" at 0x" << std::hex << module.BaseAddress << std::dec << L" (" << FormatMemorySize(module.Size) << L")\n";
+	}
+	if (dump->GetModules().size() > shownModules) {
+		oss << L"... and " << (dump->GetModules().size() - shownModules) << L" more.\n";
+	}
+
+	oss << L"\nThe Tools menu can now scan this dump for signatures, extract its strings or compare its pages with another dump.";
+	MessageBoxW(m_hWnd, oss.str().c_str(), L"Open Minidump", MB_OK | MB_ICONINFORMATION);
+}
+
+bool MainWindow::OfferToCancelMinidumpJob(const wchar_t* caption) {
+	if (!m_MinidumpThread.joinable()) {
+		return false;
+	}
+	std::wstring prompt = std::wstring(m_MinidumpJobCaption) + L" is still running. Stop it now?";
+	if (MessageBoxW(m_hWnd, prompt.c_str(), caption, MB_YESNO | MB_ICONQUESTION) == IDYES) {
+		m_MinidumpCancelled = true;
+	}
+	return true;
+}
+
+void MainWindow::ExtractMinidumpStrings() {
+	if (OfferToCancelMinidumpJob(L"Minidump Strings")) {
+		return;
+	}
+	if (!m_Minidump) {
+		MessageBoxW(m_hWnd, L"Open a minidump first.", L"Minidump Strings", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[260] = {};
+	swprintf_s(szFile, L"strings_%lu.txt", m_Minidump->GetProcessId());
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hWnd;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = sizeof(szFile) / sizeof(szFile[0]);
+	ofn.lpstrFilter = L"Text Files\0*.txt\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+	if (!GetSaveFileNameW(&ofn)) {
+		return;
+	}
+
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, szFile, L"wb") != 0 || !file) {
+		MessageBoxW(m_hWnd, L"Failed to create the output file.", L"Minidump Strings", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	m_MinidumpCancelled = false;
+	m_MinidumpJobCaption = L"Minidump Strings";
+	m_MinidumpReport.clear();
+	m_MinidumpJobFailed = false;
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Extracting strings from the minidump..."));
+	}
+
+	// The sink is never called from two workers at once, so it writes to
+	// the file directly.
+	HWND hWnd = m_hWnd;
+	m_MinidumpThread = std::thread([this, hWnd, file, dump = m_Minidump, path = std::wstring(szFile)]() {
+		const size_t previewCount = 40;
+		std::vector<ExtractedString> preview;
+		size_t written = 0;
+		ULONGLONG startTick = GetTickCount64();
+		StringExtractionStatistics statistics = StringExtractor().Extract(dump->GetReadFunction(), dump->GetRegions(), StringExtractorOptions(),
+			[file, &preview, &written](std::vector<ExtractedString>& batch) {
+				for (auto& result : batch) {
+					std::string line = StringExtractor::FormatLine(result);
+					fwrite(line.data(), 1, line.size(), file);
+					if (preview.size() < previewCount) {
+						preview.push_back(std::move(result));
 					}
 				}
+				written += batch.size();
+			}, &m_MinidumpCancelled);
+		ULONGLONG elapsed = GetTickCount64() - startTick;
+		bool ok = ferror(file) == 0;
+		fclose(file);
+
+		std::wostringstream report;
+		if (!ok) {
+			m_MinidumpJobFailed = true;
+			m_MinidumpReport = L"Failed to write the output file.";
+			PostMessageW(hWnd, WM_USER + 8, 0, 0);
+			return;
+		}
+		std::sort(preview.begin(), preview.end(), [](const ExtractedString& a, const ExtractedString& b) {
+			return a.Address < b.Address;
+		});
+		if (m_MinidumpCancelled) {
+			report << L"Stopped early. ";
+		}
+		report << written << L" strings from " << FormatMemorySize(static_cast<SIZE_T>(statistics.BytesScanned)) << L" in "
+			<< statistics.Regions << L" regions of the minidump (" << elapsed << L" ms).\n"
+			<< L"Saved to " << path << L"\n\n";
+		for (const auto& result : preview) {
+			std::wstring text = result.Text.size() > 60 ? result.Text.substr(0, 60) + L"..." : result.Text;
+			report << L"0x" << std::hex << result.Address << std::dec
+				<< (result.Encoding == StringEncoding::Ascii ? L"  A  " : L"  U  ") << text << L"\n";
+		}
+		m_MinidumpReport = report.str();
+		PostMessageW(hWnd, WM_USER + 8, 0, 0);
+	});
+}
+
+void MainWindow::CompareMinidumpPages() {
+	if (OfferToCancelMinidumpJob(L"Compare Minidump Pages")) {
+		return;
+	}
+	if (!m_Minidump) {
+		MessageBoxW(m_hWnd, L"Open a minidump first.", L"Compare Minidump Pages", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	// The open dump is the earlier one; the user picks the later one.
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[MAX_PATH] = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hWnd;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = MAX_PATH;
+	ofn.lpstrTitle = L"Compare with a Later Minidump";
+	ofn.lpstrFilter = L"Dump Files\0*.dmp;*.mdmp\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+	if (!GetOpenFileNameW(&ofn)) {
+		return;
+	}
+	auto later = std::make_shared<MinidumpFile>();
+	if (!later->Open(szFile)) {
+		MessageBoxW(m_hWnd, L"The file is not a minidump, or it could not be read.", L"Compare Minidump Pages", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	m_MinidumpCancelled = false;
+	m_MinidumpJobCaption = L"Compare Minidump Pages";
+	m_MinidumpReport.clear();
+	m_MinidumpJobFailed = false;
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Comparing minidump pages..."));
+	}
+
+	// Both dumps stay mapped, so changed bytes are read from them rather
+	// than kept in the captures.
+	HWND hWnd = m_hWnd;
+	m_MinidumpThread = std::thread([this, hWnd, earlier = m_Minidump, later]() {
+		ULONGLONG startTick = GetTickCount64();
+		PageHashSnapshot before;
+		PageHashSnapshot after;
+		bool captured = before.Capture(earlier->GetReadFunction(), earlier->GetRegions(), PageCaptureOptions(), &m_MinidumpCancelled)
+			&& after.Capture(later->GetReadFunction(), later->GetRegions(), PageCaptureOptions(), &m_MinidumpCancelled);
+		if (m_MinidumpCancelled) {
+			m_MinidumpReport = L"The comparison was stopped.";
+			PostMessageW(hWnd, WM_USER + 8, 0, 0);
+			return;
+		}
+		if (!captured) {
+			m_MinidumpJobFailed = true;
+			m_MinidumpReport = L"One of the dumps has no saved memory to compare.";
+			PostMessageW(hWnd, WM_USER + 8, 0, 0);
+			return;
+		}
+		std::vector<PageChange> changes = PageHashSnapshot::Diff(before, after);
+		ULONGLONG elapsed = GetTickCount64() - startTick;
+
+		ULONGLONG pages[4] = {};
+		for (const auto& change : changes) {
+			pages[static_cast<size_t>(change.Kind)] += change.PageCount;
+		}
+		std::wostringstream report;
+		report << before.GetPageCount() << L" pages before, " << after.GetPageCount() << L" after (" << elapsed << L" ms):\n"
+			<< pages[static_cast<size_t>(PageChangeKind::Changed)] << L" pages changed, "
+			<< pages[static_cast<size_t>(PageChangeKind::Added)] << L" new, "
+			<< pages[static_cast<size_t>(PageChangeKind::Removed)] << L" freed, "
+			<< pages[static_cast<size_t>(PageChangeKind::Unreadable)] << L" unreadable\n\n";
+
+		const size_t shownChanges = 25;
+		const size_t shownByteDiffs = 4;
+		size_t byteDiffsShown = 0;
+		for (size_t i = 0; i < changes.size() && i < shownChanges; ++i) {
+			const PageChange& change = changes[i];
+			report << (change.Kind == PageChangeKind::Changed ? L"Changed " : change.Kind == PageChangeKind::Added ? L"New "
+				: change.Kind == PageChangeKind::Removed ? L"Freed " : L"Unreadable ")
+				<< L"0x" << std::hex << change.Address << std::dec << L" (" << change.PageCount
+				<< (change.PageCount == 1 ? L" page)\n" : L" pages)\n");
+
+			// Bytes are shown for the first page of the first few changed runs.
+			const BYTE* oldPage = earlier->GetView(change.Address, PageHashSnapshot::PageSize);
+			const BYTE* newPage = later->GetView(change.Address, PageHashSnapshot::PageSize);
+			if (change.Kind != PageChangeKind::Changed || byteDiffsShown >= shownByteDiffs || !oldPage || !newPage) {
+				continue;
+			}
+			++byteDiffsShown;
+			auto ranges = PageHashSnapshot::CompareBytes(oldPage, newPage, PageHashSnapshot::PageSize);
+			for (size_t r = 0; r < ranges.size() && r < 4; ++r) {
+				wchar_t line[128];
+				swprintf_s(line, L"    +0x%03zX: %zu byte%s", ranges[r].Offset, ranges[r].Length, ranges[r].Length == 1 ? L"" : L"s");
+				report << line;
+				for (size_t b = 0; b < ranges[r].Length && b < 8; ++b) {
+					swprintf_s(line, L" %02X>%02X", oldPage[ranges[r].Offset + b], newPage[ranges[r].Offset + b]);
+					report << line;
+				}
+				report << L"\n";
+			}
+			if (ranges.size() > 4) {
+				report << L"    ... and " << (ranges.size() - 4) << L" more runs\n";
 			}
 		}
-		
-		CloseHandle(hToken);
+		if (changes.size() > shownChanges) {
+			report << L"... and " << (changes.size() - shownChanges) << L" more runs.\n";
+		} else if (changes.empty()) {
+			report << L"No pages changed.\n";
+		}
+		m_MinidumpReport = report.str();
+		PostMessageW(hWnd, WM_USER + 8, 0, 0);
+	});
+}
+
+void MainWindow::OnMinidumpJobFinished() {
+	if (!m_MinidumpThread.joinable()) {
+		return;
+	}
+	m_MinidumpThread.join();
+	if (m_hStatusBar) {
+		SendMessage(m_hStatusBar, SB_SETTEXT, SBT_NOBORDERS, reinterpret_cast<LPARAM>(L"Ready"));
+	}
+	// Taken out of the members, since another job may start while the
+	// report is shown.
+	std::wstring report;
+	report.swap(m_MinidumpReport);
+	MessageBoxW(m_hWnd, report.c_str(), m_MinidumpJobCaption, MB_OK | (m_MinidumpJobFailed ? MB_ICONERROR : MB_ICONINFORMATION));
+}
+
+void MainWindow::ShowCompressedDumpWindow() {
+	if (OfferToCancelDumpJob(L"Open Compressed Dump")) {
+		return;
+	}
+
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[MAX_PATH] = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hWnd;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = MAX_PATH;
+	ofn.lpstrFilter = L"Compressed Memory Dumps\0*.wpdmp\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+	if (!GetOpenFileNameW(&ofn)) {
+		return;
+	}
+
+	auto dump = std::make_unique<MemoryDumpFile>();
+	if (!dump->Open(szFile)) {
+		MessageBoxW(m_hWnd, L"The file is not a complete compressed dump, or it could not be read.", L"Open Compressed Dump", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	ULONGLONG memorySize = 0;
+	for (const auto& region : dump->GetRegions()) {
+		memorySize += region.RegionSize;
+	}
+	ULONGLONG storedSize = 0;
+	ULONGLONG kindCounts[4] = {};
+	for (const auto& block : dump->GetBlocks()) {
+		storedSize += block.StoredSize;
+		++kindCounts[static_cast<size_t>(block.Kind)];
+	}
+
+	std::wostringstream oss;
+	oss << L"Process ID: " << dump->GetProcessId() << L"\n";
+	oss << L"Captured: " << FormatTime(dump->GetCaptureTime()) << L" UTC\n";
+	oss << L"Memory: " << FormatMemorySize(static_cast<SIZE_T>(memorySize)) << L" in " << dump->GetRegions().size() << L" regions, stored in "
+		<< FormatMemorySize(static_cast<SIZE_T>(storedSize)) << L"\n";
+	oss << L"Blocks: " << kindCounts[static_cast<size_t>(MemoryDumpBlockKind::Compressed)] << L" compressed, "
+		<< kindCounts[static_cast<size_t>(MemoryDumpBlockKind::Raw)] << L" raw, "
+		<< kindCounts[static_cast<size_t>(MemoryDumpBlockKind::Zero)] << L" zero, "
+		<< kindCounts[static_cast<size_t>(MemoryDumpBlockKind::Unreadable)] << L" unreadable\n";
+
+	AddressSpaceSummary summary;
+	summary.Build(dump->GetRegions(), AddressSpaceHints());
+	oss << L"\n";
+	for (size_t i = static_cast<size_t>(AllocationKind::Image); i < static_cast<size_t>(AllocationKind::Count); ++i) {
+		AllocationKind kind = static_cast<AllocationKind>(i);
+		const AddressSpaceTotals& totals = summary.GetTotals(kind);
+		if (totals.Allocations != 0) {
+			oss << AddressSpaceSummary::KindToString(kind) << L": " << FormatMemorySize(totals.Committed) << L" in "
+				<< totals.Allocations << (totals.Allocations == 1 ? L" allocation\n" : L" allocations\n");
+		}
+	}
+	oss << L"\nCheck every block against its checksum?";
+	if (MessageBoxW(m_hWnd, oss.str().c_str(), L"Open Compressed Dump", MB_YESNO | MB_ICONINFORMATION) != IDYES) {
+		return;
 	}
+
+	// Decoding every block takes as long as reading the whole dump, so it
+	// runs on the dump thread and reports like a dump being written.
+	m_DumpCancelled = false;
+	m_DumpVerifying = true;
+	m_DumpProcessId = dump->GetProcessId();
+	m_DumpPath = szFile;
+	m_DumpPercent = 0;
+	m_DumpStatistics = MemoryDumpStatistics();
+	OnDumpProgress(0);
+
+	HWND hWnd = m_hWnd;
+	m_DumpThread = std::thread([this, hWnd, dump = std::move(dump)]() {
+		int lastPercent = 0;
+		m_DumpStatistics.BadBlocks = dump->Verify([hWnd, &lastPercent](ULONGLONG done, ULONGLONG total) {
+			int percent = total != 0 ? static_cast<int>(done * 100 / total) : 100;
+			if (percent != lastPercent) {
+				lastPercent = percent;
+				PostMessageW(hWnd, WM_USER + 3, static_cast<WPARAM>(percent), 0);
+			}
+		}, &m_DumpCancelled);
+		m_DumpStatistics.Verified = !m_DumpCancelled;
+		PostMessageW(hWnd, WM_USER + 4, 0, 0);
+	});
+}
+
+void MainWindow::UpdateObjectSearchIndex(const std::atomic<bool>& cancelled) {
+	if (!m_ObjectSnapshot.Capture()) {
+		return;
+	}
+	m_ObjectNames.Start(nullptr, 0);
+
+	struct PendingProcess {
+		DWORD ProcessId;
+		ULONGLONG Signature;
+		std::vector<HandleInfo> Handles;
+		// Names queued and not yet answered.
+		size_t Outstanding;
+	};
+	std::vector<PendingProcess> pending;
+	std::unordered_map<DWORD, size_t> pendingIndex;
+
+	std::vector<DWORD> processIds = m_ObjectSnapshot.GetProcessIds();
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	for (DWORD processId : processIds) {
+		if (cancelled) {
+			m_ObjectNames.CancelPending();
+			return;
+		}
+		size_t count = 0;
+		const HandleEntry* entries = m_ObjectSnapshot.GetProcessHandles(processId, count);
+		ULONGLONG signature = ObjectSearchIndex::ComputeSignature(entries, count);
+		if (m_ObjectSearch.IsCurrent(processId, signature)) {
+			continue;
+		}
+
+		PendingProcess process;
+		process.ProcessId = processId;
+		process.Signature = signature;
+		process.Outstanding = 0;
+		process.Handles.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			HandleInfo& info = process.Handles[i];
+			info.ProcessId = entries[i].ProcessId;
+			info.ObjectTypeIndex = entries[i].ObjectTypeIndex;
+			info.AccessMask = entries[i].AccessMask;
+			info.ObjectAddress = entries[i].ObjectAddress;
+			info.HandleValue = reinterpret_cast<HANDLE>(entries[i].HandleValue);
+			info.ObjectTypeName = types.GetName(info.ObjectTypeIndex);
+			if (!m_ObjectNames.Request(info, info.ObjectName)) {
+				++process.Outstanding;
+			}
+		}
+		pendingIndex[processId] = pending.size();
+		pending.push_back(std::move(process));
+	}
+
+	// Waited for in short steps so closing the window is not held up.
+	bool complete = false;
+	for (DWORD waitedMs = 0; waitedMs < 5000 && !complete && !cancelled; waitedMs += 100) {
+		complete = m_ObjectNames.WaitForPending(100);
+	}
+	std::map<std::pair<DWORD, ULONG_PTR>, std::wstring> names;
+	for (auto& result : m_ObjectNames.TakeResults()) {
+		auto it = pendingIndex.find(result.ProcessId);
+		if (it != pendingIndex.end()) {
+			--pending[it->second].Outstanding;
+		}
+		names[std::make_pair(result.ProcessId, result.HandleValue)] = std::move(result.Name);
+	}
+	m_ObjectNames.CancelPending();
+	if (cancelled) {
+		return;
+	}
+
+	for (auto& process : pending) {
+		// A process with names still missing at the deadline keeps what was
+		// last indexed for it in full, and is tried again on the next search.
+		// One never indexed in full gets what was resolved, under a signature
+		// that never matches.
+		if (process.Outstanding != 0 && m_ObjectSearch.GetSignature(process.ProcessId) != 0) {
+			continue;
+		}
+		for (auto& info : process.Handles) {
+			auto it = names.find(std::make_pair(info.ProcessId, reinterpret_cast<ULONG_PTR>(info.HandleValue)));
+			if (it != names.end()) {
+				info.ObjectName = it->second;
+			}
+		}
+		m_ObjectSearch.UpdateHandles(process.ProcessId, process.Outstanding == 0 ? process.Signature : 0, process.Handles);
+	}
+
+	// Module lists are cheap without the file checks, so every process is
+	// read again rather than trusting its handle signature.
+	for (DWORD processId : processIds) {
+		if (cancelled) {
+			return;
+		}
+		m_ObjectSearch.UpdateModules(processId, m_ModuleManager.EnumerateModules(processId, false));
+	}
+	m_ObjectSearch.RemoveMissing(processIds);
 }
 
 LRESULT MainWindow::OnCustomDraw(LPNMLVCUSTOMDRAW lplvcd) {
@@ -3321,12 +4778,11 @@ LRESULT MainWindow::OnCustomDraw(LPNMLVCUSTOMDRAW lplvcd) {
 			ListView_GetItem(m_hProcessListView, &lvi);
 			DWORD processId = static_cast<DWORD>(lvi.lParam);
 			
-			auto it = std::find_if(m_FilteredProcesses.begin(), m_FilteredProcesses.end(),
-				[processId](const ProcessInfo& p) { return p.ProcessId == processId; });
-			
-			if (it == m_FilteredProcesses.end()) {
+			size_t item = static_cast<size_t>(lplvcd->nmcd.dwItemSpec);
+			if (item >= m_FilteredRows.size() || m_Processes[m_FilteredRows[item]].ProcessId != processId) {
 				return CDRF_DODEFAULT;
 			}
+			const ProcessInfo* it = &m_Processes[m_FilteredRows[item]];
 			
 			lplvcd->clrText = RGB(0, 0, 0);
 			lplvcd->clrTextBk = (lplvcd->nmcd.dwItemSpec % 2) ? RGB(255, 255, 255) : RGB(248, 248, 248);
@@ -3503,81 +4959,9 @@ bool MainWindow::IsVerifiedProcess(const std::wstring& imagePath) {
 }
 
 std::wstring MainWindow::GetFileDescription(const std::wstring& filePath) {
-	auto it = m_DescriptionCache.find(filePath);
-	if (it != m_DescriptionCache.end()) {
-		return it->second;
-	}
-	
-	std::wstring description;
-	
-	DWORD handle = 0;
-	DWORD size = GetFileVersionInfoSizeW(filePath.c_str(), &handle);
-	if (size > 0 && size < 10 * 1024 * 1024) {
-		std::vector<BYTE> buffer(size);
-		if (GetFileVersionInfoW(filePath.c_str(), 0, size, buffer.data())) {
-			struct LANGANDCODEPAGE {
-				WORD wLanguage;
-				WORD wCodePage;
-			} *lpTranslate;
-			
-			UINT cbTranslate;
-			if (VerQueryValueW(buffer.data(), L"\\VarFileInfo\\Translation", (LPVOID*)&lpTranslate, &cbTranslate)) {
-				for (UINT i = 0; i < (cbTranslate / sizeof(struct LANGANDCODEPAGE)); i++) {
-					wchar_t subBlock[256];
-					swprintf_s(subBlock, L"\\StringFileInfo\\%04x%04x\\FileDescription",
-						lpTranslate[i].wLanguage, lpTranslate[i].wCodePage);
-					
-					LPVOID lpBuffer;
-					UINT dwBytes;
-					if (VerQueryValueW(buffer.data(), subBlock, &lpBuffer, &dwBytes) && dwBytes > 0) {
-						description = static_cast<LPCWSTR>(lpBuffer);
-						break;
-					}
-				}
-			}
-		}
-	}
-	
-	m_DescriptionCache[filePath] = description;
-	return description;
+	return m_FileMetadata.Get(filePath)->FileDescription;
 }
 
 std::wstring MainWindow::GetFileCompany(const std::wstring& filePath) {
-	auto it = m_CompanyCache.find(filePath);
-	if (it != m_CompanyCache.end()) {
-		return it->second;
-	}
-	
-	std::wstring company;
-	
-	DWORD handle = 0;
-	DWORD size = GetFileVersionInfoSizeW(filePath.c_str(), &handle);
-	if (size > 0 && size < 10 * 1024 * 1024) {
-		std::vector<BYTE> buffer(size);
-		if (GetFileVersionInfoW(filePath.c_str(), 0, size, buffer.data())) {
-			struct LANGANDCODEPAGE {
-				WORD wLanguage;
-				WORD wCodePage;
-			} *lpTranslate;
-			
-			UINT cbTranslate;
-			if (VerQueryValueW(buffer.data(), L"\\VarFileInfo\\Translation", (LPVOID*)&lpTranslate, &cbTranslate)) {
-				for (UINT i = 0; i < (cbTranslate / sizeof(struct LANGANDCODEPAGE)); i++) {
-					wchar_t subBlock[256];
-					swprintf_s(subBlock, L"\\StringFileInfo\\%04x%04x\\CompanyName",
-						lpTranslate[i].wLanguage, lpTranslate[i].wCodePage);
-					
-					LPVOID lpBuffer;
-					UINT dwBytes;
-					if (VerQueryValueW(buffer.data(), subBlock, &lpBuffer, &dwBytes) && dwBytes > 0) {
-						company = static_cast<LPCWSTR>(lpBuffer);
-						break;
-					}
-				}
-			}
-		}
-	}
-	
-	m_CompanyCache[filePath] = company;
-	return company;
+	return m_FileMetadata.Get(filePath)->CompanyName;
 }
@@ -6,11 +6,29 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
 #include "../core/ProcessManager.h"
 #include "../core/ModuleManager.h"
 #include "../core/MemoryManager.h"
 #include "../core/HandleManager.h"
 #include "../core/SystemInfo.h"
+#include "../core/ProcessSearchIndex.h"
+#include "../core/ProcessSortOrder.h"
+#include "../core/ProcessTree.h"
+#include "../core/ProcessGrouping.h"
+#include "../core/ServiceSnapshot.h"
+#include "../core/FileMetadataCache.h"
+#include "../core/ProcessImagePathCache.h"
+#include "../core/ProcessSnapshotWorker.h"
+#include "../core/RefreshScheduler.h"
+#include "../core/ObjectSearchIndex.h"
+#include "../core/HandleNameResolver.h"
+#include "../core/MemoryDumpFile.h"
+#include "../core/SignatureScanner.h"
+#include "../core/PageDedupAnalyzer.h"
+#include "../core/MinidumpFile.h"
+#include "IconLoader.h"
 #include "../utils/Logger.h"
 #include "../core/HandleWrapper.h"
 
@@ -60,9 +78,20 @@ namespace GUI {
 		LRESULT OnTimer(WPARAM wParam);
 
 		void RefreshProcessList();
+		void OnSnapshotReady();
+		void ScheduleRefresh();
+		WinProcessInspector::Core::ProcessFieldMask ComputeRequiredFields() const;
+		bool IsGroupingCollected() const;
+		bool ComputeServicesRequired() const;
+		void UpdateRequiredFields();
+		static ULONGLONG GetOwnCpuTimeMs();
 		void UpdateProcessList();
 		void SortProcessList(int column, bool ascending);
+		void ApplySortOrder();
 		void BuildProcessHierarchy();
+		void UpdateProcessTreeMetrics();
+		bool IsProcessExpanded(DWORD processId) const;
+		void RebuildSearchIndex();
 		void OnProcessListDoubleClick();
 		void OnProcessListSelectionChanged();
 		void ShowProcessContextMenu(int x, int y);
@@ -76,12 +105,31 @@ namespace GUI {
 		bool ExportToText(const std::wstring& filePath, const std::vector<WinProcessInspector::Core::ProcessInfo>& processes);
 		
 		void OnViewTreeView();
+		void OnViewGroupBy(WinProcessInspector::Core::ProcessGroupKind kind);
 		void OnViewToolbar();
 		void OnViewSearchBar();
 		void OnViewAutoRefresh();
 		void OnViewColumns();
 		void ShowNetworkConnectionsWindow();
 		void ShowSystemInformationWindow();
+		void ShowFindObjectWindow();
+		void ShowObjectSearchResults();
+		// Runs on the snapshot worker.
+		void UpdateObjectSearchIndex(const std::atomic<bool>& cancelled);
+		// Scans every process, or the open minidump.
+		void ShowSignatureScanWindow(bool scanMinidump);
+		void OnSignatureScanProgress(int percent);
+		void OnSignatureScanFinished();
+		void ShowDuplicatePagesWindow();
+		void OnDuplicatePagesFinished();
+		void ShowMinidumpWindow();
+		// True if strings or pages of a minidump were being processed; the
+		// user was asked whether to stop.
+		bool OfferToCancelMinidumpJob(const wchar_t* caption);
+		void ExtractMinidumpStrings();
+		void CompareMinidumpPages();
+		void OnMinidumpJobFinished();
+		void ShowCompressedDumpWindow();
 		void ShowColumnChooserDialog();
 		void OnHelpAbout();
 		void OnHelpGitHub();
@@ -94,7 +142,13 @@ namespace GUI {
 		void InjectDll(DWORD processId);
 		void SetProcessPriority(DWORD processId);
 		void SetProcessAffinity(DWORD processId);
+		// True if a dump was being written or checked; the user was asked
+		// whether to cancel it.
+		bool OfferToCancelDumpJob(const wchar_t* caption);
 		void CreateProcessDump(DWORD processId);
+		void StartCompressedDump(DWORD processId, const std::wstring& filePath);
+		void OnDumpProgress(int percent);
+		void OnDumpFinished();
 		int SelectInjectionMethod(DWORD processId);
 		void OpenProcessFileLocation(DWORD processId);
 		void CopyProcessId(DWORD processId);
@@ -110,13 +164,11 @@ namespace GUI {
 		std::wstring FormatIntegrityLevel(WinProcessInspector::Security::IntegrityLevel level);
 		std::wstring FormatMemorySize(SIZE_T bytes);
 		std::wstring FormatTime(const FILETIME& ft);
-		int GetProcessIconIndex(const std::wstring& imagePath);
-		std::wstring GetProcessImagePath(DWORD processId);
+		int GetProcessIconIndex(const std::wstring& imagePath, DWORD processId);
+		void OnIconsLoaded();
 		void CalculateCpuUsage();
 		void UpdateMemoryUsage();
 		double GetCpuUsage(DWORD processId) const;
-		void GroupSvchostServices(std::unordered_map<DWORD, std::vector<DWORD>>& processChildren);
-		void GroupAppContainerProcesses(std::unordered_map<DWORD, std::vector<DWORD>>& processChildren);
 
 		HWND m_hWnd;
 		HINSTANCE m_hInstance;
@@ -128,6 +180,7 @@ namespace GUI {
 		HWND m_hSearchLabel;
 		HMENU m_hMenu;
 		HMENU m_hContextMenu;
+		HMENU m_hGroupByMenu;
 		HACCEL m_hAccel;
 
 		WinProcessInspector::Core::ProcessManager m_ProcessManager;
@@ -136,15 +189,21 @@ namespace GUI {
 		WinProcessInspector::Core::HandleManager m_HandleManager;
 
 		std::vector<WinProcessInspector::Core::ProcessInfo> m_Processes;
-		std::vector<WinProcessInspector::Core::ProcessInfo> m_FilteredProcesses;
+		std::vector<size_t> m_FilteredRows;
 		std::unordered_map<DWORD, bool> m_ExpandedProcesses;
-		std::unordered_map<DWORD, std::vector<DWORD>> m_ProcessChildren;
+		WinProcessInspector::Core::ProcessTree m_ProcessTree;
+		bool m_ProcessTreeMetricsValid;
+		WinProcessInspector::Core::ProcessGrouping m_ProcessGrouping;
+		WinProcessInspector::Core::ProcessGroupKind m_GroupKind;
+		WinProcessInspector::Core::ServiceSnapshot m_ServiceSnapshot;
+		// Only touched by the refresh thread; refreshes never overlap.
+		WinProcessInspector::Core::ProcessImagePathCache m_ImagePaths;
+		WinProcessInspector::Core::ProcessSnapshotWorker m_SnapshotWorker;
 		std::unordered_map<DWORD, ULONGLONG> m_ProcessCpuTime;
 		std::unordered_map<DWORD, ULONGLONG> m_ProcessCpuTimePrev;
 		std::unordered_map<DWORD, double> m_ProcessCpuPercent;
 		std::unordered_map<DWORD, SIZE_T> m_ProcessMemory;
 		ULONGLONG m_LastCpuUpdateTime;
-		std::unordered_map<DWORD, int> m_ProcessDepth;
 		DWORD m_SelectedProcessId;
 		int m_SortColumn;
 		bool m_SortAscending;
@@ -153,23 +212,104 @@ namespace GUI {
 		bool m_SearchBarVisible;
 		bool m_TreeViewEnabled;
 		UINT_PTR m_RefreshTimerId;
-		bool m_IsRefreshing;
-		ULONGLONG m_LastRefreshTime;
+		WinProcessInspector::Core::RefreshScheduler m_RefreshScheduler;
 		std::wstring m_FilterText;
+		WinProcessInspector::Core::ProcessSearchIndex m_SearchIndex;
+		bool m_SearchIndexValid;
+		WinProcessInspector::Core::ProcessSortOrder m_SortOrder;
 		
 		std::vector<bool> m_ColumnVisible;
+		// Fields the next snapshot collects, read by the refresh thread.
+		std::atomic<WinProcessInspector::Core::ProcessFieldMask> m_RequiredFields;
+		WinProcessInspector::Core::ProcessFieldMask m_CollectedFields;
+		// Whether the refresh thread reads the service list, and whether the
+		// shown snapshot has one.
+		std::atomic<bool> m_ServicesRequired;
+		bool m_ServicesCollected;
+		// Grouping the refresh thread collects attributes for. The shown
+		// snapshot's attributes are in m_ProcessGrouping.
+		std::atomic<WinProcessInspector::Core::ProcessGroupKind> m_GroupingRequired;
+		WinProcessInspector::Core::ProcessFieldCosts m_FieldCosts;
 		
 		HIMAGELIST m_hProcessIconList;
 		std::unordered_map<std::wstring, int> m_IconCache;
 		int m_DefaultIconIndex;
+		IconLoader m_IconLoader;
+		// Rows drawn with the default icon while their image's icon is loading.
+		std::unordered_map<std::wstring, std::vector<DWORD>> m_PendingIconRows;
 		
 		std::unordered_map<DWORD, bool> m_SystemProcessCache;
 		std::unordered_map<std::wstring, bool> m_VerifiedCache;
-		std::unordered_map<std::wstring, std::wstring> m_DescriptionCache;
-		std::unordered_map<std::wstring, std::wstring> m_CompanyCache;
+		WinProcessInspector::Core::FileMetadataCache m_FileMetadata;
+		// Kept between searches; only processes whose handles changed are
+		// indexed again. The index and its helpers belong to the snapshot
+		// worker from a request until it sets m_ObjectSearchReady, and to the
+		// window after that until the next request.
+		WinProcessInspector::Core::ObjectSearchIndex m_ObjectSearch;
+		WinProcessInspector::Core::HandleSnapshot m_ObjectSnapshot;
+		WinProcessInspector::Core::HandleNameResolver m_ObjectNames;
+		std::atomic<bool> m_ObjectSearchRequested;
+		std::atomic<bool> m_ObjectSearchReady;
+		// The search waiting for the worker to update the index, if
+		// m_ObjectQueryPending.
+		std::wstring m_ObjectQueryInput;
+		std::wstring m_ObjectQueryPattern;
+		WORD m_ObjectQueryTypeIndex;
+		bool m_ObjectQueryTypeFilter;
+		bool m_ObjectQueryPending;
 		SIZE_T m_TotalSystemMemory;
 		DWORD m_CurrentProcessId;
 
+		// Compressed dump written or checked in the background, one at a
+		// time. The statistics are filled by the dump thread before it posts
+		// that it has finished.
+		std::thread m_DumpThread;
+		std::atomic<bool> m_DumpCancelled;
+		// The thread is checking an existing dump rather than writing one.
+		bool m_DumpVerifying;
+		DWORD m_DumpProcessId;
+		std::wstring m_DumpPath;
+		int m_DumpPercent;
+		WinProcessInspector::Core::MemoryDumpStatistics m_DumpStatistics;
+
+		// Signature scan of every process in the background, one at a time.
+		// The matches and totals are filled by the scan thread before it
+		// posts that it has finished.
+		std::thread m_ScanThread;
+		std::atomic<bool> m_ScanCancelled;
+		std::vector<WinProcessInspector::Core::SignaturePattern> m_ScanPatterns;
+		std::unordered_map<DWORD, std::string> m_ScanProcessNames;
+		// The first matches, by process id.
+		std::vector<std::pair<DWORD, WinProcessInspector::Core::SignatureMatch>> m_ScanMatches;
+		std::vector<size_t> m_ScanPatternCounts;
+		WinProcessInspector::Core::SignatureScanStatistics m_ScanStatistics;
+		size_t m_ScanProcesses;
+		// The file name of the minidump being scanned, or empty when
+		// scanning processes.
+		std::wstring m_ScanMinidumpName;
+		int m_ScanPercent;
+
+		// Duplicate page count in the background, one at a time. The result
+		// is filled by the thread before it posts that it has finished.
+		std::thread m_DedupThread;
+		std::atomic<bool> m_DedupCancelled;
+		std::unordered_map<DWORD, std::string> m_DedupProcessNames;
+		WinProcessInspector::Core::PageDedupResult m_DedupResult;
+
+		// The minidump opened from the Tools menu, which signatures, strings
+		// and pages are analysed on. Threads hold their own reference, so
+		// opening another dump does not unmap one still being read.
+		std::shared_ptr<WinProcessInspector::Core::MinidumpFile> m_Minidump;
+		std::wstring m_MinidumpPath;
+		// Strings or page comparison of a minidump in the background, one
+		// at a time. The report is filled by the thread before it posts
+		// that it has finished.
+		std::thread m_MinidumpThread;
+		std::atomic<bool> m_MinidumpCancelled;
+		const wchar_t* m_MinidumpJobCaption;
+		std::wstring m_MinidumpReport;
+		bool m_MinidumpJobFailed;
+
 		std::unique_ptr<ProcessPropertiesDialog> m_PropertiesDialog;
 	};
 
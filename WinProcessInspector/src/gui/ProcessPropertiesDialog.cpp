@@ -2,7 +2,9 @@
 #include "../core/ProcessManager.h"
 #include "../core/ModuleManager.h"
 #include "../core/MemoryManager.h"
+#include "../core/StringExtractor.h"
 #include "../core/HandleManager.h"
+#include "../core/ObjectTypeTable.h"
 #include "../core/NetworkManager.h"
 #include "../core/ServiceManager.h"
 #include "../security/SecurityManager.h"
@@ -10,6 +12,9 @@
 #include "../utils/CryptoHelper.h"
 #include "../../resource.h"
 #include <commctrl.h>
+#include <commdlg.h>
+#include <algorithm>
+#include <iterator>
 #include <sstream>
 #include <iomanip>
 #include <psapi.h>
@@ -39,7 +44,32 @@ ProcessPropertiesDialog::ProcessPropertiesDialog(HINSTANCE hInstance, HWND hPare
 	, m_hMemoryListView(nullptr)
 	, m_hHandleListView(nullptr)
 	, m_hServicesListView(nullptr)
+	, m_hHandleHistoryButton(nullptr)
+	, m_hSharedObjectsButton(nullptr)
+	, m_hMemorySummaryButton(nullptr)
+	, m_hMemoryStringsButton(nullptr)
+	, m_hMemoryCompareButton(nullptr)
 	, m_ProcessId(0)
+	, m_HandleSampleRecorded(false)
+	, m_CorrelationCancelled(false)
+	, m_CorrelationCaptured(false)
+	, m_CorrelationProcessId(0)
+	, m_CorrelationObjectCount(0)
+	, m_PageBaselineProcessId(0)
+	, m_PageBaselineStartTime(0)
+	, m_PageBaselineTick(0)
+	, m_PageCaptureCancelled(false)
+	, m_PageCaptured(false)
+	, m_PageCaptureHasBaseline(false)
+	, m_PageCaptureProcessId(0)
+	, m_PageCaptureStartTime(0)
+	, m_PageCaptureTick(0)
+	, m_PageCaptureElapsed(0)
+	, m_StringsCancelled(false)
+	, m_StringsFile(nullptr)
+	, m_StringsProcessId(0)
+	, m_StringsStartTick(0)
+	, m_StringsWritten(0)
 	, m_hBoldFont(nullptr)
 	, m_hNormalFont(nullptr)
 {
@@ -53,6 +83,22 @@ ProcessPropertiesDialog::ProcessPropertiesDialog(HINSTANCE hInstance, HWND hPare
 }
 
 ProcessPropertiesDialog::~ProcessPropertiesDialog() {
+	m_HandleNames.Stop();
+	if (m_StringsThread.joinable()) {
+		m_StringsCancelled = true;
+		m_StringsThread.join();
+	}
+	if (m_StringsFile) {
+		fclose(m_StringsFile);
+	}
+	if (m_PageCaptureThread.joinable()) {
+		m_PageCaptureCancelled = true;
+		m_PageCaptureThread.join();
+	}
+	if (m_CorrelationThread.joinable()) {
+		m_CorrelationCancelled = true;
+		m_CorrelationThread.join();
+	}
 	if (m_hBoldFont) {
 		DeleteObject(m_hBoldFont);
 	}
@@ -464,6 +510,65 @@ void ProcessPropertiesDialog::CreateHandlesTab() {
 		nullptr
 	);
 
+	// Sits beside OK, outside the tab, so its clicks reach this window.
+	RECT clientRc;
+	GetClientRect(m_hDlg, &clientRc);
+	m_hHandleHistoryButton = CreateWindowW(
+		L"BUTTON",
+		L"Handle Growth...",
+		WS_CHILD | BS_PUSHBUTTON | WS_TABSTOP,
+		10, clientRc.bottom - 35,
+		140, 23,
+		m_hDlg,
+		reinterpret_cast<HMENU>(IDC_HANDLE_HISTORY_BUTTON),
+		m_hInstance,
+		nullptr
+	);
+	m_hSharedObjectsButton = CreateWindowW(
+		L"BUTTON",
+		L"Shared Objects...",
+		WS_CHILD | BS_PUSHBUTTON | WS_TABSTOP,
+		160, clientRc.bottom - 35,
+		140, 23,
+		m_hDlg,
+		reinterpret_cast<HMENU>(IDC_SHARED_OBJECTS_BUTTON),
+		m_hInstance,
+		nullptr
+	);
+	m_hMemorySummaryButton = CreateWindowW(
+		L"BUTTON",
+		L"Summary...",
+		WS_CHILD | BS_PUSHBUTTON | WS_TABSTOP,
+		10, clientRc.bottom - 35,
+		140, 23,
+		m_hDlg,
+		reinterpret_cast<HMENU>(IDC_MEMORY_SUMMARY_BUTTON),
+		m_hInstance,
+		nullptr
+	);
+	m_hMemoryStringsButton = CreateWindowW(
+		L"BUTTON",
+		L"Strings...",
+		WS_CHILD | BS_PUSHBUTTON | WS_TABSTOP,
+		160, clientRc.bottom - 35,
+		140, 23,
+		m_hDlg,
+		reinterpret_cast<HMENU>(IDC_MEMORY_STRINGS_BUTTON),
+		m_hInstance,
+		nullptr
+	);
+	m_hMemoryCompareButton = CreateWindowW(
+		L"BUTTON",
+		L"Compare Pages...",
+		WS_CHILD | BS_PUSHBUTTON | WS_TABSTOP,
+		310, clientRc.bottom - 35,
+		140, 23,
+		m_hDlg,
+		reinterpret_cast<HMENU>(IDC_MEMORY_COMPARE_BUTTON),
+		m_hInstance,
+		nullptr
+	);
+
 	if (m_hHandleListView) {
 		LVCOLUMNW lvc = {};
 		lvc.mask = LVCF_FMT | LVCF_WIDTH | LVCF_TEXT;
@@ -539,6 +644,27 @@ LRESULT ProcessPropertiesDialog::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM
 			return OnClose();
 		case WM_SIZE:
 			return OnSize();
+		case WM_USER + 1:
+			OnHandleNamesResolved();
+			return 0;
+		case WM_USER + 2:
+			OnStringsBatch();
+			return 0;
+		case WM_USER + 3:
+			OnStringsFinished();
+			return 0;
+		case WM_USER + 4:
+			OnPageCaptureFinished();
+			return 0;
+		case WM_USER + 5:
+			OnSharedObjectsFinished();
+			return 0;
+		case WM_TIMER:
+			// Skipped while the previous sample is still waiting for names.
+			if (wParam == IDT_HANDLE_SAMPLE_TIMER && m_HandleRows.empty()) {
+				SampleHandles();
+			}
+			return 0;
 		default:
 			return DefWindowProc(m_hDlg, uMsg, wParam, lParam);
 	}
@@ -550,6 +676,17 @@ LRESULT ProcessPropertiesDialog::OnCreate() {
 }
 
 LRESULT ProcessPropertiesDialog::OnCommand(WPARAM wParam) {
+	if (LOWORD(wParam) == IDC_HANDLE_HISTORY_BUTTON) {
+		ShowHandleGrowth();
+	} else if (LOWORD(wParam) == IDC_SHARED_OBJECTS_BUTTON) {
+		ShowSharedObjects();
+	} else if (LOWORD(wParam) == IDC_MEMORY_SUMMARY_BUTTON) {
+		ShowAddressSpaceSummary();
+	} else if (LOWORD(wParam) == IDC_MEMORY_STRINGS_BUTTON) {
+		ShowMemoryStrings();
+	} else if (LOWORD(wParam) == IDC_MEMORY_COMPARE_BUTTON) {
+		ComparePageSnapshots();
+	}
 	return 0;
 }
 
@@ -564,6 +701,14 @@ LRESULT ProcessPropertiesDialog::OnNotify(WPARAM wParam) {
 }
 
 LRESULT ProcessPropertiesDialog::OnClose() {
+	KillTimer(m_hDlg, IDT_HANDLE_SAMPLE_TIMER);
+	m_HandleNames.CancelPending();
+	m_HandleRows.clear();
+	// A running extraction stops and keeps what it has written; a running
+	// page capture is dropped.
+	m_StringsCancelled = true;
+	m_PageCaptureCancelled = true;
+	m_CorrelationCancelled = true;
 	ShowWindow(m_hDlg, SW_HIDE);
 	return 0;
 }
@@ -610,6 +755,21 @@ LRESULT ProcessPropertiesDialog::OnSize() {
 			int btnHeight = btnRc.bottom - btnRc.top;
 			SetWindowPos(hOkButton, nullptr, rc.right - btnWidth - 10, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
 		}
+		if (m_hHandleHistoryButton) {
+			SetWindowPos(m_hHandleHistoryButton, nullptr, rc.left, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+		}
+		if (m_hSharedObjectsButton) {
+			SetWindowPos(m_hSharedObjectsButton, nullptr, rc.left + 150, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+		}
+		if (m_hMemorySummaryButton) {
+			SetWindowPos(m_hMemorySummaryButton, nullptr, rc.left, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+		}
+		if (m_hMemoryStringsButton) {
+			SetWindowPos(m_hMemoryStringsButton, nullptr, rc.left + 150, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+		}
+		if (m_hMemoryCompareButton) {
+			SetWindowPos(m_hMemoryCompareButton, nullptr, rc.left + 300, rc.bottom + 10, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+		}
 	}
 	return 0;
 }
@@ -625,6 +785,16 @@ void ProcessPropertiesDialog::OnTabChanged(int tabIndex) {
 	ShowWindow(m_hEnvironmentTab, SW_HIDE);
 	ShowWindow(m_hNetworkTab, SW_HIDE);
 	ShowWindow(m_hServicesTab, SW_HIDE);
+	ShowWindow(m_hHandleHistoryButton, tabIndex == 5 ? SW_SHOW : SW_HIDE);
+	ShowWindow(m_hSharedObjectsButton, tabIndex == 5 ? SW_SHOW : SW_HIDE);
+	ShowWindow(m_hMemorySummaryButton, tabIndex == 4 ? SW_SHOW : SW_HIDE);
+	ShowWindow(m_hMemoryStringsButton, tabIndex == 4 ? SW_SHOW : SW_HIDE);
+	ShowWindow(m_hMemoryCompareButton, tabIndex == 4 ? SW_SHOW : SW_HIDE);
+	if (tabIndex == 5) {
+		SetTimer(m_hDlg, IDT_HANDLE_SAMPLE_TIMER, 10000, nullptr);
+	} else {
+		KillTimer(m_hDlg, IDT_HANDLE_SAMPLE_TIMER);
+	}
 
 	switch (tabIndex) {
 		case 0:
@@ -825,70 +995,732 @@ void ProcessPropertiesDialog::RefreshModulesTab() {
 void ProcessPropertiesDialog::RefreshMemoryTab() {
 	if (!m_hMemoryListView) return;
 
+	SendMessage(m_hMemoryListView, WM_SETREDRAW, FALSE, 0);
 	ListView_DeleteAllItems(m_hMemoryListView);
 	auto regions = m_MemoryManager.EnumerateMemoryRegions(m_ProcessId);
+	ListView_SetItemCount(m_hMemoryListView, static_cast<int>(regions.size()));
 
+	// Text is formatted into stack buffers per row; the list view copies it.
+	wchar_t addrText[32];
+	wchar_t sizeText[32];
+	wchar_t protectText[64];
 	for (size_t i = 0; i < regions.size(); ++i) {
 		const auto& region = regions[i];
 
-		std::wostringstream addrStr;
-		addrStr << std::hex << region.BaseAddress;
-		std::wstring addrWStr = L"0x" + addrStr.str();
-		LPCWSTR addrText = addrWStr.c_str();
+		swprintf_s(addrText, L"0x%llx", static_cast<ULONGLONG>(region.BaseAddress));
 
 		LVITEMW lvi = {};
 		lvi.mask = LVIF_TEXT;
 		lvi.iItem = static_cast<int>(i);
-		lvi.pszText = const_cast<LPWSTR>(addrText);
+		lvi.pszText = addrText;
 		ListView_InsertItem(m_hMemoryListView, &lvi);
 
-		std::wostringstream sizeStr;
-		sizeStr << region.RegionSize;
-		std::wstring sizeWStr = sizeStr.str();
-		LPCWSTR sizeText = sizeWStr.c_str();
-		ListView_SetItemText(m_hMemoryListView, i, 1, const_cast<LPWSTR>(sizeText));
+		swprintf_s(sizeText, L"%llu", static_cast<ULONGLONG>(region.RegionSize));
+		ListView_SetItemText(m_hMemoryListView, i, 1, sizeText);
+
+		ListView_SetItemText(m_hMemoryListView, i, 2, const_cast<LPWSTR>(MemoryManager::StateToString(region.State).data()));
+		MemoryManager::FormatProtection(region.Protect, protectText, _countof(protectText));
+		ListView_SetItemText(m_hMemoryListView, i, 3, protectText);
+		ListView_SetItemText(m_hMemoryListView, i, 4, const_cast<LPWSTR>(MemoryManager::TypeToString(region.Type).data()));
+	}
+	SendMessage(m_hMemoryListView, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(m_hMemoryListView, nullptr, TRUE);
+}
+
+void ProcessPropertiesDialog::ShowAddressSpaceSummary() {
+	auto regions = m_MemoryManager.EnumerateMemoryRegions(m_ProcessId);
+	if (regions.empty()) {
+		MessageBoxW(m_hDlg, L"Failed to read the address space of this process.", L"Address Space Summary", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	AddressSpaceHints hints;
+	AddressSpaceSummary::CollectHints(m_ProcessId, hints);
+	AddressSpaceSummary summary;
+	summary.Build(regions, hints);
+
+	std::wostringstream message;
+	message << L"Committed: " << FormatBytes(summary.GetCommitted())
+		<< L"\nReserved: " << FormatBytes(summary.GetReserved()) << L"\n\n";
+
+	for (size_t i = static_cast<size_t>(AllocationKind::Image); i < static_cast<size_t>(AllocationKind::Count); ++i) {
+		AllocationKind kind = static_cast<AllocationKind>(i);
+		const AddressSpaceTotals& totals = summary.GetTotals(kind);
+		if (totals.Allocations == 0) {
+			continue;
+		}
+		message << AddressSpaceSummary::KindToString(kind) << L": " << FormatBytes(totals.Committed) << L" committed, "
+			<< FormatBytes(totals.Reserved) << L" reserved in " << FormatNumber(totals.Allocations)
+			<< (totals.Allocations == 1 ? L" allocation\n" : L" allocations\n");
+	}
+
+	const AddressSpaceTotals& freeTotals = summary.GetTotals(AllocationKind::Free);
+	message << L"\nFree: " << FormatBytes(freeTotals.Size) << L" in " << FormatNumber(freeTotals.Allocations) << L" blocks";
+	if (freeTotals.Size > 0) {
+		std::wostringstream base;
+		base << std::hex << summary.GetLargestFreeBase();
+		message << L"\nLargest free block: " << FormatBytes(summary.GetLargestFree()) << L" at 0x" << base.str()
+			<< L" (" << std::fixed << std::setprecision(1)
+			<< 100.0 * static_cast<double>(summary.GetLargestFree()) / static_cast<double>(freeTotals.Size) << L"% of free space)";
+	}
+
+	MessageBoxW(m_hDlg, message.str().c_str(), L"Address Space Summary", MB_OK | MB_ICONINFORMATION);
+}
+
+void ProcessPropertiesDialog::ShowMemoryStrings() {
+	if (m_StringsThread.joinable()) {
+		if (MessageBoxW(m_hDlg, L"Strings are still being extracted. Stop now and keep those found so far?", L"Memory Strings",
+			MB_YESNO | MB_ICONQUESTION) == IDYES) {
+			m_StringsCancelled = true;
+		}
+		return;
+	}
+
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[260] = {};
+	swprintf_s(szFile, L"strings_%lu.txt", m_ProcessId);
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hDlg;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = sizeof(szFile) / sizeof(szFile[0]);
+	ofn.lpstrFilter = L"Text Files\0*.txt\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+	if (!GetSaveFileNameW(&ofn)) {
+		return;
+	}
+
+	auto reader = std::make_unique<ProcessMemoryReader>();
+	auto regions = m_MemoryManager.EnumerateMemoryRegions(m_ProcessId);
+	if (regions.empty() || !reader->Open(m_ProcessId)) {
+		MessageBoxW(m_hDlg, L"Failed to open the memory of this process.", L"Memory Strings", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	if (_wfopen_s(&m_StringsFile, szFile, L"wb") != 0 || !m_StringsFile) {
+		m_StringsFile = nullptr;
+		MessageBoxW(m_hDlg, L"Failed to create the output file.", L"Memory Strings", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	m_StringsCancelled = false;
+	m_StringsQueued.clear();
+	m_StringsPreview.clear();
+	m_StringsPath = szFile;
+	m_StringsProcessId = m_ProcessId;
+	m_StringsStartTick = GetTickCount64();
+	m_StringsWritten = 0;
+	SetWindowTextW(m_hMemoryStringsButton, L"Stop Strings");
+
+	// Only the first batch of a burst posts, so the window drains the queue
+	// at its own pace however fast the workers find strings.
+	HWND hDlg = m_hDlg;
+	m_StringsThread = std::thread([this, hDlg, reader = std::move(reader), regions = std::move(regions)]() {
+		auto sink = [this, hDlg](std::vector<ExtractedString>& batch) {
+			bool notify = false;
+			{
+				std::lock_guard<std::mutex> lock(m_StringsLock);
+				notify = m_StringsQueued.empty();
+				std::move(batch.begin(), batch.end(), std::back_inserter(m_StringsQueued));
+			}
+			if (notify) {
+				PostMessageW(hDlg, WM_USER + 2, 0, 0);
+			}
+		};
+		m_StringsStatistics = StringExtractor().Extract(reader->GetReadFunction(), regions, StringExtractorOptions(), sink, &m_StringsCancelled);
+		PostMessageW(hDlg, WM_USER + 3, 0, 0);
+	});
+}
+
+void ProcessPropertiesDialog::OnStringsBatch() {
+	std::vector<ExtractedString> batch;
+	{
+		std::lock_guard<std::mutex> lock(m_StringsLock);
+		batch.swap(m_StringsQueued);
+	}
+	if (!m_StringsFile || batch.empty()) {
+		return;
+	}
+
+	const size_t previewCount = 40;
+	for (auto& result : batch) {
+		std::string line = StringExtractor::FormatLine(result);
+		fwrite(line.data(), 1, line.size(), m_StringsFile);
+
+		if (m_StringsPreview.size() < previewCount) {
+			m_StringsPreview.push_back(std::move(result));
+		}
+	}
+	m_StringsWritten += batch.size();
 
-		LPCWSTR stateText = region.StateString.c_str();
-		ListView_SetItemText(m_hMemoryListView, i, 2, const_cast<LPWSTR>(stateText));
-		LPCWSTR protectText = region.ProtectionString.c_str();
-		ListView_SetItemText(m_hMemoryListView, i, 3, const_cast<LPWSTR>(protectText));
-		LPCWSTR typeText = region.TypeString.c_str();
-		ListView_SetItemText(m_hMemoryListView, i, 4, const_cast<LPWSTR>(typeText));
+	std::wstring buttonText = L"Stop (" + FormatNumber(m_StringsWritten) + L")";
+	SetWindowTextW(m_hMemoryStringsButton, buttonText.c_str());
+}
+
+void ProcessPropertiesDialog::OnStringsFinished() {
+	if (!m_StringsThread.joinable()) {
+		return;
+	}
+	m_StringsThread.join();
+	OnStringsBatch();
+	SetWindowTextW(m_hMemoryStringsButton, L"Strings...");
+
+	bool written = ferror(m_StringsFile) == 0;
+	fclose(m_StringsFile);
+	m_StringsFile = nullptr;
+	ULONGLONG elapsed = GetTickCount64() - m_StringsStartTick;
+	std::vector<ExtractedString> preview;
+	preview.swap(m_StringsPreview);
+
+	// Closing the dialog cancels quietly.
+	if (!IsWindowVisible(m_hDlg)) {
+		return;
+	}
+	if (!written) {
+		MessageBoxW(m_hDlg, L"Failed to write the output file.", L"Memory Strings", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	std::sort(preview.begin(), preview.end(), [](const ExtractedString& a, const ExtractedString& b) {
+		return a.Address < b.Address;
+	});
+
+	const StringExtractionStatistics& statistics = m_StringsStatistics;
+	std::wostringstream message;
+	if (m_StringsCancelled) {
+		message << L"Stopped early. ";
 	}
+	message << FormatNumber(m_StringsWritten) << L" strings from " << FormatBytes(statistics.BytesScanned)
+		<< L" in " << FormatNumber(statistics.Regions) << L" regions of process " << m_StringsProcessId << L" (" << elapsed << L" ms).\n"
+		<< L"Saved to " << m_StringsPath << L"\n\n";
+	for (const auto& result : preview) {
+		std::wstring text = result.Text.size() > 60 ? result.Text.substr(0, 60) + L"..." : result.Text;
+		message << L"0x" << std::hex << result.Address << std::dec
+			<< (result.Encoding == StringEncoding::Ascii ? L"  A  " : L"  U  ") << text << L"\n";
+	}
+
+	MessageBoxW(m_hDlg, message.str().c_str(), L"Memory Strings", MB_OK | MB_ICONINFORMATION);
+}
+
+void ProcessPropertiesDialog::ComparePageSnapshots() {
+	if (m_PageCaptureThread.joinable()) {
+		if (MessageBoxW(m_hDlg, L"Pages are still being captured. Stop the capture?", L"Compare Pages", MB_YESNO | MB_ICONQUESTION) == IDYES) {
+			m_PageCaptureCancelled = true;
+		}
+		return;
+	}
+
+	ULARGE_INTEGER startTime;
+	startTime.LowPart = m_ProcessInfo.CreationTime.dwLowDateTime;
+	startTime.HighPart = m_ProcessInfo.CreationTime.dwHighDateTime;
+	bool haveBaseline = !m_PageBaseline.IsEmpty() && m_PageBaselineProcessId == m_ProcessId
+		&& m_PageBaselineStartTime == startTime.QuadPart;
+
+	auto reader = std::make_unique<ProcessMemoryReader>();
+	auto regions = m_MemoryManager.EnumerateMemoryRegions(m_ProcessId);
+	if (regions.empty() || !reader->Open(m_ProcessId)) {
+		MessageBoxW(m_hDlg, L"Failed to open the memory of this process.", L"Compare Pages", MB_OK | MB_ICONERROR);
+		return;
+	}
+	if (!haveBaseline) {
+		m_PageBaseline.Clear();
+	}
+
+	m_PageCaptureCancelled = false;
+	m_PageCaptured = false;
+	m_PageCaptureHasBaseline = haveBaseline;
+	m_PageCaptureProcessId = m_ProcessId;
+	m_PageCaptureStartTime = startTime.QuadPart;
+	SetWindowTextW(m_hMemoryCompareButton, L"Stop Capture");
+
+	// The capture and the diff against the baseline both run on the thread;
+	// the window only formats the result.
+	HWND hDlg = m_hDlg;
+	m_PageCaptureThread = std::thread([this, hDlg, haveBaseline, reader = std::move(reader), regions = std::move(regions)]() {
+		// Contents are kept for byte-level diffs unless the process is
+		// large. The baseline holds its contents between comparisons, so
+		// the limit is kept small.
+		PageCaptureOptions options;
+		options.KeepContentsLimit = 32ULL * 1024 * 1024;
+		m_PageCaptureTick = GetTickCount64();
+		m_PageCaptured = m_PageCapture.Capture(reader->GetReadFunction(), regions, options, &m_PageCaptureCancelled);
+		m_PageCaptureElapsed = GetTickCount64() - m_PageCaptureTick;
+		if (m_PageCaptured && haveBaseline) {
+			m_PageChanges = PageHashSnapshot::Diff(m_PageBaseline, m_PageCapture);
+		}
+		PostMessageW(hDlg, WM_USER + 4, 0, 0);
+	});
+}
+
+void ProcessPropertiesDialog::OnPageCaptureFinished() {
+	if (!m_PageCaptureThread.joinable()) {
+		return;
+	}
+	m_PageCaptureThread.join();
+	SetWindowTextW(m_hMemoryCompareButton, L"Compare Pages...");
+
+	PageHashSnapshot capture = std::move(m_PageCapture);
+	std::vector<PageChange> changes;
+	changes.swap(m_PageChanges);
+	bool haveBaseline = m_PageCaptureHasBaseline;
+	ULONGLONG captureTick = m_PageCaptureTick;
+	ULONGLONG elapsed = m_PageCaptureElapsed;
+	// Closing the dialog cancels quietly.
+	if (m_PageCaptureCancelled) {
+		if (IsWindowVisible(m_hDlg)) {
+			MessageBoxW(m_hDlg, L"The capture was stopped; the baseline is unchanged.", L"Compare Pages", MB_OK | MB_ICONINFORMATION);
+		}
+		return;
+	}
+	if (!m_PageCaptured) {
+		MessageBoxW(m_hDlg, L"No readable memory was found in this process.", L"Compare Pages", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	std::wostringstream message;
+	if (!haveBaseline) {
+		message << L"Captured " << FormatNumber(capture.GetPageCount()) << L" pages ("
+			<< FormatBytes(static_cast<ULONGLONG>(capture.GetPageCount()) * PageHashSnapshot::PageSize) << L") in "
+			<< elapsed << L" ms, using " << FormatBytes(capture.GetMemoryUsage()) << L".\n"
+			<< (capture.HasContents() ? L"Page contents were kept, so changed bytes will be shown."
+				: L"The process is too large to keep page contents, so only changed pages will be listed.")
+			<< L"\n\nClick Compare Pages again to see what changed since now.";
+		MessageBoxW(m_hDlg, message.str().c_str(), L"Compare Pages", MB_OK | MB_ICONINFORMATION);
+	} else {
+		ULONGLONG pages[4] = {};
+		for (const auto& change : changes) {
+			pages[static_cast<size_t>(change.Kind)] += change.PageCount;
+		}
+
+		message << L"Since the capture " << (captureTick - m_PageBaselineTick) / 1000 << L" s ago:\n"
+			<< FormatNumber(pages[static_cast<size_t>(PageChangeKind::Changed)]) << L" pages changed, "
+			<< FormatNumber(pages[static_cast<size_t>(PageChangeKind::Added)]) << L" new, "
+			<< FormatNumber(pages[static_cast<size_t>(PageChangeKind::Removed)]) << L" freed, "
+			<< FormatNumber(pages[static_cast<size_t>(PageChangeKind::Unreadable)]) << L" unreadable ("
+			<< elapsed << L" ms)\n\n";
+
+		const size_t shownChanges = 25;
+		const size_t shownByteDiffs = 4;
+		size_t byteDiffsShown = 0;
+		std::vector<BYTE> oldPage(PageHashSnapshot::PageSize);
+		std::vector<BYTE> newPage(PageHashSnapshot::PageSize);
+		for (size_t i = 0; i < changes.size() && i < shownChanges; ++i) {
+			const PageChange& change = changes[i];
+			message << (change.Kind == PageChangeKind::Changed ? L"Changed " : change.Kind == PageChangeKind::Added ? L"New "
+				: change.Kind == PageChangeKind::Removed ? L"Freed " : L"Unreadable ")
+				<< L"0x" << std::hex << change.Address << std::dec << L" (" << change.PageCount
+				<< (change.PageCount == 1 ? L" page)\n" : L" pages)\n");
+
+			// Bytes are shown for the first page of the first few changed runs.
+			if (change.Kind != PageChangeKind::Changed || byteDiffsShown >= shownByteDiffs
+				|| !m_PageBaseline.GetPage(change.Address, oldPage.data()) || !capture.GetPage(change.Address, newPage.data())) {
+				continue;
+			}
+			++byteDiffsShown;
+			auto ranges = PageHashSnapshot::CompareBytes(oldPage.data(), newPage.data(), PageHashSnapshot::PageSize);
+			for (size_t r = 0; r < ranges.size() && r < 4; ++r) {
+				wchar_t line[128];
+				swprintf_s(line, L"    +0x%03zX: %zu byte%s", ranges[r].Offset, ranges[r].Length, ranges[r].Length == 1 ? L"" : L"s");
+				message << line;
+				for (size_t b = 0; b < ranges[r].Length && b < 8; ++b) {
+					swprintf_s(line, L" %02X>%02X", oldPage[ranges[r].Offset + b], newPage[ranges[r].Offset + b]);
+					message << line;
+				}
+				message << L"\n";
+			}
+			if (ranges.size() > 4) {
+				message << L"    ... and " << (ranges.size() - 4) << L" more runs\n";
+			}
+		}
+		if (changes.size() > shownChanges) {
+			message << L"... and " << (changes.size() - shownChanges) << L" more runs.\n";
+		} else if (changes.empty()) {
+			message << L"No pages changed.\n";
+		}
+		message << L"\nThe new capture is now the baseline.";
+		MessageBoxW(m_hDlg, message.str().c_str(), L"Compare Pages", MB_OK | MB_ICONINFORMATION);
+	}
+
+	m_PageBaseline = std::move(capture);
+	m_PageBaselineProcessId = m_PageCaptureProcessId;
+	m_PageBaselineStartTime = m_PageCaptureStartTime;
+	m_PageBaselineTick = captureTick;
 }
 
 void ProcessPropertiesDialog::RefreshHandlesTab() {
 	if (!m_hHandleListView) return;
 
+	// Types and access show at once; names are filled in as they resolve.
+	m_HandleNames.CancelPending();
+	m_HandleNames.Start(m_hDlg, WM_USER + 1);
+	m_HandleRows.clear();
+	m_HandleSampleRecorded = false;
+
+	int topIndex = ListView_GetTopIndex(m_hHandleListView);
+	SendMessage(m_hHandleListView, WM_SETREDRAW, FALSE, 0);
 	ListView_DeleteAllItems(m_hHandleListView);
-	auto handles = m_HandleManager.EnumerateHandles(m_ProcessId);
+	m_Handles = m_HandleManager.EnumerateHandles(m_ProcessId, false);
 
-	for (size_t i = 0; i < handles.size(); ++i) {
-		const auto& handle = handles[i];
+	for (size_t i = 0; i < m_Handles.size(); ++i) {
+		InsertHandleRow(static_cast<int>(i), m_Handles[i]);
+		RequestHandleName(static_cast<int>(i), false);
+	}
 
-		std::wostringstream handleStr;
-		handleStr << std::hex << reinterpret_cast<ULONG_PTR>(handle.HandleValue);
-		std::wstring handleWStr = L"0x" + handleStr.str();
-		LPCWSTR handleText = handleWStr.c_str();
+	// Keep the scroll position across refreshes.
+	if (topIndex > 0 && topIndex < static_cast<int>(m_Handles.size())) {
+		ListView_EnsureVisible(m_hHandleListView, static_cast<int>(m_Handles.size()) - 1, FALSE);
+		ListView_EnsureVisible(m_hHandleListView, topIndex, FALSE);
+	}
+	SendMessage(m_hHandleListView, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(m_hHandleListView, nullptr, TRUE);
 
-		LVITEMW lvi = {};
-		lvi.mask = LVIF_TEXT;
-		lvi.iItem = static_cast<int>(i);
-		lvi.pszText = const_cast<LPWSTR>(handleText);
-		ListView_InsertItem(m_hHandleListView, &lvi);
+	if (m_HandleRows.empty()) {
+		RecordHandleSample();
+	}
+}
+
+void ProcessPropertiesDialog::SampleHandles() {
+	if (!m_hHandleListView) return;
+
+	// Rows of handles that are still open stay where they are, so the
+	// selection and scroll position survive. Their names are asked for
+	// again, since a reused handle value may now name another object; the
+	// old name shows until the new one arrives.
+	std::vector<HandleInfo> current = m_HandleManager.EnumerateHandles(m_ProcessId, false);
+	std::unordered_map<ULONG_PTR, size_t> currentIndex;
+	currentIndex.reserve(current.size());
+	for (size_t i = 0; i < current.size(); ++i) {
+		currentIndex[reinterpret_cast<ULONG_PTR>(current[i].HandleValue)] = i;
+	}
+
+	m_HandleNames.CancelPending();
+	m_HandleNames.Start(m_hDlg, WM_USER + 1);
+	m_HandleRows.clear();
+	m_HandleSampleRecorded = false;
+
+	SendMessage(m_hHandleListView, WM_SETREDRAW, FALSE, 0);
+
+	// Closed handles, and values reused for another type, lose their row.
+	std::vector<size_t> sources(m_Handles.size(), current.size());
+	std::vector<bool> placed(current.size(), false);
+	for (size_t row = m_Handles.size(); row-- > 0;) {
+		auto it = currentIndex.find(reinterpret_cast<ULONG_PTR>(m_Handles[row].HandleValue));
+		if (it == currentIndex.end() || current[it->second].ObjectTypeIndex != m_Handles[row].ObjectTypeIndex) {
+			ListView_DeleteItem(m_hHandleListView, static_cast<int>(row));
+			continue;
+		}
+		sources[row] = it->second;
+		placed[it->second] = true;
+	}
+
+	std::vector<HandleInfo> handles;
+	handles.reserve(current.size());
+	for (size_t row = 0; row < m_Handles.size(); ++row) {
+		if (sources[row] == current.size()) {
+			continue;
+		}
+		HandleInfo& handle = current[sources[row]];
+		handle.ObjectName = std::move(m_Handles[row].ObjectName);
+		if (handle.AccessMask != m_Handles[row].AccessMask) {
+			std::wostringstream accessStr;
+			accessStr << L"0x" << std::hex << handle.AccessMask;
+			std::wstring accessWStr = accessStr.str();
+			ListView_SetItemText(m_hHandleListView, static_cast<int>(handles.size()), 2, const_cast<LPWSTR>(accessWStr.c_str()));
+		}
+		handles.push_back(std::move(handle));
+	}
+
+	// New handles go at the end.
+	size_t keptRows = handles.size();
+	for (size_t i = 0; i < current.size(); ++i) {
+		if (!placed[i]) {
+			InsertHandleRow(static_cast<int>(handles.size()), current[i]);
+			handles.push_back(std::move(current[i]));
+		}
+	}
+	m_Handles = std::move(handles);
+
+	for (size_t i = 0; i < m_Handles.size(); ++i) {
+		RequestHandleName(static_cast<int>(i), i < keptRows);
+	}
 
-		LPCWSTR typeNameText = handle.ObjectTypeName.c_str();
-		ListView_SetItemText(m_hHandleListView, i, 1, const_cast<LPWSTR>(typeNameText));
+	SendMessage(m_hHandleListView, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(m_hHandleListView, nullptr, TRUE);
 
-		std::wostringstream accessStr;
-		accessStr << std::hex << handle.AccessMask;
-		std::wstring accessWStr = L"0x" + accessStr.str();
-		LPCWSTR accessText = accessWStr.c_str();
-		ListView_SetItemText(m_hHandleListView, i, 2, const_cast<LPWSTR>(accessText));
+	if (m_HandleRows.empty()) {
+		RecordHandleSample();
+	}
+}
+
+void ProcessPropertiesDialog::InsertHandleRow(int row, const HandleInfo& handle) {
+	std::wostringstream handleStr;
+	handleStr << std::hex << reinterpret_cast<ULONG_PTR>(handle.HandleValue);
+	std::wstring handleWStr = L"0x" + handleStr.str();
+
+	LVITEMW lvi = {};
+	lvi.mask = LVIF_TEXT;
+	lvi.iItem = row;
+	lvi.pszText = const_cast<LPWSTR>(handleWStr.c_str());
+	ListView_InsertItem(m_hHandleListView, &lvi);
+
+	ListView_SetItemText(m_hHandleListView, row, 1, const_cast<LPWSTR>(handle.ObjectTypeName.c_str()));
+
+	std::wostringstream accessStr;
+	accessStr << std::hex << handle.AccessMask;
+	std::wstring accessWStr = L"0x" + accessStr.str();
+	ListView_SetItemText(m_hHandleListView, row, 2, const_cast<LPWSTR>(accessWStr.c_str()));
+}
 
-		std::wstring nameStr = handle.ObjectName.empty() ? L"N/A" : handle.ObjectName;
+void ProcessPropertiesDialog::RequestHandleName(int row, bool keepShownName) {
+	HandleInfo& handle = m_Handles[row];
+	std::wstring name;
+	std::wstring nameStr;
+	if (m_HandleNames.Request(handle, name)) {
+		nameStr = name.empty() ? L"N/A" : name;
+		handle.ObjectName = std::move(name);
+	} else {
+		m_HandleRows[reinterpret_cast<ULONG_PTR>(handle.HandleValue)] = row;
+		if (keepShownName) {
+			return;
+		}
+		nameStr = L"...";
+	}
+	ListView_SetItemText(m_hHandleListView, row, 3, const_cast<LPWSTR>(nameStr.c_str()));
+}
+
+void ProcessPropertiesDialog::OnHandleNamesResolved() {
+	auto results = m_HandleNames.TakeResults();
+	if (!m_hHandleListView) return;
+
+	for (const auto& result : results) {
+		if (result.ProcessId != m_ProcessId) {
+			continue;
+		}
+		auto it = m_HandleRows.find(result.HandleValue);
+		if (it == m_HandleRows.end()) {
+			continue;
+		}
+
+		std::wstring nameStr = result.Name.empty() ? L"N/A" : result.Name;
 		LPCWSTR nameText = nameStr.c_str();
-		ListView_SetItemText(m_hHandleListView, i, 3, const_cast<LPWSTR>(nameText));
+		ListView_SetItemText(m_hHandleListView, it->second, 3, const_cast<LPWSTR>(nameText));
+		if (static_cast<size_t>(it->second) < m_Handles.size()) {
+			m_Handles[it->second].ObjectName = result.Name;
+		}
+		m_HandleRows.erase(it);
+	}
+
+	if (m_HandleRows.empty() && !m_HandleSampleRecorded) {
+		RecordHandleSample();
+	}
+}
+
+void ProcessPropertiesDialog::RecordHandleSample() {
+	ULARGE_INTEGER startTime;
+	startTime.LowPart = m_ProcessInfo.CreationTime.dwLowDateTime;
+	startTime.HighPart = m_ProcessInfo.CreationTime.dwHighDateTime;
+	m_HandleHistory.Record(m_ProcessId, startTime.QuadPart, GetTickCount64(), m_Handles);
+	m_HandleSampleRecorded = true;
+}
+
+void ProcessPropertiesDialog::ShowHandleGrowth() {
+	ULARGE_INTEGER startTime;
+	startTime.LowPart = m_ProcessInfo.CreationTime.dwLowDateTime;
+	startTime.HighPart = m_ProcessInfo.CreationTime.dwHighDateTime;
+
+	size_t samples = m_HandleHistory.GetSampleCount(m_ProcessId, startTime.QuadPart);
+	if (samples < 2) {
+		MessageBoxW(m_hDlg, L"A handle sample is taken every 10 seconds while the Handles tab is open.\n"
+			L"At least two samples are needed to show growth.", L"Handle Growth", MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	size_t from = 0, to = 0;
+	if (!PickHandleSample(0, samples - 2, L"Compare from:", from)
+		|| !PickHandleSample(from + 1, samples - 1, L"Compare to:", to)) {
+		return;
+	}
+
+	ULONGLONG fromTime = 0, toTime = 0;
+	size_t fromTotal = 0, toTotal = 0;
+	m_HandleHistory.GetSample(m_ProcessId, startTime.QuadPart, from, fromTime, fromTotal);
+	m_HandleHistory.GetSample(m_ProcessId, startTime.QuadPart, to, toTime, toTotal);
+
+	std::wostringstream message;
+	message << L"Handles: " << FormatNumber(fromTotal) << L" -> " << FormatNumber(toTotal)
+		<< L" over " << (toTime - fromTime) / 1000 << L" s (samples " << from + 1 << L" to " << to + 1
+		<< L" of " << samples << L")\n";
+
+	const size_t MaxLines = 10;
+	auto byType = m_HandleHistory.Diff(m_ProcessId, startTime.QuadPart, from, to, false);
+	message << L"\nBy type:\n";
+	for (size_t i = 0; i < byType.size() && i < MaxLines; ++i) {
+		message << L"  " << HandleHistory::FormatChange(byType[i]) << L"\n";
+	}
+	if (byType.empty()) {
+		message << L"  No change\n";
+	}
+
+	auto byPrefix = m_HandleHistory.Diff(m_ProcessId, startTime.QuadPart, from, to, true);
+	size_t shown = 0;
+	for (const auto& change : byPrefix) {
+		if (change.Prefix.empty()) {
+			continue;
+		}
+		if (shown++ == 0) {
+			message << L"\nBy name:\n";
+		}
+		message << L"  " << HandleHistory::FormatChange(change) << L"\n";
+		if (shown == MaxLines) {
+			break;
+		}
+	}
+
+	MessageBoxW(m_hDlg, message.str().c_str(), L"Handle Growth", MB_OK | MB_ICONINFORMATION);
+}
+
+bool ProcessPropertiesDialog::PickHandleSample(size_t first, size_t last, const wchar_t* title, size_t& index) {
+	ULARGE_INTEGER startTime;
+	startTime.LowPart = m_ProcessInfo.CreationTime.dwLowDateTime;
+	startTime.HighPart = m_ProcessInfo.CreationTime.dwHighDateTime;
+
+	ULONGLONG baseTime = 0;
+	size_t total = 0;
+	m_HandleHistory.GetSample(m_ProcessId, startTime.QuadPart, 0, baseTime, total);
+
+	HMENU hMenu = CreatePopupMenu();
+	if (!hMenu) {
+		return false;
+	}
+	AppendMenuW(hMenu, MF_STRING | MF_DISABLED, 0, title);
+	AppendMenuW(hMenu, MF_SEPARATOR, 0, nullptr);
+	// Commands are the sample index plus one, as 0 means dismissed.
+	for (size_t i = first; i <= last; ++i) {
+		ULONGLONG time = 0;
+		if (!m_HandleHistory.GetSample(m_ProcessId, startTime.QuadPart, i, time, total)) {
+			continue;
+		}
+		std::wostringstream item;
+		item << L"Sample " << i + 1 << L" at +" << (time - baseTime) / 1000 << L" s: "
+			<< FormatNumber(total) << L" handles";
+		AppendMenuW(hMenu, MF_STRING, static_cast<UINT_PTR>(i + 1), item.str().c_str());
+	}
+
+	RECT rc;
+	GetWindowRect(m_hHandleHistoryButton, &rc);
+	UINT command = static_cast<UINT>(TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_NONOTIFY | TPM_LEFTALIGN | TPM_BOTTOMALIGN,
+		rc.left, rc.top, 0, m_hDlg, nullptr));
+	DestroyMenu(hMenu);
+	if (command == 0) {
+		return false;
+	}
+	index = command - 1;
+	return true;
+}
+
+void ProcessPropertiesDialog::ShowSharedObjects() {
+	// The capture cannot be interrupted, so the button stays disabled until
+	// it is done.
+	if (m_CorrelationThread.joinable()) {
+		return;
+	}
+
+	m_CorrelationCancelled = false;
+	m_CorrelationCaptured = false;
+	m_CorrelationProcessId = m_ProcessId;
+	EnableWindow(m_hSharedObjectsButton, FALSE);
+	SetWindowTextW(m_hSharedObjectsButton, L"Capturing...");
+
+	// Capturing the handle table opens every process, as does naming the
+	// linked ones, so both run on the thread.
+	HWND hDlg = m_hDlg;
+	m_CorrelationThread = std::thread([this, hDlg, processId = m_ProcessId]() {
+		m_CorrelationCaptured = m_Correlation.Capture(m_CorrelationSnapshot);
+		if (m_CorrelationCaptured && !m_CorrelationCancelled) {
+			m_CorrelationObjectCount = m_Correlation.GetProcessObjects(processId).size();
+			m_CorrelationLinks = m_Correlation.GetLinks(processId);
+			for (const ProcessLink& link : m_CorrelationLinks) {
+				DWORD otherId = link.OtherProcessId;
+				if (m_CorrelationNames.count(otherId) == 0) {
+					std::wstring path = m_ProcessManager.GetProcessImagePath(otherId);
+					size_t separator = path.find_last_of(L"\\/");
+					m_CorrelationNames[otherId] = path.empty() ? L"<unknown>"
+						: path.substr(separator == std::wstring::npos ? 0 : separator + 1);
+				}
+			}
+		}
+		PostMessageW(hDlg, WM_USER + 5, 0, 0);
+	});
+}
+
+void ProcessPropertiesDialog::OnSharedObjectsFinished() {
+	if (!m_CorrelationThread.joinable()) {
+		return;
+	}
+	m_CorrelationThread.join();
+	EnableWindow(m_hSharedObjectsButton, TRUE);
+	SetWindowTextW(m_hSharedObjectsButton, L"Shared Objects...");
+
+	std::vector<ProcessLink> links;
+	links.swap(m_CorrelationLinks);
+	std::unordered_map<DWORD, std::wstring> processNames;
+	processNames.swap(m_CorrelationNames);
+	// Closing the dialog or moving it to another process drops the result.
+	if (m_CorrelationCancelled || m_CorrelationProcessId != m_ProcessId) {
+		return;
+	}
+	if (!m_CorrelationCaptured) {
+		MessageBoxW(m_hDlg, L"Failed to capture the system handle table.", L"Shared Objects", MB_OK | MB_ICONERROR);
+		return;
+	}
+
+	const ObjectTypeTable& types = ObjectTypeTable::GetSystem();
+	std::wostringstream message;
+	message << L"Shared objects: " << m_CorrelationObjectCount << L"\n";
+	message << L"Links to other processes: " << links.size() << L"\n\n";
+
+	const size_t MaxLines = 20;
+	for (size_t i = 0; i < links.size() && i < MaxLines; ++i) {
+		const ProcessLink& link = links[i];
+		std::wstring other = processNames[link.OtherProcessId] + L" (" + std::to_wstring(link.OtherProcessId) + L")";
+		switch (link.Kind) {
+			case ObjectLinkKind::HoldsProcess:
+				message << L"  Holds a handle to " << other << L"\n";
+				break;
+			case ObjectLinkKind::HeldByProcess:
+				message << L"  Handle held by " << other << L"\n";
+				break;
+			default:
+				message << L"  Shares " << link.ObjectCount << L" " << types.GetName(link.ObjectTypeIndex)
+					<< (link.ObjectCount == 1 ? L" object" : L" objects") << L" with " << other << L"\n";
+				break;
+		}
+	}
+	if (links.size() > MaxLines) {
+		message << L"  ... and " << (links.size() - MaxLines) << L" more\n";
+	}
+	message << L"\nExport the sharing graph of all processes to CSV?";
+
+	if (MessageBoxW(m_hDlg, message.str().c_str(), L"Shared Objects", MB_YESNO | MB_ICONINFORMATION) != IDYES) {
+		return;
+	}
+
+	OPENFILENAMEW ofn = {};
+	wchar_t szFile[260] = {};
+	wcscpy_s(szFile, L"shared_objects.csv");
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = m_hDlg;
+	ofn.lpstrFile = szFile;
+	ofn.nMaxFile = sizeof(szFile) / sizeof(szFile[0]);
+	ofn.lpstrFilter = L"CSV Files\0*.csv\0All Files\0*.*\0";
+	ofn.nFilterIndex = 1;
+	ofn.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY;
+	if (!GetSaveFileNameW(&ofn)) {
+		return;
+	}
+
+	if (!m_Correlation.ExportCsv(szFile)) {
+		MessageBoxW(m_hDlg, L"Failed to export the sharing graph.", L"Export Failed", MB_OK | MB_ICONERROR);
 	}
 }
 
@@ -1299,7 +2131,10 @@ void ProcessPropertiesDialog::RefreshServicesTab() {
 	if (!m_hServicesListView) return;
 
 	ListView_DeleteAllItems(m_hServicesListView);
-	auto services = m_ServiceManager.GetServicesForProcess(m_ProcessId);
+	std::vector<ServiceInfo> services;
+	if (m_ServiceSnapshot.Refresh()) {
+		services = m_ServiceManager.GetServicesForProcess(m_ServiceSnapshot, m_ProcessId);
+	}
 
 	for (size_t i = 0; i < services.size(); ++i) {
 		const auto& service = services[i];
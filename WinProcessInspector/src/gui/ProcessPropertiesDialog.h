@@ -5,11 +5,23 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdio>
 #include "../core/ProcessManager.h"
 #include "../core/ModuleManager.h"
 #include "../core/MemoryManager.h"
 #include "../core/HandleManager.h"
+#include "../core/HandleNameResolver.h"
+#include "../core/HandleHistory.h"
+#include "../core/ObjectCorrelation.h"
+#include "../core/AddressSpaceSummary.h"
+#include "../core/PageHashSnapshot.h"
+#include "../core/StringExtractor.h"
 #include "../core/ServiceManager.h"
+#include "../core/ServiceSnapshot.h"
 #include "../security/SecurityManager.h"
 
 namespace WinProcessInspector {
@@ -58,7 +70,27 @@ namespace GUI {
 		void RefreshThreadsTab();
 		void RefreshModulesTab();
 		void RefreshMemoryTab();
+		void ShowAddressSpaceSummary();
+		void ShowMemoryStrings();
+		// Writes the batches the extraction thread has queued.
+		void OnStringsBatch();
+		void OnStringsFinished();
+		void ComparePageSnapshots();
+		void OnPageCaptureFinished();
 		void RefreshHandlesTab();
+		// Timed sample: updates the Handles list in place.
+		void SampleHandles();
+		void InsertHandleRow(int row, const WinProcessInspector::Core::HandleInfo& handle);
+		// Shows the name if known, otherwise queues it; keepShownName leaves
+		// the row's current text until the result arrives.
+		void RequestHandleName(int row, bool keepShownName);
+		void OnHandleNamesResolved();
+		void RecordHandleSample();
+		void ShowHandleGrowth();
+		// Menu of samples first..last under the button; false if dismissed.
+		bool PickHandleSample(size_t first, size_t last, const wchar_t* title, size_t& index);
+		void ShowSharedObjects();
+		void OnSharedObjectsFinished();
 		void RefreshSecurityTab();
 		void RefreshEnvironmentTab();
 		void RefreshNetworkTab();
@@ -85,6 +117,11 @@ namespace GUI {
 		HWND m_hMemoryListView;
 		HWND m_hHandleListView;
 		HWND m_hServicesListView;
+		HWND m_hHandleHistoryButton;
+		HWND m_hSharedObjectsButton;
+		HWND m_hMemorySummaryButton;
+		HWND m_hMemoryStringsButton;
+		HWND m_hMemoryCompareButton;
 
 		DWORD m_ProcessId;
 		WinProcessInspector::Core::ProcessInfo m_ProcessInfo;
@@ -93,7 +130,60 @@ namespace GUI {
 		WinProcessInspector::Core::ModuleManager m_ModuleManager;
 		WinProcessInspector::Core::MemoryManager m_MemoryManager;
 		WinProcessInspector::Core::HandleManager m_HandleManager;
+		WinProcessInspector::Core::HandleNameResolver m_HandleNames;
+		// Rows of the Handles tab, in list order.
+		std::vector<WinProcessInspector::Core::HandleInfo> m_Handles;
+		// Handle value to row, for names that arrive later.
+		std::unordered_map<ULONG_PTR, int> m_HandleRows;
+		bool m_HandleSampleRecorded;
+		WinProcessInspector::Core::HandleHistory m_HandleHistory;
+		WinProcessInspector::Core::HandleSnapshot m_CorrelationSnapshot;
+		WinProcessInspector::Core::ObjectCorrelation m_Correlation;
+		// Handle table capture in the background, with the links of
+		// m_CorrelationProcessId and the names of the processes shown.
+		// Filled by the thread before it posts WM_USER + 5.
+		std::thread m_CorrelationThread;
+		std::atomic<bool> m_CorrelationCancelled;
+		bool m_CorrelationCaptured;
+		DWORD m_CorrelationProcessId;
+		size_t m_CorrelationObjectCount;
+		std::vector<WinProcessInspector::Core::ProcessLink> m_CorrelationLinks;
+		std::unordered_map<DWORD, std::wstring> m_CorrelationNames;
+		// Earlier capture the next page comparison is made against.
+		WinProcessInspector::Core::PageHashSnapshot m_PageBaseline;
+		DWORD m_PageBaselineProcessId;
+		ULONGLONG m_PageBaselineStartTime;
+		ULONGLONG m_PageBaselineTick;
+		// Page capture in the background, and its diff against the baseline
+		// when there is one. Filled by the thread before it posts
+		// WM_USER + 4.
+		std::thread m_PageCaptureThread;
+		std::atomic<bool> m_PageCaptureCancelled;
+		WinProcessInspector::Core::PageHashSnapshot m_PageCapture;
+		std::vector<WinProcessInspector::Core::PageChange> m_PageChanges;
+		bool m_PageCaptured;
+		bool m_PageCaptureHasBaseline;
+		DWORD m_PageCaptureProcessId;
+		ULONGLONG m_PageCaptureStartTime;
+		ULONGLONG m_PageCaptureTick;
+		ULONGLONG m_PageCaptureElapsed;
+		// Strings extracted in the background, one extraction at a time. The
+		// thread queues batches and posts WM_USER + 2 when the queue was
+		// empty, and WM_USER + 3 after the last batch; the window writes
+		// them to the file. The statistics are filled before WM_USER + 3.
+		std::thread m_StringsThread;
+		std::atomic<bool> m_StringsCancelled;
+		std::mutex m_StringsLock;
+		std::vector<WinProcessInspector::Core::ExtractedString> m_StringsQueued;
+		WinProcessInspector::Core::StringExtractionStatistics m_StringsStatistics;
+		FILE* m_StringsFile;
+		std::wstring m_StringsPath;
+		DWORD m_StringsProcessId;
+		ULONGLONG m_StringsStartTick;
+		ULONGLONG m_StringsWritten;
+		std::vector<WinProcessInspector::Core::ExtractedString> m_StringsPreview;
 		WinProcessInspector::Core::ServiceManager m_ServiceManager;
+		WinProcessInspector::Core::ServiceSnapshot m_ServiceSnapshot;
 		WinProcessInspector::Security::SecurityManager m_SecurityManager;
 		
 		HFONT m_hBoldFont;
@@ -0,0 +1,55 @@
+#include "CacheFile.h"
+
+namespace WinProcessInspector {
+namespace Utils {
+
+bool CacheFile::GetFileStamp(const std::wstring& filePath, ULONGLONG& fileSize, ULONGLONG& lastWriteTime) {
+	WIN32_FILE_ATTRIBUTE_DATA data = {};
+	if (!GetFileAttributesExW(filePath.c_str(), GetFileExInfoStandard, &data)) {
+		return false;
+	}
+
+	fileSize = (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	lastWriteTime = (static_cast<ULONGLONG>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+std::wstring CacheFile::GetDefaultPath(const std::wstring& fileName) {
+	wchar_t localAppData[MAX_PATH] = {};
+	DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", localAppData, MAX_PATH);
+	if (length == 0 || length >= MAX_PATH) {
+		return std::wstring();
+	}
+	return std::wstring(localAppData) + L"\\WinProcessInspector\\" + fileName;
+}
+
+bool CacheFile::Write(const std::wstring& cachePath, const std::vector<BYTE>& buffer) {
+	if (cachePath.empty()) {
+		return false;
+	}
+
+	size_t separator = cachePath.find_last_of(L"\\/");
+	if (separator != std::wstring::npos) {
+		CreateDirectoryW(cachePath.substr(0, separator).c_str(), nullptr);
+	}
+
+	std::wstring tempPath = cachePath + L".tmp";
+	HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	DWORD bytesWritten = 0;
+	bool written = WriteFile(hFile, buffer.data(), static_cast<DWORD>(buffer.size()), &bytesWritten, nullptr) &&
+		bytesWritten == buffer.size();
+	CloseHandle(hFile);
+
+	if (!written || !MoveFileExW(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace Utils
+} // namespace WinProcessInspector
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+namespace WinProcessInspector {
+namespace Utils {
+
+	// File handling shared by the caches kept between sessions.
+	class CacheFile {
+	public:
+		// Size and last write time of a file, which together identify a
+		// version of it.
+		static bool GetFileStamp(const std::wstring& filePath, ULONGLONG& fileSize, ULONGLONG& lastWriteTime);
+		// fileName in the application's folder under %LOCALAPPDATA%, or empty
+		// if that is not set.
+		static std::wstring GetDefaultPath(const std::wstring& fileName);
+		// Writes to a temporary file and moves it over cachePath, so a crash
+		// never leaves a torn cache. Creates the folder if needed.
+		static bool Write(const std::wstring& cachePath, const std::vector<BYTE>& buffer);
+	};
+
+} // namespace Utils
+} // namespace WinProcessInspector
@@ -0,0 +1,31 @@
+#include "StringConversion.h"
+
+namespace WinProcessInspector {
+namespace Utils {
+
+std::string StringConversion::ToUtf8(const std::wstring& text) {
+	if (text.empty()) {
+		return std::string();
+	}
+	int size = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+	std::string result(size > 0 ? size : 0, '\0');
+	if (size > 0) {
+		WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), &result[0], size, nullptr, nullptr);
+	}
+	return result;
+}
+
+std::wstring StringConversion::FromUtf8(const std::string& text) {
+	if (text.empty()) {
+		return std::wstring();
+	}
+	int size = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0);
+	std::wstring result(size > 0 ? size : 0, L'\0');
+	if (size > 0) {
+		MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), &result[0], size);
+	}
+	return result;
+}
+
+} // namespace Utils
+} // namespace WinProcessInspector
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+
+namespace WinProcessInspector {
+namespace Utils {
+
+	class StringConversion {
+	public:
+		// Empty on failure, as for an empty input.
+		static std::string ToUtf8(const std::wstring& text);
+		static std::wstring FromUtf8(const std::string& text);
+	};
+
+} // namespace Utils
+} // namespace WinProcessInspector
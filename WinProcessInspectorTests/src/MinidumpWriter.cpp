@@ -0,0 +1,268 @@
+#include "MinidumpWriter.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace WinProcessInspector {
+namespace Tests {
+
+namespace {
+
+	const DWORD MinidumpSignature = 0x504D444D;
+	const DWORD MinidumpVersion = 0xA793;
+	const DWORD ThreadListStream = 3;
+	const DWORD ModuleListStream = 4;
+	const DWORD MemoryListStream = 5;
+	const DWORD Memory64ListStream = 9;
+	const DWORD MiscInfoStream = 15;
+	const DWORD MemoryInfoListStream = 16;
+	const DWORD ThreadInfoListStream = 17;
+	const size_t HeaderSize = 32;
+	const size_t DirectoryEntrySize = 12;
+
+	// Little-endian whatever the host, as the format is.
+	void Put32(std::vector<BYTE>& file, ULONGLONG value) {
+		for (int i = 0; i < 4; ++i) {
+			file.push_back(static_cast<BYTE>(value >> (i * 8)));
+		}
+	}
+
+	void Put64(std::vector<BYTE>& file, ULONGLONG value) {
+		for (int i = 0; i < 8; ++i) {
+			file.push_back(static_cast<BYTE>(value >> (i * 8)));
+		}
+	}
+
+	void Patch32(std::vector<BYTE>& file, size_t offset, ULONGLONG value) {
+		for (int i = 0; i < 4; ++i) {
+			file[offset + i] = static_cast<BYTE>(value >> (i * 8));
+		}
+	}
+
+	void Patch64(std::vector<BYTE>& file, size_t offset, ULONGLONG value) {
+		for (int i = 0; i < 8; ++i) {
+			file[offset + i] = static_cast<BYTE>(value >> (i * 8));
+		}
+	}
+
+	void PutZeros(std::vector<BYTE>& file, size_t count) {
+		file.insert(file.end(), count, 0);
+	}
+
+	void PutListCount(std::vector<BYTE>& file, size_t count, bool pad) {
+		Put32(file, count);
+		if (pad) {
+			Put32(file, 0);
+		}
+	}
+
+	struct StreamLocation {
+		DWORD Type = 0;
+		size_t Rva = 0;
+		size_t Size = 0;
+	};
+
+}
+
+std::vector<WORD> ToUtf16(const std::wstring& text) {
+	std::vector<WORD> units;
+	for (wchar_t c : text) {
+		unsigned long code = static_cast<unsigned long>(c);
+		if (code >= 0x10000) {
+			code -= 0x10000;
+			units.push_back(static_cast<WORD>(0xD800 + (code >> 10)));
+			units.push_back(static_cast<WORD>(0xDC00 + (code & 0x3FF)));
+		} else {
+			units.push_back(static_cast<WORD>(code));
+		}
+	}
+	return units;
+}
+
+std::vector<BYTE> MinidumpWriter::Build(ULONGLONG* fileSize) const {
+	bool hasThreadInfo = std::any_of(Threads.begin(), Threads.end(), [](const MinidumpWriterThread& thread) {
+		return thread.StartAddress != 0;
+	});
+	size_t streamCount = (ProcessId != 0) + !Threads.empty() + hasThreadInfo + !Modules.empty()
+		+ !Memory.empty() + !Memory64.empty() + !MemoryInfo.empty();
+
+	std::vector<BYTE> file;
+	Put32(file, MinidumpSignature);
+	Put32(file, MinidumpVersion);
+	Put32(file, streamCount);
+	Put32(file, HeaderSize);
+	Put32(file, 0);
+	Put32(file, TimeDateStamp);
+	Put64(file, 0);
+	PutZeros(file, streamCount * DirectoryEntrySize);
+
+	std::vector<StreamLocation> streams;
+	auto beginStream = [&](DWORD type) {
+		StreamLocation stream;
+		stream.Type = type;
+		stream.Rva = file.size();
+		streams.push_back(stream);
+	};
+	auto endStream = [&]() {
+		streams.back().Size = file.size() - streams.back().Rva;
+	};
+
+	if (ProcessId != 0) {
+		// MINIDUMP_MISC_INFO with only the process ID.
+		beginStream(MiscInfoStream);
+		Put32(file, 24);
+		Put32(file, 1);
+		Put32(file, ProcessId);
+		PutZeros(file, 12);
+		endStream();
+	}
+
+	if (!Threads.empty()) {
+		beginStream(ThreadListStream);
+		PutListCount(file, Threads.size(), PadListCounts);
+		for (const auto& thread : Threads) {
+			Put32(file, thread.ThreadId);
+			Put32(file, 0);
+			Put32(file, 0x20);
+			Put32(file, thread.Priority);
+			Put64(file, thread.Teb);
+			// The stack's memory and the context are not saved.
+			Put64(file, thread.StackStart);
+			PutZeros(file, 16);
+		}
+		endStream();
+	}
+
+	if (hasThreadInfo) {
+		beginStream(ThreadInfoListStream);
+		Put32(file, 12);
+		Put32(file, 64);
+		Put32(file, Threads.size());
+		for (const auto& thread : Threads) {
+			Put32(file, thread.ThreadId);
+			PutZeros(file, 12 + 32);
+			Put64(file, thread.StartAddress);
+			Put64(file, 1);
+		}
+		endStream();
+	}
+
+	if (!Modules.empty()) {
+		// Names first, as MINIDUMP_STRINGs, so the list can point at them.
+		std::vector<size_t> nameRvas;
+		for (const auto& module : Modules) {
+			nameRvas.push_back(file.size());
+			Put32(file, module.Name.size() * 2);
+			for (WORD unit : module.Name) {
+				file.push_back(static_cast<BYTE>(unit));
+				file.push_back(static_cast<BYTE>(unit >> 8));
+			}
+			PutZeros(file, 2);
+		}
+
+		beginStream(ModuleListStream);
+		PutListCount(file, Modules.size(), PadListCounts);
+		for (size_t i = 0; i < Modules.size(); ++i) {
+			Put64(file, Modules[i].BaseAddress);
+			Put32(file, Modules[i].Size);
+			Put32(file, 0);
+			Put32(file, 0);
+			Put32(file, nameRvas[i]);
+			PutZeros(file, 52 + 16 + 16);
+		}
+		endStream();
+	}
+
+	if (!Memory.empty()) {
+		std::vector<size_t> dataRvas;
+		for (const auto& range : Memory) {
+			dataRvas.push_back(file.size());
+			file.insert(file.end(), range.Data.begin(), range.Data.end());
+			PutZeros(file, static_cast<size_t>(range.Size) - range.Data.size());
+		}
+
+		beginStream(MemoryListStream);
+		PutListCount(file, Memory.size(), PadListCounts);
+		for (size_t i = 0; i < Memory.size(); ++i) {
+			Put64(file, Memory[i].BaseAddress);
+			Put32(file, Memory[i].Size);
+			Put32(file, dataRvas[i]);
+		}
+		endStream();
+	}
+
+	if (!MemoryInfo.empty()) {
+		beginStream(MemoryInfoListStream);
+		Put32(file, 16);
+		Put32(file, 48);
+		Put64(file, MemoryInfo.size());
+		for (const auto& region : MemoryInfo) {
+			Put64(file, region.BaseAddress);
+			Put64(file, region.AllocationBase);
+			Put32(file, region.Protect);
+			Put32(file, 0);
+			Put64(file, region.RegionSize);
+			Put32(file, region.State);
+			Put32(file, region.Protect);
+			Put32(file, region.Type);
+			Put32(file, 0);
+		}
+		endStream();
+	}
+
+	// Last, since its ranges run from BaseRva to the end of the file.
+	ULONGLONG end = file.size();
+	if (!Memory64.empty()) {
+		beginStream(Memory64ListStream);
+		Put64(file, Memory64.size());
+		size_t baseRvaOffset = file.size();
+		Put64(file, 0);
+		for (const auto& range : Memory64) {
+			Put64(file, range.BaseAddress);
+			Put64(file, range.Size);
+		}
+		endStream();
+
+		ULONGLONG offset = file.size();
+		Patch64(file, baseRvaOffset, offset);
+		for (const auto& range : Memory64) {
+			if (!range.Data.empty()) {
+				file.resize(static_cast<size_t>(offset));
+				file.insert(file.end(), range.Data.begin(), range.Data.end());
+			}
+			offset += range.Size;
+		}
+		end = offset;
+	}
+
+	for (size_t i = 0; i < streams.size(); ++i) {
+		size_t entry = HeaderSize + i * DirectoryEntrySize;
+		Patch32(file, entry, streams[i].Type);
+		Patch32(file, entry + 4, streams[i].Size);
+		Patch32(file, entry + 8, streams[i].Rva);
+	}
+	if (fileSize) {
+		*fileSize = std::max<ULONGLONG>(end, file.size());
+	}
+	return file;
+}
+
+bool MinidumpWriter::Write(const std::wstring& path) const {
+	ULONGLONG fileSize = 0;
+	std::vector<BYTE> file = Build(&fileSize);
+	{
+		std::ofstream stream(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+		if (!stream) {
+			return false;
+		}
+	}
+	std::error_code error;
+	if (fileSize > file.size()) {
+		std::filesystem::resize_file(std::filesystem::path(path), fileSize, error);
+	}
+	return !error;
+}
+
+} // namespace Tests
+} // namespace WinProcessInspector
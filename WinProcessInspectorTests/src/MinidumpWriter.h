@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+namespace WinProcessInspector {
+namespace Tests {
+
+	struct MinidumpWriterModule {
+		ULONGLONG BaseAddress = 0;
+		DWORD Size = 0;
+		// UTF-16 code units, so names with surrogate pairs can be written
+		// whatever the size of wchar_t.
+		std::vector<WORD> Name;
+	};
+
+	struct MinidumpWriterThread {
+		DWORD ThreadId = 0;
+		DWORD Priority = 0;
+		ULONGLONG Teb = 0;
+		ULONGLONG StackStart = 0;
+		// Written to the thread info list when not zero.
+		ULONGLONG StartAddress = 0;
+	};
+
+	// Saved memory. Ranges of the 64-bit list are stored back to back and
+	// may be larger than Data; the rest reads as zeros, and when the file
+	// is written it is left as a hole, so dumps of many gigabytes cost
+	// little disk.
+	struct MinidumpWriterRange {
+		ULONGLONG BaseAddress = 0;
+		ULONGLONG Size = 0;
+		std::vector<BYTE> Data;
+	};
+
+	struct MinidumpWriterRegion {
+		ULONGLONG BaseAddress = 0;
+		ULONGLONG AllocationBase = 0;
+		ULONGLONG RegionSize = 0;
+		DWORD State = 0;
+		DWORD Protect = 0;
+		DWORD Type = 0;
+	};
+
+	// Builds minidump files in the layout MiniDumpWriteDump uses, with the
+	// streams MinidumpFile reads, so it can be tested without dbghelp and on
+	// machines that cannot write dumps. Streams without entries are left out.
+	struct MinidumpWriter {
+		DWORD ProcessId = 0;
+		DWORD TimeDateStamp = 0;
+		std::vector<MinidumpWriterModule> Modules;
+		std::vector<MinidumpWriterThread> Threads;
+		// The 32-bit memory list, as minidumps without full memory have.
+		std::vector<MinidumpWriterRange> Memory;
+		// The 64-bit memory list, as full memory dumps have.
+		std::vector<MinidumpWriterRange> Memory64;
+		std::vector<MinidumpWriterRegion> MemoryInfo;
+		// Pads the counts of the thread, module and memory lists to eight
+		// bytes, as some writers do.
+		bool PadListCounts = false;
+
+		// The file up to the end of the last saved byte that is not a hole;
+		// fileSize receives the size of the whole file, holes included.
+		std::vector<BYTE> Build(ULONGLONG* fileSize = nullptr) const;
+		bool Write(const std::wstring& path) const;
+	};
+
+	std::vector<WORD> ToUtf16(const std::wstring& text);
+
+} // namespace Tests
+} // namespace WinProcessInspector
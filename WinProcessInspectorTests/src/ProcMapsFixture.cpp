@@ -0,0 +1,193 @@
+#include "ProcMapsFixture.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+namespace WinProcessInspector {
+namespace Tests {
+
+using namespace Core;
+
+namespace {
+
+	// End of the x64 user address space; [vsyscall] lies above it.
+	const unsigned long long UserSpaceEnd = 0x800000000000ULL;
+
+	struct Mapping {
+		unsigned long long Start = 0;
+		unsigned long long End = 0;
+		bool Read = false;
+		bool Write = false;
+		bool Execute = false;
+		bool Shared = false;
+		// File path, "[heap]" style pseudo name, or empty when anonymous.
+		std::string Name;
+	};
+
+	bool ParseHex(const std::string& text, unsigned long long& value) {
+		if (text.empty()) {
+			return false;
+		}
+		char* end = nullptr;
+		value = std::strtoull(text.c_str(), &end, 16);
+		return *end == '\0';
+	}
+
+	bool ParseLine(const std::string& line, Mapping& mapping) {
+		std::istringstream stream(line);
+		std::string range, permissions, offset, device, inode;
+		if (!(stream >> range >> permissions >> offset >> device >> inode) || permissions.size() != 4) {
+			return false;
+		}
+
+		size_t dash = range.find('-');
+		if (dash == std::string::npos || !ParseHex(range.substr(0, dash), mapping.Start)
+			|| !ParseHex(range.substr(dash + 1), mapping.End) || mapping.End <= mapping.Start) {
+			return false;
+		}
+		mapping.Read = permissions[0] == 'r';
+		mapping.Write = permissions[1] == 'w';
+		mapping.Execute = permissions[2] == 'x';
+		mapping.Shared = permissions[3] == 's';
+
+		// The path is the rest of the line and may contain spaces.
+		std::getline(stream, mapping.Name);
+		size_t first = mapping.Name.find_first_not_of(" \t");
+		size_t last = mapping.Name.find_last_not_of(" \t\r");
+		mapping.Name = first == std::string::npos ? std::string() : mapping.Name.substr(first, last - first + 1);
+		return true;
+	}
+
+	bool IsFile(const Mapping& mapping) {
+		return !mapping.Name.empty() && mapping.Name[0] == '/';
+	}
+
+	bool IsReserved(const Mapping& mapping) {
+		return !mapping.Read && !mapping.Write && !mapping.Execute;
+	}
+
+	DWORD ToProtection(const Mapping& mapping) {
+		if (mapping.Execute) {
+			return mapping.Write ? PAGE_EXECUTE_READWRITE : mapping.Read ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+		}
+		if (mapping.Write) {
+			return PAGE_READWRITE;
+		}
+		return mapping.Read ? PAGE_READONLY : PAGE_NOACCESS;
+	}
+
+	MemoryType ToType(const Mapping& mapping, const std::set<std::string>& images) {
+		if (mapping.Name.empty()) {
+			return mapping.Shared ? MemoryType::Mapped : MemoryType::Private;
+		}
+		if (mapping.Name == "[heap]" || mapping.Name.compare(0, 6, "[stack") == 0 || mapping.Name.compare(0, 5, "[anon") == 0) {
+			return MemoryType::Private;
+		}
+		return images.count(mapping.Name) != 0 || mapping.Name == "[vdso]" ? MemoryType::Image : MemoryType::Mapped;
+	}
+
+	// Whether mapping continues the allocation that previous belongs to.
+	bool ContinuesAllocation(const Mapping& previous, MemoryType previousType, const Mapping& mapping) {
+		if (previous.End != mapping.Start) {
+			return false;
+		}
+		if (!mapping.Name.empty()) {
+			return mapping.Name == previous.Name;
+		}
+		if (IsReserved(mapping) || mapping.Shared) {
+			return false;
+		}
+		// Anonymous memory joins the anonymous memory before it, or the
+		// image whose .bss it is.
+		return previous.Name.empty() ? !previous.Shared : previousType == MemoryType::Image;
+	}
+
+	bool FitsPointer(unsigned long long value) {
+		return static_cast<ULONG_PTR>(value) == value;
+	}
+
+}
+
+bool ParseProcMaps(const std::string& text, ProcMapsFixture& fixture) {
+	fixture = ProcMapsFixture();
+
+	std::vector<Mapping> mappings;
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line)) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos) {
+			continue;
+		}
+		Mapping mapping;
+		if (!ParseLine(line, mapping)) {
+			return false;
+		}
+		if (mapping.Start >= UserSpaceEnd) {
+			continue;
+		}
+		if (!FitsPointer(mapping.End) || (!mappings.empty() && mapping.Start < mappings.back().End)) {
+			return false;
+		}
+		mappings.push_back(mapping);
+	}
+
+	// A file is an image if any part of it is mapped executable.
+	std::set<std::string> images;
+	for (const auto& mapping : mappings) {
+		if (IsFile(mapping) && mapping.Execute) {
+			images.insert(mapping.Name);
+		}
+	}
+
+	MemoryType allocationType = MemoryType::Unknown;
+	ULONG_PTR allocationBase = 0;
+	for (size_t i = 0; i < mappings.size(); ++i) {
+		const Mapping& mapping = mappings[i];
+		if (i > 0 && mappings[i - 1].End < mapping.Start) {
+			MemoryRegionInfo gap;
+			gap.BaseAddress = static_cast<ULONG_PTR>(mappings[i - 1].End);
+			gap.RegionSize = static_cast<SIZE_T>(mapping.Start - mappings[i - 1].End);
+			gap.Protect = PAGE_NOACCESS;
+			gap.State = MemoryState::Free;
+			fixture.Regions.push_back(gap);
+		}
+
+		if (i == 0 || !ContinuesAllocation(mappings[i - 1], allocationType, mapping)) {
+			allocationBase = static_cast<ULONG_PTR>(mapping.Start);
+			allocationType = ToType(mapping, images);
+		}
+
+		MemoryRegionInfo region;
+		region.BaseAddress = static_cast<ULONG_PTR>(mapping.Start);
+		region.AllocationBase = allocationBase;
+		region.RegionSize = static_cast<SIZE_T>(mapping.End - mapping.Start);
+		region.State = IsReserved(mapping) ? MemoryState::Reserve : MemoryState::Commit;
+		// Windows reports no protection for reserved memory.
+		region.Protect = region.State == MemoryState::Commit ? ToProtection(mapping) : 0;
+		region.Type = allocationType;
+		fixture.Regions.push_back(region);
+
+		if (mapping.Name == "[heap]") {
+			fixture.Hints.Heaps.push_back(region.BaseAddress);
+		} else if (mapping.Name.compare(0, 6, "[stack") == 0) {
+			fixture.Hints.Stacks.push_back(region.BaseAddress);
+		}
+	}
+	return true;
+}
+
+bool LoadProcMaps(const std::wstring& path, ProcMapsFixture& fixture) {
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file) {
+		fixture = ProcMapsFixture();
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return ParseProcMaps(text, fixture);
+}
+
+} // namespace Tests
+} // namespace WinProcessInspector
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include "core/AddressSpaceSummary.h"
+
+namespace WinProcessInspector {
+namespace Tests {
+
+	// Memory regions and hints derived from a Linux /proc/<pid>/maps file,
+	// so address-space code can run on captures of real processes.
+	//
+	// Each mapping becomes one region. "---" mappings are reserved, the rest
+	// committed with the nearest Windows protection. Files with any
+	// executable mapping, and [vdso], are images; other files and kernel
+	// pseudo-mappings are mapped; anonymous memory is private. Allocations
+	// are grouped as Windows would report them: the mappings of one file
+	// form one allocation, with the anonymous .bss right after an image; a
+	// "---" guard starts an allocation that the anonymous mappings after it
+	// join, as thread stacks do. Gaps become free regions. [heap] and
+	// [stack] become hints. Mappings above the user address space, such as
+	// [vsyscall], are skipped.
+	struct ProcMapsFixture {
+		std::vector<Core::MemoryRegionInfo> Regions;
+		Core::AddressSpaceHints Hints;
+	};
+
+	// Fails on malformed or overlapping lines and on addresses that do not
+	// fit a ULONG_PTR, as 64-bit captures do not in 32-bit builds.
+	bool ParseProcMaps(const std::string& text, ProcMapsFixture& fixture);
+	bool LoadProcMaps(const std::wstring& path, ProcMapsFixture& fixture);
+
+} // namespace Tests
+} // namespace WinProcessInspector
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace WinProcessInspector {
+namespace Tests {
+
+	// A test or benchmark registered by TEST_CASE or BENCHMARK_CASE.
+	// Benchmarks only run when the runner is started with --bench.
+	struct TestCase {
+		const char* Name = nullptr;
+		void (*Function)() = nullptr;
+		bool IsBenchmark = false;
+	};
+
+	std::vector<TestCase>& GetTestCases();
+
+	struct TestRegistration {
+		TestRegistration(const char* name, void (*function)(), bool isBenchmark);
+	};
+
+	// Records a failed check against the running test.
+	void ReportFailure(const char* file, int line, const char* expression);
+
+	// Files under the fixtures directory, which --fixtures overrides.
+	std::wstring GetFixturePath(const std::wstring& name);
+	// A file name in the temporary directory for the running test.
+	std::wstring GetTempPath(const std::wstring& name);
+
+	// Runs body until it has taken at least 200 ms and prints its time per
+	// item; itemsPerRun is how many items one call of body handles.
+	double Measure(const char* label, size_t itemsPerRun, const std::function<void()>& body);
+	// Keeps a result alive so the optimizer cannot drop the work behind it.
+	void KeepResult(size_t value);
+
+} // namespace Tests
+} // namespace WinProcessInspector
+
+#define WPI_TEST_REGISTER(name, isBenchmark) \
+	static void name(); \
+	static ::WinProcessInspector::Tests::TestRegistration name##Registration(#name, name, isBenchmark); \
+	static void name()
+
+#define TEST_CASE(name) WPI_TEST_REGISTER(name, false)
+#define BENCHMARK_CASE(name) WPI_TEST_REGISTER(name, true)
+
+#define CHECK(expression) \
+	((expression) ? (void)0 : ::WinProcessInspector::Tests::ReportFailure(__FILE__, __LINE__, #expression))
+#define CHECK_EQUAL(expected, actual) CHECK((expected) == (actual))
+
+// Ends the test when the check fails, for checks later steps depend on.
+#define REQUIRE(expression) \
+	do { \
+		if (!(expression)) { \
+			::WinProcessInspector::Tests::ReportFailure(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (false)
@@ -0,0 +1,128 @@
+#include "TestFramework.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace WinProcessInspector {
+namespace Tests {
+
+namespace {
+
+	struct TestRun {
+		std::filesystem::path FixtureDirectory;
+		std::filesystem::path TempDirectory;
+		const char* CurrentTest = nullptr;
+		size_t CurrentFailures = 0;
+	};
+
+	TestRun& GetRun() {
+		static TestRun run;
+		return run;
+	}
+
+	volatile size_t g_Sink = 0;
+
+}
+
+std::vector<TestCase>& GetTestCases() {
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+TestRegistration::TestRegistration(const char* name, void (*function)(), bool isBenchmark) {
+	TestCase testCase;
+	testCase.Name = name;
+	testCase.Function = function;
+	testCase.IsBenchmark = isBenchmark;
+	GetTestCases().push_back(testCase);
+}
+
+void ReportFailure(const char* file, int line, const char* expression) {
+	TestRun& run = GetRun();
+	++run.CurrentFailures;
+	std::printf("  %s(%d): CHECK(%s) failed in %s\n", file, line, expression, run.CurrentTest ? run.CurrentTest : "?");
+}
+
+std::wstring GetFixturePath(const std::wstring& name) {
+	return (GetRun().FixtureDirectory / name).wstring();
+}
+
+std::wstring GetTempPath(const std::wstring& name) {
+	TestRun& run = GetRun();
+	std::error_code error;
+	std::filesystem::create_directories(run.TempDirectory, error);
+	return (run.TempDirectory / name).wstring();
+}
+
+double Measure(const char* label, size_t itemsPerRun, const std::function<void()>& body) {
+	typedef std::chrono::steady_clock Clock;
+	// One untimed run warms caches and lazily built state.
+	body();
+
+	size_t runs = 0;
+	Clock::time_point start = Clock::now();
+	double seconds = 0.0;
+	do {
+		body();
+		++runs;
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (seconds < 0.2);
+
+	double nsPerItem = seconds * 1e9 / static_cast<double>(runs * (itemsPerRun != 0 ? itemsPerRun : 1));
+	std::printf("  %-48s %12.1f ns/item  (%zu runs)\n", label, nsPerItem, runs);
+	return nsPerItem;
+}
+
+void KeepResult(size_t value) {
+	g_Sink = g_Sink + value;
+}
+
+} // namespace Tests
+} // namespace WinProcessInspector
+
+using namespace WinProcessInspector::Tests;
+
+// WinProcessInspectorTests [--bench] [--fixtures <dir>] [name-filter]
+//
+// Runs every test whose name contains the filter, or every benchmark with
+// --bench. Exits with 1 if any check failed.
+int main(int argc, char* argv[]) {
+	TestRun& run = GetRun();
+	run.FixtureDirectory = std::filesystem::path(__FILE__).parent_path().parent_path() / "fixtures";
+	run.TempDirectory = std::filesystem::temp_directory_path() / "WinProcessInspectorTests";
+
+	bool benchmarks = false;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--bench") == 0) {
+			benchmarks = true;
+		} else if (std::strcmp(argv[i], "--fixtures") == 0 && i + 1 < argc) {
+			run.FixtureDirectory = argv[++i];
+		} else {
+			filter = argv[i];
+		}
+	}
+
+	size_t ran = 0;
+	size_t failed = 0;
+	for (const TestCase& testCase : GetTestCases()) {
+		if (testCase.IsBenchmark != benchmarks || (filter && !std::strstr(testCase.Name, filter))) {
+			continue;
+		}
+		std::printf("%s\n", testCase.Name);
+		run.CurrentTest = testCase.Name;
+		run.CurrentFailures = 0;
+		testCase.Function();
+		++ran;
+		if (run.CurrentFailures != 0) {
+			++failed;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(run.TempDirectory, error);
+
+	std::printf("\n%zu %s run, %zu failed\n", ran, benchmarks ? "benchmarks" : "tests", failed);
+	return failed != 0 ? 1 : 0;
+}
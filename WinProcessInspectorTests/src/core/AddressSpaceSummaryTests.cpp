@@ -0,0 +1,250 @@
+#include "TestFramework.h"
+#include "ProcMapsFixture.h"
+#include "core/AddressSpaceSummary.h"
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	// A 32-bit process: an image with its .bss, a heap, a shared file, a
+	// thread stack behind its guard page, and the main stack.
+	const char* const SmallMaps =
+		"08048000-08049000 r--p 00000000 08:01 100    /usr/bin/small\n"
+		"08049000-0804b000 r-xp 00001000 08:01 100    /usr/bin/small\n"
+		"0804b000-0804c000 rw-p 00003000 08:01 100    /usr/bin/small\n"
+		"0804c000-0804e000 rw-p 00000000 00:00 0\n"
+		"09000000-09021000 rw-p 00000000 00:00 0      [heap]\n"
+		"b7000000-b7100000 r--s 00000000 08:01 200    /var/tmp/shared file.bin\n"
+		"b7200000-b7201000 ---p 00000000 00:00 0\n"
+		"b7201000-b7a01000 rw-p 00000000 00:00 0\n"
+		"bf800000-bf821000 rw-p 00000000 00:00 0      [stack]\n";
+
+	const AddressSpaceTotals& Totals(const AddressSpaceSummary& summary, AllocationKind kind) {
+		return summary.GetTotals(kind);
+	}
+
+	MemoryRegionInfo Region(ULONG_PTR base, ULONG_PTR allocationBase, SIZE_T size, MemoryState state, MemoryType type) {
+		MemoryRegionInfo region;
+		region.BaseAddress = base;
+		region.AllocationBase = allocationBase;
+		region.RegionSize = size;
+		region.State = state;
+		region.Type = type;
+		region.Protect = state == MemoryState::Commit ? PAGE_READWRITE : 0;
+		return region;
+	}
+
+}
+
+TEST_CASE(ProcMaps_ParsesRegionsGapsAndHints) {
+	ProcMapsFixture fixture;
+	REQUIRE(ParseProcMaps(SmallMaps, fixture));
+	// Nine mappings and four gaps between them.
+	REQUIRE(fixture.Regions.size() == 13);
+
+	const MemoryRegionInfo& text = fixture.Regions[1];
+	CHECK_EQUAL(0x08049000u, text.BaseAddress);
+	CHECK_EQUAL(0x08048000u, text.AllocationBase);
+	CHECK_EQUAL(0x2000u, text.RegionSize);
+	CHECK(text.State == MemoryState::Commit);
+	CHECK(text.Type == MemoryType::Image);
+	CHECK_EQUAL(static_cast<DWORD>(PAGE_EXECUTE_READ), text.Protect);
+
+	// The .bss belongs to the image.
+	const MemoryRegionInfo& bss = fixture.Regions[3];
+	CHECK_EQUAL(0x08048000u, bss.AllocationBase);
+	CHECK(bss.Type == MemoryType::Image);
+
+	const MemoryRegionInfo& gap = fixture.Regions[4];
+	CHECK(gap.State == MemoryState::Free);
+	CHECK_EQUAL(0x0804E000u, gap.BaseAddress);
+	CHECK_EQUAL(0x09000000u - 0x0804E000u, gap.RegionSize);
+
+	const MemoryRegionInfo& shared = fixture.Regions[7];
+	CHECK(shared.Type == MemoryType::Mapped);
+	CHECK_EQUAL(static_cast<DWORD>(PAGE_READONLY), shared.Protect);
+
+	const MemoryRegionInfo& guard = fixture.Regions[9];
+	const MemoryRegionInfo& stack = fixture.Regions[10];
+	CHECK(guard.State == MemoryState::Reserve);
+	CHECK_EQUAL(0u, guard.Protect);
+	CHECK(guard.Type == MemoryType::Private);
+	CHECK_EQUAL(0xB7200000u, stack.AllocationBase);
+	CHECK(stack.State == MemoryState::Commit);
+
+	CHECK((fixture.Hints.Heaps == std::vector<ULONG_PTR>{ 0x09000000 }));
+	CHECK((fixture.Hints.Stacks == std::vector<ULONG_PTR>{ 0xBF800000 }));
+	CHECK(fixture.Hints.Tebs.empty());
+}
+
+TEST_CASE(ProcMaps_RejectsMalformedLines) {
+	ProcMapsFixture fixture;
+	CHECK(!ParseProcMaps("08048000 r--p 00000000 08:01 100 /bin/x\n", fixture));
+	CHECK(!ParseProcMaps("0804g000-08049000 r--p 00000000 08:01 100 /bin/x\n", fixture));
+	CHECK(!ParseProcMaps("08049000-08048000 r--p 00000000 08:01 100 /bin/x\n", fixture));
+	CHECK(!ParseProcMaps("08048000-08049000 r--p 00000000\n", fixture));
+	// Overlapping and out-of-order mappings.
+	CHECK(!ParseProcMaps(
+		"08048000-0804a000 r--p 00000000 08:01 100 /bin/x\n"
+		"08049000-0804b000 r--p 00000000 08:01 100 /bin/x\n", fixture));
+	CHECK(fixture.Regions.empty());
+
+	// Blank lines and a missing trailing newline are fine.
+	CHECK(ParseProcMaps("\n08048000-08049000 r--p 00000000 08:01 100 /bin/x", fixture));
+	CHECK_EQUAL(1u, fixture.Regions.size());
+}
+
+TEST_CASE(ProcMaps_LoadsFixtureFile) {
+	ProcMapsFixture fixture;
+	CHECK(!LoadProcMaps(GetFixturePath(L"procmaps/missing.maps"), fixture));
+	if (sizeof(ULONG_PTR) < 8) {
+		// A 64-bit capture cannot be represented.
+		CHECK(!LoadProcMaps(GetFixturePath(L"procmaps/threads-x64.maps"), fixture));
+		return;
+	}
+	REQUIRE(LoadProcMaps(GetFixturePath(L"procmaps/threads-x64.maps"), fixture));
+	// 28 mappings below [vsyscall] and 4 gaps.
+	CHECK_EQUAL(32u, fixture.Regions.size());
+}
+
+TEST_CASE(AddressSpaceSummary_BuildSmallFixture) {
+	ProcMapsFixture fixture;
+	REQUIRE(ParseProcMaps(SmallMaps, fixture));
+	AddressSpaceSummary summary;
+	summary.Build(fixture.Regions, fixture.Hints);
+
+	// image, heap, shared file, thread stack, main stack, and four free
+	// blocks between them.
+	REQUIRE(summary.GetAllocations().size() == 9);
+	CHECK(summary.GetAllocations()[0].Kind == AllocationKind::Image);
+	CHECK_EQUAL(0x6000u, summary.GetAllocations()[0].Size);
+	CHECK_EQUAL(4u, summary.GetAllocations()[0].RegionCount);
+
+	const AddressSpaceTotals& image = Totals(summary, AllocationKind::Image);
+	CHECK_EQUAL(1u, image.Allocations);
+	CHECK_EQUAL(0x6000u, image.Committed);
+	CHECK_EQUAL(1u, Totals(summary, AllocationKind::Heap).Allocations);
+	CHECK_EQUAL(0x21000u, Totals(summary, AllocationKind::Heap).Committed);
+	CHECK_EQUAL(1u, Totals(summary, AllocationKind::Mapped).Allocations);
+	CHECK_EQUAL(0x100000u, Totals(summary, AllocationKind::Mapped).Committed);
+	CHECK_EQUAL(1u, Totals(summary, AllocationKind::Stack).Allocations);
+
+	// The thread stack is unlabelled in maps, so it stays private.
+	const AddressSpaceTotals& priv = Totals(summary, AllocationKind::Private);
+	CHECK_EQUAL(1u, priv.Allocations);
+	CHECK_EQUAL(2u, priv.Regions);
+	CHECK_EQUAL(0x800000u, priv.Committed);
+	CHECK_EQUAL(0x1000u, priv.Reserved);
+	CHECK_EQUAL(0x801000u, priv.Size);
+
+	CHECK_EQUAL(0x1000u, summary.GetReserved());
+	CHECK_EQUAL(0x6000u + 0x21000u + 0x100000u + 0x800000u + 0x21000u, summary.GetCommitted());
+
+	// Between the heap and the shared file.
+	CHECK_EQUAL(4u, Totals(summary, AllocationKind::Free).Allocations);
+	CHECK_EQUAL(0x09021000u, summary.GetLargestFreeBase());
+	CHECK_EQUAL(0xB7000000u - 0x09021000u, summary.GetLargestFree());
+}
+
+TEST_CASE(AddressSpaceSummary_BuildThreadsFixture) {
+	if (sizeof(ULONG_PTR) < 8) {
+		return;
+	}
+	ProcMapsFixture fixture;
+	REQUIRE(LoadProcMaps(GetFixturePath(L"procmaps/threads-x64.maps"), fixture));
+	AddressSpaceSummary summary;
+	summary.Build(fixture.Regions, fixture.Hints);
+
+	// The program, libc, [vdso] and the loader.
+	const AddressSpaceTotals& image = Totals(summary, AllocationKind::Image);
+	CHECK_EQUAL(4u, image.Allocations);
+	CHECK_EQUAL(17u, image.Regions);
+	CHECK_EQUAL(0x21E000u, image.Committed);
+	CHECK_EQUAL(0u, image.Reserved);
+
+	// The shared file, [vvar] and [vvar_vclock].
+	const AddressSpaceTotals& mapped = Totals(summary, AllocationKind::Mapped);
+	CHECK_EQUAL(3u, mapped.Allocations);
+	CHECK_EQUAL(0x106000u, mapped.Committed);
+
+	// Two thread stacks behind guard pages, and two small anonymous blocks.
+	const AddressSpaceTotals& priv = Totals(summary, AllocationKind::Private);
+	CHECK_EQUAL(4u, priv.Allocations);
+	CHECK_EQUAL(6u, priv.Regions);
+	CHECK_EQUAL(0x1005000u, priv.Committed);
+	CHECK_EQUAL(0x2000u, priv.Reserved);
+	CHECK_EQUAL(0x1007000u, priv.Size);
+
+	CHECK_EQUAL(1u, Totals(summary, AllocationKind::Heap).Allocations);
+	CHECK_EQUAL(0x21000u, Totals(summary, AllocationKind::Heap).Committed);
+	CHECK_EQUAL(1u, Totals(summary, AllocationKind::Stack).Allocations);
+	CHECK_EQUAL(0x21000u, Totals(summary, AllocationKind::Stack).Committed);
+	CHECK_EQUAL(0u, Totals(summary, AllocationKind::Teb).Allocations);
+
+	CHECK_EQUAL(0x21E000u + 0x106000u + 0x1005000u + 0x21000u + 0x21000u, summary.GetCommitted());
+	CHECK_EQUAL(0x2000u, summary.GetReserved());
+
+	// Between the heap and the mmap area.
+	CHECK_EQUAL(4u, Totals(summary, AllocationKind::Free).Allocations);
+	CHECK_EQUAL(static_cast<ULONG_PTR>(0x56556086D000ULL), summary.GetLargestFreeBase());
+	CHECK_EQUAL(static_cast<SIZE_T>(0x29472183F000ULL), summary.GetLargestFree());
+	CHECK_EQUAL(13u + 4u, summary.GetAllocations().size());
+}
+
+TEST_CASE(AddressSpaceSummary_MostSpecificHintWins) {
+	std::vector<MemoryRegionInfo> regions = {
+		Region(0x10000, 0x10000, 0x10000, MemoryState::Commit, MemoryType::Private),
+		Region(0x20000, 0x20000, 0x10000, MemoryState::Commit, MemoryType::Image),
+		Region(0x30000, 0, 0x10000, MemoryState::Free, MemoryType::Unknown),
+		Region(0x40000, 0x40000, 0x1000, MemoryState::Reserve, MemoryType::Private),
+		Region(0x41000, 0x40000, 0xF000, MemoryState::Commit, MemoryType::Private),
+	};
+	AddressSpaceHints hints;
+	// A heap and a stack hint in one allocation: the stack is more specific.
+	hints.Heaps = { 0x18000 };
+	hints.Stacks = { 0x11000 };
+	// Images keep their kind; a hint in free space is ignored.
+	hints.Tebs = { 0x20010, 0x38000 };
+	hints.Pebs = { 0x4F000 };
+
+	AddressSpaceSummary summary;
+	summary.Build(regions, hints);
+	REQUIRE(summary.GetAllocations().size() == 4);
+	CHECK(summary.GetAllocations()[0].Kind == AllocationKind::Stack);
+	CHECK(summary.GetAllocations()[1].Kind == AllocationKind::Image);
+	CHECK(summary.GetAllocations()[2].Kind == AllocationKind::Free);
+	CHECK(summary.GetAllocations()[3].Kind == AllocationKind::Peb);
+	CHECK_EQUAL(0x1000u, Totals(summary, AllocationKind::Peb).Reserved);
+	CHECK_EQUAL(0xF000u, Totals(summary, AllocationKind::Peb).Committed);
+	CHECK_EQUAL(0u, Totals(summary, AllocationKind::Heap).Allocations);
+	CHECK_EQUAL(0u, Totals(summary, AllocationKind::Teb).Allocations);
+}
+
+TEST_CASE(AddressSpaceSummary_MergesAdjacentFreeRegions) {
+	std::vector<MemoryRegionInfo> regions = {
+		Region(0x00000, 0, 0x10000, MemoryState::Free, MemoryType::Unknown),
+		Region(0x10000, 0, 0x20000, MemoryState::Free, MemoryType::Unknown),
+		Region(0x30000, 0x30000, 0x1000, MemoryState::Commit, MemoryType::Private),
+		Region(0x31000, 0, 0x28000, MemoryState::Free, MemoryType::Unknown),
+	};
+
+	AddressSpaceSummary summary;
+	summary.Build(regions, AddressSpaceHints());
+	REQUIRE(summary.GetAllocations().size() == 3);
+	CHECK_EQUAL(0x30000u, summary.GetAllocations()[0].Size);
+	CHECK_EQUAL(2u, summary.GetAllocations()[0].RegionCount);
+
+	const AddressSpaceTotals& free = Totals(summary, AllocationKind::Free);
+	CHECK_EQUAL(2u, free.Allocations);
+	CHECK_EQUAL(3u, free.Regions);
+	CHECK_EQUAL(0x58000u, free.Size);
+	// The merged block wins, though the region after it is larger than
+	// either of its parts.
+	CHECK_EQUAL(0x30000u, summary.GetLargestFree());
+	CHECK_EQUAL(0u, summary.GetLargestFreeBase());
+
+	summary.Clear();
+	CHECK(summary.GetAllocations().empty());
+	CHECK_EQUAL(0u, summary.GetLargestFree());
+}
@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+#include "core/HandleSnapshot.h"
+#include <cstddef>
+#include <cstring>
+
+using namespace WinProcessInspector::Core;
+
+namespace {
+
+	// Synthetic SystemExtendedHandleInformation buffer. count is written as
+	// given, so a buffer can claim more entries than it holds.
+	std::vector<BYTE> MakeSystemBuffer(const std::vector<SystemHandleTableEntryEx>& entries, ULONG_PTR count) {
+		const size_t header = offsetof(SystemHandleInformationEx, Handles);
+		std::vector<BYTE> buffer(header + entries.size() * sizeof(SystemHandleTableEntryEx));
+		std::memcpy(buffer.data(), &count, sizeof(count));
+		if (!entries.empty()) {
+			std::memcpy(buffer.data() + header, entries.data(), entries.size() * sizeof(SystemHandleTableEntryEx));
+		}
+		return buffer;
+	}
+
+	std::vector<BYTE> MakeSystemBuffer(const std::vector<SystemHandleTableEntryEx>& entries) {
+		return MakeSystemBuffer(entries, static_cast<ULONG_PTR>(entries.size()));
+	}
+
+	std::vector<BYTE> MakeProcessBuffer(const std::vector<ProcessHandleTableEntryInfo>& entries, ULONG_PTR count) {
+		const size_t header = offsetof(ProcessHandleSnapshotInformation, Handles);
+		std::vector<BYTE> buffer(header + entries.size() * sizeof(ProcessHandleTableEntryInfo));
+		std::memcpy(buffer.data(), &count, sizeof(count));
+		if (!entries.empty()) {
+			std::memcpy(buffer.data() + header, entries.data(), entries.size() * sizeof(ProcessHandleTableEntryInfo));
+		}
+		return buffer;
+	}
+
+	SystemHandleTableEntryEx SystemEntry(ULONG_PTR processId, ULONG_PTR handle, USHORT typeIndex) {
+		SystemHandleTableEntryEx entry = {};
+		entry.Object = reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(0x10000 + handle * 0x10));
+		entry.UniqueProcessId = processId;
+		entry.HandleValue = handle;
+		entry.GrantedAccess = 0x1F0003;
+		entry.ObjectTypeIndex = typeIndex;
+		entry.HandleAttributes = 0x2;
+		return entry;
+	}
+
+	ProcessHandleTableEntryInfo ProcessEntry(ULONG_PTR handle, ULONG typeIndex) {
+		ProcessHandleTableEntryInfo entry = {};
+		entry.HandleValue = reinterpret_cast<HANDLE>(handle);
+		entry.HandleCount = 1;
+		entry.PointerCount = 2;
+		entry.GrantedAccess = 0x120089;
+		entry.ObjectTypeIndex = typeIndex;
+		entry.HandleAttributes = 0x1;
+		return entry;
+	}
+
+}
+
+TEST_CASE(HandleSnapshot_ParseGroupsHandlesByProcess) {
+	// Process 8 appears as two runs; the kernel normally lists each table
+	// once but a table can be split when handles are added mid-query.
+	std::vector<BYTE> buffer = MakeSystemBuffer({
+		SystemEntry(8, 0x4, 7),
+		SystemEntry(8, 0x8, 7),
+		SystemEntry(4, 0x4, 3),
+		SystemEntry(8, 0xC, 37),
+		SystemEntry(1234, 0x40, 3),
+	});
+
+	HandleSnapshot snapshot;
+	REQUIRE(snapshot.Parse(buffer.data(), buffer.size()));
+	CHECK_EQUAL(5u, snapshot.GetHandleCount());
+	CHECK_EQUAL(3u, snapshot.GetProcessCount());
+	CHECK((snapshot.GetProcessIds() == std::vector<DWORD>{ 4, 8, 1234 }));
+
+	size_t count = 0;
+	const HandleEntry* handles = snapshot.GetProcessHandles(8, count);
+	REQUIRE(handles && count == 3);
+	// Runs keep their order within a process.
+	CHECK_EQUAL(0x4u, handles[0].HandleValue);
+	CHECK_EQUAL(0x8u, handles[1].HandleValue);
+	CHECK_EQUAL(0xCu, handles[2].HandleValue);
+	CHECK_EQUAL(37, handles[2].ObjectTypeIndex);
+	CHECK_EQUAL(8u, handles[2].ProcessId);
+	CHECK_EQUAL(0x100C0u, handles[2].ObjectAddress);
+	CHECK_EQUAL(0x1F0003u, handles[2].AccessMask);
+	CHECK_EQUAL(0x2, handles[2].Attributes);
+
+	handles = snapshot.GetProcessHandles(4, count);
+	REQUIRE(handles && count == 1);
+	CHECK_EQUAL(3, handles[0].ObjectTypeIndex);
+
+	CHECK(snapshot.GetProcessHandles(5, count) == nullptr);
+	CHECK_EQUAL(0u, count);
+}
+
+TEST_CASE(HandleSnapshot_ParseKeepsFullWidthValues) {
+	// The legacy class cut both of these to 16 bits.
+	std::vector<BYTE> buffer = MakeSystemBuffer({ SystemEntry(0x12344, 0x2A004, 40) });
+
+	HandleSnapshot snapshot;
+	REQUIRE(snapshot.Parse(buffer.data(), buffer.size()));
+	size_t count = 0;
+	const HandleEntry* handles = snapshot.GetProcessHandles(0x12344, count);
+	REQUIRE(handles && count == 1);
+	CHECK_EQUAL(0x2A004u, handles[0].HandleValue);
+	CHECK(snapshot.GetProcessHandles(0x2344, count) == nullptr);
+}
+
+TEST_CASE(HandleSnapshot_ParseEmptyTable) {
+	std::vector<BYTE> buffer = MakeSystemBuffer({});
+
+	HandleSnapshot snapshot;
+	CHECK(snapshot.Parse(buffer.data(), buffer.size()));
+	CHECK_EQUAL(0u, snapshot.GetHandleCount());
+	CHECK_EQUAL(0u, snapshot.GetProcessCount());
+}
+
+TEST_CASE(HandleSnapshot_ParseRejectsCountOverrunningBuffer) {
+	std::vector<BYTE> good = MakeSystemBuffer({ SystemEntry(4, 0x4, 3) });
+	std::vector<BYTE> overrun = MakeSystemBuffer({ SystemEntry(4, 0x4, 3), SystemEntry(4, 0x8, 3) }, 3);
+
+	HandleSnapshot snapshot;
+	REQUIRE(snapshot.Parse(good.data(), good.size()));
+	CHECK(!snapshot.Parse(overrun.data(), overrun.size()));
+	// A rejected buffer leaves nothing of the previous capture behind.
+	CHECK_EQUAL(0u, snapshot.GetHandleCount());
+	CHECK_EQUAL(0u, snapshot.GetProcessCount());
+
+	// One byte short of the last entry.
+	std::vector<BYTE> exact = MakeSystemBuffer({ SystemEntry(4, 0x4, 3), SystemEntry(4, 0x8, 3) });
+	CHECK(!snapshot.Parse(exact.data(), exact.size() - 1));
+	CHECK(snapshot.Parse(exact.data(), exact.size()));
+	CHECK_EQUAL(2u, snapshot.GetHandleCount());
+}
+
+TEST_CASE(HandleSnapshot_ParseRejectsHugeCount) {
+	// A count whose byte size wraps around must not pass the bounds check.
+	std::vector<BYTE> buffer = MakeSystemBuffer({ SystemEntry(4, 0x4, 3) }, ~static_cast<ULONG_PTR>(0) / sizeof(SystemHandleTableEntryEx) + 2);
+
+	HandleSnapshot snapshot;
+	CHECK(!snapshot.Parse(buffer.data(), buffer.size()));
+}
+
+TEST_CASE(HandleSnapshot_ParseRejectsTruncatedHeader) {
+	std::vector<BYTE> buffer = MakeSystemBuffer({});
+
+	HandleSnapshot snapshot;
+	CHECK(!snapshot.Parse(buffer.data(), buffer.size() - 1));
+	CHECK(!snapshot.Parse(nullptr, 0));
+	CHECK(!snapshot.ParseProcess(4, buffer.data(), 0));
+	CHECK(!snapshot.ParseProcess(4, nullptr, 64));
+}
+
+TEST_CASE(HandleSnapshot_ParseProcessTagsProcessId) {
+	std::vector<BYTE> buffer = MakeProcessBuffer({ ProcessEntry(0x4, 3), ProcessEntry(0x10C, 42), ProcessEntry(0x3FFFC, 7) }, 3);
+
+	HandleSnapshot snapshot;
+	REQUIRE(snapshot.ParseProcess(4242, buffer.data(), buffer.size()));
+	CHECK_EQUAL(3u, snapshot.GetHandleCount());
+	CHECK((snapshot.GetProcessIds() == std::vector<DWORD>{ 4242 }));
+
+	size_t count = 0;
+	const HandleEntry* handles = snapshot.GetProcessHandles(4242, count);
+	REQUIRE(handles && count == 3);
+	CHECK_EQUAL(0x10Cu, handles[1].HandleValue);
+	CHECK_EQUAL(42, handles[1].ObjectTypeIndex);
+	CHECK_EQUAL(0x120089u, handles[1].AccessMask);
+	CHECK_EQUAL(0x1, handles[1].Attributes);
+	CHECK_EQUAL(4242u, handles[1].ProcessId);
+	// The per-process class does not report object addresses.
+	CHECK_EQUAL(0u, handles[1].ObjectAddress);
+	CHECK_EQUAL(0x3FFFCu, handles[2].HandleValue);
+}
+
+TEST_CASE(HandleSnapshot_ParseProcessRejectsCountOverrunningBuffer) {
+	std::vector<BYTE> buffer = MakeProcessBuffer({ ProcessEntry(0x4, 3) }, 2);
+
+	HandleSnapshot snapshot;
+	CHECK(!snapshot.ParseProcess(4242, buffer.data(), buffer.size()));
+	CHECK_EQUAL(0u, snapshot.GetHandleCount());
+
+	buffer = MakeProcessBuffer({ ProcessEntry(0x4, 3) }, ~static_cast<ULONG_PTR>(0));
+	CHECK(!snapshot.ParseProcess(4242, buffer.data(), buffer.size()));
+}
+
+TEST_CASE(HandleSnapshot_ParseProcessWithNoHandles) {
+	std::vector<BYTE> buffer = MakeProcessBuffer({}, 0);
+
+	HandleSnapshot snapshot;
+	REQUIRE(snapshot.ParseProcess(4242, buffer.data(), buffer.size()));
+	CHECK_EQUAL(0u, snapshot.GetProcessCount());
+	size_t count = 1;
+	CHECK(snapshot.GetProcessHandles(4242, count) == nullptr);
+	CHECK_EQUAL(0u, count);
+}
@@ -0,0 +1,323 @@
+#include "TestFramework.h"
+#include "core/MemoryManager.h"
+#include "core/HandleWrapper.h"
+#include <cstdio>
+#include <random>
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	// The region record and formatting before the packed model: three
+	// strings built for every region as it was enumerated.
+	struct LegacyRegionInfo {
+		ULONG_PTR BaseAddress = 0;
+		SIZE_T RegionSize = 0;
+		DWORD State = 0;
+		DWORD Protect = 0;
+		DWORD Type = 0;
+		std::wstring ProtectionString;
+		std::wstring StateString;
+		std::wstring TypeString;
+	};
+
+	std::wstring LegacyProtectionToString(DWORD protect) {
+		if (protect == 0) {
+			return L"";
+		}
+
+		std::wstring result;
+		switch (protect & 0xFF) {
+			case PAGE_NOACCESS: result = L"No Access"; break;
+			case PAGE_READONLY: result = L"Read-Only"; break;
+			case PAGE_READWRITE: result = L"Read/Write"; break;
+			case PAGE_WRITECOPY: result = L"Write Copy"; break;
+			case PAGE_EXECUTE: result = L"Execute"; break;
+			case PAGE_EXECUTE_READ: result = L"Execute/Read"; break;
+			case PAGE_EXECUTE_READWRITE: result = L"Execute/Read/Write"; break;
+			case PAGE_EXECUTE_WRITECOPY: result = L"Execute/Write Copy"; break;
+			default: result = L"Unknown"; break;
+		}
+		if (protect & PAGE_GUARD) {
+			result += L" | Guard";
+		}
+		if (protect & PAGE_NOCACHE) {
+			result += L" | No Cache";
+		}
+		if (protect & PAGE_WRITECOMBINE) {
+			result += L" | Write Combine";
+		}
+		return result;
+	}
+
+	std::wstring LegacyStateToString(DWORD state) {
+		switch (state) {
+			case MEM_COMMIT: return L"Committed";
+			case MEM_RESERVE: return L"Reserved";
+			case MEM_FREE: return L"Free";
+			default: return L"Unknown";
+		}
+	}
+
+	std::wstring LegacyTypeToString(DWORD type) {
+		switch (type) {
+			case MEM_IMAGE: return L"Image";
+			case MEM_MAPPED: return L"Mapped";
+			case MEM_PRIVATE: return L"Private";
+			default: return L"Unknown";
+		}
+	}
+
+	LegacyRegionInfo MakeLegacyRecord(const MEMORY_BASIC_INFORMATION& mbi) {
+		LegacyRegionInfo info;
+		info.BaseAddress = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress);
+		info.RegionSize = mbi.RegionSize;
+		info.State = mbi.State;
+		info.Protect = mbi.Protect;
+		info.Type = mbi.Type;
+		info.ProtectionString = LegacyProtectionToString(mbi.Protect);
+		info.StateString = LegacyStateToString(mbi.State);
+		info.TypeString = LegacyTypeToString(mbi.Type);
+		return info;
+	}
+
+	// The loop EnumerateMemoryRegions ran before the packed model.
+	std::vector<LegacyRegionInfo> LegacyEnumerate(DWORD processId) {
+		std::vector<LegacyRegionInfo> regions;
+		HandleWrapper process(::OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId));
+		if (!process.IsValid()) {
+			return regions;
+		}
+
+		MEMORY_BASIC_INFORMATION mbi = {};
+		ULONG_PTR address = 0;
+		while (VirtualQueryEx(process.Get(), reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi)) == sizeof(mbi)) {
+			regions.push_back(MakeLegacyRecord(mbi));
+			address = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress) + mbi.RegionSize;
+			if (address == 0 || address < reinterpret_cast<ULONG_PTR>(mbi.BaseAddress)) {
+				break;
+			}
+		}
+		return regions;
+	}
+
+	MemoryRegionInfo MakePackedRecord(const MEMORY_BASIC_INFORMATION& mbi) {
+		MemoryRegionInfo info;
+		info.BaseAddress = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress);
+		info.AllocationBase = reinterpret_cast<ULONG_PTR>(mbi.AllocationBase);
+		info.RegionSize = mbi.RegionSize;
+		info.Protect = mbi.Protect;
+		info.State = MemoryManager::StateFromFlags(mbi.State);
+		info.Type = MemoryManager::TypeFromFlags(mbi.Type);
+		return info;
+	}
+
+	// VirtualQueryEx results with the mix of a large managed process: mostly
+	// committed private heap segments and reserved tails, some images and
+	// mapped views, and a few guard pages.
+	std::vector<MEMORY_BASIC_INFORMATION> MakeQueryResults(size_t count) {
+		static const DWORD protections[] = { PAGE_READWRITE, PAGE_READWRITE, PAGE_READONLY, PAGE_EXECUTE_READ, PAGE_READWRITE | PAGE_GUARD, PAGE_WRITECOPY };
+		std::mt19937 random(43);
+		std::vector<MEMORY_BASIC_INFORMATION> results(count);
+		ULONG_PTR address = 0x10000;
+		for (auto& mbi : results) {
+			mbi = MEMORY_BASIC_INFORMATION();
+			mbi.BaseAddress = reinterpret_cast<PVOID>(address);
+			mbi.AllocationBase = mbi.BaseAddress;
+			mbi.RegionSize = static_cast<SIZE_T>(1 + random() % 16) * 0x1000;
+			switch (random() % 8) {
+				case 0:
+					mbi.State = MEM_FREE;
+					mbi.Protect = PAGE_NOACCESS;
+					break;
+				case 1:
+				case 2:
+					mbi.State = MEM_RESERVE;
+					mbi.Type = MEM_PRIVATE;
+					break;
+				default:
+					mbi.State = MEM_COMMIT;
+					mbi.Type = random() % 5 == 0 ? MEM_IMAGE : random() % 4 == 0 ? MEM_MAPPED : MEM_PRIVATE;
+					mbi.Protect = protections[random() % _countof(protections)];
+					break;
+			}
+			address += mbi.RegionSize;
+		}
+		return results;
+	}
+
+	// Row text as the Memory tab shows it: the three columns that were
+	// stored strings, now formatted from codes into stack buffers.
+	size_t FormatRows(const std::vector<MemoryRegionInfo>& regions) {
+		size_t characters = 0;
+		wchar_t protection[64];
+		for (const auto& region : regions) {
+			characters += MemoryManager::FormatProtection(region.Protect, protection, _countof(protection));
+			characters += MemoryManager::StateToString(region.State).size();
+			characters += MemoryManager::TypeToString(region.Type).size();
+		}
+		return characters;
+	}
+
+	size_t FormatRows(const std::vector<LegacyRegionInfo>& regions) {
+		size_t characters = 0;
+		for (const auto& region : regions) {
+			characters += region.ProtectionString.size() + region.StateString.size() + region.TypeString.size();
+		}
+		return characters;
+	}
+
+	// Reserves allocations in this process, each with one committed page, so
+	// a live enumeration has tens of thousands of regions to walk.
+	class RegionFiller {
+	public:
+		explicit RegionFiller(size_t allocationCount) {
+			static const DWORD protections[] = { PAGE_READWRITE, PAGE_READONLY, PAGE_READWRITE | PAGE_GUARD, PAGE_EXECUTE_READ };
+			for (size_t i = 0; i < allocationCount; ++i) {
+				void* base = VirtualAlloc(nullptr, 0x10000, MEM_RESERVE, PAGE_NOACCESS);
+				if (!base) {
+					break;
+				}
+				m_Allocations.push_back(base);
+				VirtualAlloc(base, 0x1000, MEM_COMMIT, protections[i % _countof(protections)]);
+			}
+		}
+
+		~RegionFiller() {
+			for (void* base : m_Allocations) {
+				VirtualFree(base, 0, MEM_RELEASE);
+			}
+		}
+
+		RegionFiller(const RegionFiller&) = delete;
+		RegionFiller& operator=(const RegionFiller&) = delete;
+
+	private:
+		std::vector<void*> m_Allocations;
+	};
+
+}
+
+TEST_CASE(MemoryManager_FormatProtectionMatchesLegacyText) {
+	static const DWORD bases[] = { 0, PAGE_NOACCESS, PAGE_READONLY, PAGE_READWRITE, PAGE_WRITECOPY, PAGE_EXECUTE,
+		PAGE_EXECUTE_READ, PAGE_EXECUTE_READWRITE, PAGE_EXECUTE_WRITECOPY, 0x03 };
+	for (DWORD base : bases) {
+		for (DWORD modifiers = 0; modifiers < 8; ++modifiers) {
+			DWORD protect = base;
+			if (modifiers & 1) {
+				protect |= PAGE_GUARD;
+			}
+			if (modifiers & 2) {
+				protect |= PAGE_NOCACHE;
+			}
+			if (modifiers & 4) {
+				protect |= PAGE_WRITECOMBINE;
+			}
+			wchar_t buffer[64];
+			size_t length = MemoryManager::FormatProtection(protect, buffer, _countof(buffer));
+			CHECK(std::wstring(buffer, length) == LegacyProtectionToString(protect));
+			CHECK(MemoryManager::ProtectionToString(protect) == LegacyProtectionToString(protect));
+		}
+	}
+}
+
+TEST_CASE(MemoryManager_FormatProtectionTruncates) {
+	wchar_t buffer[8];
+	size_t length = MemoryManager::FormatProtection(PAGE_EXECUTE_READWRITE | PAGE_GUARD, buffer, _countof(buffer));
+	CHECK_EQUAL(7u, length);
+	CHECK(std::wstring(buffer) == L"Execute");
+	CHECK_EQUAL(0u, MemoryManager::FormatProtection(PAGE_READONLY, buffer, 0));
+}
+
+TEST_CASE(MemoryManager_CodesMatchLegacyText) {
+	static const DWORD states[] = { MEM_COMMIT, MEM_RESERVE, MEM_FREE, 0 };
+	static const DWORD types[] = { MEM_IMAGE, MEM_MAPPED, MEM_PRIVATE, 0 };
+	for (DWORD state : states) {
+		CHECK(std::wstring(MemoryManager::StateToString(MemoryManager::StateFromFlags(state))) == LegacyStateToString(state));
+	}
+	for (DWORD type : types) {
+		CHECK(std::wstring(MemoryManager::TypeToString(MemoryManager::TypeFromFlags(type))) == LegacyTypeToString(type));
+	}
+	// Out-of-range codes fall back to the first name.
+	CHECK(MemoryManager::StateToString(static_cast<MemoryState>(200)) == L"Unknown");
+	CHECK(MemoryManager::TypeToString(static_cast<MemoryType>(200)) == L"Unknown");
+}
+
+TEST_CASE(MemoryManager_IsReadable) {
+	MemoryRegionInfo region;
+	region.State = MemoryState::Commit;
+	region.Type = MemoryType::Private;
+	region.RegionSize = 0x1000;
+	region.Protect = PAGE_READWRITE;
+	CHECK(MemoryManager::IsReadable(region, false));
+
+	region.Protect = PAGE_READWRITE | PAGE_GUARD;
+	CHECK(!MemoryManager::IsReadable(region, false));
+	region.Protect = PAGE_NOACCESS;
+	CHECK(!MemoryManager::IsReadable(region, false));
+	region.Protect = PAGE_EXECUTE;
+	CHECK(!MemoryManager::IsReadable(region, false));
+
+	region.Protect = PAGE_EXECUTE_READ;
+	region.Type = MemoryType::Image;
+	CHECK(!MemoryManager::IsReadable(region, false));
+	CHECK(MemoryManager::IsReadable(region, true));
+
+	region.State = MemoryState::Reserve;
+	CHECK(!MemoryManager::IsReadable(region, true));
+}
+
+BENCHMARK_CASE(MemoryManager_RecordsFromQueryResults) {
+	// Record building and row formatting alone, without the system calls,
+	// for a 100k-region address space.
+	const size_t count = 100000;
+	std::vector<MEMORY_BASIC_INFORMATION> results = MakeQueryResults(count);
+	std::printf(" %zu regions, %zu bytes per legacy record, %zu per packed record\n", count, sizeof(LegacyRegionInfo), sizeof(MemoryRegionInfo));
+
+	Measure("legacy records (three strings)", count, [&]() {
+		std::vector<LegacyRegionInfo> regions;
+		for (const auto& mbi : results) {
+			regions.push_back(MakeLegacyRecord(mbi));
+		}
+		KeepResult(regions.size());
+	});
+	Measure("packed records", count, [&]() {
+		std::vector<MemoryRegionInfo> regions;
+		for (const auto& mbi : results) {
+			regions.push_back(MakePackedRecord(mbi));
+		}
+		KeepResult(regions.size());
+	});
+
+	std::vector<LegacyRegionInfo> legacy;
+	std::vector<MemoryRegionInfo> packed;
+	for (const auto& mbi : results) {
+		legacy.push_back(MakeLegacyRecord(mbi));
+		packed.push_back(MakePackedRecord(mbi));
+	}
+	CHECK_EQUAL(FormatRows(legacy), FormatRows(packed));
+	Measure("legacy records, row text", count, [&]() {
+		KeepResult(FormatRows(legacy));
+	});
+	Measure("packed records, row text", count, [&]() {
+		KeepResult(FormatRows(packed));
+	});
+}
+
+BENCHMARK_CASE(MemoryManager_EnumerateThisProcess) {
+	// A live walk of this process with 20k extra allocations, which is where
+	// the strings used to be built.
+	RegionFiller filler(20000);
+	MemoryManager manager;
+	size_t count = manager.EnumerateMemoryRegions(GetCurrentProcessId()).size();
+	REQUIRE(count != 0);
+	std::printf(" %zu regions\n", count);
+
+	Measure("legacy EnumerateMemoryRegions", count, [&]() {
+		KeepResult(LegacyEnumerate(GetCurrentProcessId()).size());
+	});
+	Measure("EnumerateMemoryRegions", count, [&]() {
+		KeepResult(manager.EnumerateMemoryRegions(GetCurrentProcessId()).size());
+	});
+}
@@ -0,0 +1,384 @@
+#include "TestFramework.h"
+#include "MinidumpWriter.h"
+#include "core/MinidumpFile.h"
+#include "core/SignatureScanner.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	const ULONG_PTR NtdllBase = 0x10000000;
+	const ULONG_PTR AppBase = 0x00400000;
+	const ULONG_PTR HeapBase = 0x20000000;
+
+	std::vector<BYTE> Pattern(size_t size, BYTE seed) {
+		std::vector<BYTE> data(size);
+		for (size_t i = 0; i < size; ++i) {
+			data[i] = static_cast<BYTE>(seed + i * 7);
+		}
+		return data;
+	}
+
+	// Two modules, two threads, a small 32-bit memory list inside the
+	// application image and two 64-bit ranges with a gap between them.
+	MinidumpWriter MakeDump() {
+		MinidumpWriter writer;
+		writer.ProcessId = 4242;
+		writer.TimeDateStamp = 0x65000000;
+
+		MinidumpWriterModule app;
+		app.BaseAddress = AppBase;
+		app.Size = 0x3000;
+		app.Name = ToUtf16(L"C:\\Program Files\\App\\app.exe");
+		MinidumpWriterModule ntdll;
+		ntdll.BaseAddress = NtdllBase;
+		ntdll.Size = 0x10000;
+		ntdll.Name = ToUtf16(L"C:\\Windows\\System32\\ntdll.dll");
+		writer.Modules = { app, ntdll };
+
+		MinidumpWriterThread main;
+		main.ThreadId = 100;
+		main.Priority = 8;
+		main.Teb = 0x7FFDE000;
+		main.StackStart = 0x00100000;
+		main.StartAddress = AppBase + 0x1200;
+		MinidumpWriterThread worker;
+		worker.ThreadId = 104;
+		worker.Priority = 10;
+		worker.Teb = 0x7FFDB000;
+		worker.StackStart = 0x00200000;
+		writer.Threads = { main, worker };
+
+		MinidumpWriterRange header;
+		header.BaseAddress = AppBase;
+		header.Size = 0x1000;
+		header.Data = Pattern(0x1000, 1);
+		writer.Memory = { header };
+
+		MinidumpWriterRange first;
+		first.BaseAddress = HeapBase;
+		first.Size = 0x2000;
+		first.Data = Pattern(0x2000, 2);
+		MinidumpWriterRange second;
+		second.BaseAddress = HeapBase + 0x3000;
+		second.Size = 0x1000;
+		second.Data = Pattern(0x1000, 3);
+		writer.Memory64 = { first, second };
+		return writer;
+	}
+
+	bool OpenWritten(const MinidumpWriter& writer, MinidumpFile& dump, const wchar_t* name = L"test.dmp") {
+		std::wstring path = GetTempPath(name);
+		return writer.Write(path) && dump.Open(path);
+	}
+
+	bool WriteBytes(const std::wstring& path, const std::vector<BYTE>& bytes) {
+		std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+
+}
+
+TEST_CASE(MinidumpFile_OpensWrittenDump) {
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(MakeDump(), dump));
+	CHECK(dump.IsOpen());
+	CHECK_EQUAL(4242u, dump.GetProcessId());
+	CHECK_EQUAL(0x65000000u, dump.GetTimeDateStamp());
+	CHECK(dump.FindStream(MinidumpStreamType::ThreadList) != nullptr);
+	CHECK(dump.FindStream(MinidumpStreamType::SystemInfo) == nullptr);
+
+	const auto& modules = dump.GetModules();
+	REQUIRE(modules.size() == 2);
+	CHECK(modules[0].Name == L"app.exe");
+	CHECK(modules[0].FullPath == L"C:\\Program Files\\App\\app.exe");
+	CHECK_EQUAL(AppBase, modules[0].BaseAddress);
+	CHECK_EQUAL(0x3000u, modules[0].Size);
+	CHECK(modules[1].Name == L"ntdll.dll");
+
+	const auto& threads = dump.GetThreads();
+	REQUIRE(threads.size() == 2);
+	CHECK_EQUAL(100u, threads[0].ThreadId);
+	CHECK_EQUAL(4242u, threads[0].ProcessId);
+	CHECK_EQUAL(8, threads[0].Priority);
+	CHECK_EQUAL(AppBase + 0x1200, threads[0].StartAddress);
+	CHECK_EQUAL(0u, threads[1].StartAddress);
+
+	AddressSpaceHints hints = dump.GetAddressSpaceHints();
+	CHECK((hints.Stacks == std::vector<ULONG_PTR>{ 0x00100000, 0x00200000 }));
+	CHECK((hints.Tebs == std::vector<ULONG_PTR>{ 0x7FFDE000, 0x7FFDB000 }));
+
+	CHECK_EQUAL(3u, dump.GetMemoryRanges().size());
+	CHECK_EQUAL(0x4000u, dump.GetMemorySize());
+	dump.Close();
+	CHECK(!dump.IsOpen());
+	CHECK(dump.GetModules().empty());
+}
+
+TEST_CASE(MinidumpFile_ReadsModuleNamesWithSurrogatePairs) {
+	MinidumpWriter writer = MakeDump();
+	// U+1F600, then a lone high surrogate, which is kept as it is.
+	writer.Modules[0].Name = ToUtf16(L"C:\\x\\");
+	writer.Modules[0].Name.insert(writer.Modules[0].Name.end(), { 0xD83D, 0xDE00, 0xD800, 'a' });
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(writer, dump));
+
+	std::wstring expected;
+	if (sizeof(wchar_t) == 2) {
+		expected = { static_cast<wchar_t>(0xD83D), static_cast<wchar_t>(0xDE00) };
+	} else {
+		expected = { static_cast<wchar_t>(0x1F600) };
+	}
+	expected += static_cast<wchar_t>(0xD800);
+	expected += L'a';
+	CHECK(dump.GetModules()[0].Name == expected);
+}
+
+TEST_CASE(MinidumpFile_RegionsWithoutMemoryInfo) {
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(MakeDump(), dump));
+	CHECK(!dump.HasMemoryInfo());
+
+	// One committed region per range, sorted; the one inside app.exe is
+	// image memory of that module.
+	const auto& regions = dump.GetRegions();
+	REQUIRE(regions.size() == 3);
+	CHECK_EQUAL(AppBase, regions[0].BaseAddress);
+	CHECK(regions[0].Type == MemoryType::Image);
+	CHECK_EQUAL(AppBase, regions[0].AllocationBase);
+	CHECK_EQUAL(HeapBase, regions[1].BaseAddress);
+	CHECK(regions[1].Type == MemoryType::Private);
+	CHECK_EQUAL(0x2000u, regions[1].RegionSize);
+	CHECK(regions[2].State == MemoryState::Commit);
+	CHECK(MemoryManager::IsReadable(regions[2], false));
+}
+
+TEST_CASE(MinidumpFile_RegionsFromMemoryInfoList) {
+	MinidumpWriter writer = MakeDump();
+	MinidumpWriterRegion image;
+	image.BaseAddress = AppBase;
+	image.AllocationBase = AppBase;
+	image.RegionSize = 0x3000;
+	image.State = MEM_COMMIT;
+	image.Protect = PAGE_EXECUTE_READ;
+	image.Type = MEM_IMAGE;
+	MinidumpWriterRegion reserved;
+	reserved.BaseAddress = HeapBase;
+	reserved.AllocationBase = HeapBase;
+	reserved.RegionSize = 0x10000;
+	reserved.State = MEM_RESERVE;
+	reserved.Type = MEM_PRIVATE;
+	writer.MemoryInfo = { image, reserved };
+
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(writer, dump));
+	CHECK(dump.HasMemoryInfo());
+	const auto& regions = dump.GetRegions();
+	REQUIRE(regions.size() == 2);
+	CHECK(regions[0].Type == MemoryType::Image);
+	CHECK(regions[0].State == MemoryState::Commit);
+	CHECK_EQUAL(static_cast<DWORD>(PAGE_EXECUTE_READ), regions[0].Protect);
+	CHECK(regions[1].State == MemoryState::Reserve);
+	CHECK_EQUAL(0x10000u, regions[1].RegionSize);
+}
+
+TEST_CASE(MinidumpFile_ReadsSavedMemory) {
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(MakeDump(), dump));
+
+	// 64-bit ranges follow each other from BaseRva.
+	std::vector<BYTE> first = Pattern(0x2000, 2);
+	std::vector<BYTE> second = Pattern(0x1000, 3);
+	const BYTE* view = dump.GetView(HeapBase + 0x10, 0x100);
+	REQUIRE(view != nullptr);
+	CHECK(std::equal(view, view + 0x100, first.begin() + 0x10));
+	view = dump.GetView(HeapBase + 0x3000, 0x1000);
+	REQUIRE(view != nullptr);
+	CHECK(std::equal(view, view + 0x1000, second.begin()));
+	CHECK(dump.GetView(HeapBase + 0x1F00, 0x200) == nullptr);
+	CHECK(dump.GetView(HeapBase - 1, 1) == nullptr);
+
+	// The gap between the ranges reads as zeros.
+	std::vector<BYTE> buffer(0x2000, 0xCC);
+	REQUIRE(dump.Read(HeapBase + 0x1800, buffer.data(), buffer.size()));
+	CHECK(std::equal(buffer.begin(), buffer.begin() + 0x800, first.begin() + 0x1800));
+	CHECK(std::all_of(buffer.begin() + 0x800, buffer.begin() + 0x1800, [](BYTE b) { return b == 0; }));
+	CHECK(std::equal(buffer.begin() + 0x1800, buffer.end(), second.begin()));
+	// Of the three pages touched, only the one in the gap failed.
+	std::vector<bool> failedPages;
+	REQUIRE(dump.Read(HeapBase + 0x1800, buffer.data(), buffer.size(), &failedPages));
+	CHECK((failedPages == std::vector<bool>{ false, true, false }));
+
+	CHECK(!dump.Read(HeapBase + 0x2000, buffer.data(), 0x1000));
+	CHECK(!dump.Read(HeapBase + 0x3000, buffer.data(), 0));
+
+	BYTE byte = 0;
+	MemoryReadFunction read = dump.GetReadFunction();
+	REQUIRE(read(AppBase + 5, &byte, 1, nullptr));
+	CHECK_EQUAL(Pattern(0x1000, 1)[5], byte);
+}
+
+TEST_CASE(MinidumpFile_ReadsPaddedListCounts) {
+	MinidumpWriter writer = MakeDump();
+	writer.PadListCounts = true;
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(writer, dump));
+	CHECK_EQUAL(2u, dump.GetModules().size());
+	CHECK(dump.GetModules()[1].Name == L"ntdll.dll");
+	CHECK_EQUAL(2u, dump.GetThreads().size());
+	CHECK_EQUAL(104u, dump.GetThreads()[1].ThreadId);
+	REQUIRE(dump.GetView(AppBase, 0x1000) != nullptr);
+	CHECK_EQUAL(1, dump.GetView(AppBase, 0x1000)[0]);
+}
+
+TEST_CASE(MinidumpFile_RejectsDamagedFiles) {
+	MinidumpFile dump;
+	CHECK(!dump.Open(GetTempPath(L"missing.dmp")));
+
+	std::vector<BYTE> file = MakeDump().Build();
+	std::wstring path = GetTempPath(L"damaged.dmp");
+
+	REQUIRE(WriteBytes(path, {}));
+	CHECK(!dump.Open(path));
+
+	std::vector<BYTE> damaged = file;
+	damaged[0] = 'X';
+	REQUIRE(WriteBytes(path, damaged));
+	CHECK(!dump.Open(path));
+
+	// A directory that runs past the end of the file.
+	damaged.assign(file.begin(), file.begin() + 40);
+	REQUIRE(WriteBytes(path, damaged));
+	CHECK(!dump.Open(path));
+
+	// Cut in the middle of the 64-bit memory: the ranges before the cut
+	// are kept and the rest dropped.
+	damaged.assign(file.begin(), file.end() - 0x800);
+	REQUIRE(WriteBytes(path, damaged));
+	REQUIRE(dump.Open(path));
+	CHECK_EQUAL(2u, dump.GetMemoryRanges().size());
+	CHECK_EQUAL(2u, dump.GetModules().size());
+
+	// A failed open leaves nothing behind from the last one.
+	CHECK(!dump.Open(GetTempPath(L"missing.dmp")));
+	CHECK(!dump.IsOpen());
+	CHECK(dump.GetMemoryRanges().empty());
+}
+
+TEST_CASE(MinidumpFile_ScansDumpMemory) {
+	// The signature scanner runs on a dump through its read function and
+	// regions, as it does on a live process.
+	MinidumpWriter writer = MakeDump();
+	const BYTE marker[] = { 'b', 'e', 'a', 'c', 'o', 'n', 0x13, 0x37 };
+	std::copy(marker, marker + sizeof(marker), writer.Memory64[1].Data.begin() + 0x123);
+
+	SignaturePattern pattern;
+	REQUIRE(SignatureScanner::ParsePattern(L"beacon: 62 65 61 63 6F 6E 13 37", pattern));
+	SignatureScanner scanner;
+	REQUIRE(scanner.Compile({ pattern }));
+
+	MinidumpFile dump;
+	REQUIRE(OpenWritten(writer, dump));
+	std::vector<SignatureMatch> matches;
+	SignatureScanStatistics statistics = scanner.Scan(dump.GetReadFunction(), dump.GetRegions(), SignatureScanOptions(), [&matches](std::vector<SignatureMatch>& batch) {
+		matches.insert(matches.end(), batch.begin(), batch.end());
+	});
+	REQUIRE(matches.size() == 1);
+	CHECK_EQUAL(HeapBase + 0x3123, matches[0].Address);
+	CHECK_EQUAL(dump.GetMemorySize(), statistics.BytesScanned);
+}
+
+BENCHMARK_CASE(MinidumpFile_LargeDump) {
+	// A full memory dump of 4 GB (256 MB in 32-bit builds, which cannot
+	// map more) in 256 KB ranges with a memory info entry each. Unsaved
+	// bytes are holes in the file, so reads measure the lookup and the
+	// mapping rather than the disk.
+	const ULONGLONG total = sizeof(void*) == 8 ? 4ULL << 30 : 256ULL << 20;
+	const ULONGLONG rangeSize = 256 * 1024;
+	const size_t rangeCount = static_cast<size_t>(total / rangeSize);
+	const ULONG_PTR base = 0x10000;
+
+	MinidumpWriter writer = MakeDump();
+	writer.Memory.clear();
+	writer.Memory64.clear();
+	for (size_t i = 0; i < rangeCount; ++i) {
+		MinidumpWriterRange range;
+		// A 64 KB gap between ranges, as between allocations.
+		range.BaseAddress = base + i * (rangeSize + 0x10000);
+		range.Size = rangeSize;
+		writer.Memory64.push_back(range);
+
+		MinidumpWriterRegion region;
+		region.BaseAddress = range.BaseAddress;
+		region.AllocationBase = range.BaseAddress;
+		region.RegionSize = rangeSize;
+		region.State = MEM_COMMIT;
+		region.Protect = PAGE_READWRITE;
+		region.Type = MEM_PRIVATE;
+		writer.MemoryInfo.push_back(region);
+	}
+	ULONGLONG fileSize = 0;
+	writer.Build(&fileSize);
+	std::wstring path = GetTempPath(L"large.dmp");
+	REQUIRE(writer.Write(path));
+	std::printf(" %zu ranges, %llu MB file\n", rangeCount, static_cast<unsigned long long>(fileSize >> 20));
+
+	Measure("Open + Close", 1, [&]() {
+		MinidumpFile dump;
+		KeepResult(dump.Open(path) ? dump.GetRegions().size() : 0);
+	});
+
+	MinidumpFile dump;
+	REQUIRE(dump.Open(path));
+	REQUIRE(dump.GetMemoryRanges().size() == rangeCount);
+
+	// Random 4 KB reads across the whole dump, through the mapping and, as
+	// a baseline, by seeking in the file.
+	const size_t readCount = 4096;
+	std::mt19937_64 random(50);
+	std::vector<ULONG_PTR> addresses(readCount);
+	std::vector<ULONGLONG> offsets(readCount);
+	ULONGLONG baseRva = fileSize - total;
+	for (size_t i = 0; i < readCount; ++i) {
+		size_t range = static_cast<size_t>(random() % rangeCount);
+		ULONGLONG offset = (random() % (rangeSize / 4096)) * 4096;
+		addresses[i] = static_cast<ULONG_PTR>(writer.Memory64[range].BaseAddress + offset);
+		offsets[i] = baseRva + range * rangeSize + offset;
+	}
+
+	std::vector<BYTE> buffer(4096);
+	Measure("MinidumpFile::Read, random 4 KB", readCount, [&]() {
+		size_t read = 0;
+		for (ULONG_PTR address : addresses) {
+			read += dump.Read(address, buffer.data(), buffer.size());
+		}
+		KeepResult(read);
+	});
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	Measure("seek + read, random 4 KB", readCount, [&]() {
+		size_t read = 0;
+		for (ULONGLONG offset : offsets) {
+			file.seekg(static_cast<std::streamoff>(offset));
+			read += static_cast<bool>(file.read(reinterpret_cast<char*>(buffer.data()), buffer.size()));
+		}
+		KeepResult(read);
+	});
+	// Reads that span the end of one range, the gap and the start of the
+	// next, which are copied piece by piece.
+	std::vector<BYTE> spanning(2048 + 0x10000 + 2048);
+	Measure("MinidumpFile::Read, across a gap", readCount, [&]() {
+		size_t read = 0;
+		for (size_t i = 0; i < readCount; ++i) {
+			ULONG_PTR address = static_cast<ULONG_PTR>(writer.Memory64[i % (rangeCount - 1)].BaseAddress + rangeSize - 2048);
+			read += dump.Read(address, spanning.data(), spanning.size());
+		}
+		KeepResult(read);
+	});
+}
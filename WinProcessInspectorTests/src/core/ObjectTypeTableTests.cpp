@@ -0,0 +1,233 @@
+#include "TestFramework.h"
+#include "core/ObjectTypeTable.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace WinProcessInspector::Core;
+
+namespace {
+
+	// Builds an ObjectTypesInformation buffer the way NtQueryObject lays it
+	// out: a ULONG count, then each entry aligned to a pointer and followed
+	// by its name and terminator. Entries can be edited before Build to
+	// produce malformed buffers.
+	class ObjectTypesBuffer {
+	public:
+		ObjectTypeInformationEntry& Add(const std::wstring& name, UCHAR typeIndex, ULONG handles = 0) {
+			ObjectTypeInformationEntry entry = {};
+			entry.TypeName.Length = static_cast<USHORT>(name.size() * sizeof(WCHAR));
+			entry.TypeName.MaximumLength = static_cast<USHORT>(entry.TypeName.Length + sizeof(WCHAR));
+			// Points into the capturing process; Parse must not follow it.
+			entry.TypeName.Buffer = reinterpret_cast<PWSTR>(static_cast<ULONG_PTR>(0xDEAD0000));
+			entry.TotalNumberOfObjects = handles / 2;
+			entry.TotalNumberOfHandles = handles;
+			entry.HighWaterNumberOfHandles = handles + 10;
+			entry.ValidAccessMask = 0x1F0001;
+			entry.TypeIndex = typeIndex;
+			m_Entries.push_back(entry);
+			m_Names.push_back(name);
+			return m_Entries.back();
+		}
+
+		std::vector<BYTE> Build() const {
+			return Build(static_cast<ULONG>(m_Entries.size()));
+		}
+
+		std::vector<BYTE> Build(ULONG count) const {
+			std::vector<BYTE> buffer;
+			Append(buffer, &count, sizeof(count));
+			for (size_t i = 0; i < m_Entries.size(); ++i) {
+				Align(buffer);
+				Append(buffer, &m_Entries[i], sizeof(m_Entries[i]));
+				// MaximumLength bytes follow the entry, whatever Length says.
+				std::vector<BYTE> name(m_Entries[i].TypeName.MaximumLength);
+				std::memcpy(name.data(), m_Names[i].data(), std::min(name.size(), m_Names[i].size() * sizeof(WCHAR)));
+				Append(buffer, name.data(), name.size());
+			}
+			Align(buffer);
+			return buffer;
+		}
+
+	private:
+		static void Append(std::vector<BYTE>& buffer, const void* data, size_t size) {
+			const BYTE* bytes = static_cast<const BYTE*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+
+		static void Align(std::vector<BYTE>& buffer) {
+			buffer.resize((buffer.size() + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1));
+		}
+
+		std::vector<ObjectTypeInformationEntry> m_Entries;
+		std::vector<std::wstring> m_Names;
+	};
+
+	// The first types of a Windows 10 system, with their reported indices.
+	ObjectTypesBuffer MakeWindows10Types() {
+		ObjectTypesBuffer types;
+		types.Add(L"Type", 2, 2);
+		types.Add(L"Directory", 3, 180);
+		types.Add(L"SymbolicLink", 4, 40);
+		types.Add(L"Token", 5, 1200);
+		types.Add(L"Process", 7, 5400);
+		types.Add(L"Thread", 8, 9800);
+		types.Add(L"Event", 16, 60000);
+		types.Add(L"File", 37, 42000);
+		return types;
+	}
+
+}
+
+TEST_CASE(ObjectTypeTable_ParseReadsNamesAndIndices) {
+	std::vector<BYTE> buffer = MakeWindows10Types().Build();
+
+	ObjectTypeTable table;
+	REQUIRE(table.Parse(buffer.data(), buffer.size()));
+	CHECK_EQUAL(8u, table.GetTypeCount());
+	CHECK_EQUAL(38u, table.GetTypes().size());
+
+	const ObjectTypeInfo* file = table.GetType(37);
+	REQUIRE(file != nullptr);
+	CHECK(file->Name == L"File");
+	CHECK_EQUAL(37, file->Index);
+	CHECK_EQUAL(42000u, file->TotalHandles);
+	CHECK_EQUAL(21000u, file->TotalObjects);
+	CHECK_EQUAL(42010u, file->HighWaterHandles);
+	CHECK_EQUAL(0x1F0001u, file->ValidAccessMask);
+
+	CHECK(table.GetName(12) == L"Type12");
+	CHECK(table.GetType(6) == nullptr);
+	CHECK(table.GetType(500) == nullptr);
+	CHECK(table.GetName(7) == L"Process");
+	CHECK(table.GetName(4) == L"SymbolicLink");
+}
+
+TEST_CASE(ObjectTypeTable_ParseNumbersTypesWithoutIndex) {
+	// Before Windows 8.1 TypeIndex is zero and types count up from 2.
+	ObjectTypesBuffer types;
+	types.Add(L"Type", 0);
+	types.Add(L"Directory", 0);
+	types.Add(L"SymbolicLink", 0);
+	std::vector<BYTE> buffer = types.Build();
+
+	ObjectTypeTable table;
+	REQUIRE(table.Parse(buffer.data(), buffer.size()));
+	CHECK(table.GetName(2) == L"Type");
+	CHECK(table.GetName(3) == L"Directory");
+	CHECK(table.GetName(4) == L"SymbolicLink");
+}
+
+TEST_CASE(ObjectTypeTable_FindIgnoresCase) {
+	std::vector<BYTE> buffer = MakeWindows10Types().Build();
+
+	ObjectTypeTable table;
+	REQUIRE(table.Parse(buffer.data(), buffer.size()));
+	WORD index = 0;
+	CHECK(table.Find(L"file", index));
+	CHECK_EQUAL(37, index);
+	CHECK(table.Find(L"EVENT", index));
+	CHECK_EQUAL(16, index);
+	CHECK(!table.Find(L"Fil", index));
+	CHECK(!table.Find(L"Key", index));
+}
+
+TEST_CASE(ObjectTypeTable_CountHandlesByType) {
+	std::vector<BYTE> buffer = MakeWindows10Types().Build();
+
+	ObjectTypeTable table;
+	REQUIRE(table.Parse(buffer.data(), buffer.size()));
+	std::vector<HandleEntry> handles(5);
+	handles[0].ObjectTypeIndex = 37;
+	handles[1].ObjectTypeIndex = 37;
+	handles[2].ObjectTypeIndex = 7;
+	// Unknown to the table; the counts grow to hold it.
+	handles[3].ObjectTypeIndex = 60;
+	handles[4].ObjectTypeIndex = 16;
+
+	std::vector<size_t> counts = table.CountHandles(handles.data(), handles.size());
+	REQUIRE(counts.size() == 61);
+	CHECK_EQUAL(2u, counts[37]);
+	CHECK_EQUAL(1u, counts[7]);
+	CHECK_EQUAL(1u, counts[16]);
+	CHECK_EQUAL(1u, counts[60]);
+	CHECK_EQUAL(0u, counts[2]);
+}
+
+TEST_CASE(ObjectTypeTable_ParseRejectsCountOverrunningBuffer) {
+	ObjectTypesBuffer types = MakeWindows10Types();
+	std::vector<BYTE> good = types.Build();
+	std::vector<BYTE> overrun = types.Build(9);
+	// Far more entries than any buffer could hold.
+	std::vector<BYTE> huge = types.Build(0xFFFFFFFF);
+
+	ObjectTypeTable table;
+	REQUIRE(table.Parse(good.data(), good.size()));
+	CHECK(!table.Parse(overrun.data(), overrun.size()));
+	CHECK(table.IsEmpty());
+	CHECK(table.GetTypes().empty());
+	CHECK(!table.Parse(huge.data(), huge.size()));
+
+	// The buffer cut inside the last name.
+	CHECK(!table.Parse(good.data(), good.size() - sizeof(ULONG_PTR) - 2));
+	CHECK(!table.Parse(good.data(), 2));
+	CHECK(!table.Parse(nullptr, good.size()));
+}
+
+TEST_CASE(ObjectTypeTable_ParseRejectsOddLengthNames) {
+	ObjectTypesBuffer types = MakeWindows10Types();
+	types.Add(L"Mutant", 17).TypeName.Length = 11;
+	std::vector<BYTE> buffer = types.Build();
+
+	ObjectTypeTable table;
+	CHECK(!table.Parse(buffer.data(), buffer.size()));
+	CHECK(table.IsEmpty());
+	CHECK(table.GetTypes().empty());
+}
+
+TEST_CASE(ObjectTypeTable_ParseRejectsBadNameLengths) {
+	ObjectTypeTable table;
+	{
+		ObjectTypesBuffer types;
+		types.Add(L"", 2);
+		std::vector<BYTE> buffer = types.Build();
+		CHECK(!table.Parse(buffer.data(), buffer.size()));
+	}
+	{
+		// Length beyond MaximumLength would read past the name.
+		ObjectTypesBuffer types;
+		ObjectTypeInformationEntry& entry = types.Add(L"Section", 42);
+		entry.TypeName.Length = static_cast<USHORT>(entry.TypeName.MaximumLength + 2);
+		std::vector<BYTE> buffer = types.Build();
+		CHECK(!table.Parse(buffer.data(), buffer.size()));
+	}
+	{
+		// MaximumLength running past the end of the buffer.
+		ObjectTypesBuffer types;
+		types.Add(L"Key", 44);
+		std::vector<BYTE> buffer = types.Build();
+		ObjectTypeInformationEntry entry;
+		std::memcpy(&entry, buffer.data() + sizeof(ULONG_PTR), sizeof(entry));
+		entry.TypeName.MaximumLength = 0x8000;
+		std::memcpy(buffer.data() + sizeof(ULONG_PTR), &entry, sizeof(entry));
+		CHECK(!table.Parse(buffer.data(), buffer.size()));
+	}
+	CHECK(table.IsEmpty());
+}
+
+TEST_CASE(ObjectTypeTable_ParseRejectsDuplicateIndices) {
+	ObjectTypesBuffer types = MakeWindows10Types();
+	types.Add(L"Desktop", 37);
+	std::vector<BYTE> buffer = types.Build();
+
+	ObjectTypeTable table;
+	CHECK(!table.Parse(buffer.data(), buffer.size()));
+	CHECK(table.IsEmpty());
+	CHECK(table.GetTypes().empty());
+
+	// A reported index colliding with a numbered one is just as ambiguous.
+	ObjectTypesBuffer mixed;
+	mixed.Add(L"Type", 0);
+	mixed.Add(L"Directory", 2);
+	buffer = mixed.Build();
+	CHECK(!table.Parse(buffer.data(), buffer.size()));
+}
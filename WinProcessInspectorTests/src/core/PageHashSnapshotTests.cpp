@@ -0,0 +1,121 @@
+#include "TestFramework.h"
+#include "MinidumpWriter.h"
+#include "core/PageHashSnapshot.h"
+#include "core/MinidumpFile.h"
+#include <cstring>
+#include <set>
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	const ULONG_PTR RegionBase = 0x100000;
+	const size_t PageSize = PageHashSnapshot::PageSize;
+
+	std::vector<MemoryRegionInfo> MakeRegions(size_t pages) {
+		MemoryRegionInfo region;
+		region.BaseAddress = RegionBase;
+		region.AllocationBase = RegionBase;
+		region.RegionSize = pages * PageSize;
+		region.Protect = PAGE_READWRITE;
+		region.State = MemoryState::Commit;
+		region.Type = MemoryType::Private;
+		return { region };
+	}
+
+	// Fills each page with its address and version, except the failed
+	// pages, which are zero filled and flagged as a process reader does
+	// when only part of a chunk can be read.
+	MemoryReadFunction MakeRead(const std::set<size_t>& failed, size_t changedPage = ~static_cast<size_t>(0)) {
+		return [failed, changedPage](ULONG_PTR address, void* buffer, size_t size, std::vector<bool>* failedPages) {
+			ResetFailedPages(failedPages, address, size);
+			BYTE* out = static_cast<BYTE*>(buffer);
+			for (size_t offset = 0; offset < size; offset += PageSize) {
+				size_t page = (address + offset - RegionBase) / PageSize;
+				if (failed.count(page) != 0) {
+					memset(out + offset, 0, PageSize);
+					MarkFailedPages(failedPages, address, address + offset, PageSize);
+					continue;
+				}
+				ULONGLONG stamp = (address + offset) * 2 + (page == changedPage ? 1 : 0);
+				memset(out + offset, 0x5A, PageSize);
+				memcpy(out + offset, &stamp, sizeof(stamp));
+			}
+			return failed.size() < size / PageSize;
+		};
+	}
+
+}
+
+TEST_CASE(PageHashSnapshot_PartiallyReadChunkMarksFailedPages) {
+	// Every page of the region falls in one chunk, so the read succeeds as
+	// a whole while two of its pages fail.
+	std::vector<MemoryRegionInfo> regions = MakeRegions(16);
+	PageHashSnapshot before;
+	REQUIRE(before.Capture(MakeRead({}), regions, PageCaptureOptions()));
+	PageHashSnapshot after;
+	REQUIRE(after.Capture(MakeRead({ 3, 4 }, 10), regions, PageCaptureOptions()));
+	CHECK_EQUAL(16u, after.GetPageCount());
+
+	std::vector<PageChange> changes = PageHashSnapshot::Diff(before, after);
+	REQUIRE(changes.size() == 2);
+	CHECK(changes[0].Kind == PageChangeKind::Unreadable);
+	CHECK_EQUAL(RegionBase + 3 * PageSize, changes[0].Address);
+	CHECK_EQUAL(2u, changes[0].PageCount);
+	CHECK(changes[1].Kind == PageChangeKind::Changed);
+	CHECK_EQUAL(RegionBase + 10 * PageSize, changes[1].Address);
+}
+
+TEST_CASE(PageHashSnapshot_KeptContentsOfFailedPagesAreZero) {
+	std::vector<MemoryRegionInfo> regions = MakeRegions(4);
+	PageCaptureOptions options;
+	options.KeepContentsLimit = 4 * PageSize;
+	PageHashSnapshot capture;
+	REQUIRE(capture.Capture(MakeRead({ 1 }), regions, options));
+
+	std::vector<BYTE> page(PageSize, 0xCC);
+	REQUIRE(capture.GetPage(RegionBase + PageSize, page.data()));
+	CHECK(std::all_of(page.begin(), page.end(), [](BYTE b) { return b == 0; }));
+	REQUIRE(capture.GetPage(RegionBase, page.data()));
+	CHECK_EQUAL(0x5A, page[PageSize - 1]);
+}
+
+TEST_CASE(PageHashSnapshot_UnsavedMinidumpPagesAreUnreadable) {
+	// A committed region of four pages of which the dump saved the first
+	// and the last.
+	MinidumpWriter writer;
+	MinidumpWriterRange first;
+	first.BaseAddress = RegionBase;
+	first.Size = PageSize;
+	first.Data.assign(PageSize, 1);
+	MinidumpWriterRange last = first;
+	last.BaseAddress = RegionBase + 3 * PageSize;
+	last.Data.assign(PageSize, 2);
+	writer.Memory64 = { first, last };
+	MinidumpWriterRegion region;
+	region.BaseAddress = RegionBase;
+	region.AllocationBase = RegionBase;
+	region.RegionSize = 4 * PageSize;
+	region.State = MEM_COMMIT;
+	region.Protect = PAGE_READWRITE;
+	region.Type = MEM_PRIVATE;
+	writer.MemoryInfo = { region };
+
+	MinidumpFile dump;
+	std::wstring path = GetTempPath(L"gaps.dmp");
+	REQUIRE(writer.Write(path) && dump.Open(path));
+
+	std::vector<bool> failedPages;
+	std::vector<BYTE> buffer(4 * PageSize);
+	REQUIRE(dump.Read(RegionBase, buffer.data(), buffer.size(), &failedPages));
+	CHECK((failedPages == std::vector<bool>{ false, true, true, false }));
+
+	PageHashSnapshot capture;
+	REQUIRE(capture.Capture(dump.GetReadFunction(), dump.GetRegions(), PageCaptureOptions()));
+	std::vector<PageChange> changes = PageHashSnapshot::Diff(capture, capture);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].Kind == PageChangeKind::Unreadable);
+	CHECK_EQUAL(RegionBase + PageSize, changes[0].Address);
+	CHECK_EQUAL(2u, changes[0].PageCount);
+}
@@ -0,0 +1,268 @@
+#include "TestFramework.h"
+#include "core/ProcessSearchIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cwctype>
+#include <random>
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	typedef size_t (*FindFunction)(const wchar_t*, size_t, const wchar_t*, size_t);
+
+	struct KernelEntry {
+		const char* Name;
+		FindFunction Find;
+	};
+
+	// The kernels this CPU can run, scalar first.
+	std::vector<KernelEntry> GetSupportedKernels() {
+		std::vector<KernelEntry> kernels;
+		kernels.push_back({ "scalar", ProcessSearchIndex::FindScalar });
+		ProcessSearchIndex::Kernel active = ProcessSearchIndex::GetActiveKernel();
+		if (active == ProcessSearchIndex::Kernel::SSE2 || active == ProcessSearchIndex::Kernel::AVX2) {
+			kernels.push_back({ "SSE2", ProcessSearchIndex::FindSse2 });
+		}
+		if (active == ProcessSearchIndex::Kernel::AVX2) {
+			kernels.push_back({ "AVX2", ProcessSearchIndex::FindAvx2 });
+		}
+		return kernels;
+	}
+
+	size_t Expected(const std::wstring& text, const std::wstring& pattern) {
+		size_t position = text.find(pattern);
+		return position == std::wstring::npos ? static_cast<size_t>(-1) : position;
+	}
+
+	// One row of a process list, shaped like the fields MainWindow indexes.
+	struct ProcessRow {
+		std::string Name;
+		DWORD ProcessId = 0;
+		std::wstring UserName;
+		std::wstring ImagePath;
+		std::wstring Description;
+		std::wstring Company;
+	};
+
+	std::vector<ProcessRow> MakeRows(size_t count) {
+		static const char* const names[] = { "svchost", "explorer", "chrome", "RuntimeBroker", "conhost", "MsMpEng", "dllhost", "SearchHost" };
+		static const wchar_t* const companies[] = { L"Microsoft Corporation", L"Google LLC", L"Mozilla Corporation", L"Contoso Ltd." };
+		static const wchar_t* const users[] = { L"NT AUTHORITY\\SYSTEM", L"NT AUTHORITY\\LOCAL SERVICE", L"DESKTOP-4F2K\\Alice" };
+
+		std::mt19937 random(26);
+		std::vector<ProcessRow> rows(count);
+		for (size_t i = 0; i < count; ++i) {
+			ProcessRow& row = rows[i];
+			const char* name = names[random() % 8];
+			row.Name = std::string(name) + std::to_string(i % 97) + ".exe";
+			row.ProcessId = static_cast<DWORD>(4 + i * 4);
+			row.UserName = users[random() % 3];
+			row.ImagePath = L"C:\\Program Files\\Vendor" + std::to_wstring(i % 31) + L"\\" + std::wstring(row.Name.begin(), row.Name.end());
+			row.Description = std::wstring(row.Name.begin(), row.Name.end() - 4) + L" Host Process";
+			row.Company = companies[random() % 4];
+		}
+		return rows;
+	}
+
+	void BuildIndex(const std::vector<ProcessRow>& rows, ProcessSearchIndex& index) {
+		index.Clear();
+		index.Reserve(rows.size(), rows.size() * 128);
+		for (const auto& row : rows) {
+			index.BeginRow();
+			index.AddField(row.Name);
+			index.AddField(std::to_wstring(row.ProcessId));
+			index.AddField(row.UserName);
+			index.AddField(row.ImagePath);
+			index.AddField(row.Description);
+			index.AddField(row.Company);
+		}
+	}
+
+	std::wstring Lower(std::wstring text) {
+		std::transform(text.begin(), text.end(), text.begin(), ::towlower);
+		return text;
+	}
+
+	// The filter before the index: lowercase copies of each field of each
+	// row on every keystroke, then one std::wstring::find per field.
+	size_t CountMatchesWithCopies(const std::vector<ProcessRow>& rows, const std::wstring& filter) {
+		std::wstring filterLower = Lower(filter);
+		size_t matches = 0;
+		for (const auto& row : rows) {
+			std::wstring name = Lower(std::wstring(row.Name.begin(), row.Name.end()));
+			std::wstring pid = Lower(std::to_wstring(row.ProcessId));
+			std::wstring user = Lower(row.UserName);
+			std::wstring path = Lower(row.ImagePath);
+			std::wstring description = Lower(row.Description);
+			std::wstring company = Lower(row.Company);
+			if (name.find(filterLower) != std::wstring::npos || pid.find(filterLower) != std::wstring::npos
+				|| user.find(filterLower) != std::wstring::npos || path.find(filterLower) != std::wstring::npos
+				|| description.find(filterLower) != std::wstring::npos || company.find(filterLower) != std::wstring::npos) {
+				++matches;
+			}
+		}
+		return matches;
+	}
+
+	// Every match of pattern in the packed text through one kernel, the way
+	// FindRows walks it, so each kernel can be timed on the same index.
+	size_t CountHits(const std::vector<wchar_t>& text, const std::wstring& pattern, FindFunction find) {
+		size_t hits = 0;
+		size_t start = 0;
+		while (start < text.size()) {
+			size_t hit = find(text.data() + start, text.size() - start, pattern.data(), pattern.size());
+			if (hit == static_cast<size_t>(-1)) {
+				break;
+			}
+			++hits;
+			start += hit + 1;
+		}
+		return hits;
+	}
+
+	void RunFilterBenchmark(size_t rowCount) {
+		std::vector<ProcessRow> rows = MakeRows(rowCount);
+		ProcessSearchIndex index;
+		std::printf(" %zu rows\n", rowCount);
+		// Paid once per snapshot rather than once per keystroke.
+		Measure("index build", rowCount, [&]() {
+			BuildIndex(rows, index);
+			KeepResult(index.GetRowCount());
+		});
+
+		// A common prefix, a rare word and a miss.
+		for (const wchar_t* text : { L"svc", L"mozilla", L"notepad++" }) {
+			std::wstring filter = text;
+			CHECK_EQUAL(CountMatchesWithCopies(rows, filter), index.FindRows(filter).size());
+
+			std::printf(" %zu rows, \"%s\"\n", rowCount, std::string(filter.begin(), filter.end()).c_str());
+			Measure("lowercase copies + wstring::find", rowCount, [&]() {
+				KeepResult(CountMatchesWithCopies(rows, filter));
+			});
+			Measure("index FindRows", rowCount, [&]() {
+				KeepResult(index.FindRows(filter).size());
+			});
+		}
+	}
+
+	void RunKernelBenchmark(size_t rowCount) {
+		std::vector<ProcessRow> rows = MakeRows(rowCount);
+		// The same packed text FindRows scans.
+		std::vector<wchar_t> text;
+		auto add = [&text](const std::wstring& field) {
+			std::wstring lower = Lower(field);
+			text.insert(text.end(), lower.begin(), lower.end());
+			text.push_back(L'\0');
+		};
+		for (const auto& row : rows) {
+			add(std::wstring(row.Name.begin(), row.Name.end()));
+			add(std::to_wstring(row.ProcessId));
+			add(row.UserName);
+			add(row.ImagePath);
+			add(row.Description);
+			add(row.Company);
+		}
+
+		for (const wchar_t* literal : { L"mozilla", L"notepad++" }) {
+			std::wstring pattern = literal;
+			std::printf(" %zu rows, %zu chars, \"%s\"\n", rowCount, text.size(), std::string(pattern.begin(), pattern.end()).c_str());
+			for (const auto& kernel : GetSupportedKernels()) {
+				Measure(kernel.Name, text.size(), [&]() {
+					KeepResult(CountHits(text, pattern, kernel.Find));
+				});
+			}
+		}
+	}
+
+}
+
+TEST_CASE(ProcessSearchIndex_KernelsMatchWstringFind) {
+	// Few distinct characters so partial matches are common, and lengths
+	// that cover each kernel's block loop and its tail.
+	std::mt19937 random(1);
+	std::vector<KernelEntry> kernels = GetSupportedKernels();
+	for (size_t length = 0; length < 80; ++length) {
+		std::wstring text(length, L'a');
+		for (auto& ch : text) {
+			ch = static_cast<wchar_t>(L'a' + random() % 3);
+		}
+		for (size_t patternLength = 1; patternLength <= 20; ++patternLength) {
+			std::wstring pattern(patternLength, L'a');
+			for (auto& ch : pattern) {
+				ch = static_cast<wchar_t>(L'a' + random() % 3);
+			}
+			// Also a pattern that occurs exactly at the end.
+			std::wstring suffix = length >= patternLength ? text.substr(length - patternLength) : pattern;
+			for (const std::wstring* p : { &pattern, &suffix }) {
+				size_t expected = Expected(text, *p);
+				for (const auto& kernel : kernels) {
+					CHECK_EQUAL(expected, kernel.Find(text.data(), text.size(), p->data(), p->size()));
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(ProcessSearchIndex_KernelsHandleWideCharacters) {
+	// Characters with the high bit set in either byte, which a signed
+	// compare or a byte-wise mask could confuse with their neighbours.
+	std::wstring text = L"\u0100\u00FF\uFFFF\u8000abc\u00FF\u0100\uFFFF\u8000";
+	text += text;
+	text += L"\uFFFE\u8001";
+	std::wstring needle = L"\uFFFE\u8001";
+	std::wstring missing = L"\u00FF\u00FF";
+	std::wstring single = L"\u8000";
+	for (const auto& kernel : GetSupportedKernels()) {
+		CHECK_EQUAL(Expected(text, needle), kernel.Find(text.data(), text.size(), needle.data(), needle.size()));
+		CHECK_EQUAL(Expected(text, missing), kernel.Find(text.data(), text.size(), missing.data(), missing.size()));
+		CHECK_EQUAL(Expected(text, single), kernel.Find(text.data(), text.size(), single.data(), single.size()));
+	}
+}
+
+TEST_CASE(ProcessSearchIndex_FindRowsReportsEachRowOnce) {
+	ProcessSearchIndex index;
+	index.BeginRow();
+	index.AddField(std::string("svchost.exe"));
+	index.AddField(L"SVCHOST service host");
+	index.BeginRow();
+	index.AddField(std::string("explorer.exe"));
+	index.AddField(L"Windows Explorer");
+	index.BeginRow();
+	index.AddField(std::string("SvcTool.exe"));
+
+	CHECK((index.FindRows(L"svc") == std::vector<size_t>{ 0, 2 }));
+	CHECK((index.FindRows(L"EXPLORER") == std::vector<size_t>{ 1 }));
+	CHECK(index.FindRows(L"notepad").empty());
+	CHECK_EQUAL(3u, index.FindRows(L"").size());
+}
+
+TEST_CASE(ProcessSearchIndex_FindRowsDoesNotMatchAcrossFields) {
+	ProcessSearchIndex index;
+	index.BeginRow();
+	index.AddField(L"abc");
+	index.AddField(L"def");
+	index.BeginRow();
+	index.AddField(L"cd");
+
+	CHECK((index.FindRows(L"cd") == std::vector<size_t>{ 1 }));
+	CHECK(index.FindRows(L"abcdef").empty());
+	CHECK(index.FindRows(std::wstring(L"c\0d", 3)).empty());
+}
+
+BENCHMARK_CASE(ProcessSearchIndex_Filter10k) {
+	RunFilterBenchmark(10000);
+}
+
+BENCHMARK_CASE(ProcessSearchIndex_Filter100k) {
+	RunFilterBenchmark(100000);
+}
+
+BENCHMARK_CASE(ProcessSearchIndex_Kernels10k) {
+	RunKernelBenchmark(10000);
+}
+
+BENCHMARK_CASE(ProcessSearchIndex_Kernels100k) {
+	RunKernelBenchmark(100000);
+}
@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+#include "core/RefreshScheduler.h"
+
+using namespace WinProcessInspector::Core;
+
+namespace {
+
+	// Simulated wall clock and tool CPU time, both in milliseconds.
+	struct FakeClock {
+		ULONGLONG Now = 1000000;
+		ULONGLONG CpuTimeMs = 0;
+
+		void Advance(ULONGLONG ms) { Now += ms; }
+	};
+
+	// A refresh that finishes at the current time and cost costMs of CPU.
+	void Refresh(RefreshScheduler& scheduler, FakeClock& clock, ULONGLONG costMs) {
+		clock.CpuTimeMs += costMs;
+		scheduler.OnRefreshCompleted(clock.Now, clock.CpuTimeMs);
+	}
+
+	RefreshScheduler MakeActiveScheduler(const FakeClock& clock) {
+		RefreshScheduler scheduler;
+		scheduler.SetLastInputTime(clock.Now);
+		return scheduler;
+	}
+
+}
+
+TEST_CASE(RefreshScheduler_FirstRefreshIsDueImmediately) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	CHECK_EQUAL(0u, scheduler.GetDelay(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_DelayCountsDownFromLastRefresh) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	Refresh(scheduler, clock, 0);
+
+	CHECK_EQUAL(2000u, scheduler.GetInterval(clock.Now));
+	CHECK_EQUAL(2000u, scheduler.GetDelay(clock.Now));
+	clock.Advance(500);
+	CHECK_EQUAL(1500u, scheduler.GetDelay(clock.Now));
+	clock.Advance(1500);
+	CHECK_EQUAL(0u, scheduler.GetDelay(clock.Now));
+	clock.Advance(10000);
+	CHECK_EQUAL(0u, scheduler.GetDelay(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_WatchingRefreshesFaster) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	scheduler.SetWatching(true);
+	Refresh(scheduler, clock, 0);
+
+	CHECK_EQUAL(1000u, scheduler.GetInterval(clock.Now));
+	CHECK_EQUAL(1000u, scheduler.GetDelay(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_BacksOffWhenIdle) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	scheduler.SetWatching(true);
+	Refresh(scheduler, clock, 0);
+
+	clock.Advance(59999);
+	CHECK_EQUAL(1000u, scheduler.GetInterval(clock.Now));
+	clock.Advance(1);
+	CHECK_EQUAL(5000u, scheduler.GetInterval(clock.Now));
+
+	// Input resets the idle timer.
+	scheduler.SetLastInputTime(clock.Now);
+	CHECK_EQUAL(1000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_InputAfterNowIsNotIdle) {
+	FakeClock clock;
+	RefreshScheduler scheduler;
+	scheduler.SetLastInputTime(clock.Now + 100000);
+	CHECK_EQUAL(2000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_HiddenOverridesOtherStates) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	scheduler.SetWatching(true);
+	scheduler.SetVisible(false);
+	Refresh(scheduler, clock, 0);
+
+	CHECK_EQUAL(15000u, scheduler.GetInterval(clock.Now));
+	clock.Advance(120000);
+	CHECK_EQUAL(15000u, scheduler.GetInterval(clock.Now));
+
+	scheduler.SetVisible(true);
+	CHECK_EQUAL(5000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_CheapRefreshesStayOnStateInterval) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	for (int i = 0; i < 10; ++i) {
+		Refresh(scheduler, clock, 5);
+		clock.Advance(scheduler.GetDelay(clock.Now));
+		scheduler.SetLastInputTime(clock.Now);
+	}
+
+	// 5 ms a cycle at 1% of a core allows a refresh every 500 ms.
+	CHECK(scheduler.GetAverageCostMs() > 4.99 && scheduler.GetAverageCostMs() < 5.01);
+	CHECK(!scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(2000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_ExpensiveRefreshesStretchInterval) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	// The first refresh has no previous CPU time to measure against.
+	Refresh(scheduler, clock, 400);
+	CHECK_EQUAL(0.0, scheduler.GetAverageCostMs());
+	CHECK(!scheduler.IsBudgetLimited(clock.Now));
+
+	clock.Advance(2000);
+	Refresh(scheduler, clock, 50);
+	CHECK(scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(5000u, scheduler.GetInterval(clock.Now));
+	CHECK_EQUAL(5000u, scheduler.GetDelay(clock.Now));
+
+	// The newest cycle weighs 30%: 50 + 0.3 * (10 - 50) = 38 ms.
+	clock.Advance(5000);
+	Refresh(scheduler, clock, 10);
+	CHECK_EQUAL(3800u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_BudgetFollowsSettings) {
+	FakeClock clock;
+	RefreshSchedulerSettings settings;
+	settings.CpuBudget = 0.05;
+	RefreshScheduler scheduler(settings);
+	scheduler.SetLastInputTime(clock.Now);
+	Refresh(scheduler, clock, 0);
+	clock.Advance(2000);
+	Refresh(scheduler, clock, 50);
+
+	CHECK(!scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(2000u, scheduler.GetInterval(clock.Now));
+
+	settings.CpuBudget = 0.0;
+	scheduler.SetSettings(settings);
+	CHECK(!scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(2000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_IntervalIsClamped) {
+	FakeClock clock;
+	RefreshSchedulerSettings settings;
+	settings.WatchingIntervalMs = 100;
+	RefreshScheduler scheduler(settings);
+	scheduler.SetLastInputTime(clock.Now);
+	scheduler.SetWatching(true);
+	Refresh(scheduler, clock, 0);
+	CHECK_EQUAL(500u, scheduler.GetInterval(clock.Now));
+
+	// 2 s of CPU a cycle would need 200 s between refreshes.
+	clock.Advance(500);
+	Refresh(scheduler, clock, 2000);
+	CHECK(scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(60000u, scheduler.GetInterval(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_CpuTimeGoingBackIsIgnored) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	Refresh(scheduler, clock, 0);
+	clock.Advance(2000);
+	Refresh(scheduler, clock, 30);
+	double cost = scheduler.GetAverageCostMs();
+
+	clock.Advance(3000);
+	clock.CpuTimeMs -= 20;
+	scheduler.OnRefreshCompleted(clock.Now, clock.CpuTimeMs);
+	CHECK_EQUAL(cost, scheduler.GetAverageCostMs());
+	CHECK_EQUAL(3000u, scheduler.GetDelay(clock.Now));
+}
+
+TEST_CASE(RefreshScheduler_ResetForgetsHistory) {
+	FakeClock clock;
+	RefreshScheduler scheduler = MakeActiveScheduler(clock);
+	Refresh(scheduler, clock, 0);
+	clock.Advance(2000);
+	Refresh(scheduler, clock, 100);
+	CHECK(scheduler.IsBudgetLimited(clock.Now));
+
+	scheduler.Reset();
+	CHECK_EQUAL(0.0, scheduler.GetAverageCostMs());
+	CHECK(!scheduler.IsBudgetLimited(clock.Now));
+	CHECK_EQUAL(0u, scheduler.GetDelay(clock.Now));
+}
@@ -0,0 +1,258 @@
+#include "TestFramework.h"
+#include "core/SignatureScanner.h"
+#include "core/MemoryImageFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace WinProcessInspector::Core;
+using namespace WinProcessInspector::Tests;
+
+namespace {
+
+	// fixtures/images/signatures.bin is 0x22000 bytes of pseudo-random data
+	// with the patterns of signatures.txt planted at these offsets. Two of
+	// them straddle the 64 KB chunk boundaries and the last one ends at the
+	// end of the file.
+	const ULONG_PTR ImageBase = 0x10000000;
+	const ULONGLONG ImageSize = 0x22000;
+
+	struct ExpectedMatch {
+		const wchar_t* Pattern;
+		ULONG_PTR Offset;
+	};
+
+	const ExpectedMatch FixtureMatches[] = {
+		{ L"mz-stub", 0x100 },
+		{ L"c2-host", 0x2345 },
+		{ L"mutex", 0x5000 },
+		{ L"c2-host", 0xFFF0 },
+		{ L"beacon-cfg", 0x1FFF8 },
+		{ L"shellcode", 0x21FF6 },
+	};
+
+	bool LoadFixturePatterns(SignatureScanner& scanner) {
+		std::vector<SignaturePattern> patterns;
+		return SignatureScanner::LoadPatterns(GetFixturePath(L"images/signatures.txt"), patterns) && scanner.Compile(patterns);
+	}
+
+	std::vector<SignatureMatch> ScanAll(const SignatureScanner& scanner, const MemoryReadFunction& read,
+		const std::vector<MemoryRegionInfo>& regions, const SignatureScanOptions& options, SignatureScanStatistics* statistics = nullptr) {
+		std::vector<SignatureMatch> matches;
+		SignatureScanStatistics result = scanner.Scan(read, regions, options, [&matches](std::vector<SignatureMatch>& batch) {
+			matches.insert(matches.end(), batch.begin(), batch.end());
+		});
+		if (statistics) {
+			*statistics = result;
+		}
+		std::sort(matches.begin(), matches.end(), [](const SignatureMatch& a, const SignatureMatch& b) {
+			return a.Address != b.Address ? a.Address < b.Address : a.PatternIndex < b.PatternIndex;
+		});
+		return matches;
+	}
+
+	void CheckFixtureMatches(const SignatureScanner& scanner, const std::vector<SignatureMatch>& matches) {
+		REQUIRE(matches.size() == _countof(FixtureMatches));
+		for (size_t i = 0; i < matches.size(); ++i) {
+			CHECK_EQUAL(ImageBase + FixtureMatches[i].Offset, matches[i].Address);
+			CHECK(scanner.GetPatterns()[matches[i].PatternIndex].Name == FixtureMatches[i].Pattern);
+		}
+	}
+
+	// Writes size bytes of random data to a temporary file with every
+	// pattern planted count times, for the throughput benchmark.
+	std::wstring WriteBenchmarkImage(const std::vector<SignaturePattern>& patterns, size_t size, size_t count) {
+		std::mt19937 random(46);
+		std::vector<BYTE> data(size);
+		for (auto& byte : data) {
+			byte = static_cast<BYTE>(random());
+		}
+		for (size_t i = 0; i < count; ++i) {
+			for (const auto& pattern : patterns) {
+				size_t offset = random() % (size - pattern.Bytes.size());
+				for (size_t j = 0; j < pattern.Bytes.size(); ++j) {
+					if (pattern.Mask[j]) {
+						data[offset + j] = pattern.Bytes[j];
+					}
+				}
+			}
+		}
+
+		std::wstring path = GetTempPath(L"signatures-bench.bin");
+		std::ofstream file(std::filesystem::path(path), std::ios::binary);
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return file ? path : std::wstring();
+	}
+
+}
+
+TEST_CASE(SignatureScanner_ParsePattern) {
+	SignaturePattern pattern;
+	REQUIRE(SignatureScanner::ParsePattern(L"stub: 4D 5A ?? 00", pattern));
+	CHECK(pattern.Name == L"stub");
+	CHECK((pattern.Bytes == std::vector<BYTE>{ 0x4D, 0x5A, 0x00, 0x00 }));
+	CHECK((pattern.Mask == std::vector<BYTE>{ 0xFF, 0xFF, 0x00, 0xFF }));
+
+	REQUIRE(SignatureScanner::ParsePattern(L"host: \"a\\x41\\\"\"", pattern));
+	CHECK((pattern.Bytes == std::vector<BYTE>{ 'a', 0x41, '"' }));
+
+	REQUIRE(SignatureScanner::ParsePattern(L"wide: u\"ab\"", pattern));
+	CHECK((pattern.Bytes == std::vector<BYTE>{ 'a', 0, 'b', 0 }));
+
+	CHECK(!SignatureScanner::ParsePattern(L"no colon 4D 5A", pattern));
+	CHECK(!SignatureScanner::ParsePattern(L": 4D 5A", pattern));
+	CHECK(!SignatureScanner::ParsePattern(L"empty:", pattern));
+}
+
+TEST_CASE(SignatureScanner_CompileRejectsAllWildcards) {
+	SignaturePattern pattern;
+	REQUIRE(SignatureScanner::ParsePattern(L"wild: ?? ??", pattern));
+	SignatureScanner scanner;
+	CHECK(!scanner.Compile({ pattern }));
+	CHECK(!scanner.IsCompiled());
+	CHECK(!scanner.Compile({}));
+}
+
+TEST_CASE(SignatureScanner_ScanBufferRespectsReportLimit) {
+	SignaturePattern pattern;
+	REQUIRE(SignatureScanner::ParsePattern(L"p: 11 ?? 33", pattern));
+	SignatureScanner scanner;
+	REQUIRE(scanner.Compile({ pattern }));
+
+	const BYTE data[] = { 0x11, 0x22, 0x33, 0x00, 0x11, 0xFF, 0x33, 0x11, 0x00 };
+	std::vector<SignatureMatch> matches;
+	scanner.ScanBuffer(data, sizeof(data), sizeof(data), 0x1000, matches);
+	REQUIRE(matches.size() == 2);
+	CHECK_EQUAL(0x1000u, matches[0].Address);
+	CHECK_EQUAL(0x1004u, matches[1].Address);
+
+	// A match starting at or past the limit belongs to the next chunk.
+	matches.clear();
+	scanner.ScanBuffer(data, sizeof(data), 4, 0x1000, matches);
+	CHECK_EQUAL(1u, matches.size());
+}
+
+TEST_CASE(MemoryImageFile_ReadsAtBaseAddress) {
+	MemoryImageFile image;
+	REQUIRE(image.Open(GetFixturePath(L"images/signatures.bin"), ImageBase));
+	CHECK_EQUAL(ImageSize, image.GetSize());
+
+	std::vector<MemoryRegionInfo> regions = image.GetRegions();
+	REQUIRE(regions.size() == 1);
+	CHECK_EQUAL(ImageBase, regions[0].BaseAddress);
+	CHECK_EQUAL(ImageSize, static_cast<ULONGLONG>(regions[0].RegionSize));
+	CHECK(MemoryManager::IsReadable(regions[0], false));
+
+	BYTE bytes[4] = {};
+	REQUIRE(image.Read(ImageBase + 0x100, bytes, sizeof(bytes)));
+	CHECK(bytes[0] == 0x4D && bytes[1] == 0x5A && bytes[2] == 0x90 && bytes[3] == 0x00);
+
+	// Past the end reads as zeros; wholly outside fails. The file ends with
+	// the last four bytes of the shellcode pattern.
+	BYTE tail[16];
+	std::fill(tail, tail + sizeof(tail), static_cast<BYTE>(0xCC));
+	REQUIRE(image.Read(ImageBase + static_cast<ULONG_PTR>(ImageSize) - 4, tail, sizeof(tail)));
+	CHECK(tail[0] == 0x7F && tail[1] == 0x00 && tail[3] == 0x00);
+	CHECK(std::count(tail + 4, tail + sizeof(tail), static_cast<BYTE>(0)) == 12);
+	CHECK(!image.Read(ImageBase - 1, bytes, sizeof(bytes)));
+	CHECK(!image.Read(ImageBase + static_cast<ULONG_PTR>(ImageSize), bytes, sizeof(bytes)));
+
+	CHECK(!MemoryImageFile().Open(GetFixturePath(L"images/missing.bin")));
+}
+
+TEST_CASE(SignatureScanner_ScansFixtureImage) {
+	SignatureScanner scanner;
+	REQUIRE(LoadFixturePatterns(scanner));
+	CHECK_EQUAL(6u, scanner.GetPatterns().size());
+
+	MemoryImageFile image;
+	REQUIRE(image.Open(GetFixturePath(L"images/signatures.bin"), ImageBase));
+
+	// The smallest chunks, so matches across chunk boundaries are found by
+	// the chunk they start in, with one worker and with several.
+	for (size_t workers : { 1, 4 }) {
+		SignatureScanOptions options;
+		options.ChunkSize = 64 * 1024;
+		options.WorkerCount = workers;
+		SignatureScanStatistics statistics;
+		std::vector<SignatureMatch> matches = ScanAll(scanner, image.GetReadFunction(), image.GetRegions(), options, &statistics);
+		CheckFixtureMatches(scanner, matches);
+		CHECK_EQUAL(1u, statistics.Regions);
+		CHECK_EQUAL(ImageSize, statistics.BytesScanned);
+		CHECK_EQUAL(matches.size(), statistics.Matches);
+		CHECK(!statistics.Truncated);
+	}
+}
+
+TEST_CASE(SignatureScanner_ScanStopsAtMaxResults) {
+	SignatureScanner scanner;
+	REQUIRE(LoadFixturePatterns(scanner));
+	MemoryImageFile image;
+	REQUIRE(image.Open(GetFixturePath(L"images/signatures.bin"), ImageBase));
+
+	SignatureScanOptions options;
+	options.WorkerCount = 1;
+	options.MaxResults = 2;
+	SignatureScanStatistics statistics;
+	std::vector<SignatureMatch> matches = ScanAll(scanner, image.GetReadFunction(), image.GetRegions(), options, &statistics);
+	CHECK_EQUAL(2u, matches.size());
+	CHECK_EQUAL(2u, statistics.Matches);
+	CHECK(statistics.Truncated);
+}
+
+TEST_CASE(SignatureScanner_ScanSkipsUnreadableRegions) {
+	SignatureScanner scanner;
+	REQUIRE(LoadFixturePatterns(scanner));
+	MemoryImageFile image;
+	REQUIRE(image.Open(GetFixturePath(L"images/signatures.bin"), ImageBase));
+
+	std::vector<MemoryRegionInfo> regions = image.GetRegions();
+	regions[0].Protect = PAGE_NOACCESS;
+	SignatureScanStatistics statistics;
+	CHECK(ScanAll(scanner, image.GetReadFunction(), regions, SignatureScanOptions(), &statistics).empty());
+	CHECK_EQUAL(0u, statistics.Regions);
+
+	// Images are skipped unless asked for.
+	regions[0].Protect = PAGE_READONLY;
+	regions[0].Type = MemoryType::Image;
+	SignatureScanOptions options;
+	options.IncludeImages = false;
+	CHECK(ScanAll(scanner, image.GetReadFunction(), regions, options).empty());
+	options.IncludeImages = true;
+	CHECK_EQUAL(_countof(FixtureMatches), ScanAll(scanner, image.GetReadFunction(), regions, options).size());
+}
+
+BENCHMARK_CASE(SignatureScanner_FileImageThroughput) {
+	// The fixture patterns plus 200 indicator strings, over a 256 MB image
+	// read from a file, as an incident-response sweep would run them.
+	std::vector<SignaturePattern> patterns;
+	REQUIRE(SignatureScanner::LoadPatterns(GetFixturePath(L"images/signatures.txt"), patterns));
+	for (size_t i = 0; i < 200; ++i) {
+		SignaturePattern pattern;
+		REQUIRE(SignatureScanner::ParsePattern(L"ioc" + std::to_wstring(i) + L": \"ioc-" + std::to_wstring(i * 7919) + L".example.net\"", pattern));
+		patterns.push_back(pattern);
+	}
+	SignatureScanner scanner;
+	REQUIRE(scanner.Compile(patterns));
+
+	const size_t size = 256 * 1024 * 1024;
+	std::wstring path = WriteBenchmarkImage(patterns, size, 4);
+	MemoryImageFile image;
+	REQUIRE(!path.empty() && image.Open(path, ImageBase));
+	std::printf(" %zu patterns, %zu automaton states, %zu MB image\n", patterns.size(), scanner.GetStateCount(), size >> 20);
+
+	for (size_t workers : { 1, 0 }) {
+		SignatureScanOptions options;
+		options.WorkerCount = workers;
+		SignatureScanStatistics statistics;
+		char label[64];
+		std::snprintf(label, sizeof(label), "Scan, %s", workers == 1 ? "one worker" : "one worker per core");
+		Measure(label, size, [&]() {
+			KeepResult(ScanAll(scanner, image.GetReadFunction(), image.GetRegions(), options, &statistics).size());
+		});
+		std::printf("  %-48s %12.2f GB/s  (%zu matches)\n", "as reported by Scan", statistics.GetGigabytesPerSecond(), statistics.Matches);
+	}
+}